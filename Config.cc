@@ -5,10 +5,33 @@ namespace Config
   int nTracks = 10000;
   int nEvents = 20;
 
+  int nLayers = 10;
+  int nTotHit = 10;
+
+  float fEtaDet = 1;
+
+  std::vector<float> g_layer_zwidth;
+  std::vector<float> g_layer_dz;
+
+  float m_max_dz   = 1;
+  float m_max_dphi = 0.02;
+
+  float chi2Cut = 15.;
+  float minDPhi = 0.;
+  float minDZ   = 0.;
+
   // Dependent constants, assigned after processing of commandline options
   int maxHitsPerBunch;
   int maxCandsPerEtaBin;
 
+  float fEtaFull;
+  float lEtaPart;
+  float lEtaBin;
+  float fEtaOffB1;
+  float fEtaFacB1;
+  float fEtaOffB2;
+  float fEtaFacB2;
+
   // Multi threading and Clone engine configuration
   int   numThreadsFinder = 1;
   
@@ -27,14 +50,23 @@ namespace Config
 
   int   nlayers_per_seed = 3; // default is 3 for barrel seeding --> will need a new variable once we move to endcap seeding
   int   numSeedsPerTask = 32;
+  int   numBatchesInterleaved = 1;
+  int   fitVecWidth = 0;
+  int   buildVecWidth = 0;
+  bool  useHitMajorChi2 = false;
   
   // number of hits per task for finding seeds
   int   numHitsPerTask = 32;
 
   bool  useCMSGeom = false;
   bool  readCmsswSeeds = false;
+  bool  useFieldMap = false;
 
   bool  findSeeds   = false;
+  bool  cleanSeeds     = false;
+  float seedCleanDEta  = 0.01;
+  float seedCleanDPhi  = 0.005;
+  float seedCleanDCurv = 0.001;
   bool  endcapTest = false;
 
   bool  cf_seeding  = false;
@@ -49,5 +81,54 @@ namespace Config
   {
     maxCandsPerEtaBin = std::max(100, maxCandsPerSeed * (nTracks+100) / nEtaPart);
     maxHitsPerBunch   = std::max(100, nTracks * 12 / 10 / nEtaPart) + maxHitsConsidered;
+
+    fEtaFull  = 2 * fEtaDet;
+    lEtaPart  = fEtaFull / float(nEtaPart);
+    lEtaBin   = lEtaPart / 2.;
+    fEtaOffB1 = fEtaDet;
+    fEtaFacB1 = nEtaPart / fEtaFull;
+    fEtaOffB2 = fEtaDet - fEtaFull / (2 * nEtaPart);
+    fEtaFacB2 = (nEtaPart > 1 ? (nEtaPart - 1) / (fEtaFull - fEtaFull / nEtaPart) : 1);
+  }
+
+  namespace
+  {
+    const float toy_layer_zwidth[] = { 10, 14, 18, 23, 28, 32, 37, 42, 48, 52 };
+    const float toy_layer_dz[]     = { 0.6, 0.55, 0.5, 0.5, 0.45, 0.4, 0.4, 0.4, 0.35, 0.35 };
+
+    const float cms_layer_zwidth[] = { 30, 30, 30, 70, 70, 70, 70, 70, 70, 110, 110, 110, 110, 110, 110, 110, 110 };
+    const float cms_layer_dz[]     = { 1, 1, 1, 20, 20, 20, 20, 20, 20, 20, 20, 20, 20, 20, 20, 20, 20 };
+
+    template<int N>
+    constexpr int n_entries(const float (&)[N]) { return N; }
+  }
+
+  bool SetupLayers()
+  {
+    int n_geom = nMaxLayers;
+    if (useCMSGeom) n_geom = endcapTest ? n_entries(cmsAvgZs) : n_entries(cmsAvgRads);
+
+    if (nLayers <= nlayers_per_seed || nLayers > nMaxLayers || nLayers > n_geom)
+    {
+      return false;
+    }
+
+    // Toy layers past the end of the table keep the outermost values.
+    const float *zwidth = useCMSGeom ? cms_layer_zwidth : toy_layer_zwidth;
+    const float *dz     = useCMSGeom ? cms_layer_dz     : toy_layer_dz;
+    const int    n_tab  = useCMSGeom ? n_entries(cms_layer_zwidth) : n_entries(toy_layer_zwidth);
+
+    g_layer_zwidth.resize(nLayers);
+    g_layer_dz    .resize(nLayers);
+
+    for (int i = 0; i < nLayers; ++i)
+    {
+      g_layer_zwidth[i] = zwidth[std::min(i, n_tab - 1)];
+      g_layer_dz[i]     = dz    [std::min(i, n_tab - 1)];
+    }
+
+    nTotHit = nLayers;
+
+    return true;
   }
 }
@@ -4,6 +4,7 @@
 #include <algorithm>
 #include <cmath>
 #include <string> // won't compile on clang gcc for mac OS w/o this!
+#include <vector>
 
 //#define PRINTOUTS_FOR_PLOTS
 #define CCSCOORD
@@ -33,12 +34,17 @@ namespace Config
   extern int nEvents;
 
   // config on main -- for geometry
-  constexpr int   nLayers   = 10; // default: 10; cmssw tests: 13, 17, 26 (for endcap)
+  // nLayers is chosen at run time (--num-layers), default: 10; cmssw tests: 13, 17, 26 (for endcap).
+  // Per-layer storage is allocated for nLayers, except for the hit index
+  // array in Track -- Tracks are written to files and copied to the GPU as
+  // raw bytes, so it has the fixed size of the largest geometry.
+  constexpr int   nMaxLayers = 26;
+  extern    int   nLayers;
   constexpr float fRadialSpacing   = 4.;
   constexpr float fRadialExtent    = 0.01;
   constexpr float fInnerSensorSize = 5.0; // approximate sensor size in cm
   constexpr float fOuterSensorSize = Config::fInnerSensorSize * 2.;
-  constexpr float fEtaDet          = 1; // default: 1; cmssw tests: 2, 2.5
+  extern    float fEtaDet; // default: 1; cmssw tests: 2, 2.5 (--eta-det)
 
   //constexpr float cmsAvgRads[13] = {4.42,7.31,10.17,25.58,33.98,41.79,49.78,60.78,69.2,77.96,86.80,96.53,108.00}; // cms average radii, noSplit version
   constexpr float cmsAvgRads[17] = {4.42,7.31,10.17,25.58,25.58,33.98,33.98,41.79,49.78,60.57,61.00,69.41,68.98,77.96,86.80,96.53,108.00}; // cms average radii, split version
@@ -51,25 +57,24 @@ namespace Config
   constexpr float cmsDiskMaxRsHole[26] = {999.,999.,999.,999.,999.,999., 999., 999., 59.9, 999., 59.9, 999., 59.9, 999., 59.7, 999., 59.7, 999., 59.7, 999., 999., 999., 999., 999., 999., 999.};
   const     float g_disk_dr[]        = {   1,   1,  20,  20,  20,  20,   20,   20,   20,   20,   20,   20,   20,   20,   20,   20,   20,   20,   20,   20,   20,   20,   20,   20,   20,   20};
 
-  const float g_layer_zwidth[] = { 10, 14, 18, 23, 28, 32, 37, 42, 48, 52 }; //default
-  const float g_layer_dz[]     = { 0.6, 0.55, 0.5, 0.5, 0.45, 0.4, 0.4, 0.4, 0.35, 0.35 }; //default
-
-  /* const float g_layer_zwidth[] = { 30, 30, 30, 70, 70, 70, 70, 70, 70, 110, 110, 110, 110, 110, 110, 110, 110 }; //cmssw tests */
-  /* const float g_layer_dz[] = { 1, 1, 1, 20, 20, 20, 20, 20, 20, 20, 20, 20, 20, 20, 20, 20, 20 }; //cmssw tests */
+  // z extent and z bin size of the barrel LayerOfHits, filled by SetupLayers()
+  // from the toy or the cmssw table depending on useCMSGeom.
+  extern std::vector<float> g_layer_zwidth;
+  extern std::vector<float> g_layer_dz;
 
   // These could be parameters, layer dependent.
   static constexpr int   m_nphi = 1024;
-  static constexpr float m_max_dz   = 1; // default: 1; cmssw tests: 20
-  static constexpr float m_max_dphi = 0.02; // default: 0.02; cmssw tests: 0.2
+  extern float m_max_dz;   // default: 1; cmssw tests: 20 (--max-dz)
+  extern float m_max_dphi; // default: 0.02; cmssw tests: 0.2 (--max-dphi)
 
   // config on Event
-  constexpr float chi2Cut = 15.;// default: 15.; cmssw tests: 30.
+  extern    float chi2Cut; // default: 15.; cmssw tests: 30. (--chi2-cut)
   constexpr float nSigma  = 3.;
-  constexpr float minDPhi = 0.;// default: 0.;  cmssw tests: 0.01;
+  extern    float minDPhi; // default: 0.;  cmssw tests: 0.01 (--min-dphi)
   constexpr float maxDPhi = Config::PI;
   constexpr float minDEta = 0.;
   constexpr float maxDEta = 1.0;
-  constexpr float minDZ = 0.; // default: 0.; cmssw tests: 10.;
+  extern    float minDZ;   // default: 0.; cmssw tests: 10. (--min-dz)
 
   // Configuration for simulation info
   //CMS beam spot width 25um in xy and 5cm in z 
@@ -89,7 +94,7 @@ namespace Config
   constexpr float varZ        = Config::hitposerrZ  * Config::hitposerrZ;
   constexpr float varR        = Config::hitposerrR  * Config::hitposerrR;
 
-  constexpr int nTotHit = Config::nLayers; // for now one hit per layer for sim
+  extern int nTotHit; // for now one hit per layer for sim, set by SetupLayers()
 
   // scattering simulation
   constexpr float X0 = 9.370; // cm, from http://pdg.lbl.gov/2014/AtomicNuclearProperties/HTML/silicon_Si.html // Pb = 0.5612 cm
@@ -110,9 +115,28 @@ namespace Config
   extern bool cf_seeding;
   extern bool findSeeds;
 
+  // Cleaning of road search seeds before the seed fit (--clean-seeds). Seeds
+  // are ranked by d0 and the z residual of the middle hit, a seed is dropped
+  // if a better kept one shares two of its hits and is within seedCleanDEta /
+  // DPhi / DCurv.
+  extern bool  cleanSeeds;
+  extern float seedCleanDEta;
+  extern float seedCleanDPhi;
+  extern float seedCleanDCurv; // 1/cm
+
   // Config for propagation
   constexpr int Niter = 5;
   constexpr bool useTrigApprox = true;
+  // Matriplex propagation to R: closed-form intersection instead of Niter steps.
+  // Slots ending with |cos| of the angle between position and momentum below
+  // analyticHelixMinCosDir graze r, there the iterative steps are used.
+  constexpr bool useAnalyticHelixAtR = true;
+  constexpr float analyticHelixMinCosDir = 0.05f;
+  // Cartesian parameters (CCSCOORD not defined) only: run the Kalman update
+  // through CCS, converting parameters and errors there and back (true), or
+  // directly on the cartesian state (false). The measurement projects out
+  // x, y, z, which are the same in both, so the two agree to first order.
+  constexpr bool updateViaCCS = false;
 
   // Config for Bfield
   constexpr float Bfield = 3.8112;
@@ -130,13 +154,14 @@ namespace Config
   constexpr int   nEtaPart   = 11;  // 1 is better for GPU best_hit
   constexpr int   nEtaBin    = 2 * nEtaPart - 1;
 
-  constexpr float        fEtaFull  = 2 * Config::fEtaDet;
-  constexpr float        lEtaPart  = Config::fEtaFull/float(Config::nEtaPart);
-  constexpr float        lEtaBin   = Config::lEtaPart/2.;
-  constexpr float        fEtaOffB1 = Config::fEtaDet;
-  constexpr float        fEtaFacB1 = Config::nEtaPart / Config::fEtaFull;
-  constexpr float        fEtaOffB2 = Config::fEtaDet - Config::fEtaFull / (2 * Config::nEtaPart);
-  constexpr float        fEtaFacB2 = (Config::nEtaPart>1 ? (Config::nEtaPart - 1) / (Config::fEtaFull - Config::fEtaFull / Config::nEtaPart) : 1);
+  // Eta binning derived from fEtaDet, set by RecalculateDependentConstants().
+  extern float fEtaFull;
+  extern float lEtaPart;
+  extern float lEtaBin;
+  extern float fEtaOffB1;
+  extern float fEtaFacB1;
+  extern float fEtaOffB2;
+  extern float fEtaFacB2;
 
   // This is for extra bins narrower ... thinking about this some more it
   // seems it would be even better to have two more exta bins, hanging off at
@@ -190,12 +215,33 @@ namespace Config
 
   extern int    numSeedsPerTask;
 
+  // Number of MkFitter batches a building task keeps in flight. Hit-window
+  // selection and hit prefetching for one batch is done while the previous
+  // one is being crunched, hiding part of the hit-gather latency.
+  constexpr int maxBatchesInterleaved = 4;
+  extern int    numBatchesInterleaved;
+
+  // Matriplex width used for seed / track fitting and for track building
+  // (best-hit, standard and clone-engine); 0 means the compiled-in NN. mkFit sets both at startup, to
+  // --vec-width or the widest width the cpu can run (select_vec_widths()).
+  // Only widths listed in MPLEX_FOR_EACH_WIDTH are instantiated.
+  extern int    fitVecWidth;
+  extern int    buildVecWidth;
+
+  // Allow chi2 of a candidate vs. its whole hit window to be computed in one
+  // Matriplex pass (hits in the plex dimension) when this needs fewer passes
+  // than the usual one-hit-per-candidate loop.
+  extern bool   useHitMajorChi2;
+
   // number of layer1 hits for finding seeds per task
   extern int    numHitsPerTask;
   
   extern bool   useCMSGeom;
   extern bool   readCmsswSeeds;
 
+  // propagation with useParamBfield takes Bz from g_field_map (FieldMap.h)
+  extern bool   useFieldMap;
+
   extern bool   endcapTest;
 
   const std::string inputFile = "cmssw.simtracks.SingleMu1GeV.10k.new.txt";
@@ -204,6 +250,11 @@ namespace Config
   //const std::string inputFile = "cmssw.rectracks.SingleMu10GeV.10k.new.txt";
 
   void RecalculateDependentConstants();
+
+  // Fills the per-layer tables for nLayers, to be called after nLayers,
+  // useCMSGeom and endcapTest are set. Returns false if the geometry does not
+  // describe that many layers.
+  bool SetupLayers();
   
   inline float BfieldFromZR(const float z, const float r)
   {
@@ -215,6 +266,8 @@ namespace Config
   #ifndef MPT_SIZE
     #ifdef __MIC__
       #define MPT_SIZE 16
+    #elif defined(__AVX512F__)
+      #define MPT_SIZE 16
     #elif defined USE_CUDA
       #define MPT_SIZE 8
     #else
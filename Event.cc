@@ -14,6 +14,39 @@
 #include "tbb/tbb.h"
 #endif
 
+namespace
+{
+  void write_tracks(FILE *fp, const TrackVec& tracks)
+  {
+    if (Config::nLayers == Config::nMaxLayers)
+    {
+      fwrite(&tracks[0], sizeof(Track), tracks.size(), fp);
+      return;
+    }
+    std::vector<char> buf(Track::fileSize() * tracks.size());
+    for (size_t i = 0; i < tracks.size(); ++i)
+    {
+      tracks[i].toFileBytes(&buf[i * Track::fileSize()]);
+    }
+    fwrite(&buf[0], Track::fileSize(), tracks.size(), fp);
+  }
+
+  void read_tracks(FILE *fp, TrackVec& tracks)
+  {
+    if (Config::nLayers == Config::nMaxLayers)
+    {
+      fread(&tracks[0], sizeof(Track), tracks.size(), fp);
+      return;
+    }
+    std::vector<char> buf(Track::fileSize() * tracks.size());
+    fread(&buf[0], Track::fileSize(), tracks.size(), fp);
+    for (size_t i = 0; i < tracks.size(); ++i)
+    {
+      tracks[i].fromFileBytes(&buf[i * Track::fileSize()]);
+    }
+  }
+}
+
 inline bool sortByPhi(const Hit& hit1, const Hit& hit2)
 {
   return hit1.phi()<hit2.phi();
@@ -326,7 +359,7 @@ void Event::write_out(FILE *fp)
 
   int nt = simTracks_.size();
   fwrite(&nt, sizeof(int), 1, fp);
-  fwrite(&simTracks_[0], sizeof(Track), nt, fp);
+  write_tracks(fp, simTracks_);
 
   if (Config::normal_val || Config::fit_val) {
     for (int it = 0; it<nt; ++it) {
@@ -374,7 +407,7 @@ void Event::read_in(FILE *fp)
   int nt;
   fread(&nt, sizeof(int), 1, fp);
   simTracks_.resize(nt);
-  fread(&simTracks_[0], sizeof(Track), nt, fp);
+  read_tracks(fp, simTracks_);
   Config::nTracks = nt;
 
   if (Config::normal_val || Config::fit_val) {
@@ -411,8 +444,8 @@ void Event::read_in(FILE *fp)
     int ns;
     fread(&ns, sizeof(int), 1, fp);
     seedTracks_.resize(ns);
-    if (Config::readCmsswSeeds) fread(&seedTracks_[0], sizeof(Track), ns, fp);
-    else fseek(fp, sizeof(Track)*ns, SEEK_CUR);
+    if (Config::readCmsswSeeds) read_tracks(fp, seedTracks_);
+    else fseek(fp, Track::fileSize()*ns, SEEK_CUR);
     /*
     printf("read %i seedtracks\n",nt);
     for (int it = 0; it<ns; it++) {
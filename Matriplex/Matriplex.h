@@ -5,6 +5,8 @@
 
 namespace Matriplex
 {
+inline namespace MPLEX_ISA_NS
+{
 
 //------------------------------------------------------------------------------
 
@@ -66,6 +68,12 @@ public:
 
 #if defined(MIC_INTRINSICS)
 
+   void SlurpIn(const char *arr, const int vi[N])
+   {
+      __m512i v = _mm512_load_epi32(vi);
+      SlurpIn(arr, v);
+   }
+
    void SlurpIn(const char *arr, __m512i& vi)
    {
       //_mm512_prefetch_i32gather_ps(vi, arr, 1, _MM_HINT_T0);
@@ -122,8 +130,12 @@ public:
 
 #else
 
-   void SlurpIn(const char *arr, int vi[N])
+   void SlurpIn(const char *arr, const int vi[N])
    {
+#if defined(MPLEX_GATHER)
+      static_assert(sizeof(T) == sizeof(float), "SlurpIn gathers 32-bit elements");
+      GatherIn<N>((float*) fArray, kSize, arr, vi);
+#else
       for (int i = 0; i < kSize; ++i)
       {
         // Next loop vectorizes with "#pragma ivdep", but it runs slower
@@ -136,6 +148,7 @@ public:
            //}
         }
       }
+#endif
    }
 
 #endif
@@ -147,6 +160,47 @@ public:
          *(arr++) = fArray[i];
       }
    }
+
+   // Copy n_proc matrices in / out of slots 0 .. n_proc-1 in one go, see
+   // TransposeIn() / TransposeOut() in MatriplexCommon.h.
+   void CopyInBlock(const T *const *arr, idx_t n_proc)
+   {
+      static_assert(sizeof(T) == sizeof(float), "CopyInBlock transposes 32-bit elements");
+      TransposeIn<N>((float*) fArray, kSize, (const float *const *) arr, n_proc);
+   }
+
+   void CopyOutBlock(T *const *arr, idx_t n_proc) const
+   {
+      static_assert(sizeof(T) == sizeof(float), "CopyOutBlock transposes 32-bit elements");
+      TransposeOut<N>((const float*) fArray, kSize, (float *const *) arr, n_proc);
+   }
+
+   // Fill all N slots with the matrix at slot n of m.
+   void Broadcast(const Matriplex& m, idx_t n)
+   {
+      for (idx_t i = 0; i < kSize; ++i)
+      {
+         const T v = m.fArray[i * N + n];
+#pragma simd
+         for (idx_t j = 0; j < N; ++j)
+         {
+            fArray[i * N + j] = v;
+         }
+      }
+   }
+
+   // Take the slots with non-zero mask[j] from m, keep the others.
+   void Blend(const Matriplex& m, const int mask[N])
+   {
+      for (idx_t i = 0; i < kSize; ++i)
+      {
+#pragma simd
+         for (idx_t j = 0; j < N; ++j)
+         {
+            fArray[i * N + j] = mask[j] ? m.fArray[i * N + j] : fArray[i * N + j];
+         }
+      }
+   }
 };
 
 
@@ -450,6 +504,7 @@ void InvertCholesky(MPlex<T, D, D, N>& A)
    CholeskyInverter<T, D, N>::Invert(A);
 }
 
+}
 }
 
 #endif
@@ -16,7 +16,7 @@
 
 #if defined(MPLEX_USE_INTRINSICS)
 
-  #if defined(__MIC__) || defined(__AVX__)
+  #if defined(__MIC__) || defined(__AVX512F__) || defined(__AVX__)
 
     #define MPLEX_INTRINSICS
 
@@ -35,6 +35,29 @@
     #define MUL(a, b)     _mm512_mul_ps(a, b)
     #define FMA(a, b, v)  _mm512_fmadd_ps(a, b, v)
 
+  #elif defined(__AVX512F__)
+
+    // AVX-512 Xeons. Matriplex sizes that are not a multiple of 16 (e.g.
+    // MPT_SIZE=8) use masked, unaligned load / store for the last chunk.
+
+    typedef __m512 IntrVec_t;
+    #define MPLEX_INTRINSICS_WIDTH_BYTES  64
+    #define MPLEX_INTRINSICS_WIDTH_BITS  512
+    #define AVX512_INTRINSICS
+
+    // static as the AVX2 one below differs only in the return type, see
+    // MPLEX_ISA_NS.
+    static inline __mmask16 MPlexLaneMask(int n_left)
+    {
+      return n_left >= 16 ? (__mmask16) 0xffff : (__mmask16) ((1u << n_left) - 1);
+    }
+
+    #define LD(a, i)      ((N) % 16 == 0 ? _mm512_load_ps(&a[i*N+n]) : _mm512_maskz_loadu_ps(MPlexLaneMask(N - n), &a[i*N+n]))
+    #define ST(a, i, r)   ((N) % 16 == 0 ? _mm512_store_ps(&a[i*N+n], r) : _mm512_mask_storeu_ps(&a[i*N+n], MPlexLaneMask(N - n), r))
+    #define ADD(a, b)     _mm512_add_ps(a, b) 
+    #define MUL(a, b)     _mm512_mul_ps(a, b)
+    #define FMA(a, b, v)  _mm512_fmadd_ps(a, b, v)
+
   #elif defined(__AVX__)
 
     typedef __m256 IntrVec_t;
@@ -42,16 +65,42 @@
     #define MPLEX_INTRINSICS_WIDTH_BITS  256
     #define AVX_INTRINSICS
 
+    #if defined(__AVX2__)
+
+    // Masked load / store for Matriplex sizes that are not a multiple of 8.
+
+    static inline __m256i MPlexLaneMask(int n_left)
+    {
+      return _mm256_cmpgt_epi32(_mm256_set1_epi32(n_left), _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7));
+    }
+
+    #define LD(a, i)      ((N) % 8 == 0 ? _mm256_load_ps(&a[i*N+n]) : _mm256_maskload_ps(&a[i*N+n], MPlexLaneMask(N - n)))
+    #define ST(a, i, r)   ((N) % 8 == 0 ? _mm256_store_ps(&a[i*N+n], r) : _mm256_maskstore_ps(&a[i*N+n], MPlexLaneMask(N - n), r))
+
+    #else
+
     #define LD(a, i)      _mm256_load_ps(&a[i*N+n])
     #define ST(a, i, r)   _mm256_store_ps(&a[i*N+n], r)
+
+    #endif
+
     #define ADD(a, b)     _mm256_add_ps(a, b) 
     #define MUL(a, b)     _mm256_mul_ps(a, b)
+
+    #if defined(__FMA__)
+
+    #define FMA(a, b, v)  _mm256_fmadd_ps(a, b, v)
+
+    #else
+
     // #define FMA(a, b, v)  { __m256 temp = _mm256_mul_ps(a, b); v = _mm256_add_ps(temp, v); }
-    inline __m256 FMA(const __m256 &a, const __m256 &b, const __m256 &v)
+    static inline __m256 FMA(const __m256 &a, const __m256 &b, const __m256 &v)
     {
       __m256 temp = _mm256_mul_ps(a, b); return _mm256_add_ps(temp, v);
     }
 
+    #endif
+
   #endif
 
 #endif
@@ -72,14 +121,337 @@
 
 // #endif
 
+#if defined(AVX512_INTRINSICS) || (defined(AVX_INTRINSICS) && defined(__AVX2__))
+  #define MPLEX_GATHER
+#endif
+
+// Everything in namespace Matriplex lives in an inline namespace named after
+// the instruction set the including code is compiled for. Kernels built for
+// several ISAs can then be linked into one binary (WITH_ISA_VARIANTS in
+// Makefile.config) without out-of-line copies of Matriplex functions being
+// merged across ISAs by the linker.
+
+#if defined(__MIC__)
+  #define MPLEX_ISA_NS isa_mic
+#elif defined(__AVX512F__)
+  #define MPLEX_ISA_NS isa_avx512
+#elif defined(__AVX2__)
+  #define MPLEX_ISA_NS isa_avx2
+#elif defined(__AVX__)
+  #define MPLEX_ISA_NS isa_avx
+#elif defined(__SSE4_2__)
+  #define MPLEX_ISA_NS isa_sse42
+#else
+  #define MPLEX_ISA_NS isa_generic
+#endif
+
 namespace Matriplex
+{
+inline namespace MPLEX_ISA_NS
 {
    typedef int idx_t;
 
+#if defined(MPLEX_GATHER)
+
+   // Hardware gather for SlurpIn() on Xeon. Loads n_elem consecutive floats
+   // starting at arr + vi[j] into dst[i*N + j]; vi are byte offsets. Plex
+   // sizes that are not a multiple of the vector width use a masked last chunk.
+   template<idx_t N>
+   inline void GatherIn(float *dst, idx_t n_elem, const char *arr, const int *vi)
+   {
+#if defined(AVX512_INTRINSICS)
+      for (idx_t n = 0; n < N; n += 16)
+      {
+         const __mmask16 m  = MPlexLaneMask(N - n);
+         const __m512i   vn = _mm512_maskz_loadu_epi32(m, vi + n);
+
+         for (idx_t i = 0; i < n_elem; ++i)
+         {
+            __m512 reg = _mm512_mask_i32gather_ps(_mm512_setzero_ps(), m, vn, arr + i*sizeof(float), 1);
+            if (N % 16 == 0) _mm512_store_ps(&dst[i*N + n], reg);
+            else             _mm512_mask_storeu_ps(&dst[i*N + n], m, reg);
+         }
+      }
+#else
+      for (idx_t n = 0; n < N; n += 8)
+      {
+         const __m256i m  = MPlexLaneMask(N - n);
+         const __m256i vn = _mm256_maskload_epi32(vi + n, m);
+
+         for (idx_t i = 0; i < n_elem; ++i)
+         {
+            __m256 reg = _mm256_mask_i32gather_ps(_mm256_setzero_ps(), (const float*) (arr + i*sizeof(float)),
+                                                  vn, _mm256_castsi256_ps(m), 1);
+            if (N % 8 == 0) _mm256_store_ps(&dst[i*N + n], reg);
+            else            _mm256_maskstore_ps(&dst[i*N + n], m, reg);
+         }
+      }
+#endif
+   }
+
+#endif
+
+   //---------------------------------------------------------------------------
+   // Blocked transposes between n_proc separate matrices (e.g. the parameters
+   // or errors of Track objects) and the plex layout, dst[i*N + j] = src[j][i].
+   // Tiles of 8x8 (AVX) or 4x4 (SSE) are loaded row-wise and transposed in
+   // registers so plex memory is written / read with full vector stores /
+   // loads instead of one float every N.
+   //---------------------------------------------------------------------------
+
+#if defined(MPLEX_USE_INTRINSICS) && defined(__AVX__) && ! defined(__MIC__)
+
+   #define MPLEX_TRANSPOSE_AVX
+
+   inline __m256i MPlexTailMask8(int n_left)
+   {
+      return _mm256_castps_si256(_mm256_cmp_ps(_mm256_set1_ps((float) n_left),
+                                               _mm256_setr_ps(0, 1, 2, 3, 4, 5, 6, 7), _CMP_GT_OQ));
+   }
+
+   inline void Transpose8x8(__m256 r[8])
+   {
+      __m256 t[8], u[8];
+      for (int k = 0; k < 8; k += 2)
+      {
+         t[k]     = _mm256_unpacklo_ps(r[k], r[k + 1]);
+         t[k + 1] = _mm256_unpackhi_ps(r[k], r[k + 1]);
+      }
+      for (int k = 0; k < 8; k += 4)
+      {
+         u[k]     = _mm256_shuffle_ps(t[k],     t[k + 2], _MM_SHUFFLE(1, 0, 1, 0));
+         u[k + 1] = _mm256_shuffle_ps(t[k],     t[k + 2], _MM_SHUFFLE(3, 2, 3, 2));
+         u[k + 2] = _mm256_shuffle_ps(t[k + 1], t[k + 3], _MM_SHUFFLE(1, 0, 1, 0));
+         u[k + 3] = _mm256_shuffle_ps(t[k + 1], t[k + 3], _MM_SHUFFLE(3, 2, 3, 2));
+      }
+      for (int k = 0; k < 4; ++k)
+      {
+         r[k]     = _mm256_permute2f128_ps(u[k], u[k + 4], 0x20);
+         r[k + 4] = _mm256_permute2f128_ps(u[k], u[k + 4], 0x31);
+      }
+   }
+
+#endif
+
+#if defined(MPLEX_USE_INTRINSICS) && defined(__SSE__) && ! defined(__MIC__)
+
+   #define MPLEX_TRANSPOSE_SSE
+
+   inline __m128 MPlexLoadPartial4(const float *p, int n)
+   {
+      if (n >= 4) return _mm_loadu_ps(p);
+      float tmp[4] __attribute__((aligned(16))) = { 0, 0, 0, 0 };
+      for (int i = 0; i < n && i < 4; ++i) tmp[i] = p[i];
+      return _mm_load_ps(tmp);
+   }
+
+   inline void MPlexStorePartial4(float *p, __m128 r, int n)
+   {
+      if (n >= 4) { _mm_storeu_ps(p, r); return; }
+      float tmp[4] __attribute__((aligned(16)));
+      _mm_store_ps(tmp, r);
+      for (int i = 0; i < n && i < 4; ++i) p[i] = tmp[i];
+   }
+
+#endif
+
+   // Slots n_proc .. N-1 of a partially filled tile get a copy of the first
+   // matrix of the tile.
+   template<idx_t N>
+   inline void TransposeIn(float *dst, idx_t n_elem, const float *const *src, idx_t n_proc)
+   {
+#if defined(MPLEX_TRANSPOSE_AVX)
+      if (N % 8 == 0)
+      {
+         for (idx_t n = 0; n < n_proc; n += 8)
+         {
+            const float *p[8];
+            for (int k = 0; k < 8; ++k) p[k] = src[n + k < n_proc ? n + k : n];
+
+            for (idx_t e = 0; e < n_elem; e += 8)
+            {
+               __m256 r[8];
+               if (e + 8 <= n_elem)
+               {
+                  for (int k = 0; k < 8; ++k) r[k] = _mm256_loadu_ps(p[k] + e);
+               }
+               else
+               {
+                  const __m256i m = MPlexTailMask8(n_elem - e);
+                  for (int k = 0; k < 8; ++k) r[k] = _mm256_maskload_ps(p[k] + e, m);
+               }
+               Transpose8x8(r);
+               for (int k = 0; k < 8 && e + k < n_elem; ++k) _mm256_store_ps(&dst[(e + k)*N + n], r[k]);
+            }
+         }
+         return;
+      }
+#endif
+#if defined(MPLEX_TRANSPOSE_SSE)
+      if (N % 4 == 0)
+      {
+         for (idx_t n = 0; n < n_proc; n += 4)
+         {
+            const float *p[4];
+            for (int k = 0; k < 4; ++k) p[k] = src[n + k < n_proc ? n + k : n];
+
+            for (idx_t e = 0; e < n_elem; e += 4)
+            {
+               __m128 r0 = MPlexLoadPartial4(p[0] + e, n_elem - e);
+               __m128 r1 = MPlexLoadPartial4(p[1] + e, n_elem - e);
+               __m128 r2 = MPlexLoadPartial4(p[2] + e, n_elem - e);
+               __m128 r3 = MPlexLoadPartial4(p[3] + e, n_elem - e);
+               _MM_TRANSPOSE4_PS(r0, r1, r2, r3);
+               const __m128 r[4] = { r0, r1, r2, r3 };
+               for (int k = 0; k < 4 && e + k < n_elem; ++k) _mm_store_ps(&dst[(e + k)*N + n], r[k]);
+            }
+         }
+         return;
+      }
+#endif
+      for (idx_t j = 0; j < n_proc; ++j)
+      {
+         for (idx_t i = 0; i < n_elem; ++i)
+         {
+            dst[i*N + j] = src[j][i];
+         }
+      }
+   }
+
+   // Inverse of TransposeIn(), only the first n_proc slots are written out.
+   template<idx_t N>
+   inline void TransposeOut(const float *src, idx_t n_elem, float *const *dst, idx_t n_proc)
+   {
+#if defined(MPLEX_TRANSPOSE_AVX)
+      if (N % 8 == 0)
+      {
+         for (idx_t n = 0; n < n_proc; n += 8)
+         {
+            for (idx_t e = 0; e < n_elem; e += 8)
+            {
+               __m256 r[8];
+               for (int k = 0; k < 8; ++k)
+               {
+                  r[k] = e + k < n_elem ? _mm256_load_ps(&src[(e + k)*N + n]) : _mm256_setzero_ps();
+               }
+               Transpose8x8(r);
+               if (e + 8 <= n_elem)
+               {
+                  for (int k = 0; k < 8 && n + k < n_proc; ++k) _mm256_storeu_ps(dst[n + k] + e, r[k]);
+               }
+               else
+               {
+                  const __m256i m = MPlexTailMask8(n_elem - e);
+                  for (int k = 0; k < 8 && n + k < n_proc; ++k) _mm256_maskstore_ps(dst[n + k] + e, m, r[k]);
+               }
+            }
+         }
+         return;
+      }
+#endif
+#if defined(MPLEX_TRANSPOSE_SSE)
+      if (N % 4 == 0)
+      {
+         for (idx_t n = 0; n < n_proc; n += 4)
+         {
+            for (idx_t e = 0; e < n_elem; e += 4)
+            {
+               __m128 r[4];
+               for (int k = 0; k < 4; ++k)
+               {
+                  r[k] = e + k < n_elem ? _mm_load_ps(&src[(e + k)*N + n]) : _mm_setzero_ps();
+               }
+               _MM_TRANSPOSE4_PS(r[0], r[1], r[2], r[3]);
+               for (int k = 0; k < 4 && n + k < n_proc; ++k) MPlexStorePartial4(dst[n + k] + e, r[k], n_elem - e);
+            }
+         }
+         return;
+      }
+#endif
+      for (idx_t j = 0; j < n_proc; ++j)
+      {
+         for (idx_t i = 0; i < n_elem; ++i)
+         {
+            dst[j][i] = src[i*N + j];
+         }
+      }
+   }
+
+   //---------------------------------------------------------------------------
+   // out[n] = 1 / sqrt(in[n]) for the N slots of a plex, in and out may be the
+   // same. With intrinsics the hardware estimate is refined by one
+   // Newton-Raphson step, y' = y * (3 - x * y * y) / 2, which brings it to
+   // within about an ulp of float without sqrt or division.
+   //---------------------------------------------------------------------------
+
+   template<typename T, idx_t N>
+   struct InvSqrtOp
+   {
+      static void run(const T *in, T *out)
+      {
+#pragma simd
+         for (idx_t n = 0; n < N; ++n)
+         {
+            out[n] = T(1) / std::sqrt(in[n]);
+         }
+      }
+   };
+
+#if defined(MPLEX_USE_INTRINSICS) && defined(__SSE__) && ! defined(__MIC__)
+
+   #define MPLEX_FAST_RSQRT
+
+   template<idx_t N>
+   struct InvSqrtOp<float, N>
+   {
+      static void run(const float *in, float *out)
+      {
+         idx_t n = 0;
+#if defined(__AVX512F__)
+         for ( ; n + 16 <= N; n += 16)
+         {
+            const __m512 x = _mm512_loadu_ps(in + n);
+            const __m512 y = _mm512_rsqrt14_ps(x);
+            const __m512 t = _mm512_sub_ps(_mm512_set1_ps(3.0f), _mm512_mul_ps(_mm512_mul_ps(x, y), y));
+            _mm512_storeu_ps(out + n, _mm512_mul_ps(_mm512_mul_ps(_mm512_set1_ps(0.5f), y), t));
+         }
+#endif
+#if defined(__AVX__)
+         for ( ; n + 8 <= N; n += 8)
+         {
+            const __m256 x = _mm256_loadu_ps(in + n);
+            const __m256 y = _mm256_rsqrt_ps(x);
+            const __m256 t = _mm256_sub_ps(_mm256_set1_ps(3.0f), _mm256_mul_ps(_mm256_mul_ps(x, y), y));
+            _mm256_storeu_ps(out + n, _mm256_mul_ps(_mm256_mul_ps(_mm256_set1_ps(0.5f), y), t));
+         }
+#endif
+         for ( ; n + 4 <= N; n += 4)
+         {
+            const __m128 x = _mm_loadu_ps(in + n);
+            const __m128 y = _mm_rsqrt_ps(x);
+            const __m128 t = _mm_sub_ps(_mm_set1_ps(3.0f), _mm_mul_ps(_mm_mul_ps(x, y), y));
+            _mm_storeu_ps(out + n, _mm_mul_ps(_mm_mul_ps(_mm_set1_ps(0.5f), y), t));
+         }
+         for ( ; n < N; ++n)
+         {
+            out[n] = 1.0f / std::sqrt(in[n]);
+         }
+      }
+   };
+
+#endif
+
+   template<typename T, idx_t N>
+   inline void InvSqrt(const T *in, T *out)
+   {
+      InvSqrtOp<T, N>::run(in, out);
+   }
+
    inline void align_check(const char* pref, void *adr)
    {
       printf("%s 0x%llx  -  modulo 64 = %lld\n", pref, (long long unsigned)adr, (long long)adr%64);
    }
 }
+}
 
 #endif
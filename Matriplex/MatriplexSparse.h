@@ -0,0 +1,305 @@
+#ifndef MatriplexSparse_H
+#define MatriplexSparse_H
+
+#include "MatriplexCommon.h"
+
+//==============================================================================
+// Compile-time sparse Matriplex products
+//==============================================================================
+//
+// Sparsity patterns are types: each element of an operand is known to be
+// zero (O), one (I) or anything (X). Products are unrolled by the compiler,
+// terms with a zero factor are never emitted and multiplications by one are
+// dropped -- the same code GenMul.pm writes into .ah files, without the Perl
+// step. Operands are the fArrays of the Matriplexes, N is the plex size.
+//
+//   using namespace Matriplex::Sparse;
+//   typedef Gen<3, 3, Pattern<X, O, X,
+//                             X, O, X,
+//                             O, I, O> > Rot;
+//
+//   Mult<N, Rot, Sym<3>, Gen<3, 3> >(a, b, c);   // c = a * b
+//   Similarity<N, Rot, Sym<3>, Sym<3> >(a, b, c); // c = a * b * aT
+//
+// Similarity() keeps the live elements of a * b in an N-wide temporary on
+// the stack, as the .ah pairs do with an explicit temporary Matriplex.
+//
+// Accumulation order is the same as in GenMul.pm and, when intrinsics with
+// FMA are enabled, fused multiply-adds are used -- results match the .ah
+// kernels, see test/SparseTest.cxx.
+
+namespace Matriplex
+{
+inline namespace MPLEX_ISA_NS
+{
+namespace Sparse
+{
+   enum { O = 0, I = 1, X = 2 };
+
+   // Element kinds in storage order: row-major for Gen, lower triangle row by
+   // row for Sym, as in MatriplexSym.
+
+   template<int... E> struct Pattern;
+
+   template<>
+   struct Pattern<>
+   {
+      static constexpr int at(int) { return O; }
+   };
+
+   template<int H, int... T>
+   struct Pattern<H, T...>
+   {
+      static constexpr int at(int i) { return i == 0 ? H : Pattern<T...>::at(i - 1); }
+   };
+
+   struct Dense
+   {
+      static constexpr int at(int) { return X; }
+   };
+
+   //---------------------------------------------------------------------------
+   // Operand layouts
+   //---------------------------------------------------------------------------
+
+   template<int D1, int D2, class P = Dense>
+   struct Gen
+   {
+      static constexpr int kRows = D1, kCols = D2;
+
+      static constexpr int  off   (int i, int j) { return i * D2 + j; }
+      static constexpr int  kind  (int i, int j) { return P::at(i * D2 + j); }
+      static constexpr bool stored(int, int)     { return true; }
+   };
+
+   template<int D, class P = Dense>
+   struct Sym
+   {
+      static constexpr int kRows = D, kCols = D;
+
+      static constexpr int  off   (int i, int j) { return i >= j ? i * (i + 1) / 2 + j : j * (j + 1) / 2 + i; }
+      static constexpr int  kind  (int i, int j) { return P::at(off(i, j)); }
+      static constexpr bool stored(int i, int j) { return j <= i; }
+   };
+
+   template<class M>
+   struct Transp
+   {
+      static constexpr int kRows = M::kCols, kCols = M::kRows;
+
+      static constexpr int  off   (int i, int j) { return M::off(j, i); }
+      static constexpr int  kind  (int i, int j) { return M::kind(j, i); }
+      static constexpr bool stored(int i, int j) { return M::stored(j, i); }
+   };
+
+   // Dense row-major result of A * B, zero where no term survives.
+   template<class A, class B>
+   struct Prod
+   {
+      static constexpr int kRows = A::kRows, kCols = B::kCols;
+
+      static constexpr bool live(int i, int j, int k)
+      {
+         return k < A::kCols && ((A::kind(i, k) != O && B::kind(k, j) != O) || live(i, j, k + 1));
+      }
+
+      static constexpr int  off   (int i, int j) { return i * kCols + j; }
+      static constexpr int  kind  (int i, int j) { return live(i, j, 0) ? X : O; }
+      static constexpr bool stored(int, int)     { return true; }
+   };
+
+   //---------------------------------------------------------------------------
+   // Unrolling machinery
+   //---------------------------------------------------------------------------
+
+   namespace Detail
+   {
+#if defined(MPLEX_USE_INTRINSICS) && defined(__FMA__)
+      inline float MAdd(float a, float b, float c) { return std::fma(a, b, c); }
+#else
+      inline float MAdd(float a, float b, float c) { return a * b + c; }
+#endif
+
+      // Add x * y to acc, knowing the kinds of x and y. Started is false for
+      // the first surviving term of a sum.
+      template<int kx, int ky, bool started>
+      struct Term
+      {
+         static float add(float acc, const float *x, const float *y)
+         { return started ? MAdd(*x, *y, acc) : *x * *y; }
+      };
+
+      template<int ky, bool started>
+      struct Term<O, ky, started>
+      {
+         static float add(float acc, const float*, const float*) { return acc; }
+      };
+
+      template<int kx, bool started>
+      struct Term<kx, O, started>
+      {
+         static float add(float acc, const float*, const float*) { return acc; }
+      };
+
+      template<bool started>
+      struct Term<O, O, started>
+      {
+         static float add(float acc, const float*, const float*) { return acc; }
+      };
+
+      template<bool started>
+      struct Term<I, X, started>
+      {
+         static float add(float acc, const float*, const float *y) { return started ? acc + *y : *y; }
+      };
+
+      template<bool started>
+      struct Term<X, I, started>
+      {
+         static float add(float acc, const float *x, const float*) { return started ? acc + *x : *x; }
+      };
+
+      template<bool started>
+      struct Term<I, I, started>
+      {
+         static float add(float acc, const float*, const float*) { return started ? acc + 1.0f : 1.0f; }
+      };
+
+      // Element (i, j) of A * B for one slot; N is the stride of the operands.
+      template<idx_t N, class A, class B, int i, int j, int k, bool started,
+               bool done = (k == A::kCols)>
+      struct Dot
+      {
+         static constexpr int  kx = A::kind(i, k), ky = B::kind(k, j);
+         static constexpr bool live = kx != O && ky != O;
+
+         static float sum(const float *a, const float *b, float acc)
+         {
+            return Dot<N, A, B, i, j, k + 1, started || live>::sum(a, b,
+                     Term<kx, ky, started>::add(acc, a + A::off(i, k) * N, b + B::off(k, j) * N));
+         }
+      };
+
+      template<idx_t N, class A, class B, int i, int j, int k, bool started>
+      struct Dot<N, A, B, i, j, k, started, true>
+      {
+         static float sum(const float*, const float*, float acc) { return acc; }
+      };
+
+      // Write stored elements of C = A * B, starting at flat index e. The
+      // loop over slots is innermost, one element at a time, so that it
+      // vectorizes the same way as the .ah kernels do. Elements where C is
+      // known to be zero are skipped, they are never read (see Prod).
+      template<idx_t N, class A, class B, class C, int e,
+               bool done  = (e == C::kRows * C::kCols),
+               bool write = C::stored(e / C::kCols, e % C::kCols) &&
+                            C::kind(e / C::kCols, e % C::kCols) != O>
+      struct Store
+      {
+         static void run(const float*, const float*, float*) {}
+      };
+
+      template<idx_t N, class A, class B, class C, int e>
+      struct Store<N, A, B, C, e, false, false>
+      {
+         __attribute__((always_inline)) static void run(const float *a, const float *b, float *c)
+         {
+            Store<N, A, B, C, e + 1>::run(a, b, c);
+         }
+      };
+
+      template<idx_t N, class A, class B, class C, int e>
+      struct Store<N, A, B, C, e, false, true>
+      {
+         static constexpr int i = e / C::kCols, j = e % C::kCols;
+
+         __attribute__((always_inline)) static void run(const float *a, const float *b, float *c)
+         {
+            float *cij = c + C::off(i, j) * N;
+#pragma simd
+            for (idx_t n = 0; n < N; ++n)
+            {
+               cij[n] = Dot<N, A, B, i, j, 0, false>::sum(a + n, b + n, 0.0f);
+            }
+            Store<N, A, B, C, e + 1>::run(a, b, c);
+         }
+      };
+
+      // Copy K elements between one slot of a Matriplex (stride N) and a
+      // plain array, unrolled so that a loop over slots around it vectorizes.
+      template<idx_t N, int K, int k = 0, bool done = (k == K)>
+      struct Slot
+      {
+         __attribute__((always_inline)) static void load(const float *a, float *s)
+         {
+            s[k] = a[k * N];
+            Slot<N, K, k + 1>::load(a, s);
+         }
+         __attribute__((always_inline)) static void store(const float *s, float *a)
+         {
+            a[k * N] = s[k];
+            Slot<N, K, k + 1>::store(s, a);
+         }
+      };
+
+      template<idx_t N, int K, int k>
+      struct Slot<N, K, k, true>
+      {
+         static void load(const float*, float*) {}
+         static void store(const float*, float*) {}
+      };
+   }
+
+   //---------------------------------------------------------------------------
+   // Kernels
+   //---------------------------------------------------------------------------
+
+   // c = a * b
+   template<idx_t N, class A, class B, class C>
+   __attribute__((always_inline)) inline void Mult(const float *a, const float *b, float *c)
+   {
+      static_assert(A::kCols == B::kRows && C::kRows == A::kRows && C::kCols == B::kCols,
+                    "Sparse::Mult dimension mismatch");
+      Detail::Store<N, A, B, C, 0>::run(a, b, c);
+   }
+
+   // c = a * b * aT; b and c may be the same Matriplex.
+   template<idx_t N, class A, class B, class C>
+   __attribute__((always_inline)) inline void Similarity(const float *a, const float *b, float *c)
+   {
+      static_assert(A::kCols == B::kRows && B::kRows == B::kCols &&
+                    C::kRows == A::kRows && C::kCols == A::kRows,
+                    "Sparse::Similarity dimension mismatch");
+
+      typedef Prod<A, B> T;
+      float t[T::kRows * T::kCols * N] __attribute__((aligned(64)));
+      Mult<N, A, B, T>(a, b, t);
+      Mult<N, T, Transp<A>, C>(t, a, c);
+   }
+
+   // Kernels can also be run for a single slot, with N = 1 on plain arrays,
+   // to fuse them with other per slot work in one loop over the slots.
+   // LoadSlot() / StoreSlot() move the K elements of slot n between the
+   // Matriplex and such an array, m is the fArray offset by n:
+   //
+   //   float j[36], e[21], r[21];
+   //   LoadSlot<N, 36>(a + n, j); LoadSlot<N, 21>(b + n, e);
+   //   Similarity<1, Jac, Sym<6>, Sym<6> >(j, e, r);
+   //   StoreSlot<N, 21>(r, c + n);
+
+   template<idx_t N, int K>
+   __attribute__((always_inline)) inline void LoadSlot(const float *m, float *s)
+   {
+      Detail::Slot<N, K>::load(m, s);
+   }
+
+   template<idx_t N, int K>
+   __attribute__((always_inline)) inline void StoreSlot(const float *s, float *m)
+   {
+      Detail::Slot<N, K>::store(s, m);
+   }
+}
+}
+}
+
+#endif
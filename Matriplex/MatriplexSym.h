@@ -10,6 +10,8 @@
 //==============================================================================
 
 namespace Matriplex
+{
+inline namespace MPLEX_ISA_NS
 {
 
   const idx_t gSymOffsets[7][36] =
@@ -85,6 +87,12 @@ public:
 
 #if defined(MIC_INTRINSICS)
 
+   void SlurpIn(const char *arr, const int vi[N])
+   {
+      __m512i v = _mm512_load_epi32(vi);
+      SlurpIn(arr, v);
+   }
+
    void SlurpIn(const char *arr, __m512i& vi)
    {
       //_mm512_prefetch_i32gather_ps(vi, arr, 1, _MM_HINT_T0);
@@ -142,8 +150,12 @@ public:
 
 #else
 
-   void SlurpIn(const char *arr, int vi[N])
+   void SlurpIn(const char *arr, const int vi[N])
    {
+#if defined(MPLEX_GATHER)
+      static_assert(sizeof(T) == sizeof(float), "SlurpIn gathers 32-bit elements");
+      GatherIn<N>((float*) fArray, kSize, arr, vi);
+#else
       for (int i = 0; i < kSize; ++i)
       {
         for (int j = 0; j < N; ++j)
@@ -151,6 +163,7 @@ public:
            fArray[i*N + j] = * (const T*) (arr + i*sizeof(T) + vi[j]);
         }
       }
+#endif
    }
 
 #endif
@@ -163,6 +176,47 @@ public:
       }
    }
 
+   // Copy n_proc matrices in / out of slots 0 .. n_proc-1 in one go, see
+   // TransposeIn() / TransposeOut() in MatriplexCommon.h.
+   void CopyInBlock(const T *const *arr, idx_t n_proc)
+   {
+      static_assert(sizeof(T) == sizeof(float), "CopyInBlock transposes 32-bit elements");
+      TransposeIn<N>((float*) fArray, kSize, (const float *const *) arr, n_proc);
+   }
+
+   void CopyOutBlock(T *const *arr, idx_t n_proc) const
+   {
+      static_assert(sizeof(T) == sizeof(float), "CopyOutBlock transposes 32-bit elements");
+      TransposeOut<N>((const float*) fArray, kSize, (float *const *) arr, n_proc);
+   }
+
+   // Fill all N slots with the matrix at slot n of m.
+   void Broadcast(const MatriplexSym& m, idx_t n)
+   {
+      for (idx_t i = 0; i < kSize; ++i)
+      {
+         const T v = m.fArray[i * N + n];
+#pragma simd
+         for (idx_t j = 0; j < N; ++j)
+         {
+            fArray[i * N + j] = v;
+         }
+      }
+   }
+
+   // Take the slots with non-zero mask[j] from m, keep the others.
+   void Blend(const MatriplexSym& m, const int mask[N])
+   {
+      for (idx_t i = 0; i < kSize; ++i)
+      {
+#pragma simd
+         for (idx_t j = 0; j < N; ++j)
+         {
+            fArray[i * N + j] = mask[j] ? m.fArray[i * N + j] : fArray[i * N + j];
+         }
+      }
+   }
+
    void SetDiagonal3x3(idx_t n, T d)
    {
       T *p = fArray + n;
@@ -271,7 +325,7 @@ struct SymMultiplyCls<T, 3, N>
 
 #ifdef MPLEX_INTRINSICS
 
-   for (idx_t n = 0; n < N; n += 64 / sizeof(T))
+   for (idx_t n = 0; n < N; n += MPLEX_INTRINSICS_WIDTH_BYTES / sizeof(T))
    {
 #include "intr_sym_3x3.ah"
    }
@@ -301,7 +355,7 @@ struct SymMultiplyCls<T, 6, N>
 
 #ifdef MPLEX_INTRINSICS
 
-   for (idx_t n = 0; n < N; n += 64 / sizeof(T))
+   for (idx_t n = 0; n < N; n += MPLEX_INTRINSICS_WIDTH_BYTES / sizeof(T))
    {
       #include "intr_sym_6x6.ah"
    }
@@ -463,10 +517,204 @@ void InvertCholeskySym(MPlexSym<T, D, N>& A)
 }
 
 
+//==============================================================================
+// Cholesky factorization and solves
+//==============================================================================
+
+// A = L * LT, L is written over A. Diagonal elements are stored as
+// 1 / L(i,i) so the solves below need no divisions; see InvSqrt() for the
+// rsqrt fast path. The general version works for all D with symmetric
+// offsets (2, 3 and 6), every step is a loop over the plex; the offsets are
+// looked up at run time which keeps the compiler from vectorizing it well,
+// so D = 2 and 3 are written out.
+
+template<typename T, idx_t D, idx_t N>
+struct CholeskyDecomposerSym
+{
+   static void Decompose(MPlexSym<T, D, N>& A)
+   {
+      T *a = A.fArray;
+      const idx_t *off = A.Offsets();
+
+      for (idx_t j = 0; j < D; ++j)
+      {
+         T *ajj = a + off[j * D + j] * N;
+
+         for (idx_t k = 0; k < j; ++k)
+         {
+            const T *ajk = a + off[j * D + k] * N;
+#pragma simd
+            for (idx_t n = 0; n < N; ++n)
+            {
+               ajj[n] -= ajk[n] * ajk[n];
+            }
+         }
+
+         InvSqrt<T, N>(ajj, ajj);
+
+         for (idx_t i = j + 1; i < D; ++i)
+         {
+            T *aij = a + off[i * D + j] * N;
+
+            for (idx_t k = 0; k < j; ++k)
+            {
+               const T *aik = a + off[i * D + k] * N;
+               const T *ajk = a + off[j * D + k] * N;
+#pragma simd
+               for (idx_t n = 0; n < N; ++n)
+               {
+                  aij[n] -= aik[n] * ajk[n];
+               }
+            }
+#pragma simd
+            for (idx_t n = 0; n < N; ++n)
+            {
+               aij[n] *= ajj[n];
+            }
+         }
+      }
+   }
+};
+
+template<typename T, idx_t N>
+struct CholeskyDecomposerSym<T, 2, N>
+{
+   static void Decompose(MPlexSym<T, 2, N>& A)
+   {
+      T *a = A.fArray;
+
+      InvSqrt<T, N>(a, a);
+
+#pragma simd
+      for (idx_t n = 0; n < N; ++n)
+      {
+         a[1*N+n] *= a[0*N+n];
+         a[2*N+n] -= a[1*N+n] * a[1*N+n];
+      }
+
+      InvSqrt<T, N>(a + 2*N, a + 2*N);
+   }
+};
+
+template<typename T, idx_t N>
+struct CholeskyDecomposerSym<T, 3, N>
+{
+   static void Decompose(MPlexSym<T, 3, N>& A)
+   {
+      T *a = A.fArray;
+
+      InvSqrt<T, N>(a, a);
+
+#pragma simd
+      for (idx_t n = 0; n < N; ++n)
+      {
+         a[1*N+n] *= a[0*N+n];
+         a[3*N+n] *= a[0*N+n];
+         a[2*N+n] -= a[1*N+n] * a[1*N+n];
+      }
+
+      InvSqrt<T, N>(a + 2*N, a + 2*N);
+
+#pragma simd
+      for (idx_t n = 0; n < N; ++n)
+      {
+         a[4*N+n]  = (a[4*N+n] - a[3*N+n] * a[1*N+n]) * a[2*N+n];
+         a[5*N+n] -= a[3*N+n] * a[3*N+n] + a[4*N+n] * a[4*N+n];
+      }
+
+      InvSqrt<T, N>(a + 5*N, a + 5*N);
+   }
+};
+
+template<typename T, idx_t D, idx_t N>
+void CholeskyDecomposeSym(MPlexSym<T, D, N>& A)
+{
+   CholeskyDecomposerSym<T, D, N>::Decompose(A);
+}
+
+// B = L^-1 * B, L from CholeskyDecomposeSym(). For a residual vector r,
+// chi2 = rT * A^-1 * r is the squared norm of the result.
+template<typename T, idx_t D, idx_t M, idx_t N>
+void CholeskyForwardSubst(const MPlexSym<T, D, N>& L, MPlex<T, D, M, N>& B)
+{
+   const T *l = L.fArray;
+         T *b = B.fArray;
+   const idx_t *off = L.Offsets();
+
+   for (idx_t c = 0; c < M; ++c)
+   {
+      for (idx_t i = 0; i < D; ++i)
+      {
+         T *bi = b + (i * M + c) * N;
+
+         for (idx_t k = 0; k < i; ++k)
+         {
+            const T *lik = l + off[i * D + k] * N;
+            const T *bk  = b + (k * M + c) * N;
+#pragma simd
+            for (idx_t n = 0; n < N; ++n)
+            {
+               bi[n] -= lik[n] * bk[n];
+            }
+         }
+         const T *lii = l + off[i * D + i] * N;
+#pragma simd
+         for (idx_t n = 0; n < N; ++n)
+         {
+            bi[n] *= lii[n];
+         }
+      }
+   }
+}
+
+// B = LT^-1 * B
+template<typename T, idx_t D, idx_t M, idx_t N>
+void CholeskyBackSubst(const MPlexSym<T, D, N>& L, MPlex<T, D, M, N>& B)
+{
+   const T *l = L.fArray;
+         T *b = B.fArray;
+   const idx_t *off = L.Offsets();
+
+   for (idx_t c = 0; c < M; ++c)
+   {
+      for (idx_t i = D - 1; i >= 0; --i)
+      {
+         T *bi = b + (i * M + c) * N;
+
+         for (idx_t k = i + 1; k < D; ++k)
+         {
+            const T *lki = l + off[k * D + i] * N;
+            const T *bk  = b + (k * M + c) * N;
+#pragma simd
+            for (idx_t n = 0; n < N; ++n)
+            {
+               bi[n] -= lki[n] * bk[n];
+            }
+         }
+         const T *lii = l + off[i * D + i] * N;
+#pragma simd
+         for (idx_t n = 0; n < N; ++n)
+         {
+            bi[n] *= lii[n];
+         }
+      }
+   }
+}
+
+// B = A^-1 * B, L from CholeskyDecomposeSym().
+template<typename T, idx_t D, idx_t M, idx_t N>
+void CholeskySolveSym(const MPlexSym<T, D, N>& L, MPlex<T, D, M, N>& B)
+{
+   CholeskyForwardSubst(L, B);
+   CholeskyBackSubst   (L, B);
+}
+
+
 //==============================================================================
 // End Attic, close namespace Matriplex
 //==============================================================================
 
+}
 }
 
 #endif
@@ -10,6 +10,8 @@
 
 namespace Matriplex
 {
+inline namespace MPLEX_ISA_NS
+{
 
 //------------------------------------------------------------------------------
 
@@ -182,6 +184,7 @@ void InvertCholeskySym(MPlexVec<MPlexSym<T, D, N>>& A,
    }
 }
 
+}
 }
 
 #endif
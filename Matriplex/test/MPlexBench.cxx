@@ -0,0 +1,823 @@
+// Matriplex micro-benchmarks: throughput of the Matriplex operations used in
+// mkFit, each checked against an SMatrix (double) reference.
+//
+// Build and run via Makefile in this directory:
+//   make bench       -- MPlexBench-<isa>-<width> for all ISA variants and widths
+//   make run-bench   -- run them all, variants the CPU can not run say so
+//
+// Columns:
+//   ns/mat  -- wall time per matrix (best of several runs, warm L1/L2),
+//   GFLOP/s -- flops counted from the kernel source (zero terms of sparse
+//              kernels are not counted, sqrt and division count as one),
+//   rel err -- max |x - ref| / max |ref| over all slots of one plex.
+//
+// The .ah kernels come from ../../mkFit (GenMPlexOps.pl), the patterns below
+// must be kept in sync with the ones used there.
+
+#if defined(__INTEL_COMPILER)
+  #define ASSUME_ALIGNED(a, b) __assume_aligned(a, b)
+#else
+  #define ASSUME_ALIGNED(a, b) a = static_cast<decltype(a)>(__builtin_assume_aligned(a, b))
+#endif
+
+#include "Math/SMatrix.h"
+
+#include "MatriplexSym.h"
+#include "MatriplexSparse.h"
+
+#include "MathMPlex.h"
+#include "FieldMap.h"
+#include "Config.h"
+#include "Matrix.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+
+#ifndef MPT_SIZE
+  #define MPT_SIZE 16
+#endif
+
+const int N    = MPT_SIZE;
+const int NMAT = 256;      // matrices processed per timed call
+const int NP   = NMAT / N; // ... in this many plexes
+
+using Matriplex::idx_t;
+using namespace Matriplex::Sparse;
+
+typedef Matriplex::Matriplex   <float, 3, 1, N> MPlex31;
+typedef Matriplex::Matriplex   <float, 2, 2, N> MPlex22;
+typedef Matriplex::Matriplex   <float, 3, 3, N> MPlex33;
+typedef Matriplex::Matriplex   <float, 6, 1, N> MPlex61;
+typedef Matriplex::Matriplex   <float, 6, 2, N> MPlex62;
+typedef Matriplex::Matriplex   <float, 6, 6, N> MPlex66;
+typedef Matriplex::MatriplexSym<float, 2,    N> MPlexS2;
+typedef Matriplex::MatriplexSym<float, 3,    N> MPlexS3;
+typedef Matriplex::MatriplexSym<float, 6,    N> MPlexS6;
+
+// Patterns of the mkFit kernels, see mkFit/GenMPlexOps.pl.
+
+typedef Gen<6, 6, Pattern<X, X, O, X, X, O,
+                          X, X, O, X, X, O,
+                          X, X, I, X, X, X,
+                          X, X, O, X, X, O,
+                          X, X, O, X, X, O,
+                          O, O, O, O, O, I> > ErrProp;
+
+typedef Gen<6, 6, Pattern<I, O, X, X, X, X,
+                          O, I, X, X, X, X,
+                          O, O, O, O, O, O,
+                          O, O, O, I, O, O,
+                          O, O, X, X, I, X,
+                          O, O, O, O, O, I> > ErrPropEndcap;
+
+typedef Gen<6, 6, Pattern<I, O, O, O, O, O,
+                          O, I, O, O, O, O,
+                          O, O, I, O, O, O,
+                          O, O, O, X, X, O,
+                          O, O, O, X, X, O,
+                          O, O, O, X, X, X> > JacCCS;
+
+typedef Gen<6, 6, Pattern<X, X, X, O, O, O,
+                          X, X, X, O, O, O,
+                          X, X, X, O, O, O,
+                          X, X, X, O, O, O,
+                          X, X, X, O, O, O,
+                          X, X, X, O, O, O> > KHPat;
+
+//==============================================================================
+// mkFit kernels
+//==============================================================================
+
+// C = A * B
+void MultHelixProp(const MPlex66& A, const MPlexS6& B, MPlex66& C)
+{
+   typedef float T;
+   const T *a = A.fArray; ASSUME_ALIGNED(a, 64);
+   const T *b = B.fArray; ASSUME_ALIGNED(b, 64);
+         T *c = C.fArray; ASSUME_ALIGNED(c, 64);
+#include "MultHelixProp.ah"
+}
+
+// C = B * AT
+void MultHelixPropTransp(const MPlex66& A, const MPlex66& B, MPlexS6& C)
+{
+   typedef float T;
+   const T *a = A.fArray; ASSUME_ALIGNED(a, 64);
+   const T *b = B.fArray; ASSUME_ALIGNED(b, 64);
+         T *c = C.fArray; ASSUME_ALIGNED(c, 64);
+#include "MultHelixPropTransp.ah"
+}
+
+// C = A * B
+void MultHelixPropEndcap(const MPlex66& A, const MPlexS6& B, MPlex66& C)
+{
+   typedef float T;
+   const T *a = A.fArray; ASSUME_ALIGNED(a, 64);
+   const T *b = B.fArray; ASSUME_ALIGNED(b, 64);
+         T *c = C.fArray; ASSUME_ALIGNED(c, 64);
+#include "MultHelixPropEndcap.ah"
+}
+
+// C = B * AT
+void MultHelixPropTranspEndcap(const MPlex66& A, const MPlex66& B, MPlexS6& C)
+{
+   typedef float T;
+   const T *a = A.fArray; ASSUME_ALIGNED(a, 64);
+   const T *b = B.fArray; ASSUME_ALIGNED(b, 64);
+         T *c = C.fArray; ASSUME_ALIGNED(c, 64);
+#include "MultHelixPropTranspEndcap.ah"
+}
+
+// C = A * B, lower triangle of C only
+void KHC(const MPlex66& A, const MPlexS6& B, MPlexS6& C)
+{
+   typedef float T;
+   const T *a = A.fArray; ASSUME_ALIGNED(a, 64);
+   const T *b = B.fArray; ASSUME_ALIGNED(b, 64);
+         T *c = C.fArray; ASSUME_ALIGNED(c, 64);
+#include "KHC.ah"
+}
+
+// C = A * B(0:2, 0:6), lower triangle of C only
+void K62HC(const MPlex62& A, const MPlexS6& B, MPlexS6& C)
+{
+   typedef float T;
+   const T *a = A.fArray; ASSUME_ALIGNED(a, 64);
+   const T *b = B.fArray; ASSUME_ALIGNED(b, 64);
+         T *c = C.fArray; ASSUME_ALIGNED(c, 64);
+#include "K62HC.ah"
+}
+
+// C = A * B
+void CFMatrix33Vector3(const MPlex33& A, const MPlex31& B, MPlex31& C)
+{
+   typedef float T;
+   const T *a = A.fArray; ASSUME_ALIGNED(a, 64);
+   const T *b = B.fArray; ASSUME_ALIGNED(b, 64);
+         T *c = C.fArray; ASSUME_ALIGNED(c, 64);
+#include "CFMatrix33Vector3.ah"
+}
+
+//==============================================================================
+// Data, references, comparison
+//==============================================================================
+
+template<int D1, int D2> using SMat    = ROOT::Math::SMatrix<double, D1, D2>;
+
+std::default_random_engine      g_gen(0xbeef0133);
+std::normal_distribution<float> g_dis(0.0, 1.0);
+
+template<class MP>
+MP* NewPlexes()
+{
+   void *p = 0;
+   if (posix_memalign(&p, 64, NP * sizeof(MP))) throw std::bad_alloc();
+   return static_cast<MP*>(p);
+}
+
+template<class MP>
+void Fill(MP *m)
+{
+   for (int p = 0; p < NP; ++p)
+      for (int i = 0; i < MP::kTotSize; ++i)
+         m[p].fArray[i] = g_dis(g_gen);
+}
+
+// Zeros and ones of a Sparse layout.
+template<class L, int D1, int D2>
+void Enforce(Matriplex::Matriplex<float, D1, D2, N> *m)
+{
+   for (int p = 0; p < NP; ++p)
+      for (int n = 0; n < N; ++n)
+         for (int i = 0; i < D1; ++i)
+            for (int j = 0; j < D2; ++j)
+               if (L::kind(i, j) != X) m[p](n, i, j) = L::kind(i, j);
+}
+
+// Well conditioned symmetric positive definite, A = M * MT + D * 1.
+template<class MP>
+void FillPosDef(MP *m)
+{
+   const int D = MP::kRows;
+   for (int p = 0; p < NP; ++p)
+      for (int n = 0; n < N; ++n)
+      {
+         float r[D][D];
+         for (int i = 0; i < D; ++i)
+            for (int j = 0; j < D; ++j)
+               r[i][j] = g_dis(g_gen);
+
+         for (int i = 0; i < D; ++i)
+            for (int j = 0; j < D; ++j)
+            {
+               float s = i == j ? D : 0;
+               for (int k = 0; k < D; ++k) s += r[i][k] * r[j][k];
+               m[p](n, i, j) = s;
+            }
+      }
+}
+
+template<int D1, int D2>
+SMat<D1, D2> ToSMat(const Matriplex::Matriplex<float, D1, D2, N>& m, int n)
+{
+   SMat<D1, D2> s;
+   for (int i = 0; i < D1; ++i)
+      for (int j = 0; j < D2; ++j)
+         s(i, j) = m.ConstAt(n, i, j);
+   return s;
+}
+
+// Symmetric plexes go into full SMatrices: products with MatRepSym operands
+// gave wrong results with gcc 12 at -O3 -mavx512f.
+template<int D>
+SMat<D, D> ToSMat(const Matriplex::MatriplexSym<float, D, N>& m, int n)
+{
+   SMat<D, D> s;
+   for (int i = 0; i < D; ++i)
+      for (int j = 0; j < D; ++j)
+         s(i, j) = m.ConstAt(n, i, j);
+   return s;
+}
+
+template<class MP, class SM>
+void Accumulate(const MP& m, int n, const SM& ref, bool lower_only, double& max_diff, double& max_ref)
+{
+   for (int i = 0; i < MP::kRows; ++i)
+      for (int j = 0; j < MP::kCols; ++j)
+      {
+         if (lower_only && j > i) continue;
+         max_diff = std::max(max_diff, std::abs(m.ConstAt(n, i, j) - ref(i, j)));
+         max_ref  = std::max(max_ref,  std::abs(ref(i, j)));
+      }
+}
+
+// Max relative error over the slots of plex p, computed as max over slots of
+// max |x - ref| / max |ref|. RefFn(n) returns the reference for slot n.
+template<int D1, int D2, class RefFn>
+double RelErr(const Matriplex::Matriplex<float, D1, D2, N>& m, RefFn ref)
+{
+   double err = 0;
+   for (int n = 0; n < N; ++n)
+   {
+      double d = 0, r = 0;
+      Accumulate(m, n, ref(n), false, d, r);
+      err = std::max(err, d / r);
+   }
+   return err;
+}
+
+template<int D, class RefFn>
+double RelErr(const Matriplex::MatriplexSym<float, D, N>& m, RefFn ref)
+{
+   double err = 0;
+   for (int n = 0; n < N; ++n)
+   {
+      double d = 0, r = 0;
+      Accumulate(m, n, ref(n), true, d, r);
+      err = std::max(err, d / r);
+   }
+   return err;
+}
+
+//==============================================================================
+// Timing
+//==============================================================================
+
+// Calls f(p) for all plexes; not inlined so the work can not be hoisted out
+// of the timing loop.
+template<class F>
+__attribute__((noinline)) void Loop(F f)
+{
+   for (int p = 0; p < NP; ++p) f(p);
+}
+
+template<class F>
+double NsPerMatrix(F f)
+{
+   typedef std::chrono::steady_clock clk;
+
+   long reps = 1;
+   for (;;)
+   {
+      const clk::time_point t0 = clk::now();
+      for (long r = 0; r < reps; ++r) Loop(f);
+      if (std::chrono::duration<double>(clk::now() - t0).count() > 0.02) break;
+      reps *= 2;
+   }
+
+   double best = 1e30;
+   for (int trial = 0; trial < 5; ++trial)
+   {
+      const clk::time_point t0 = clk::now();
+      for (long r = 0; r < reps; ++r) Loop(f);
+      const double ns = std::chrono::duration<double, std::nano>(clk::now() - t0).count();
+      best = std::min(best, ns / (reps * NMAT));
+   }
+   return best;
+}
+
+template<class F>
+void Report(const char *name, int flops, double err, F f)
+{
+   const double ns = NsPerMatrix(f);
+   if (flops > 0)
+      printf("%-36s %9.3f %9.2f %11.2e\n", name, ns, flops / ns, err);
+   else
+      printf("%-36s %9.3f %9s %11.2e\n", name, ns, "-", err);
+}
+
+// Flops of C = A * B for Sparse layouts: a mul per surviving term, adds to
+// combine them, only stored elements of C.
+template<class A, class B, class C>
+int SparseFlops()
+{
+   int f = 0;
+   for (int i = 0; i < C::kRows; ++i)
+      for (int j = 0; j < C::kCols; ++j)
+      {
+         if ( ! C::stored(i, j)) continue;
+         int t = 0;
+         for (int k = 0; k < A::kCols; ++k)
+            if (A::kind(i, k) == X && B::kind(k, j) != O) ++t;
+            else if (A::kind(i, k) != O && B::kind(k, j) == X) ++t;
+         if (t > 0) f += 2 * t - 1;
+      }
+   return f;
+}
+
+// Cholesky factorization plus solve with one right-hand side.
+int CholeskyFlops(int D)
+{
+   int f = 0;
+   for (int j = 0; j < D; ++j) f += 2 * j + 1 + (D - j - 1) * (2 * j + 1);
+   return f + 2 * D * D;
+}
+
+//==============================================================================
+// Benchmarks
+//==============================================================================
+
+void BenchMultiply()
+{
+   {
+      MPlexS3 *a = NewPlexes<MPlexS3>(), *b = NewPlexes<MPlexS3>();
+      MPlex33 *c = NewPlexes<MPlex33>();
+      Fill(a); Fill(b);
+      for (int p = 0; p < NP; ++p) Matriplex::Multiply(a[p], b[p], c[p]);
+      const double err = RelErr(c[0], [&](int n) { return SMat<3, 3>(ToSMat(a[0], n) * ToSMat(b[0], n)); });
+      Report("Multiply Sym3 * Sym3", 45, err, [=](int p) { Matriplex::Multiply(a[p], b[p], c[p]); });
+   }
+   {
+      MPlexS6 *a = NewPlexes<MPlexS6>(), *b = NewPlexes<MPlexS6>();
+      MPlex66 *c = NewPlexes<MPlex66>();
+      Fill(a); Fill(b);
+      for (int p = 0; p < NP; ++p) Matriplex::Multiply(a[p], b[p], c[p]);
+      const double err = RelErr(c[0], [&](int n) { return SMat<6, 6>(ToSMat(a[0], n) * ToSMat(b[0], n)); });
+      Report("Multiply Sym6 * Sym6", 396, err, [=](int p) { Matriplex::Multiply(a[p], b[p], c[p]); });
+   }
+   {
+      MPlex33 *a = NewPlexes<MPlex33>(), *b = NewPlexes<MPlex33>(), *c = NewPlexes<MPlex33>();
+      Fill(a); Fill(b);
+      for (int p = 0; p < NP; ++p) Matriplex::Multiply(a[p], b[p], c[p]);
+      const double err = RelErr(c[0], [&](int n) { return SMat<3, 3>(ToSMat(a[0], n) * ToSMat(b[0], n)); });
+      Report("Multiply 3x3 * 3x3", 45, err, [=](int p) { Matriplex::Multiply(a[p], b[p], c[p]); });
+   }
+   {
+      MPlex66 *a = NewPlexes<MPlex66>(), *b = NewPlexes<MPlex66>(), *c = NewPlexes<MPlex66>();
+      Fill(a); Fill(b);
+      for (int p = 0; p < NP; ++p) Matriplex::Multiply(a[p], b[p], c[p]);
+      const double err = RelErr(c[0], [&](int n) { return SMat<6, 6>(ToSMat(a[0], n) * ToSMat(b[0], n)); });
+      Report("Multiply 6x6 * 6x6", 396, err, [=](int p) { Matriplex::Multiply(a[p], b[p], c[p]); });
+   }
+}
+
+void BenchInvert()
+{
+   // Inversions are in place: timing alternates between A and A^-1.
+
+   {
+      MPlex22 *a = NewPlexes<MPlex22>(), *r = NewPlexes<MPlex22>();
+      FillPosDef(a);
+      for (int p = 0; p < NP; ++p) { r[p] = a[p]; Matriplex::InvertCramer(a[p]); }
+      const double err = RelErr(a[0], [&](int n) { int f; return ToSMat(r[0], n).Inverse(f); });
+      Report("InvertCramer 2x2", 8, err, [=](int p) { Matriplex::InvertCramer(a[p]); });
+   }
+   {
+      MPlex33 *a = NewPlexes<MPlex33>(), *r = NewPlexes<MPlex33>();
+      FillPosDef(a);
+      for (int p = 0; p < NP; ++p) { r[p] = a[p]; Matriplex::InvertCramer(a[p]); }
+      const double err = RelErr(a[0], [&](int n) { int f; return ToSMat(r[0], n).Inverse(f); });
+      Report("InvertCramer 3x3", 42, err, [=](int p) { Matriplex::InvertCramer(a[p]); });
+   }
+   {
+      MPlex33 *a = NewPlexes<MPlex33>(), *r = NewPlexes<MPlex33>();
+      FillPosDef(a);
+      for (int p = 0; p < NP; ++p) { r[p] = a[p]; Matriplex::InvertCholesky(a[p]); }
+      const double err = RelErr(a[0], [&](int n) { int f; return ToSMat(r[0], n).Inverse(f); });
+      Report("InvertCholesky 3x3", 42, err, [=](int p) { Matriplex::InvertCholesky(a[p]); });
+   }
+   {
+      MPlexS2 *a = NewPlexes<MPlexS2>(), *r = NewPlexes<MPlexS2>();
+      FillPosDef(a);
+      for (int p = 0; p < NP; ++p) { r[p] = a[p]; Matriplex::InvertCramerSym(a[p]); }
+      const double err = RelErr(a[0], [&](int n) { int f; return ToSMat(r[0], n).Inverse(f); });
+      Report("InvertCramerSym 2", 7, err, [=](int p) { Matriplex::InvertCramerSym(a[p]); });
+   }
+   {
+      MPlexS3 *a = NewPlexes<MPlexS3>(), *r = NewPlexes<MPlexS3>();
+      FillPosDef(a);
+      for (int p = 0; p < NP; ++p) { r[p] = a[p]; Matriplex::InvertCramerSym(a[p]); }
+      const double err = RelErr(a[0], [&](int n) { int f; return ToSMat(r[0], n).Inverse(f); });
+      Report("InvertCramerSym 3", 30, err, [=](int p) { Matriplex::InvertCramerSym(a[p]); });
+   }
+   {
+      MPlexS3 *a = NewPlexes<MPlexS3>(), *r = NewPlexes<MPlexS3>();
+      FillPosDef(a);
+      for (int p = 0; p < NP; ++p) { r[p] = a[p]; Matriplex::InvertCholeskySym(a[p]); }
+      const double err = RelErr(a[0], [&](int n) { int f; return ToSMat(r[0], n).Inverse(f); });
+      Report("InvertCholeskySym 3", 42, err, [=](int p) { Matriplex::InvertCholeskySym(a[p]); });
+   }
+}
+
+template<class MPS, class MPV>
+void BenchCholesky()
+{
+   // Factorization and solves are in place, the timings include copying
+   // the input. For small plexes the copy can dominate: memcpy may store in
+   // narrower chunks than the kernel loads, stalling store forwarding.
+
+   const int D = MPS::kRows;
+   char name[64];
+
+   MPS *a = NewPlexes<MPS>(), *l = NewPlexes<MPS>();
+   MPV *b = NewPlexes<MPV>(), *x = NewPlexes<MPV>();
+   FillPosDef(a); Fill(b);
+
+   auto decompose = [=](int p) { l[p] = a[p]; Matriplex::CholeskyDecomposeSym(l[p]); };
+   for (int p = 0; p < NP; ++p) decompose(p);
+
+   // L * LT, the diagonal of the factor holds 1 / L(i,i).
+   const double err_l = RelErr(a[0], [&](int n)
+   {
+      SMat<D, D> m;
+      for (int i = 0; i < D; ++i)
+         for (int j = 0; j <= i; ++j)
+            m(i, j) = i == j ? 1 / l[0].ConstAt(n, i, i) : l[0].ConstAt(n, i, j);
+      return SMat<D, D>(m * ROOT::Math::Transpose(m));
+   });
+   snprintf(name, sizeof(name), "CholeskyDecomposeSym %d (+copy)", D);
+   Report(name, CholeskyFlops(D) - 2 * D * D, err_l, decompose);
+
+   auto solve = [=](int p) { x[p] = b[p]; Matriplex::CholeskySolveSym(l[p], x[p]); };
+   solve(0);
+
+   const double err_x = RelErr(x[0], [&](int n) { int f; return SMat<D, 1>(ToSMat(a[0], n).Inverse(f) * ToSMat(b[0], n)); });
+   snprintf(name, sizeof(name), "CholeskySolveSym %d (+copy)", D);
+   Report(name, 2 * D * D, err_x, solve);
+}
+
+void BenchCopy()
+{
+   // Per-slot CopyIn / CopyOut against block transposes and gathers, for
+   // track errors (21 floats) in a Track-like 128 byte record.
+
+   struct Rec { float par[6]; float err[21]; float pad[5]; };
+
+   const int NR = 4 * NMAT;
+   Rec *recs; if (posix_memalign((void**) &recs, 64, NR * sizeof(Rec))) throw std::bad_alloc();
+   for (int r = 0; r < NR; ++r) for (int i = 0; i < 21; ++i) recs[r].err[i] = g_dis(g_gen);
+
+   // Every 4th record, in shuffled order.
+   int *idx = new int[NMAT];
+   for (int m = 0; m < NMAT; ++m) idx[m] = 4 * m;
+   std::shuffle(idx, idx + NMAT, g_gen);
+
+   const float **src = new const float*[NMAT];
+   float       **dst = new float*[NMAT];
+   int          *off = new int[NMAT];
+   for (int m = 0; m < NMAT; ++m)
+   {
+      src[m] = recs[idx[m]].err;
+      dst[m] = recs[idx[m]].err;
+      off[m] = idx[m] * sizeof(Rec);
+   }
+
+   MPlexS6 *e = NewPlexes<MPlexS6>();
+
+   auto check = [&]()
+   {
+      double err = 0;
+      for (int n = 0; n < N; ++n)
+         for (int i = 0; i < 21; ++i)
+            err = std::max(err, (double) std::abs(e[0].fArray[i * N + n] - src[n][i]));
+      return err;
+   };
+
+   auto copy_in = [=](int p) { for (int n = 0; n < N; ++n) e[p].CopyIn(n, src[p * N + n]); };
+   copy_in(0);
+   Report("CopyIn Sym6 (per slot)", 0, check(), copy_in);
+
+   auto copy_in_block = [=](int p) { e[p].CopyInBlock(src + p * N, N); };
+   e[0].SetVal(0); copy_in_block(0);
+   Report("CopyInBlock Sym6", 0, check(), copy_in_block);
+
+   auto slurp_in = [=](int p) { e[p].SlurpIn((const char*) recs[0].err, off + p * N); };
+   e[0].SetVal(0); slurp_in(0);
+   Report("SlurpIn Sym6", 0, check(), slurp_in);
+
+   Report("CopyOut Sym6 (per slot)", 0, 0, [=](int p) { for (int n = 0; n < N; ++n) e[p].CopyOut(n, dst[p * N + n]); });
+   Report("CopyOutBlock Sym6", 0, 0, [=](int p) { e[p].CopyOutBlock(dst + p * N, N); });
+
+   // Compact errors of COMPACT_TRACK_ERRORS builds (CompactSym66, Matrix.h),
+   // same access pattern. Rel err is that of the round trip through the
+   // compact form, for positive definite matrices.
+
+   MPlexS6 *pd = NewPlexes<MPlexS6>();
+   FillPosDef(pd);
+
+   CompactSym66  *cmps = new CompactSym66[NR];
+   CompactSym66 **cmp  = new CompactSym66*[NMAT];
+   for (int m = 0; m < NMAT; ++m)
+   {
+      float a[21];
+      pd[m / N].CopyOut(m % N, a);
+      cmp[m] = &cmps[idx[m]];
+      cmp[m]->Pack(a);
+   }
+
+   auto round_trip_err = [&]() { return RelErr(e[0], [&](int n) { return ToSMat(pd[0], n); }); };
+
+   auto copy_in_compact = [=](int p) { CopyInCompact<N>(e[p], cmp + p * N, N); };
+   copy_in_compact(0);
+   Report("CopyInCompact Sym6", 0, round_trip_err(), copy_in_compact);
+
+   auto copy_out_compact = [=](int p) { CopyOutCompact<N>(pd[p], cmp + p * N, N); };
+   copy_out_compact(0); e[0].SetVal(0); copy_in_compact(0);
+   Report("CopyOutCompact Sym6", 0, round_trip_err(), copy_out_compact);
+}
+
+void BenchGenerated()
+{
+   MPlexS6 *err = NewPlexes<MPlexS6>(), *out = NewPlexes<MPlexS6>();
+   MPlex66 *jac = NewPlexes<MPlex66>(), *tmp = NewPlexes<MPlex66>();
+   Fill(err);
+
+   auto helix = [&](const char *name1, const char *name2, const char *name3,
+                    void (*mult)(const MPlex66&, const MPlexS6&, MPlex66&),
+                    void (*transp)(const MPlex66&, const MPlex66&, MPlexS6&),
+                    int flops1, int flops2)
+   {
+      for (int p = 0; p < NP; ++p) mult(jac[p], err[p], tmp[p]);
+      double e1 = RelErr(tmp[0], [&](int n) { return SMat<6, 6>(ToSMat(jac[0], n) * ToSMat(err[0], n)); });
+      Report(name1, flops1, e1, [=](int p) { mult(jac[p], err[p], tmp[p]); });
+
+      for (int p = 0; p < NP; ++p) transp(jac[p], tmp[p], out[p]);
+      double e2 = RelErr(out[0], [&](int n) { return SMat<6, 6>(ToSMat(tmp[0], n) * ROOT::Math::Transpose(ToSMat(jac[0], n))); });
+      Report(name2, flops2, e2, [=](int p) { transp(jac[p], tmp[p], out[p]); });
+
+      for (int p = 0; p < NP; ++p) mult(jac[p], err[p], tmp[p]), transp(jac[p], tmp[p], out[p]);
+      double e3 = RelErr(out[0], [&](int n) { return SMat<6, 6>(ToSMat(jac[0], n) * ToSMat(err[0], n) * ROOT::Math::Transpose(ToSMat(jac[0], n))); });
+      Report(name3, flops1 + flops2, e3, [=](int p) { mult(jac[p], err[p], tmp[p]); transp(jac[p], tmp[p], out[p]); });
+   };
+
+   Fill(jac); Enforce<ErrProp>(jac);
+   helix("MultHelixProp.ah", "MultHelixPropTransp.ah", "  barrel similarity (.ah pair)",
+         MultHelixProp, MultHelixPropTransp,
+         SparseFlops<ErrProp, Sym<6>, Gen<6, 6> >(),
+         SparseFlops<Gen<6, 6>, Transp<ErrProp>, Sym<6> >());
+   {
+      for (int p = 0; p < NP; ++p) { out[p] = err[p]; Similarity<N, ErrProp, Sym<6>, Sym<6> >(jac[p].fArray, out[p].fArray, out[p].fArray); }
+      double e = RelErr(out[0], [&](int n) { return SMat<6, 6>(ToSMat(jac[0], n) * ToSMat(err[0], n) * ROOT::Math::Transpose(ToSMat(jac[0], n))); });
+      Report("  barrel similarity (Sparse, +copy)",
+             SparseFlops<ErrProp, Sym<6>, Prod<ErrProp, Sym<6> > >() + SparseFlops<Prod<ErrProp, Sym<6> >, Transp<ErrProp>, Sym<6> >(), e,
+             [=](int p) { out[p] = err[p]; Similarity<N, ErrProp, Sym<6>, Sym<6> >(jac[p].fArray, out[p].fArray, out[p].fArray); });
+   }
+
+   Fill(jac); Enforce<ErrPropEndcap>(jac);
+   helix("MultHelixPropEndcap.ah", "MultHelixPropTranspEndcap.ah", "  endcap similarity (.ah pair)",
+         MultHelixPropEndcap, MultHelixPropTranspEndcap,
+         SparseFlops<ErrPropEndcap, Sym<6>, Gen<6, 6> >(),
+         SparseFlops<Gen<6, 6>, Transp<ErrPropEndcap>, Sym<6> >());
+
+   Fill(jac); Enforce<JacCCS>(jac);
+   {
+      for (int p = 0; p < NP; ++p) { out[p] = err[p]; Similarity<N, JacCCS, Sym<6>, Sym<6> >(jac[p].fArray, out[p].fArray, out[p].fArray); }
+      double e = RelErr(out[0], [&](int n) { return SMat<6, 6>(ToSMat(jac[0], n) * ToSMat(err[0], n) * ROOT::Math::Transpose(ToSMat(jac[0], n))); });
+      Report("CCSErr similarity (Sparse, +copy)",
+             SparseFlops<JacCCS, Sym<6>, Prod<JacCCS, Sym<6> > >() + SparseFlops<Prod<JacCCS, Sym<6> >, Transp<JacCCS>, Sym<6> >(), e,
+             [=](int p) { out[p] = err[p]; Similarity<N, JacCCS, Sym<6>, Sym<6> >(jac[p].fArray, out[p].fArray, out[p].fArray); });
+   }
+
+   Fill(jac); Enforce<KHPat>(jac);
+   {
+      for (int p = 0; p < NP; ++p) KHC(jac[p], err[p], out[p]);
+      double e = RelErr(out[0], [&](int n) { return SMat<6, 6>(ToSMat(jac[0], n) * ToSMat(err[0], n)); });
+      Report("KHC.ah", SparseFlops<KHPat, Sym<6>, Sym<6> >(), e, [=](int p) { KHC(jac[p], err[p], out[p]); });
+   }
+   {
+      MPlex62 *k = NewPlexes<MPlex62>();
+      Fill(k);
+      for (int p = 0; p < NP; ++p) K62HC(k[p], err[p], out[p]);
+      double e = RelErr(out[0], [&](int n) { return SMat<6, 6>(ToSMat(k[0], n) * ToSMat(err[0], n).Sub<SMat<2, 6> >(0, 0)); });
+      Report("K62HC.ah", SparseFlops<Gen<6, 2>, Gen<2, 6>, Sym<6> >(), e, [=](int p) { K62HC(k[p], err[p], out[p]); });
+   }
+   {
+      MPlex33 *a = NewPlexes<MPlex33>();
+      MPlex31 *b = NewPlexes<MPlex31>(), *c = NewPlexes<MPlex31>();
+      Fill(a); Fill(b);
+      for (int p = 0; p < NP; ++p) CFMatrix33Vector3(a[p], b[p], c[p]);
+      double e = RelErr(c[0], [&](int n) { return SMat<3, 1>(ToSMat(a[0], n) * ToSMat(b[0], n)); });
+      Report("CFMatrix33Vector3.ah", 15, e, [=](int p) { CFMatrix33Vector3(a[p], b[p], c[p]); });
+   }
+}
+
+//==============================================================================
+// Vector math, mkFit/MathMPlex.h
+//==============================================================================
+
+// Here ns/mat is per slot and rel err is max |x - ref| / max |ref| over all
+// slots, reference in double. The libm rows are what the hot loops used before.
+void BenchVecMath()
+{
+   typedef Matriplex::Matriplex<float, 1, 1, N> MPlexQ;
+
+   MPlexQ *x = NewPlexes<MPlexQ>(), *y = NewPlexes<MPlexQ>();
+   MPlexQ *a = NewPlexes<MPlexQ>(), *b = NewPlexes<MPlexQ>();
+
+   auto err = [&](const MPlexQ *m, double (*ref)(double, double)) {
+      double d = 0, r = 0;
+      for (int p = 0; p < NP; ++p)
+         for (int n = 0; n < N; ++n)
+         {
+            const double v = ref(x[p](n, 0, 0), y[p](n, 0, 0));
+            d = std::max(d, std::abs(m[p](n, 0, 0) - v));
+            r = std::max(r, std::abs(v));
+         }
+      return d / r;
+   };
+
+   // Angles of a few turns.
+   for (int p = 0; p < NP; ++p)
+      for (int n = 0; n < N; ++n)
+         x[p](n, 0, 0) = 10.f * g_dis(g_gen), y[p](n, 0, 0) = g_dis(g_gen);
+
+   auto sincos = [=](int p) { VecMath::SinCos(x[p], a[p], b[p]); };
+   for (int p = 0; p < NP; ++p) sincos(p);
+   Report("VecMath::SinCos", 0, std::max(err(a, [](double v, double) { return std::sin(v); }),
+                                         err(b, [](double v, double) { return std::cos(v); })), sincos);
+   auto sincos_fast = [=](int p) { VecMath::SinCos<VecMath::Fast>(x[p], a[p], b[p]); };
+   for (int p = 0; p < NP; ++p) sincos_fast(p);
+   Report("VecMath::SinCos<Fast>", 0, std::max(err(a, [](double v, double) { return std::sin(v); }),
+                                               err(b, [](double v, double) { return std::cos(v); })), sincos_fast);
+   auto sincos_libm = [=](int p) { for (int n = 0; n < N; ++n) { a[p](n, 0, 0) = std::sin(x[p](n, 0, 0)); b[p](n, 0, 0) = std::cos(x[p](n, 0, 0)); } };
+   for (int p = 0; p < NP; ++p) sincos_libm(p);
+   Report("  std::sin + std::cos", 0, std::max(err(a, [](double v, double) { return std::sin(v); }),
+                                               err(b, [](double v, double) { return std::cos(v); })), sincos_libm);
+
+   auto atan2 = [=](int p) { VecMath::ATan2(y[p], x[p], a[p]); };
+   auto atan2_ref = [](double v, double w) { return std::atan2(w, v); };
+   for (int p = 0; p < NP; ++p) atan2(p);
+   Report("VecMath::ATan2", 0, err(a, atan2_ref), atan2);
+   auto atan2_fast = [=](int p) { VecMath::ATan2<VecMath::Fast>(y[p], x[p], a[p]); };
+   for (int p = 0; p < NP; ++p) atan2_fast(p);
+   Report("VecMath::ATan2<Fast>", 0, err(a, atan2_ref), atan2_fast);
+   auto atan2_libm = [=](int p) { for (int n = 0; n < N; ++n) a[p](n, 0, 0) = std::atan2(y[p](n, 0, 0), x[p](n, 0, 0)); };
+   for (int p = 0; p < NP; ++p) atan2_libm(p);
+   Report("  std::atan2", 0, err(a, atan2_ref), atan2_libm);
+
+   // Radiation lengths and the like for log, a wide range for exp.
+   for (int p = 0; p < NP; ++p)
+      for (int n = 0; n < N; ++n)
+         x[p](n, 0, 0) = std::exp(5.f * g_dis(g_gen)), y[p](n, 0, 0) = 20.f * g_dis(g_gen);
+
+   auto log = [=](int p) { VecMath::Log(x[p], a[p]); };
+   auto log_ref = [](double v, double) { return std::log(v); };
+   for (int p = 0; p < NP; ++p) log(p);
+   Report("VecMath::Log", 0, err(a, log_ref), log);
+   auto log_libm = [=](int p) { for (int n = 0; n < N; ++n) a[p](n, 0, 0) = std::log(x[p](n, 0, 0)); };
+   for (int p = 0; p < NP; ++p) log_libm(p);
+   Report("  std::log", 0, err(a, log_ref), log_libm);
+
+   // exp error relative per slot, the range spans many decades.
+   auto exp_err = [&]() {
+      double e = 0;
+      for (int p = 0; p < NP; ++p)
+         for (int n = 0; n < N; ++n)
+         {
+            const double v = std::exp((double) y[p](n, 0, 0));
+            e = std::max(e, std::abs(b[p](n, 0, 0) - v) / v);
+         }
+      return e;
+   };
+   auto exp = [=](int p) { VecMath::Exp(y[p], b[p]); };
+   for (int p = 0; p < NP; ++p) exp(p);
+   Report("VecMath::Exp", 0, exp_err(), exp);
+   auto exp_libm = [=](int p) { for (int n = 0; n < N; ++n) b[p](n, 0, 0) = std::exp(y[p](n, 0, 0)); };
+   for (int p = 0; p < NP; ++p) exp_libm(p);
+   Report("  std::exp", 0, exp_err(), exp_libm);
+}
+
+//==============================================================================
+// Field map, mkFit/FieldMap.h
+//==============================================================================
+
+// gcc only vectorizes this when the output is a local plex, as in
+// fieldAtStart() (mkFit/PropagationMPlex.cc), the copy out is included.
+template<typename MPlexQ>
+void FieldMapBz(const FieldMap& fmap, const MPlexQ& r, const MPlexQ& z, MPlexQ& b)
+{
+   MPlexQ t;
+#pragma simd
+   for (int n = 0; n < N; ++n) t(n, 0, 0) = fmap.Bz(r(n, 0, 0), z(n, 0, 0));
+   b = t;
+}
+
+// Bz at the start of a propagation with useParamBfield, per slot: the default
+// map (sampled from the polynomial) against Config::BfieldFromZR(), which is
+// also the reference.
+void BenchFieldMap()
+{
+   typedef Matriplex::Matriplex<float, 1, 1, N> MPlexQ;
+
+   MPlexQ *r = NewPlexes<MPlexQ>(), *z = NewPlexes<MPlexQ>(), *b = NewPlexes<MPlexQ>();
+
+   // Uniform over the tracker, the map clamps outside of it.
+   std::uniform_real_distribution<float> uni(0.f, 1.f);
+   for (int p = 0; p < NP; ++p)
+      for (int n = 0; n < N; ++n)
+         r[p](n, 0, 0) = 110.f * uni(g_gen), z[p](n, 0, 0) = 560.f * uni(g_gen) - 280.f;
+
+   auto err = [&]() {
+      double d = 0;
+      for (int p = 0; p < NP; ++p)
+         for (int n = 0; n < N; ++n)
+            d = std::max(d, (double) std::abs(b[p](n, 0, 0) - Config::BfieldFromZR(z[p](n, 0, 0), r[p](n, 0, 0))));
+      return d / Config::Bfield;
+   };
+
+   const FieldMap fmap;
+   auto map = [=, &fmap](int p) { FieldMapBz(fmap, r[p], z[p], b[p]); };
+   for (int p = 0; p < NP; ++p) map(p);
+   Report("FieldMap::Bz", 0, err(), map);
+
+   auto poly = [=](int p) {
+#pragma simd
+      for (int n = 0; n < N; ++n) b[p](n, 0, 0) = Config::BfieldFromZR(z[p](n, 0, 0), r[p](n, 0, 0));
+   };
+   for (int p = 0; p < NP; ++p) poly(p);
+   Report("  Config::BfieldFromZR", 0, err(), poly);
+}
+
+//==============================================================================
+// main
+//==============================================================================
+
+int main()
+{
+#if defined(__AVX512F__)
+   const char *isa = "avx512";
+   const bool  ok  = __builtin_cpu_supports("avx512f");
+#elif defined(__AVX2__)
+   const char *isa = "avx2";
+   const bool  ok  = __builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma");
+#elif defined(__AVX__)
+   const char *isa = "avx";
+   const bool  ok  = __builtin_cpu_supports("avx");
+#else
+   const char *isa = "sse";
+   const bool  ok  = true;
+#endif
+
+#if defined(MPLEX_INTRINSICS)
+   const char *impl = "intrinsics";
+#else
+   const char *impl = "std";
+#endif
+
+   printf("=== Matriplex benchmark: isa=%s (%s), plex width N=%d, %d matrices per call\n", isa, impl, N, NMAT);
+   if ( ! ok)
+   {
+      printf("    CPU does not support %s, skipping.\n\n", isa);
+      return 0;
+   }
+
+   printf("%-36s %9s %9s %11s\n", "kernel", "ns/mat", "GFLOP/s", "rel err");
+
+   BenchMultiply();
+   BenchInvert();
+   BenchCholesky<MPlexS2, Matriplex::Matriplex<float, 2, 1, N> >();
+   BenchCholesky<MPlexS3, MPlex31>();
+   BenchCholesky<MPlexS6, MPlex61>();
+   BenchCopy();
+   BenchGenerated();
+   BenchVecMath();
+   BenchFieldMap();
+
+   printf("\n");
+
+   return 0;
+}
@@ -0,0 +1,162 @@
+#include "MatriplexSym.h"
+#include "MatriplexSparse.h"
+
+#include <random>
+#include <cstdio>
+
+/*
+# Generate reference .ah files (make sure patterns match the typedefs below):
+  ./SparseTest.pl
+# Compile host, with and without intrinsics:
+  g++ -std=c++11 -O3 -mavx2 -mfma -DMPLEX_USE_INTRINSICS -I.. SparseTest.cxx -o SparseTest
+  g++ -std=c++11 -O3 -I.. SparseTest.cxx -o SparseTest-std
+# Or just run 'make sparse-test' which does all of the above.
+# Results of Sparse:: kernels and of the GenMul kernels are expected to be
+# identical, the test prints the largest difference per kernel and returns
+# non-zero if any of them differ.
+*/
+
+const int N = 16;
+
+using namespace Matriplex::Sparse;
+
+typedef Gen<6, 6, Pattern<I, O, O, O, O, O,
+                          O, I, O, O, O, O,
+                          O, O, I, O, O, O,
+                          O, O, O, X, X, O,
+                          O, O, O, X, X, O,
+                          O, O, O, X, X, X> > Jac;
+
+typedef Gen<6, 6, Pattern<I, O, X, X, X, X,
+                          O, I, X, X, X, X,
+                          O, O, O, O, O, O,
+                          O, O, O, I, O, O,
+                          O, O, X, X, I, X,
+                          O, O, O, O, O, I> > JacEndcap;
+
+typedef Sym<3, Pattern<X,
+                       X, I,
+                       X, X, X> > SymA;
+
+typedef Gen<3, 6, Pattern<X, X, X, X, O, X,
+                          X, I, X, I, O, X,
+                          X, X, X, X, O, X> > GenB;
+
+typedef Matriplex::Matriplex   <float, 6, 6, N> MPlexLL;
+typedef Matriplex::MatriplexSym<float, 6,    N> MPlexLS;
+typedef Matriplex::Matriplex   <float, 3, 6, N> MPlexX;
+typedef Matriplex::MatriplexSym<float, 3,    N> MPlexS;
+
+using Matriplex::idx_t;
+
+void RefJacErr(const MPlexLL& A, const MPlexLS& B, MPlexLL& C)
+{
+   typedef float T;
+   const T *a = A.fArray; const T *b = B.fArray; T *c = C.fArray;
+#include "sparse-jac-err.ah"
+}
+
+void RefTempJacT(const MPlexLL& A, const MPlexLL& B, MPlexLS& C)
+{
+   // C = B * AT, A is jac, B is temp (names as in SparseTest.pl)
+
+   typedef float T;
+   const T *a = A.fArray; const T *b = B.fArray; T *c = C.fArray;
+#include "sparse-temp-jact.ah"
+}
+
+void RefJacErrEndcap(const MPlexLL& A, const MPlexLS& B, MPlexLL& C)
+{
+   typedef float T;
+   const T *a = A.fArray; const T *b = B.fArray; T *c = C.fArray;
+#include "sparse-jac-err-endcap.ah"
+}
+
+void RefTempJacTEndcap(const MPlexLL& A, const MPlexLL& B, MPlexLS& C)
+{
+   typedef float T;
+   const T *a = A.fArray; const T *b = B.fArray; T *c = C.fArray;
+#include "sparse-temp-jact-endcap.ah"
+}
+
+void RefSymGen(const MPlexS& A, const MPlexX& B, MPlexX& C)
+{
+   typedef float T;
+   const T *a = A.fArray; const T *b = B.fArray; T *c = C.fArray;
+#include "sparse-sym-gen.ah"
+}
+
+template<class P>
+bool Report(const char *name, const P& ref, const P& tst)
+{
+   float max_diff = 0;
+   for (int i = 0; i < P::kTotSize; ++i)
+   {
+      max_diff = std::max(max_diff, std::abs(ref.fArray[i] - tst.fArray[i]));
+   }
+   printf("%-24s max |diff| = %e%s\n", name, max_diff, max_diff != 0 ? "  FAILED" : "");
+   return max_diff != 0;
+}
+
+int main()
+{
+   std::default_random_engine      gen(0xbeef0133);
+   std::normal_distribution<float> dis(1.0, 0.05);
+
+   MPlexLL jac, jac_ec, temp_ref, temp, temp_ec_ref;
+   MPlexLS err, out_ref, out, out_fused, out_ec_ref, out_ec;
+   MPlexS  a;
+   MPlexX  b, c_ref, c;
+
+   for (int i = 0; i < MPlexLL::kTotSize; ++i) jac.fArray[i] = dis(gen);
+   for (int i = 0; i < MPlexLL::kTotSize; ++i) jac_ec.fArray[i] = dis(gen);
+   for (int i = 0; i < MPlexLS::kTotSize; ++i) err.fArray[i] = dis(gen);
+   for (int i = 0; i < MPlexS ::kTotSize; ++i) a  .fArray[i] = dis(gen);
+   for (int i = 0; i < MPlexX ::kTotSize; ++i) b  .fArray[i] = dis(gen);
+
+   // Enforce patterns, both kernels must agree on what is zero / one anyway.
+   for (int n = 0; n < N; ++n)
+   {
+      for (int i = 0; i < 6; ++i)
+         for (int j = 0; j < 6; ++j)
+            if (Jac::kind(i, j) != X) jac(n, i, j) = Jac::kind(i, j);
+
+      for (int i = 0; i < 6; ++i)
+         for (int j = 0; j < 6; ++j)
+            if (JacEndcap::kind(i, j) != X) jac_ec(n, i, j) = JacEndcap::kind(i, j);
+
+      for (int i = 0; i < 3; ++i)
+         for (int j = 0; j <= i; ++j)
+            if (SymA::kind(i, j) != X) a.fArray[SymA::off(i, j) * N + n] = SymA::kind(i, j);
+
+      for (int i = 0; i < 3; ++i)
+         for (int j = 0; j < 6; ++j)
+            if (GenB::kind(i, j) != X) b(n, i, j) = GenB::kind(i, j);
+   }
+
+   RefJacErr  (jac, err, temp_ref);
+   RefTempJacT(jac, temp_ref, out_ref);
+   RefSymGen  (a, b, c_ref);
+
+   RefJacErrEndcap  (jac_ec, err, temp_ec_ref);
+   RefTempJacTEndcap(jac_ec, temp_ec_ref, out_ec_ref);
+
+   Mult<N, Jac, Sym<6>, Gen<6, 6> >(jac.fArray, err.fArray, temp.fArray);
+   Mult<N, Gen<6, 6>, Transp<Jac>, Sym<6> >(temp.fArray, jac.fArray, out.fArray);
+   Mult<N, SymA, GenB, Gen<3, 6> >(a.fArray, b.fArray, c.fArray);
+
+   out_fused = err;
+   Similarity<N, Jac, Sym<6>, Sym<6> >(jac.fArray, out_fused.fArray, out_fused.fArray);
+
+   out_ec = err;
+   Similarity<N, JacEndcap, Sym<6>, Sym<6> >(jac_ec.fArray, out_ec.fArray, out_ec.fArray);
+
+   int n_fail = 0;
+   n_fail += Report("jac * err",           temp_ref, temp);
+   n_fail += Report("temp * jacT",         out_ref,  out);
+   n_fail += Report("sym * gen, ones",     c_ref,    c);
+   n_fail += Report("jac * err * jacT",    out_ref,  out_fused);
+   n_fail += Report("endcap jac similarity", out_ec_ref, out_ec);
+
+   return n_fail != 0;
+}
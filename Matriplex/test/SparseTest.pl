@@ -0,0 +1,76 @@
+#!/usr/bin/perl
+
+use lib "..";
+
+use GenMul;
+
+### Reference kernels for SparseTest.cxx. Patterns here *MUST* match the
+### Sparse::Pattern typedefs there.
+
+#------------------------------------------------------------------------------
+# c = jac * err, err symmetric; then err = c * jacT (as CCSErr / CCSErrTransp)
+
+$jac = new GenMul::Matrix('name'=>'a', 'M'=>6, 'N'=>6);
+$jac->set_pattern(<<"FNORD");
+1 0 0 0 0 0
+0 1 0 0 0 0
+0 0 1 0 0 0
+0 0 0 x x 0
+0 0 0 x x 0
+0 0 0 x x x
+FNORD
+
+$err  = new GenMul::MatrixSym('name'=>'b', 'M'=>6, 'N'=>6);
+$temp = new GenMul::Matrix('name'=>'c', 'M'=>6, 'N'=>6);
+
+$m = new GenMul::Multiply;
+
+$m->dump_multiply_std_and_intrinsic("sparse-jac-err.ah", $jac, $err, $temp);
+
+$jacT = new GenMul::MatrixTranspose($jac);
+$outErr = new GenMul::MatrixSym('name'=>'c', 'M'=>6, 'N'=>6);
+$temp->{name} = 'b';
+
+$m->dump_multiply_std_and_intrinsic("sparse-temp-jact.ah", $temp, $jacT, $outErr);
+
+#------------------------------------------------------------------------------
+# Same for the jacobian of helix propagation to a disk (as MultHelixPropEndcap)
+
+$jac->set_pattern(<<"FNORD");
+1 0 x x x x
+0 1 x x x x
+0 0 0 0 0 0
+0 0 0 1 0 0
+0 0 x x 1 x
+0 0 0 0 0 1
+FNORD
+
+$temp->{name} = 'c';
+
+$m->dump_multiply_std_and_intrinsic("sparse-jac-err-endcap.ah", $jac, $err, $temp);
+
+$jacT = new GenMul::MatrixTranspose($jac);
+$temp->{name} = 'b';
+
+$m->dump_multiply_std_and_intrinsic("sparse-temp-jact-endcap.ah", $temp, $jacT, $outErr);
+
+#------------------------------------------------------------------------------
+# Ones on both sides, c = a * b with a symmetric (as in GMtest.pl)
+
+$a = new GenMul::MatrixSym('name'=>'a', 'M'=>3);
+$a->set_pattern(<<"FNORD");
+x
+x 1
+x x x
+FNORD
+
+$b = new GenMul::Matrix('name'=>'b', 'M'=>3, 'N'=>6);
+$b->set_pattern(<<"FNORD");
+x x x x 0 x
+x 1 x 1 0 x
+x x x x 0 x
+FNORD
+
+$c = new GenMul::Matrix('name'=>'c', 'M'=>3, 'N'=>6);
+
+$m->dump_multiply_std_and_intrinsic("sparse-sym-gen.ah", $a, $b, $c);
@@ -34,6 +34,65 @@ void dumpMatrix(Matrix m)
   }
 }
 
+//==============================================================================
+// CompactSym66 -- 6x6 covariance in 56 bytes instead of 84
+//==============================================================================
+
+// Square roots of the diagonal are kept as floats, off-diagonal elements as
+// correlation coefficients c(i,j) / (s(i) * s(j)) in 16-bit fixed point,
+// absolute precision 1 / 32767. Used for errors of stored tracks when built
+// with -DCOMPACT_TRACK_ERRORS, see Track.h; CopyInCompact / CopyOutCompact
+// below convert to and from Matriplexes.
+
+struct CompactSym66
+{
+  static constexpr float kRhoScale = 32767.f;
+
+  float sigma[6];
+  short rho[15]; // lower triangle without the diagonal, row by row
+
+  // err is in MatRepSym<float,6> order, lower triangle row by row.
+  void Pack(const float *err)
+  {
+    float is[6];
+    for (int i = 0; i < 6; ++i)
+    {
+      const float d = err[i*(i+1)/2 + i];
+      sigma[i] = d > 0 ? std::sqrt(d) : 0;
+      is[i]    = d > 0 ? 1 / sigma[i] : 0;
+    }
+    for (int i = 1, k = 0; i < 6; ++i)
+    {
+      for (int j = 0; j < i; ++j, ++k)
+      {
+        const float r = std::min(std::max(err[i*(i+1)/2 + j] * is[i] * is[j], -1.f), 1.f);
+        rho[k] = (short) std::lrint(r * kRhoScale);
+      }
+    }
+  }
+
+  void Unpack(float *err) const
+  {
+    for (int i = 0, k = 0; i < 6; ++i)
+    {
+      for (int j = 0; j < i; ++j, ++k)
+      {
+        err[i*(i+1)/2 + j] = rho[k] * (1 / kRhoScale) * sigma[i] * sigma[j];
+      }
+      err[i*(i+1)/2 + i] = sigma[i] * sigma[i];
+    }
+  }
+
+  void Pack(const SMatrixSym66& m) { Pack(m.Array()); }
+
+  SMatrixSym66 Unpack() const
+  {
+    SMatrixSym66 m;
+    Unpack(m.Array());
+    return m;
+  }
+};
+
 
 //==============================================================================
 
@@ -86,25 +145,197 @@ inline void sincos4(const float x, float& sin, float& cos)
   const Matriplex::idx_t LL =  6; // Dimension of large/long  MPlex entities
   const Matriplex::idx_t HH =  3; // Dimension of small/short MPlex entities
 
-  typedef Matriplex::Matriplex<float, LL, LL, NN>   MPlexLL;
-  typedef Matriplex::Matriplex<float, LL,  1, NN>   MPlexLV;
-  typedef Matriplex::MatriplexSym<float, LL,  NN>   MPlexLS;
+  // Width-templated MPlex types, for kernels instantiated for several
+  // widths (MkFitterT, PropagationMPlex, KalmanUtilsMPlex, ConformalUtilsMPlex).
+  // The plain names below are the NN-wide ones.
+
+  template<int W> using MPlexLL_T = Matriplex::Matriplex<float, LL, LL, W>;
+  template<int W> using MPlexLV_T = Matriplex::Matriplex<float, LL,  1, W>;
+  template<int W> using MPlexLS_T = Matriplex::MatriplexSym<float, LL,  W>;
+
+  template<int W> using MPlexHH_T = Matriplex::Matriplex<float, HH, HH, W>;
+  template<int W> using MPlexHV_T = Matriplex::Matriplex<float, HH,  1, W>;
+  template<int W> using MPlexHS_T = Matriplex::MatriplexSym<float, HH,  W>;
+
+  template<int W> using MPlex22_T = Matriplex::Matriplex<float, 2,  2, W>;
+  template<int W> using MPlex2V_T = Matriplex::Matriplex<float, 2,  1, W>;
+  template<int W> using MPlex2S_T = Matriplex::MatriplexSym<float,  2, W>;
+
+  template<int W> using MPlexLH_T = Matriplex::Matriplex<float, LL, HH, W>;
+  template<int W> using MPlexHL_T = Matriplex::Matriplex<float, HH, LL, W>;
+
+  template<int W> using MPlexL2_T = Matriplex::Matriplex<float, LL,  2, W>;
+
+  template<int W> using MPlexQF_T = Matriplex::Matriplex<float, 1, 1, W>;
+  template<int W> using MPlexQI_T = Matriplex::Matriplex<int,   1, 1, W>;
+
+  typedef MPlexLL_T<NN>   MPlexLL;
+  typedef MPlexLV_T<NN>   MPlexLV;
+  typedef MPlexLS_T<NN>   MPlexLS;
+
+  typedef MPlexHH_T<NN>   MPlexHH;
+  typedef MPlexHV_T<NN>   MPlexHV;
+  typedef MPlexHS_T<NN>   MPlexHS;
+
+  typedef MPlex22_T<NN>   MPlex22;
+  typedef MPlex2V_T<NN>   MPlex2V;
+  typedef MPlex2S_T<NN>   MPlex2S;
 
-  typedef Matriplex::Matriplex<float, HH, HH, NN>   MPlexHH;
-  typedef Matriplex::Matriplex<float, HH,  1, NN>   MPlexHV;
-  typedef Matriplex::MatriplexSym<float, HH,  NN>   MPlexHS;
+  typedef MPlexLH_T<NN>   MPlexLH;
+  typedef MPlexHL_T<NN>   MPlexHL;
 
-  typedef Matriplex::Matriplex<float, 2,  2, NN>    MPlex22;
-  typedef Matriplex::Matriplex<float, 2,  1, NN>    MPlex2V;
-  typedef Matriplex::MatriplexSym<float,  2, NN>    MPlex2S;
+  typedef MPlexL2_T<NN>   MPlexL2;
 
-  typedef Matriplex::Matriplex<float, LL, HH, NN>   MPlexLH;
-  typedef Matriplex::Matriplex<float, HH, LL, NN>   MPlexHL;
+  typedef MPlexQF_T<NN>   MPlexQF;
+  typedef MPlexQI_T<NN>   MPlexQI;
 
-  typedef Matriplex::Matriplex<float, LL,  2, NN>   MPlexL2;
+  // Widths the templated kernels are available in, as M(width), and the
+  // widths a given translation unit instantiates them for. MIC and plain AVX
+  // intrinsics have no masked load / store so only multiples of the vector
+  // width work there. NN is always included.
+  //
+  // With WITH_ISA_VARIANTS (Makefile.config) the widths are those of the
+  // variants, MKFIT_ISA_WIDTHS. Kernel objects of a variant are built with
+  // MPLEX_VARIANT_WIDTH and instantiate only that width, the host objects
+  // instantiate none.
 
-  typedef Matriplex::Matriplex<float, 1, 1, NN>     MPlexQF;
-  typedef Matriplex::Matriplex<int,   1, 1, NN>     MPlexQI;
+  #if defined(MKFIT_ISA_WIDTHS)
+    #define MPLEX_FOR_EACH_WIDTH(M) MKFIT_ISA_WIDTHS(M)
+  #elif defined(MIC_INTRINSICS)
+    #define MPLEX_FOR_EACH_WIDTH_ISA(M) M(16)
+    #define MPLEX_ISA_HAS_NN (MPT_SIZE == 16)
+  #elif defined(AVX_INTRINSICS) && ! defined(__AVX2__)
+    #define MPLEX_FOR_EACH_WIDTH_ISA(M) M(8) M(16)
+    #define MPLEX_ISA_HAS_NN (MPT_SIZE == 8 || MPT_SIZE == 16)
+  #else
+    #define MPLEX_FOR_EACH_WIDTH_ISA(M) M(4) M(8) M(16)
+    #define MPLEX_ISA_HAS_NN (MPT_SIZE == 4 || MPT_SIZE == 8 || MPT_SIZE == 16)
+  #endif
+
+  #if defined(MKFIT_ISA_WIDTHS)
+  #elif MPLEX_ISA_HAS_NN
+    #define MPLEX_FOR_EACH_WIDTH(M) MPLEX_FOR_EACH_WIDTH_ISA(M)
+  #else
+    #define MPLEX_FOR_EACH_WIDTH(M) MPLEX_FOR_EACH_WIDTH_ISA(M) M(MPT_SIZE)
+  #endif
+
+  #if defined(MPLEX_VARIANT_WIDTH)
+    #define MPLEX_FOR_EACH_KERNEL_WIDTH(M) M(MPLEX_VARIANT_WIDTH)
+  #elif defined(MKFIT_ISA_WIDTHS)
+    #define MPLEX_FOR_EACH_KERNEL_WIDTH(M)
+  #else
+    #define MPLEX_FOR_EACH_KERNEL_WIDTH(M) MPLEX_FOR_EACH_WIDTH(M)
+  #endif
+
+  inline bool isMPlexWidthAvailable(int w)
+  {
+    #define MPLEX_WIDTH_MATCH(W) if (w == W) return true;
+    MPLEX_FOR_EACH_WIDTH(MPLEX_WIDTH_MATCH)
+    #undef MPLEX_WIDTH_MATCH
+    return false;
+  }
+
+  // CompactSym66 <-> MPlexLS for the first n_proc slots; on input the
+  // remaining slots get a copy of the first matrix.
+
+  template<int W>
+  void CopyInCompact(MPlexLS_T<W>& A, const CompactSym66 *const *src, int n_proc)
+  {
+    float s[6  * W] __attribute__((aligned(64)));
+    float r[15 * W] __attribute__((aligned(64)));
+
+    const float *sp[W];
+    for (int n = 0; n < W; ++n)
+    {
+      const CompactSym66 &c = *src[n < n_proc ? n : 0];
+      sp[n] = c.sigma;
+      for (int k = 0; k < 15; ++k) r[k*W + n] = c.rho[k];
+    }
+    Matriplex::TransposeIn<W>(s, 6, sp, W);
+
+    float *a = A.fArray; ASSUME_ALIGNED(a, 64);
+
+    for (int i = 0, k = 0; i < 6; ++i)
+    {
+      for (int j = 0; j < i; ++j, ++k)
+      {
+        float *aij = a + (i*(i+1)/2 + j) * W;
+#pragma simd
+        for (int n = 0; n < W; ++n)
+        {
+          aij[n] = r[k*W + n] * (1 / CompactSym66::kRhoScale) * s[i*W + n] * s[j*W + n];
+        }
+      }
+      float *aii = a + (i*(i+1)/2 + i) * W;
+#pragma simd
+      for (int n = 0; n < W; ++n)
+      {
+        aii[n] = s[i*W + n] * s[i*W + n];
+      }
+    }
+  }
+
+  template<int W>
+  void CopyOutCompact(const MPlexLS_T<W>& A, CompactSym66 *const *dst, int n_proc)
+  {
+    float d [6  * W] __attribute__((aligned(64)));
+    float x [6  * W] __attribute__((aligned(64)));
+    float is[6  * W] __attribute__((aligned(64)));
+    float s [6  * W] __attribute__((aligned(64)));
+    short r [15 * W] __attribute__((aligned(64)));
+
+    const float *a = A.fArray; ASSUME_ALIGNED(a, 64);
+
+    for (int i = 0; i < 6; ++i)
+    {
+      const float *aii = a + (i*(i+1)/2 + i) * W;
+#pragma simd
+      for (int n = 0; n < W; ++n)
+      {
+        d[i*W + n] = aii[n];
+      }
+    }
+#pragma simd
+    for (int m = 0; m < 6 * W; ++m)
+    {
+      x[m] = d[m] > 0 ? d[m] : 1;
+    }
+    Matriplex::InvSqrt<float, 6 * W>(x, is);
+#pragma simd
+    for (int m = 0; m < 6 * W; ++m)
+    {
+      is[m] = d[m] > 0 ? is[m] : 0;
+      s [m] = d[m] * is[m];
+    }
+
+    for (int i = 1, k = 0; i < 6; ++i)
+    {
+      for (int j = 0; j < i; ++j, ++k)
+      {
+        const float *aij = a + (i*(i+1)/2 + j) * W;
+#pragma simd
+        for (int n = 0; n < W; ++n)
+        {
+          // Clamp with plain selects and round with rint, gcc does not
+          // vectorize this loop with std::min/max or +-0.5 rounding.
+          float q = aij[n] * is[i*W + n] * is[j*W + n] * CompactSym66::kRhoScale;
+          q = q < -CompactSym66::kRhoScale ? -CompactSym66::kRhoScale : q;
+          q = q >  CompactSym66::kRhoScale ?  CompactSym66::kRhoScale : q;
+          r[k*W + n] = (short) (int) std::rint(q);
+        }
+      }
+    }
+
+    float *sp[W];
+    for (int n = 0; n < n_proc; ++n) sp[n] = dst[n]->sigma;
+    Matriplex::TransposeOut<W>(s, 6, sp, n_proc);
+
+    for (int n = 0; n < n_proc; ++n)
+    {
+      short *rho = dst[n]->rho;
+      for (int k = 0; k < 15; ++k) rho[k] = r[k*W + n];
+    }
+  }
 
 #endif
 
@@ -71,10 +71,7 @@ void setupTrackByToyMC(SVector3& pos, SVector3& mom, SMatrixSym66& covtrk,
 
   // useful info for loopers/overlaps
 
-  int layer_counts[Config::nLayers];
-  for (int ilayer=0;ilayer<Config::nLayers;++ilayer){
-    layer_counts[ilayer]=0;
-  }
+  std::vector<int> layer_counts(Config::nLayers, 0);
 
   // to include loopers would rather add a break on the code if nLayers
   // if block BREAK if hit.Layer == theGeom->CountLayers() 
@@ -354,10 +351,7 @@ void setupTrackByToyMCEndcap(SVector3& pos, SVector3& mom, SMatrixSym66& covtrk,
     hits.reserve(Config::nTotHit);
     initTSs.reserve(Config::nTotHit);
 
-    int layer_counts[Config::nLayers];
-    for (int ilayer=0;ilayer<Config::nLayers;++ilayer){
-      layer_counts[ilayer]=0;
-    }
+    std::vector<int> layer_counts(Config::nLayers, 0);
 
     TrackState initState;
     initState.parameters=SVector6(pos[0],pos[1],pos[2],mom[0],mom[1],mom[2]);
@@ -435,10 +429,7 @@ void setupTrackFromTextFile(SVector3& pos, SVector3& mom, SMatrixSym66& covtrk,
   const float varXY  = hitposerrXY*hitposerrXY;
   const float varZ   = hitposerrZ*hitposerrZ;
 
-  int layer_counts[Config::nLayers];
-  for (int ilayer=0;ilayer<Config::nLayers;++ilayer){
-    layer_counts[ilayer]=0;
-  }
+  std::vector<int> layer_counts(Config::nLayers, 0);
   int nTotHit = Config::nLayers; // can tune this number!
   // to include loopers, and would rather add a break on the code if layer ten exceeded
   // if block BREAK if hit.Layer == theGeom->CountLayers() 
@@ -142,13 +142,13 @@ public:
 
   // mc truth
   int mccharge_debug_;
-  int layer_mc_debug_[Config::nLayers];
-  float x_hit_debug_[Config::nLayers],y_hit_debug_[Config::nLayers],z_hit_debug_[Config::nLayers];
-  float exx_hit_debug_[Config::nLayers],eyy_hit_debug_[Config::nLayers],ezz_hit_debug_[Config::nLayers];
-  float x_mc_debug_[Config::nLayers],y_mc_debug_[Config::nLayers],z_mc_debug_[Config::nLayers];
-  float px_mc_debug_[Config::nLayers],py_mc_debug_[Config::nLayers],pz_mc_debug_[Config::nLayers];
-  float pt_mc_debug_[Config::nLayers],phi_mc_debug_[Config::nLayers],eta_mc_debug_[Config::nLayers];
-  float invpt_mc_debug_[Config::nLayers],theta_mc_debug_[Config::nLayers];
+  int layer_mc_debug_[Config::nMaxLayers];
+  float x_hit_debug_[Config::nMaxLayers],y_hit_debug_[Config::nMaxLayers],z_hit_debug_[Config::nMaxLayers];
+  float exx_hit_debug_[Config::nMaxLayers],eyy_hit_debug_[Config::nMaxLayers],ezz_hit_debug_[Config::nMaxLayers];
+  float x_mc_debug_[Config::nMaxLayers],y_mc_debug_[Config::nMaxLayers],z_mc_debug_[Config::nMaxLayers];
+  float px_mc_debug_[Config::nMaxLayers],py_mc_debug_[Config::nMaxLayers],pz_mc_debug_[Config::nMaxLayers];
+  float pt_mc_debug_[Config::nMaxLayers],phi_mc_debug_[Config::nMaxLayers],eta_mc_debug_[Config::nMaxLayers];
+  float invpt_mc_debug_[Config::nMaxLayers],theta_mc_debug_[Config::nMaxLayers];
 
   // track info
   int recocharge_debug_;
@@ -160,34 +160,34 @@ public:
   float invpt_cf_debug_,theta_cf_debug_,einvpt_cf_debug_,etheta_cf_debug_;
 
   // chi2 info
-  int layer_chi2_debug_[Config::nLayers];
-  float chi2_debug_[Config::nLayers];
+  int layer_chi2_debug_[Config::nMaxLayers];
+  float chi2_debug_[Config::nMaxLayers];
 
   // prop info
-  int layer_prop_debug_[Config::nLayers];
-  float x_prop_debug_[Config::nLayers],y_prop_debug_[Config::nLayers],z_prop_debug_[Config::nLayers];
-  float exx_prop_debug_[Config::nLayers],eyy_prop_debug_[Config::nLayers],ezz_prop_debug_[Config::nLayers];
-  float px_prop_debug_[Config::nLayers],py_prop_debug_[Config::nLayers],pz_prop_debug_[Config::nLayers];
-  float epxpx_prop_debug_[Config::nLayers],epypy_prop_debug_[Config::nLayers],epzpz_prop_debug_[Config::nLayers];
-  float pt_prop_debug_[Config::nLayers],phi_prop_debug_[Config::nLayers],eta_prop_debug_[Config::nLayers];
-  float ept_prop_debug_[Config::nLayers],ephi_prop_debug_[Config::nLayers],eeta_prop_debug_[Config::nLayers];
-  float invpt_prop_debug_[Config::nLayers],theta_prop_debug_[Config::nLayers];
-  float einvpt_prop_debug_[Config::nLayers],etheta_prop_debug_[Config::nLayers];
+  int layer_prop_debug_[Config::nMaxLayers];
+  float x_prop_debug_[Config::nMaxLayers],y_prop_debug_[Config::nMaxLayers],z_prop_debug_[Config::nMaxLayers];
+  float exx_prop_debug_[Config::nMaxLayers],eyy_prop_debug_[Config::nMaxLayers],ezz_prop_debug_[Config::nMaxLayers];
+  float px_prop_debug_[Config::nMaxLayers],py_prop_debug_[Config::nMaxLayers],pz_prop_debug_[Config::nMaxLayers];
+  float epxpx_prop_debug_[Config::nMaxLayers],epypy_prop_debug_[Config::nMaxLayers],epzpz_prop_debug_[Config::nMaxLayers];
+  float pt_prop_debug_[Config::nMaxLayers],phi_prop_debug_[Config::nMaxLayers],eta_prop_debug_[Config::nMaxLayers];
+  float ept_prop_debug_[Config::nMaxLayers],ephi_prop_debug_[Config::nMaxLayers],eeta_prop_debug_[Config::nMaxLayers];
+  float invpt_prop_debug_[Config::nMaxLayers],theta_prop_debug_[Config::nMaxLayers];
+  float einvpt_prop_debug_[Config::nMaxLayers],etheta_prop_debug_[Config::nMaxLayers];
 
   // update info
-  int layer_up_debug_[Config::nLayers];
-  float x_up_debug_[Config::nLayers],y_up_debug_[Config::nLayers],z_up_debug_[Config::nLayers];
-  float exx_up_debug_[Config::nLayers],eyy_up_debug_[Config::nLayers],ezz_up_debug_[Config::nLayers];
-  float px_up_debug_[Config::nLayers],py_up_debug_[Config::nLayers],pz_up_debug_[Config::nLayers];
-  float epxpx_up_debug_[Config::nLayers],epypy_up_debug_[Config::nLayers],epzpz_up_debug_[Config::nLayers];
-  float pt_up_debug_[Config::nLayers],phi_up_debug_[Config::nLayers],eta_up_debug_[Config::nLayers];
-  float ept_up_debug_[Config::nLayers],ephi_up_debug_[Config::nLayers],eeta_up_debug_[Config::nLayers];
-  float invpt_up_debug_[Config::nLayers],theta_up_debug_[Config::nLayers];
-  float einvpt_up_debug_[Config::nLayers],etheta_up_debug_[Config::nLayers];
+  int layer_up_debug_[Config::nMaxLayers];
+  float x_up_debug_[Config::nMaxLayers],y_up_debug_[Config::nMaxLayers],z_up_debug_[Config::nMaxLayers];
+  float exx_up_debug_[Config::nMaxLayers],eyy_up_debug_[Config::nMaxLayers],ezz_up_debug_[Config::nMaxLayers];
+  float px_up_debug_[Config::nMaxLayers],py_up_debug_[Config::nMaxLayers],pz_up_debug_[Config::nMaxLayers];
+  float epxpx_up_debug_[Config::nMaxLayers],epypy_up_debug_[Config::nMaxLayers],epzpz_up_debug_[Config::nMaxLayers];
+  float pt_up_debug_[Config::nMaxLayers],phi_up_debug_[Config::nMaxLayers],eta_up_debug_[Config::nMaxLayers];
+  float ept_up_debug_[Config::nMaxLayers],ephi_up_debug_[Config::nMaxLayers],eeta_up_debug_[Config::nMaxLayers];
+  float invpt_up_debug_[Config::nMaxLayers],theta_up_debug_[Config::nMaxLayers];
+  float einvpt_up_debug_[Config::nMaxLayers],etheta_up_debug_[Config::nMaxLayers];
 
   // eta/phi bin info
-  int ebhit_debug_[Config::nLayers], ebp_debug_[Config::nLayers], ebm_debug_[Config::nLayers];
-  int pbhit_debug_[Config::nLayers], pbp_debug_[Config::nLayers], pbm_debug_[Config::nLayers];
+  int ebhit_debug_[Config::nMaxLayers], ebp_debug_[Config::nMaxLayers], ebm_debug_[Config::nMaxLayers];
+  int pbhit_debug_[Config::nMaxLayers], pbp_debug_[Config::nMaxLayers], pbm_debug_[Config::nMaxLayers];
 
   // seedinfo tree
   TTree* seedinfotree_;
@@ -331,13 +331,13 @@ public:
   // Fit tree (for fine tuning z-phi windows and such --> MPlex Only
   TTree* fittree_;
   int   nlayers_fit_=0,tkid_fit_=0,evtid_fit_=0;
-  float z_prop_fit_[Config::nLayers],ez_prop_fit_[Config::nLayers];
-  float z_hit_fit_[Config::nLayers],ez_hit_fit_[Config::nLayers],z_sim_fit_[Config::nLayers],ez_sim_fit_[Config::nLayers];
-  float pphi_prop_fit_[Config::nLayers],epphi_prop_fit_[Config::nLayers];
-  float pphi_hit_fit_[Config::nLayers],epphi_hit_fit_[Config::nLayers],pphi_sim_fit_[Config::nLayers],epphi_sim_fit_[Config::nLayers];
-  float pt_up_fit_[Config::nLayers],ept_up_fit_[Config::nLayers],pt_sim_fit_[Config::nLayers],ept_sim_fit_[Config::nLayers];
-  float mphi_up_fit_[Config::nLayers],emphi_up_fit_[Config::nLayers],mphi_sim_fit_[Config::nLayers],emphi_sim_fit_[Config::nLayers];
-  float meta_up_fit_[Config::nLayers],emeta_up_fit_[Config::nLayers],meta_sim_fit_[Config::nLayers],emeta_sim_fit_[Config::nLayers];
+  float z_prop_fit_[Config::nMaxLayers],ez_prop_fit_[Config::nMaxLayers];
+  float z_hit_fit_[Config::nMaxLayers],ez_hit_fit_[Config::nMaxLayers],z_sim_fit_[Config::nMaxLayers],ez_sim_fit_[Config::nMaxLayers];
+  float pphi_prop_fit_[Config::nMaxLayers],epphi_prop_fit_[Config::nMaxLayers];
+  float pphi_hit_fit_[Config::nMaxLayers],epphi_hit_fit_[Config::nMaxLayers],pphi_sim_fit_[Config::nMaxLayers],epphi_sim_fit_[Config::nMaxLayers];
+  float pt_up_fit_[Config::nMaxLayers],ept_up_fit_[Config::nMaxLayers],pt_sim_fit_[Config::nMaxLayers],ept_sim_fit_[Config::nMaxLayers];
+  float mphi_up_fit_[Config::nMaxLayers],emphi_up_fit_[Config::nMaxLayers],mphi_sim_fit_[Config::nMaxLayers],emphi_sim_fit_[Config::nMaxLayers];
+  float meta_up_fit_[Config::nMaxLayers],emeta_up_fit_[Config::nMaxLayers],meta_sim_fit_[Config::nMaxLayers],emeta_sim_fit_[Config::nMaxLayers];
 
   std::mutex glock_;
 };
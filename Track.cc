@@ -1,7 +1,33 @@
 #include "Track.h"
+
+#include <cstring>
 //#define DEBUG
 #include "Debug.h"
 
+void Track::toFileBytes(char *buf) const
+{
+  const char *beg  = reinterpret_cast<const char*>(this);
+  const int   head = reinterpret_cast<const char*>(hitIdxArr_) - beg + Config::nLayers * sizeof(int);
+  const int   tail = reinterpret_cast<const char*>(hitIdxArr_ + Config::nMaxLayers) - beg;
+
+  memcpy(buf,        beg,        head);
+  memcpy(buf + head, beg + tail, sizeof(Track) - tail);
+}
+
+void Track::fromFileBytes(const char *buf)
+{
+  char      *beg  = reinterpret_cast<char*>(this);
+  const int  head = reinterpret_cast<char*>(hitIdxArr_) - beg + Config::nLayers * sizeof(int);
+  const int  tail = reinterpret_cast<char*>(hitIdxArr_ + Config::nMaxLayers) - beg;
+
+  memcpy(beg,        buf,        head);
+  memcpy(beg + tail, buf + head, sizeof(Track) - tail);
+  for (int h = Config::nLayers; h < Config::nMaxLayers; ++h)
+  {
+    hitIdxArr_[h] = -1;
+  }
+}
+
 void TrackState::convertFromCartesianToCCS() {
   //assume we are currently in cartesian coordinates and want to move to ccs
   const float px = parameters.At(3);
@@ -110,16 +110,24 @@ public:
   SMatrix66 jacobianCartesianToCCS(float px,float py,float pz) const;
 };
 
+// With COMPACT_TRACK_ERRORS Track keeps its errors as CompactSym66 (see
+// Matrix.h): errors() and state() return expanded copies, MkFitter packs
+// and unpacks them when copying tracks to and from Matriplexes.
+
+#if defined(COMPACT_TRACK_ERRORS) && defined(USE_CUDA)
+#error "COMPACT_TRACK_ERRORS is not supported with USE_CUDA"
+#endif
+
 class Track
 {
 public:
   Track() {}
 
   Track(const TrackState& state, float chi2, int label, int nHits, const int* hitIdxArr) :
-    state_(state),
     chi2_(chi2),
     label_(label)
   {
+    setState(state);
     for (int h = 0; h < nHits; ++h)
     {
       addHitIdx(hitIdxArr[h],0.0f);
@@ -130,10 +138,37 @@ public:
   }
   
   Track(int charge, const SVector3& position, const SVector3& momentum, const SMatrixSym66& errors, float chi2) :
-    state_(charge, position, momentum, errors), chi2_(chi2) {}
+    chi2_(chi2)
+  {
+    setState(TrackState(charge, position, momentum, errors));
+  }
 
   ~Track(){}
 
+#ifdef COMPACT_TRACK_ERRORS
+  const SVector6&     parameters() const {return parameters_;}
+  SMatrixSym66        errors()     const {return errors_.Unpack();}
+  TrackState          state()      const {TrackState s = param_state(); s.errors = errors(); return s;}
+
+  const float* posArray() const {return parameters_.Array();}
+
+  // Non-const versions needed for CopyOut of Matriplex.
+  SVector6&     parameters_nc() {return parameters_;}
+
+  const CompactSym66& errors_compact()    const {return errors_;}
+  CompactSym66&       errors_compact_nc()       {return errors_;}
+
+  int  charge() const     {return charge_;}
+  void setCharge(int chg) {charge_=chg;}
+
+  void setState(const TrackState& newState)
+  {
+    parameters_ = newState.parameters;
+    errors_.Pack(newState.errors);
+    charge_     = newState.charge;
+    valid_      = newState.valid;
+  }
+#else
   const SVector6&     parameters() const {return state_.parameters;}
   const SMatrixSym66& errors()     const {return state_.errors;}
   const TrackState&   state()      const {return state_;}
@@ -151,35 +186,41 @@ public:
   SMatrixSym66& errors_nc()     {return state_.errors;}
   TrackState&   state_nc()      {return state_;}
 
-  SVector3 position() const {return SVector3(state_.parameters[0],state_.parameters[1],state_.parameters[2]);}
-  SVector3 momentum() const {return SVector3(state_.parameters[3],state_.parameters[4],state_.parameters[5]);}
-
   CUDA_CALLABLE
   int      charge() const {return state_.charge;}
+  CUDA_CALLABLE
+  void setCharge(int chg)  {state_.charge=chg;}
+
+  void setState(const TrackState& newState) {state_=newState;}
+#endif
+
+  SVector3 position() const {return SVector3(parameters()[0],parameters()[1],parameters()[2]);}
+  SVector3 momentum() const {return SVector3(parameters()[3],parameters()[4],parameters()[5]);}
+
   CUDA_CALLABLE
   float    chi2()   const {return chi2_;}
   CUDA_CALLABLE
   int      label()  const {return label_;}
 
-  float x()      const { return state_.parameters[0];}
-  float y()      const { return state_.parameters[1];}
-  float z()      const { return state_.parameters[2];}
-  float posR()   const { return getHypot(state_.parameters[0],state_.parameters[1]); }
-  float posPhi() const { return getPhi(state_.parameters[0],state_.parameters[1]); }
-  float posEta() const { return getEta(state_.parameters[0],state_.parameters[1],state_.parameters[2]); }
-
-  float px()     const { return state_.px();}
-  float py()     const { return state_.py();}
-  float pz()     const { return state_.pz();}
-  float pT()     const { return state_.pT(); }
-  float p()     const { return state_.p(); }
-  float momPhi() const { return state_.momPhi(); }
-  float momEta() const { return state_.momEta(); }
+  float x()      const { return parameters()[0];}
+  float y()      const { return parameters()[1];}
+  float z()      const { return parameters()[2];}
+  float posR()   const { return getHypot(parameters()[0],parameters()[1]); }
+  float posPhi() const { return getPhi(parameters()[0],parameters()[1]); }
+  float posEta() const { return getEta(parameters()[0],parameters()[1],parameters()[2]); }
+
+  float px()     const { return param_state().px();}
+  float py()     const { return param_state().py();}
+  float pz()     const { return param_state().pz();}
+  float pT()     const { return param_state().pT(); }
+  float p()     const { return param_state().p(); }
+  float momPhi() const { return param_state().momPhi(); }
+  float momEta() const { return param_state().momEta(); }
 
   // track state momentum errors
-  float epT()     const { return state_.epT();}
-  float emomPhi() const { return state_.emomPhi();}
-  float emomEta() const { return state_.emomEta();}
+  float epT()     const { return state().epT();}
+  float emomPhi() const { return state().emomPhi();}
+  float emomEta() const { return state().emomEta();}
   
   //this function is very inefficient, use only for debug and validation!
   const HitVec hitsVector(const std::vector<HitVec>& globalHitVec) const 
@@ -268,21 +309,42 @@ public:
     return layers;
   }
 
-  CUDA_CALLABLE
-  void setCharge(int chg)  {state_.charge=chg;}
   CUDA_CALLABLE
   void setChi2(float chi2) {chi2_=chi2;}
   CUDA_CALLABLE
   void setLabel(int lbl)   {label_=lbl;}
 
-  void setState(const TrackState& newState) {state_=newState;}
+  Track clone() const { return Track(state(),chi2_,label_,nTotalHits(),hitIdxArr_); }
 
-  Track clone() const { return Track(state_,chi2_,label_,nTotalHits(),hitIdxArr_); }
+  // Event files keep the raw bytes of a track with the hit index array cut to
+  // Config::nLayers entries, so they do not depend on nMaxLayers.
+  static int fileSize() { return sizeof(Track) - (Config::nMaxLayers - Config::nLayers) * sizeof(int); }
+  void toFileBytes  (char *buf) const;
+  void fromFileBytes(const char *buf);
 
 private:
+#ifdef COMPACT_TRACK_ERRORS
+  // State for the accessors that only need parameters and charge.
+  TrackState param_state() const
+  {
+    TrackState s;
+    s.parameters = parameters_;
+    s.charge     = charge_;
+    s.valid      = valid_;
+    return s;
+  }
+
+  SVector6     parameters_;
+  CompactSym66 errors_;
+  short        charge_ = 0;
+  bool         valid_  = true;
+#else
+  const TrackState& param_state() const {return state_;}
+
   TrackState state_;
+#endif
   float chi2_ = 0.;
-  int   hitIdxArr_[Config::nLayers];
+  int   hitIdxArr_[Config::nMaxLayers];
   int   hitIdxPos_ = -1;
   int   nGoodHitIdx_ =  0;
   int   label_       = -1;
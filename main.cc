@@ -175,6 +175,7 @@ int main(int argc, const char* argv[])
         "Options:\n"
         "  --num-events    <num>    number of events to run over (def: %d)\n"
         "  --num-tracks    <num>    number of tracks to generate for each event (def: %d)\n"
+        "  --num-layers    <num>    number of detector layers (def: %d, max: %d)\n"
 	"  --num-thr       <num>    number of threads used for TBB  (def: %d)\n"
 	"  --super-debug            bool to enable super debug mode (def: %s)\n"
 	"  --normal-val             bool to enable normal validation (eff, FR, DR) (def: %s)\n"
@@ -184,10 +185,14 @@ int main(int argc, const char* argv[])
 	"  --file-name              file name for write/read (def: %s)\n"
 	"  --cmssw-seeds            take seeds from CMSSW (def: %i)\n"
 	"  --endcap-test            test endcap tracking (def: %i)\n"
+	"  --eta-det       <num>    eta extent of the detector, sets the eta binning (def: %g; cmssw tests: 2, endcap 2.5)\n"
+	"  --chi2-cut      <num>    chi2 cut for adding a hit to a candidate (def: %g; cmssw tests: 30)\n"
+	"  --min-dphi      <num>    minimum half width in phi of the hit search window (def: %g; cmssw tests: 0.01)\n"
         ,
         argv[0],
         Config::nEvents,
         Config::nTracks,
+        Config::nLayers, Config::nMaxLayers,
         nThread, 
 	(Config::super_debug ? "true" : "false"),
 	(Config::normal_val  ? "true" : "false"),
@@ -195,7 +200,8 @@ int main(int argc, const char* argv[])
 	(Config::cf_seeding  ? "true" : "false"),
 	s_file_name.c_str(),
 	Config::readCmsswSeeds,
-	Config::endcapTest
+	Config::endcapTest,
+	Config::fEtaDet, Config::chi2Cut, Config::minDPhi
       );
       exit(0);
     }
@@ -209,6 +215,11 @@ int main(int argc, const char* argv[])
       next_arg_or_die(mArgs, i);
       Config::nTracks = atoi(i->c_str());
     }
+    else if (*i == "--num-layers")
+    {
+      next_arg_or_die(mArgs, i);
+      Config::nLayers = atoi(i->c_str());
+    }
     else if (*i == "--num-thr")
     {
       next_arg_or_die(mArgs, i);
@@ -256,6 +267,21 @@ int main(int argc, const char* argv[])
     {
       Config::endcapTest = true;
     }
+    else if (*i == "--eta-det")
+    {
+      next_arg_or_die(mArgs, i);
+      Config::fEtaDet = atof(i->c_str());
+    }
+    else if (*i == "--chi2-cut")
+    {
+      next_arg_or_die(mArgs, i);
+      Config::chi2Cut = atof(i->c_str());
+    }
+    else if (*i == "--min-dphi")
+    {
+      next_arg_or_die(mArgs, i);
+      Config::minDPhi = atof(i->c_str());
+    }
     else
     {
       fprintf(stderr, "Error: Unknown option/argument '%s'.\n", i->c_str());
@@ -264,6 +290,14 @@ int main(int argc, const char* argv[])
     mArgs.erase(start, ++i);
   }
 
+  if ( ! Config::SetupLayers())
+  {
+    fprintf(stderr, "Error: %d layers not supported by this geometry (max: %d).\n",
+            Config::nLayers, Config::nMaxLayers);
+    exit(1);
+  }
+  Config::RecalculateDependentConstants();
+
   Geometry geom;
   initGeom(geom);
 #if defined(NO_ROOT)
@@ -99,7 +99,7 @@ void CandCloner::DoWorkInSideThread(CandClonerWork_t work)
 
   while (beg != the_end)
   {
-    int end = std::min(beg + s_max_seed_range, the_end);
+    int end = std::min(beg + m_max_seed_range, the_end);
 
     // printf("CandCloner::DoWorkInSideThread processing %4d -> %4d\n", beg, end);
 
@@ -15,22 +15,24 @@ typedef std::pair<int, int> CandClonerWork_t;
 class CandCloner : public SideThread<CandClonerWork_t>
 {
 public:
-  // Maximum number of seeds processed in one call to ProcessSeedRange()
-  static const int s_max_seed_range = MPT_SIZE;
+  // Maximum number of seeds processed in one call to ProcessSeedRange(),
+  // the Matriplex width clone-engine building runs with.
+  const int m_max_seed_range;
 
 private:
   // Temporaries in ProcessSeedRange(), re-sized/served  in constructor.
 
-  // Size of this one is s_max_seed_range
+  // Size of this one is m_max_seed_range
   std::vector<std::vector<Track> > t_cands_for_next_lay;
 
 public:
-  CandCloner(int cpuid=-1, int cpuid_st=-1, bool pin_mt=true)
+  CandCloner(int cpuid=-1, int cpuid_st=-1, bool pin_mt=true) :
+    m_max_seed_range(Config::buildVecWidth > 0 ? Config::buildVecWidth : NN)
   {
     // m_fitter = new (_mm_malloc(sizeof(MkFitter), 64)) MkFitter(0);
 
-    t_cands_for_next_lay.resize(s_max_seed_range);
-    for (int iseed = 0; iseed < s_max_seed_range; ++iseed)
+    t_cands_for_next_lay.resize(m_max_seed_range);
+    for (int iseed = 0; iseed < m_max_seed_range; ++iseed)
     {
       t_cands_for_next_lay[iseed].reserve(Config::maxCandsPerSeed);
     }
@@ -108,10 +110,10 @@ public:
 
     // printf("CandCloner::end_iteration process %d, max_prev=%d, max=%d\n", proc_n, m_idx_max_prev, m_idx_max);
 
-    if (proc_n >= s_max_seed_range)
+    if (proc_n >= m_max_seed_range)
     {
-      // Round to multiple of s_max_seed_range.
-      signal_work_to_st((m_idx_max / s_max_seed_range) * s_max_seed_range);
+      // Round to multiple of m_max_seed_range.
+      signal_work_to_st((m_idx_max / m_max_seed_range) * m_max_seed_range);
     }
   }
 
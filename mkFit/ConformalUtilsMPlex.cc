@@ -1,12 +1,14 @@
 #include "ConformalUtilsMPlex.h"
 #include "Track.h"
 #include "Hit.h"
+#include "MathMPlex.h"
 
 //#define DEBUG
 #include "Debug.h"
 
+template<int NN>
 inline
-void CFMap(const MPlexHH& A, const MPlexHV& B, MPlexHV& C)
+void CFMap(const MPlexHH_T<NN>& A, const MPlexHV_T<NN>& B, MPlexHV_T<NN>& C)
 {
   using idx_t = Matriplex::idx_t;
 
@@ -26,8 +28,9 @@ void CFMap(const MPlexHH& A, const MPlexHV& B, MPlexHV& C)
 //M. Hansroul, H. Jeremie and D. Savard, NIM A 270 (1988) 498
 //http://www.sciencedirect.com/science/article/pii/016890028890722X
 
-void conformalFitMPlex(bool fitting, MPlexQI seedID, MPlexLS& outErr, MPlexLV& outPar, 
-		       const MPlexHV& msPar0, const MPlexHV& msPar1, const MPlexHV& msPar2)
+template<int NN>
+void conformalFitMPlex(bool fitting, MPlexQI_T<NN> seedID, MPlexLS_T<NN>& outErr, MPlexLV_T<NN>& outPar, 
+		       const MPlexHV_T<NN>& msPar0, const MPlexHV_T<NN>& msPar1, const MPlexHV_T<NN>& msPar2)
 {
   bool debug(false);
 
@@ -35,7 +38,7 @@ void conformalFitMPlex(bool fitting, MPlexQI seedID, MPlexLS& outErr, MPlexLV& o
   const idx_t N = NN;
 
   // Store positions in mplex vectors... could consider storing in a 3x3 matrix, too
-  MPlexHV x, y, z, r2;
+  MPlexHV_T<NN> x, y, z, r2;
 #pragma simd
   for (int n = 0; n < N; ++n) 
   {
@@ -84,16 +87,16 @@ void conformalFitMPlex(bool fitting, MPlexQI seedID, MPlexLS& outErr, MPlexLV& o
     outErr.At(n, 2, 2) = Config::varZ;
   }
   
-  MPlexQF initPhi;
-  MPlexQI xtou; // bool to determine "split space", i.e. map x to u or v
+  MPlexQF_T<NN> initPhi;
+  MPlexQI_T<NN> xtou; // bool to determine "split space", i.e. map x to u or v
 #pragma simd
   for (int n = 0; n < N; ++n) 
   {
-    initPhi.At(n, 0, 0) = std::abs(getPhi(x.ConstAt(n, 0, 0), y.ConstAt(n, 0, 0)));
+    initPhi.At(n, 0, 0) = std::abs(VecMath::atan2(y.ConstAt(n, 0, 0), x.ConstAt(n, 0, 0)));
     xtou.At(n, 0, 0)    = ((initPhi.ConstAt(n, 0, 0) < Config::PIOver4 || initPhi.ConstAt(n, 0, 0) > Config::PI3Over4) ? 1 : 0);
   }
 
-  MPlexHV u,v;
+  MPlexHV_T<NN> u,v;
 #pragma simd
   for (int n = 0; n < N; ++n) 
   {
@@ -115,7 +118,7 @@ void conformalFitMPlex(bool fitting, MPlexQI seedID, MPlexLS& outErr, MPlexLV& o
     }
   }
 
-  MPlexHH A;
+  MPlexHH_T<NN> A;
 #pragma simd
   for (int n = 0; n < N; ++n) 
   {
@@ -127,10 +130,10 @@ void conformalFitMPlex(bool fitting, MPlexQI seedID, MPlexLS& outErr, MPlexLV& o
     }
   }
   Matriplex::InvertCramer(A);  
-  MPlexHV C; 
+  MPlexHV_T<NN> C; 
   CFMap(A, v, C);
   
-  MPlexQF a,b;
+  MPlexQF_T<NN> a,b;
 #pragma simd
   for (int n = 0; n < N; ++n) 
   {
@@ -141,7 +144,7 @@ void conformalFitMPlex(bool fitting, MPlexQI seedID, MPlexLS& outErr, MPlexLV& o
   // constant used throughtout
   const float k = (Config::sol*Config::Bfield)/100.0f;
 
-  MPlexQF vrx, vry, pT, px, py, pz;
+  MPlexQF_T<NN> vrx, vry, pT, px, py, pz;
 #pragma simd
   for (int n = 0; n < N; ++n)
   {
@@ -158,8 +161,8 @@ void conformalFitMPlex(bool fitting, MPlexQI seedID, MPlexLS& outErr, MPlexLV& o
   for (int n = 0; n < N; ++n)
   {
     outPar.At(n, 3, 0) = 1.0f/pT.ConstAt(n, 0, 0);
-    outPar.At(n, 4, 0) = getPhi(px.ConstAt(n, 0, 0),py.ConstAt(n, 0, 0));
-    outPar.At(n, 5, 0) = getTheta(pT.ConstAt(n, 0, 0),pz.ConstAt(n, 0, 0));
+    outPar.At(n, 4, 0) = VecMath::atan2(py.ConstAt(n, 0, 0), px.ConstAt(n, 0, 0));
+    outPar.At(n, 5, 0) = VecMath::atan2(pT.ConstAt(n, 0, 0), pz.ConstAt(n, 0, 0));
 #ifdef INWARDFIT // arctan is odd, so pz -> -pz means theta -> -theta
     if (fitting) outPar.At(n, 5, 0) *= -1.0f;
 #endif
@@ -238,3 +241,13 @@ void conformalFitMPlex(bool fitting, MPlexQI seedID, MPlexLS& outErr, MPlexLV& o
     }
   }
 }
+
+//==============================================================================
+// Explicit instantiations, see MPLEX_FOR_EACH_WIDTH in Matrix.h
+//==============================================================================
+
+#define INSTANTIATE_CONFORMAL_MPLEX(W) \
+  template void conformalFitMPlex<W>(bool, MPlexQI_T<W>, MPlexLS_T<W>&, MPlexLV_T<W>&, \
+                                     const MPlexHV_T<W>&, const MPlexHV_T<W>&, const MPlexHV_T<W>&);
+
+MPLEX_FOR_EACH_KERNEL_WIDTH(INSTANTIATE_CONFORMAL_MPLEX)
@@ -3,8 +3,11 @@
 
 #include "Matrix.h"
 
+// Templated on plex width, instantiated for MPLEX_FOR_EACH_WIDTH (Matrix.h).
+
   // write to iC --> next step will be a propagation no matter what
-void conformalFitMPlex(bool fitting, const MPlexQI seedID, MPlexLS& outErr, MPlexLV& outPar, 
-		       const MPlexHV& msPar0, const MPlexHV& msPar1, const MPlexHV& msPar2);
+template<int NN>
+void conformalFitMPlex(bool fitting, const MPlexQI_T<NN> seedID, MPlexLS_T<NN>& outErr, MPlexLV_T<NN>& outPar, 
+		       const MPlexHV_T<NN>& msPar0, const MPlexHV_T<NN>& msPar1, const MPlexHV_T<NN>& msPar2);
 
 #endif
@@ -4,7 +4,6 @@
 #include "MkFitter.h"
 #include "CandCloner.h"
 
-class MkFitter;
 class CandCloner;
 
 class EventTmp
@@ -0,0 +1,110 @@
+#include "FieldMap.h"
+
+#include "Config.h"
+
+#include <cstdio>
+#include <fstream>
+#include <sstream>
+
+FieldMap g_field_map;
+
+//==============================================================================
+
+FieldMap::FieldMap(int nr, float rmax, int nz, float zmax)
+{
+  Reset(nr, rmax, nz, zmax);
+}
+
+void FieldMap::Reset(int nr, float rmax, int nz, float zmax)
+{
+  m_nr     = nr;
+  m_nz     = nz;
+  m_inv_dr = (nr - 1) / rmax;
+  m_inv_dz = (nz - 1) / (2.f * zmax);
+  m_zmax   = zmax;
+  m_last_r = nr - 1;
+  m_last_z = nz - 1;
+
+  m_bz.assign(nr * nz, 0.0f);
+
+  FillFromParametrization();
+}
+
+void FieldMap::FillFromParametrization()
+{
+  const float dr = 1.0f / m_inv_dr;
+  const float dz = 1.0f / m_inv_dz;
+
+  for (int ir = 0; ir < m_nr; ++ir)
+  {
+    for (int iz = 0; iz < m_nz; ++iz)
+    {
+      m_bz[ir * m_nz + iz] = Config::BfieldFromZR(iz * dz - m_zmax, ir * dr);
+    }
+  }
+
+  FillNext();
+}
+
+void FieldMap::FillNext()
+{
+  m_bz_next.assign(m_bz.begin() + 1, m_bz.end());
+  m_bz_next.push_back(m_bz.back());
+}
+
+//------------------------------------------------------------------------------
+
+bool FieldMap::Load(const std::string& fname)
+{
+  std::ifstream infile(fname);
+  if ( ! infile) return false;
+
+  bool        got_header = false;
+  std::string line;
+  while (std::getline(infile, line))
+  {
+    if (line.empty() || line[0] == '#') continue;
+
+    std::istringstream iss(line);
+    if ( ! got_header)
+    {
+      int   nr, nz;
+      float rmax, zmax;
+      iss >> nr >> rmax >> nz >> zmax;
+      if ( ! iss || nr < 2 || nz < 2 || rmax <= 0 || zmax <= 0) return false;
+      Reset(nr, rmax, nz, zmax);
+      got_header = true;
+      continue;
+    }
+
+    int   ir, iz;
+    float bz;
+    iss >> ir >> iz >> bz;
+    if ( ! iss || ir < 0 || ir >= m_nr || iz < 0 || iz >= m_nz) return false;
+
+    m_bz[ir * m_nz + iz] = bz;
+  }
+
+  FillNext();
+
+  return got_header;
+}
+
+bool FieldMap::Save(const std::string& fname) const
+{
+  FILE *fp = fopen(fname.c_str(), "w");
+  if ( ! fp) return false;
+
+  fprintf(fp, "# nr rmax nz zmax, then: ir iz bz\n");
+  fprintf(fp, "%d %g %d %g\n", m_nr, rMax(), m_nz, zMax());
+  for (int ir = 0; ir < m_nr; ++ir)
+  {
+    for (int iz = 0; iz < m_nz; ++iz)
+    {
+      fprintf(fp, "%d %d %.7g\n", ir, iz, m_bz[ir * m_nz + iz]);
+    }
+  }
+
+  fclose(fp);
+  return true;
+}
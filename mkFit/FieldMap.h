@@ -0,0 +1,79 @@
+#ifndef _field_map_
+#define _field_map_
+
+#include <string>
+#include <vector>
+
+// Bz of the solenoid tabulated on a uniform (r, z) grid, bilinear
+// interpolation between the grid nodes. Only Bz is kept as that is all the
+// helix propagation uses. Used instead of Config::BfieldFromZR() for
+// propagations with useParamBfield when Config::useFieldMap is set
+// (--field-map).
+//
+// Nodes are at r = ir * dr and z = zmin + iz * dz, points outside the grid
+// take the value at the nearest edge. The lookup is selects and four loads, so
+// the loop filling Bz for a whole plex vectorizes.
+
+class FieldMap
+{
+public:
+  FieldMap(int nr = 61, float rmax = 120.f, int nz = 301, float zmax = 300.f);
+
+  // Grid of nr x nz nodes over [0, rmax] x [-zmax, zmax].
+  void Reset(int nr, float rmax, int nz, float zmax);
+
+  // Sample Config::BfieldFromZR() at the nodes.
+  void FillFromParametrization();
+
+  // Text format: a "nr rmax nz zmax" line followed by "ir iz bz" lines.
+  // Lines starting with # are skipped, nodes not listed take the
+  // parametrization values.
+  bool Load(const std::string& fname);
+  bool Save(const std::string& fname) const;
+
+  float Bz(const float r, const float z) const
+  {
+    float fr = r * m_inv_dr;
+    float fz = (z + m_zmax) * m_inv_dz;
+    fr = fr > 0.f       ? fr : 0.f;
+    fr = fr < m_last_r  ? fr : m_last_r;
+    fz = fz > 0.f       ? fz : 0.f;
+    fz = fz < m_last_z  ? fz : m_last_z;
+
+    // Cell index clamped one below the last node so the top edge is reached
+    // with weight 1.
+    int ir = (int) fr, iz = (int) fz;
+    ir = ir < m_nr - 2 ? ir : m_nr - 2;
+    iz = iz < m_nz - 2 ? iz : m_nz - 2;
+    const float ur = fr - ir, uz = fz - iz;
+
+    const int    i  = ir * m_nz + iz;
+    const float *b  = &m_bz[0];
+    const float *bn = &m_bz_next[0];
+    return (1.f - ur) * ((1.f - uz) * b[i]        + uz * bn[i]) +
+                  ur  * ((1.f - uz) * b[i + m_nz] + uz * bn[i + m_nz]);
+  }
+
+  int   nR()   const { return m_nr; }
+  int   nZ()   const { return m_nz; }
+  float rMax() const { return (m_nr - 1) / m_inv_dr; }
+  float zMax() const { return m_zmax; }
+
+private:
+  int   m_nr, m_nz;
+  float m_inv_dr, m_inv_dz;
+  float m_zmax;
+  float m_last_r, m_last_z;
+
+  // bz at node (ir, iz) is m_bz[ir * m_nz + iz], m_bz_next holds the value of
+  // the next node in z at the same index. gcc does not vectorize the lookup
+  // when the two z neighbours are loaded from one array.
+  std::vector<float> m_bz;
+  std::vector<float> m_bz_next;
+
+  void FillNext();
+};
+
+extern FieldMap g_field_map;
+
+#endif
@@ -41,12 +41,14 @@ void FitterCU<T>::allocateDevice() {
 
   cudaMalloc((void**)&d_msPar_arr, Config::nLayers * sizeof(GPlexHV));
   cudaMalloc((void**)&d_msErr_arr, Config::nLayers * sizeof(GPlexHS));
+  d_msPar.resize(Config::nLayers);
+  d_msErr.resize(Config::nLayers);
   for (int hi = 0; hi < Config::nLayers; ++hi) {
     d_msPar[hi].allocate(Nalloc);
     d_msErr[hi].allocate(Nalloc);
   }
-  cudaMemcpy(d_msPar_arr, d_msPar, Config::nLayers*sizeof(GPlexHV), cudaMemcpyHostToDevice);
-  cudaMemcpy(d_msErr_arr, d_msErr, Config::nLayers*sizeof(GPlexHS), cudaMemcpyHostToDevice);
+  cudaMemcpy(d_msPar_arr, d_msPar.data(), Config::nLayers*sizeof(GPlexHV), cudaMemcpyHostToDevice);
+  cudaMemcpy(d_msErr_arr, d_msErr.data(), Config::nLayers*sizeof(GPlexHS), cudaMemcpyHostToDevice);
   cudaMalloc((void**)&d_maxSize, sizeof(int));  //  global maximum
   cudaCheckError();
 }
@@ -108,10 +110,11 @@ void FitterCU<T>::allocate_extra_addBestHit() {
   d_XHitSize.allocate(Nalloc);
   d_XHitArr.allocate(Nalloc);
   cudaMalloc((void**)&d_HitsIdx_arr, Config::nLayers * sizeof(GPlexQI));
+  d_HitsIdx.resize(Config::nLayers);
   for (int hi = 0; hi < Config::nLayers; ++hi) {
     d_HitsIdx[hi].allocate(Nalloc);
   }
-  cudaMemcpy(d_HitsIdx_arr, d_HitsIdx, Config::nLayers*sizeof(GPlexQI), cudaMemcpyHostToDevice);
+  cudaMemcpy(d_HitsIdx_arr, d_HitsIdx.data(), Config::nLayers*sizeof(GPlexQI), cudaMemcpyHostToDevice);
   d_Chi2.allocate(Nalloc);
   d_Label.allocate(Nalloc);
   cudaCheckError();
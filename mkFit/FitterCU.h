@@ -18,6 +18,7 @@
 
 #include <omp.h>
 #include <stdexcept>
+#include <vector>
 
 #define BLOCK_SIZE_X 256
 
@@ -87,9 +88,9 @@ class FitterCU {
   GPlexLL d_errorProp;  // LL
 
   GPlexHV *d_msPar_arr;  // completely on the GPU
-  GPlexHV d_msPar[Config::nLayers];  // on the CPU, with arrays on the GPU
+  std::vector<GPlexHV> d_msPar;  // on the CPU, with arrays on the GPU
   GPlexHS *d_msErr_arr;
-  GPlexHS d_msErr[Config::nLayers];
+  std::vector<GPlexHS> d_msErr;
   
   GPlexQI d_XHitPos;  // QI : 1D arrary following itracks
   GPlexQI d_XHitSize;  // QI : " "
@@ -97,7 +98,7 @@ class FitterCU {
 
   GPlexQF d_outChi2;
   GPlexQI *d_HitsIdx_arr;
-  GPlexQI d_HitsIdx[Config::nLayers];
+  std::vector<GPlexQI> d_HitsIdx;
   GPlexQF d_Chi2;
   GPlexQI d_Label;
 
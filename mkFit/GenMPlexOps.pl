@@ -79,27 +79,6 @@ $temp  ->{name} = 'b';
 $m->dump_multiply_std_and_intrinsic("CartesianErrTransp.ah",
                                     $temp, $jac_back_ccsT, $outErr);
 
-#------------------------------------------------------------------------------
-###updateParametersMPlex -- first term to get kalman gain (H^T*G)
-# temp = rot * resErr_loc
-
-$rot = new GenMul::Matrix('name'=>'a', 'M'=>3, 'N'=>3);
-$rot->set_pattern(<<"FNORD");
-x 0 x
-x 0 x
-0 1 0
-FNORD
-
-$resErr_loc = new GenMul::MatrixSym('name'=>'b', 'M'=>3, 'N'=>3);
-
-$temp   = new GenMul::Matrix('name'=>'c', 'M'=>3, 'N'=>3);
-
-$m = new GenMul::Multiply;
-
-$m->dump_multiply_std_and_intrinsic("KalmanHTG.ah",
-                                    $rot, $resErr_loc, $temp);
-
-
 #------------------------------------------------------------------------------
 ###updateParametersMPlex -- kalman gain
 # K = propErr_ccs * resErrTmpLH
@@ -122,23 +101,6 @@ $m = new GenMul::Multiply;
 
 $m->dump_multiply_std_and_intrinsic("KalmanGain.ah",
                                     $propErr_ccs, $resErrTmpLH, $K);
-#------------------------------------------------------------------------------
-###updateParametersMPlex -- kalman gain
-# K = propErr * resErr2x2
-
-$propErr = new GenMul::MatrixSym('name'=>'a', 'M'=>6, 'N'=>6);
-
-$resErr2x2  = new GenMul::MatrixSym('name'=>'b', 'M'=>2, 'N'=>2);
-
-$K   = new GenMul::Matrix('name'=>'c', 'M'=>6, 'N'=>2);
-
-{
-  my $m_kg = new GenMul::Multiply('no_size_check' => 1);
-
-  $m_kg->dump_multiply_std_and_intrinsic("KalmanGain62.ah",
-					 $propErr, $resErr2x2, $K);
-}
-
 #------------------------------------------------------------------------------
 ###updateParametersMPlex -- KH
 # KH = K * H
@@ -1,5 +1,6 @@
 #include "HitStructures.h"
 #include "BinInfoUtils.h"
+#include "MathMPlex.h"
 
 #include "Ice/IceRevisitedRadix.h"
 
@@ -72,7 +73,7 @@ void LayerOfHits::SuckInHits(const HitVec &hitv)
     for (auto const &h : hitv)
     {
       HitInfo &hi = ha[i];
-      hi.phi  = h.phi();
+      hi.phi  = VecMath::atan2(h.y(), h.x());
       hi.z    = h.z();
       hi.zbin = std::min(static_cast<int>((hi.z - m_zmin) * m_fz), m_nz-1);
       m_hit_phis[i] = hi.phi + 6.3f * (hi.zbin - nzh);
@@ -96,6 +97,7 @@ void LayerOfHits::SuckInHits(const HitVec &hitv)
     // Could fix the mis-sorts. Set ha size to size + 1 and fake last entry to avoid ifs.
 
     memcpy(&m_hits[i], &hitv[j], sizeof(Hit));
+    m_hit_inv2rs[i] = 1.0f / (2 * hipo(hitv[j].x(), hitv[j].y()));
 #ifdef LOH_USE_PHI_Z_ARRAYS
     m_hit_phis[i] = ha[j].phi;
     m_hit_zs  [i] = ha[j].z;
@@ -300,7 +302,7 @@ void LayerOfHits::SuckInHitsEndcap(const HitVec &hitv)
     for (auto const &h : hitv)
     {
       HitInfo &hi = ha[i];
-      hi.phi  = h.phi();
+      hi.phi  = VecMath::atan2(h.y(), h.x());
       hi.r    = h.r();
       hi.rbin = (hi.r - m_rmin) * m_fr;
       m_hit_phis[i] = hi.phi + 6.3f * (hi.rbin - nrh);
@@ -10,8 +10,6 @@
 #include <array>
 #include <tbb/tbb.h>
 
-typedef tbb::concurrent_vector<TripletIdx> TripletIdxConVec;
-
 // for each layer
 //   Config::nEtaBin vectors of hits, resized to large enough N
 //   filled with corresponding hits
@@ -67,6 +65,9 @@ class LayerOfHits
 public:
   Hit                      *m_hits = 0;
   vecvecPhiBinInfo_t        m_phi_bin_infos;
+  // Hit-only part of the tangent-plane rotation, 1 / (2 * r_hit), see
+  // computeChi2MPlex() / updateParametersMPlex(). Barrel only.
+  std::vector<float>        m_hit_inv2rs;
 #ifdef LOH_USE_PHI_Z_ARRAYS
   std::vector<float>        m_hit_phis;
   std::vector<float>        m_hit_zs;
@@ -93,6 +94,7 @@ protected:
     m_hits = (Hit*) _mm_malloc(sizeof(Hit) * size, 64);
     m_capacity = size;
     for (int ihit = 0; ihit < m_capacity; ihit++){m_hits[ihit] = Hit();} 
+    m_hit_inv2rs.resize(size);
 #ifdef LOH_USE_PHI_Z_ARRAYS
     m_hit_phis.resize(size);
     m_hit_zs  .resize(size);
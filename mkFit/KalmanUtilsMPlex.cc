@@ -1,20 +1,23 @@
 #include "KalmanUtilsMPlex.h"
 #include "PropagationMPlex.h"
+#include "Matriplex/MatriplexSparse.h"
 
 //#define DEBUG
 #include "Debug.h"
 
+#include "MathMPlex.h"
 #include "KalmanUtilsMPlex.icc"
 
 namespace
 {
   using idx_t = Matriplex::idx_t;
 
+template<int NN>
 inline
-void MultResidualsAdd(const MPlexLH& A,
-		      const MPlexLV& B,
-		      const MPlex2V& C,
-		            MPlexLV& D)
+void MultResidualsAdd(const MPlexLH_T<NN>& A,
+		      const MPlexLV_T<NN>& B,
+		      const MPlex2V_T<NN>& C,
+		            MPlexLV_T<NN>& D)
 {
    // outPar = psPar + kalmanGain*(dPar)
    //   D    =   B         A         C
@@ -25,11 +28,12 @@ void MultResidualsAdd(const MPlexLH& A,
    MultResidualsAdd_imp(A, B, C, D, 0, NN);
 }
 
+template<int NN>
 inline
-void MultResidualsAdd(const MPlexL2& A,
-		      const MPlexLV& B,
-		      const MPlex2V& C,
-		            MPlexLV& D)
+void MultResidualsAdd(const MPlexL2_T<NN>& A,
+		      const MPlexLV_T<NN>& B,
+		      const MPlex2V_T<NN>& C,
+		            MPlexLV_T<NN>& D)
 {
    // outPar = psPar + kalmanGain*(dPar)
    //   D    =   B         A         C
@@ -60,10 +64,11 @@ void MultResidualsAdd(const MPlexL2& A,
 
 //------------------------------------------------------------------------------
 
+template<int NN>
 inline
-void Chi2Similarity(const MPlex2V& A,//resPar
-		    const MPlex2S& C,//resErr
-                          MPlexQF& D)//outChi2
+void Chi2Similarity(const MPlex2V_T<NN>& A,//resPar
+		    const MPlex2S_T<NN>& C,//resErr
+                          MPlexQF_T<NN>& D)//outChi2
 {
 
    // outChi2 = (resPar) * resErr * (resPar)
@@ -88,8 +93,9 @@ void Chi2Similarity(const MPlex2V& A,//resPar
 
 //------------------------------------------------------------------------------
 
+template<int NN>
 inline
-void AddIntoUpperLeft3x3(const MPlexLS& A, const MPlexHS& B, MPlexHS& C)
+void AddIntoUpperLeft3x3(const MPlexLS_T<NN>& A, const MPlexHS_T<NN>& B, MPlexHS_T<NN>& C)
 {
    // The rest of matrix is left untouched.
 
@@ -112,8 +118,9 @@ void AddIntoUpperLeft3x3(const MPlexLS& A, const MPlexHS& B, MPlexHS& C)
    }
 }
 
+template<int NN>
 inline
-void AddIntoUpperLeft2x2(const MPlexLS& A, const MPlexHS& B, MPlex2S& C)
+void AddIntoUpperLeft2x2(const MPlexLS_T<NN>& A, const MPlexHS_T<NN>& B, MPlex2S_T<NN>& C)
 {
    // The rest of matrix is left untouched.
 
@@ -135,8 +142,9 @@ void AddIntoUpperLeft2x2(const MPlexLS& A, const MPlexHS& B, MPlex2S& C)
 
 //------------------------------------------------------------------------------
 
+template<int NN>
 inline
-void SubtractFirst3(const MPlexHV& A, const MPlexLV& B, MPlexHV& C)
+void SubtractFirst3(const MPlexHV_T<NN>& A, const MPlexLV_T<NN>& B, MPlexHV_T<NN>& C)
 {
    // The rest of matrix is left untouched.
 
@@ -156,8 +164,9 @@ void SubtractFirst3(const MPlexHV& A, const MPlexLV& B, MPlexHV& C)
    }
 }
 
+template<int NN>
 inline
-void SubtractFirst2(const MPlexHV& A, const MPlexLV& B, MPlex2V& C)
+void SubtractFirst2(const MPlexHV_T<NN>& A, const MPlexLV_T<NN>& B, MPlex2V_T<NN>& C)
 {
    // The rest of matrix is left untouched.
 
@@ -178,11 +187,12 @@ void SubtractFirst2(const MPlexHV& A, const MPlexLV& B, MPlex2V& C)
 
 //==============================================================================
 
+template<int NN>
 inline
-void ProjectResErr(const MPlexQF& A00,
-		   const MPlexQF& A01,
-		   const MPlexHS& B, 
-		         MPlexHH& C)
+void ProjectResErr(const MPlexQF_T<NN>& A00,
+		   const MPlexQF_T<NN>& A01,
+		   const MPlexHS_T<NN>& B, 
+		         MPlexHH_T<NN>& C)
 {
   // C = A * B, C is 3x3, A is 3x3 , B is 3x3 sym
 
@@ -211,11 +221,12 @@ void ProjectResErr(const MPlexQF& A00,
    }
 }
 
+template<int NN>
 inline
-void ProjectResErrTransp(const MPlexQF& A00,
-			 const MPlexQF& A01,
-			 const MPlexHH& B, 
-			       MPlex2S& C)
+void ProjectResErrTransp(const MPlexQF_T<NN>& A00,
+			 const MPlexQF_T<NN>& A01,
+			 const MPlexHH_T<NN>& B, 
+			       MPlex2S_T<NN>& C)
 {
   // C = A * B, C is 3x3 sym, A is 3x3 , B is 3x3
 
@@ -238,71 +249,55 @@ void ProjectResErrTransp(const MPlexQF& A00,
    }
 }
 
-inline
-void CCSErr(const MPlexLL& A, const MPlexLS& B, MPlexLL& C)
+// Jacobians of ConvertToCCS() and ConvertToCartesian(). The same patterns
+// are in GenMPlexOps.pl for the GPU kernels.
+namespace KalmanSparse
 {
-  // C = A * B, C is 6x6, A is 6x6 , B is 6x6 sym
- 
-  typedef float T;
-  const idx_t N = NN;
-  
-  const T *a = A.fArray; ASSUME_ALIGNED(a, 64);
-  const T *b = B.fArray; ASSUME_ALIGNED(b, 64);
-        T *c = C.fArray; ASSUME_ALIGNED(c, 64);
-
-#include "CCSErr.ah"
+  using namespace Matriplex::Sparse;
+
+  typedef Gen<6, 6, Pattern<I, O, O, O, O, O,
+                            O, I, O, O, O, O,
+                            O, O, I, O, O, O,
+                            O, O, O, X, X, O,
+                            O, O, O, X, X, O,
+                            O, O, O, X, X, X> > JacCCS;
+
+  typedef Gen<6, 6, Pattern<I, O, O, O, O, O,
+                            O, I, O, O, O, O,
+                            O, O, I, O, O, O,
+                            O, O, O, X, X, O,
+                            O, O, O, X, X, O,
+                            O, O, O, X, O, X> > JacCartesian;
+
+  typedef Sym<6> ErrLS;
 }
 
+template<int NN>
 inline
-void CCSErrTransp(const MPlexLL& A, const MPlexLL& B, MPlexLS& C)
+void CCSErr(const MPlexLL_T<NN>& A, MPlexLS_T<NN>& B)
 {
-  // C = A * B, C is sym, A is 6x6 , B is 6x6
- 
-  typedef float T;
-  const idx_t N = NN;
-  
-  const T *a = A.fArray; ASSUME_ALIGNED(a, 64);
-  const T *b = B.fArray; ASSUME_ALIGNED(b, 64);
-        T *c = C.fArray; ASSUME_ALIGNED(c, 64);
+  // B = A * B * AT, A is jacobian from cartesian to CCS
 
-#include "CCSErrTransp.ah"
+  using namespace KalmanSparse;
+  Similarity<NN, JacCCS, ErrLS, ErrLS>(A.fArray, B.fArray, B.fArray);
 }
 
+template<int NN>
 inline
-void CartesianErr(const MPlexLL& A, const MPlexLS& B, MPlexLL& C)
+void CartesianErr(const MPlexLL_T<NN>& A, MPlexLS_T<NN>& B)
 {
-  // C = A * B, C is 6x6, A is 6x6 , B is 6x6 sym
- 
-  typedef float T;
-  const idx_t N = NN;
-  
-  const T *a = A.fArray; ASSUME_ALIGNED(a, 64);
-  const T *b = B.fArray; ASSUME_ALIGNED(b, 64);
-        T *c = C.fArray; ASSUME_ALIGNED(c, 64);
+  // B = A * B * AT, A is jacobian from CCS to cartesian
 
-#include "CartesianErr.ah"
+  using namespace KalmanSparse;
+  Similarity<NN, JacCartesian, ErrLS, ErrLS>(A.fArray, B.fArray, B.fArray);
 }
 
+template<int NN>
 inline
-void CartesianErrTransp(const MPlexLL& A, const MPlexLL& B, MPlexLS& C)
-{
-  // C = A * B, C is sym, A is 6x6 , B is 6x6
- 
-  typedef float T;
-  const idx_t N = NN;
-  
-  const T *a = A.fArray; ASSUME_ALIGNED(a, 64);
-  const T *b = B.fArray; ASSUME_ALIGNED(b, 64);
-        T *c = C.fArray; ASSUME_ALIGNED(c, 64);
-
-#include "CartesianErrTransp.ah"
-}
-
-inline
-void RotateResidulsOnTangentPlane(const MPlexQF& R00,//r00
-				  const MPlexQF& R01,//r01
-				  const MPlexHV& A  ,//res_glo
-				        MPlex2V& B  )//res_loc
+void RotateResidulsOnTangentPlane(const MPlexQF_T<NN>& R00,//r00
+				  const MPlexQF_T<NN>& R01,//r01
+				  const MPlexHV_T<NN>& A  ,//res_glo
+				        MPlex2V_T<NN>& B  )//res_loc
 {
   RotateResidulsOnTangentPlane_impl(R00, R01, A, B, 0, NN);
 #if 0
@@ -326,104 +321,222 @@ void RotateResidulsOnTangentPlane(const MPlexQF& R00,//r00
 #endif
 }
 
+template<int NN>
 inline
-void KalmanHTG(const MPlexQF& A00,
-	       const MPlexQF& A01,
-	       const MPlex2S& B  ,
-	             MPlexHH& C  )
+void HitInvTwoR(const MPlexHV_T<NN>& A, MPlexQF_T<NN>& B)
 {
+   // B = 1 / (2 * r_hit), the hit-only part of the tangent-plane rotation
 
-   // HTG  = rot * res_loc
-   //   C  =  A  *    B   
+   typedef float T;
+   const idx_t N = NN;
 
-   // Based on script generation and adapted to custom sizes.
+   const T *a = A.fArray; ASSUME_ALIGNED(a, 64);
+         T *b = B.fArray; ASSUME_ALIGNED(b, 64);
+
+#pragma simd
+   for (idx_t n = 0; n < N; ++n)
+   {
+      b[n] = 1.0f / (2 * hipo(a[0 * N + n], a[1 * N + n]));
+   }
+}
+
+//------------------------------------------------------------------------------
+
+template<int NN>
+inline
+void Chi2FromCholesky(const MPlex2S_T<NN>& L,//resErr, factorized
+                      const MPlex2V_T<NN>& R,//res
+                            MPlexQF_T<NN>& F)//outChi2
+{
+   // chi2 = resT * resErr^-1 * res = |L^-1 * res|^2, the forward
+   // substitution of Matriplex::CholeskyForwardSubst() written out for 2x2.
 
    typedef float T;
    const idx_t N = NN;
 
-   const T *a00 = A00.fArray; ASSUME_ALIGNED(a00, 64);
-   const T *a01 = A01.fArray; ASSUME_ALIGNED(a01, 64);
-   const T *b   = B.fArray;   ASSUME_ALIGNED(b, 64);
-         T *c   = C.fArray;   ASSUME_ALIGNED(c, 64);
+   const T *l = L.fArray; ASSUME_ALIGNED(l, 64);
+   const T *r = R.fArray; ASSUME_ALIGNED(r, 64);
+         T *f = F.fArray; ASSUME_ALIGNED(f, 64);
 
 #pragma simd
-   for (int n = 0; n < N; ++n)
+   for (idx_t n = 0; n < N; ++n)
    {
-      c[ 0*N+n] = a00[n]*b[ 0*N+n];
-      c[ 1*N+n] = a00[n]*b[ 1*N+n];
-      c[ 2*N+n] = 0.;
-      c[ 3*N+n] = a01[n]*b[ 0*N+n];
-      c[ 4*N+n] = a01[n]*b[ 1*N+n];
-      c[ 5*N+n] = 0.;
-      c[ 6*N+n] = b[ 1*N+n];
-      c[ 7*N+n] = b[ 2*N+n];
-      c[ 8*N+n] = 0.;
+      const T y0 =  r[0 * N + n] * l[0 * N + n];
+      const T y1 = (r[1 * N + n] - l[1 * N + n] * y0) * l[2 * N + n];
+
+      f[n] = y0 * y0 + y1 * y1;
    }
 }
 
+template<int NN>
 inline
-void KalmanGain(const MPlexLS& A, const MPlexHH& B, MPlexLH& C)
+void Chi2OnTangentPlane(const MPlexLS_T<NN>& A,//propErr
+                        const MPlexLV_T<NN>& B,//propPar
+                        const MPlexHS_T<NN>& C,//msErr
+                        const MPlexHV_T<NN>& D,//msPar
+                        const MPlexQF_T<NN>& E,//msInv2R
+                              MPlexQF_T<NN>& F)//outChi2
 {
-  // C = A * B, C is 6x3, A is 6x6 sym , B is 3x3
+   // Fused SubtractFirst3 + AddIntoUpperLeft3x3 + RotateResidulsOnTangentPlane +
+   // ProjectResErr + ProjectResErrTransp, operation order is kept from the
+   // above. The 2x2 result is then factorized, chi2 is computed without
+   // forming the inverse.
 
-  typedef float T;
-  const idx_t N = NN;
+   typedef float T;
+   const idx_t N = NN;
 
-  const T *a = A.fArray; ASSUME_ALIGNED(a, 64);
-  const T *b = B.fArray; ASSUME_ALIGNED(b, 64);
-        T *c = C.fArray; ASSUME_ALIGNED(c, 64);
+   MPlex2V_T<NN> R;
+   MPlex2S_T<NN> S;
+
+   const T *a = A.fArray; ASSUME_ALIGNED(a, 64);
+   const T *b = B.fArray; ASSUME_ALIGNED(b, 64);
+   const T *c = C.fArray; ASSUME_ALIGNED(c, 64);
+   const T *d = D.fArray; ASSUME_ALIGNED(d, 64);
+   const T *e = E.fArray; ASSUME_ALIGNED(e, 64);
+         T *r = R.fArray; ASSUME_ALIGNED(r, 64);
+         T *s = S.fArray; ASSUME_ALIGNED(s, 64);
 
 #pragma simd
-   for (int n = 0; n < N; ++n)
+   for (idx_t n = 0; n < N; ++n)
    {
-      c[ 0*N+n] = a[ 0*N+n]*b[ 0*N+n] + a[ 1*N+n]*b[ 3*N+n] + a[ 3*N+n]*b[ 6*N+n];
-      c[ 1*N+n] = a[ 0*N+n]*b[ 1*N+n] + a[ 1*N+n]*b[ 4*N+n] + a[ 3*N+n]*b[ 7*N+n];
-      c[ 2*N+n] = 0;
-      c[ 3*N+n] = a[ 1*N+n]*b[ 0*N+n] + a[ 2*N+n]*b[ 3*N+n] + a[ 4*N+n]*b[ 6*N+n];
-      c[ 4*N+n] = a[ 1*N+n]*b[ 1*N+n] + a[ 2*N+n]*b[ 4*N+n] + a[ 4*N+n]*b[ 7*N+n];
-      c[ 5*N+n] = 0;
-      c[ 6*N+n] = a[ 3*N+n]*b[ 0*N+n] + a[ 4*N+n]*b[ 3*N+n] + a[ 5*N+n]*b[ 6*N+n];
-      c[ 7*N+n] = a[ 3*N+n]*b[ 1*N+n] + a[ 4*N+n]*b[ 4*N+n] + a[ 5*N+n]*b[ 7*N+n];
-      c[ 8*N+n] = 0;
-      c[ 9*N+n] = a[ 6*N+n]*b[ 0*N+n] + a[ 7*N+n]*b[ 3*N+n] + a[ 8*N+n]*b[ 6*N+n];
-      c[10*N+n] = a[ 6*N+n]*b[ 1*N+n] + a[ 7*N+n]*b[ 4*N+n] + a[ 8*N+n]*b[ 7*N+n];
-      c[11*N+n] = 0;
-      c[12*N+n] = a[10*N+n]*b[ 0*N+n] + a[11*N+n]*b[ 3*N+n] + a[12*N+n]*b[ 6*N+n];
-      c[13*N+n] = a[10*N+n]*b[ 1*N+n] + a[11*N+n]*b[ 4*N+n] + a[12*N+n]*b[ 7*N+n];
-      c[14*N+n] = 0;
-      c[15*N+n] = a[15*N+n]*b[ 0*N+n] + a[16*N+n]*b[ 3*N+n] + a[17*N+n]*b[ 6*N+n];
-      c[16*N+n] = a[15*N+n]*b[ 1*N+n] + a[16*N+n]*b[ 4*N+n] + a[17*N+n]*b[ 7*N+n];
-      c[17*N+n] = 0;
+      const T r00 = -(d[1 * N + n] + b[1 * N + n]) * e[n];
+      const T r01 =  (d[0 * N + n] + b[0 * N + n]) * e[n];
+
+      r[0 * N + n] = r00 * (d[0 * N + n] - b[0 * N + n]) + r01 * (d[1 * N + n] - b[1 * N + n]);
+      r[1 * N + n] = d[2 * N + n] - b[2 * N + n];
+
+      const T s00 = a[0 * N + n] + c[0 * N + n];
+      const T s01 = a[1 * N + n] + c[1 * N + n];
+      const T s11 = a[2 * N + n] + c[2 * N + n];
+      const T s02 = a[3 * N + n] + c[3 * N + n];
+      const T s12 = a[4 * N + n] + c[4 * N + n];
+      const T s22 = a[5 * N + n] + c[5 * N + n];
+
+      s[0 * N + n] = (r00 * s00 + r01 * s01) * r00 + (r00 * s01 + r01 * s11) * r01;
+      s[1 * N + n] = s02 * r00 + s12 * r01;
+      s[2 * N + n] = s22;
    }
+
+   Matriplex::CholeskyDecomposeSym(S);
+   Chi2FromCholesky(S, R, F);
+}
+
+template<int NN>
+inline
+void Chi2OnZPlane(const MPlexLS_T<NN>& A,//propErr
+                  const MPlexLV_T<NN>& B,//propPar
+                  const MPlexHS_T<NN>& C,//msErr
+                  const MPlexHV_T<NN>& D,//msPar
+                        MPlexQF_T<NN>& F)//outChi2
+{
+   // SubtractFirst2 + AddIntoUpperLeft2x2, then chi2 from the Cholesky factor.
+
+   MPlex2V_T<NN> R;
+   SubtractFirst2(D, B, R);
+
+   MPlex2S_T<NN> S;
+   AddIntoUpperLeft2x2(A, C, S);
+
+   Matriplex::CholeskyDecomposeSym(S);
+   Chi2FromCholesky(S, R, F);
+}
+
+template<int NN>
+inline
+void KalmanGain(const MPlexLS_T<NN>& A,//propErr
+                const MPlexQF_T<NN>& R00,
+                const MPlexQF_T<NN>& R01,
+                const MPlex2S_T<NN>& L,//resErr_loc, factorized
+                      MPlexLH_T<NN>& C)
+{
+  // C = A * HT * L^-T * L^-1, C is 6x3 (right column is 0), A is 6x6 sym,
+  // HT is 3x2 (rotT00, 0; rotT01, 0; 0, 1), L is the 2x2 Cholesky factor.
+  // Each row of A * HT is solved against the factor, no inverse is formed.
+
+  typedef float T;
+  const idx_t N = NN;
+
+  const T *a   = A.fArray;   ASSUME_ALIGNED(a, 64);
+  const T *r00 = R00.fArray; ASSUME_ALIGNED(r00, 64);
+  const T *r01 = R01.fArray; ASSUME_ALIGNED(r01, 64);
+  const T *l   = L.fArray;   ASSUME_ALIGNED(l, 64);
+        T *c   = C.fArray;   ASSUME_ALIGNED(c, 64);
+
+  // Rows of A: first three elements of row i, in packed sym storage.
+  static const int rA[6][3] = { { 0,  1,  3}, { 1,  2,  4}, { 3,  4,  5},
+                                { 6,  7,  8}, {10, 11, 12}, {15, 16, 17} };
+
+#pragma simd
+  for (int n = 0; n < N; ++n)
+  {
+    const T il00 = l[0*N+n], l10 = l[1*N+n], il11 = l[2*N+n];
+
+    for (int i = 0; i < 6; ++i)
+    {
+      const T p0 = a[rA[i][0]*N+n]*r00[n] + a[rA[i][1]*N+n]*r01[n];
+      const T p1 = a[rA[i][2]*N+n];
+
+      const T y0 =  p0 * il00;
+      const T y1 = (p1 - l10 * y0) * il11;
+      const T x1 =  y1 * il11;
+      const T x0 = (y0 - l10 * x1) * il00;
+
+      c[(3*i + 0)*N+n] = x0;
+      c[(3*i + 1)*N+n] = x1;
+      c[(3*i + 2)*N+n] = 0;
+    }
+  }
 }
 
-void KalmanGain(const MPlexLS& A, const MPlex2S& B, MPlexL2& C)
+template<int NN>
+void KalmanGain(const MPlexLS_T<NN>& A, const MPlex2S_T<NN>& L, MPlexL2_T<NN>& C)
 {
-  // C = A * B, C is 6x2, A is 6x6 sym , B is 2x2
+  // C = A * HT * L^-T * L^-1, C is 6x2, A is 6x6 sym, HT selects the first
+  // two columns of A, L is the 2x2 Cholesky factor of the residual error.
 
   typedef float T;
   const idx_t N = NN;
 
   const T *a = A.fArray; ASSUME_ALIGNED(a, 64);
-  const T *b = B.fArray; ASSUME_ALIGNED(b, 64);
+  const T *l = L.fArray; ASSUME_ALIGNED(l, 64);
         T *c = C.fArray; ASSUME_ALIGNED(c, 64);
 
-#include "KalmanGain62.ah"
+  static const int rA[6][2] = { { 0,  1}, { 1,  2}, { 3,  4},
+                                { 6,  7}, {10, 11}, {15, 16} };
+
+#pragma simd
+  for (int n = 0; n < N; ++n)
+  {
+    const T il00 = l[0*N+n], l10 = l[1*N+n], il11 = l[2*N+n];
+
+    for (int i = 0; i < 6; ++i)
+    {
+      const T y0 =  a[rA[i][0]*N+n] * il00;
+      const T y1 = (a[rA[i][1]*N+n] - l10 * y0) * il11;
+      const T x1 =  y1 * il11;
+      const T x0 = (y0 - l10 * x1) * il00;
+
+      c[(2*i + 0)*N+n] = x0;
+      c[(2*i + 1)*N+n] = x1;
+    }
+  }
 }
 
+template<int NN>
 inline
-void KHMult(const MPlexLH& A, 
-	    const MPlexQF& B00,
-	    const MPlexQF& B01,
-	          MPlexLL& C)
+void KHMult(const MPlexLH_T<NN>& A, 
+	    const MPlexQF_T<NN>& B00,
+	    const MPlexQF_T<NN>& B01,
+	          MPlexLL_T<NN>& C)
 {
   // C = A * B, C is 6x6, A is 6x3 , B is 3x6
   KHMult_imp(A, B00, B01, C, 0, NN);
 }
 
 
+template<int NN>
 inline
-void KHC(const MPlexLL& A, const MPlexLS& B, MPlexLS& C)
+void KHC(const MPlexLL_T<NN>& A, const MPlexLS_T<NN>& B, MPlexLS_T<NN>& C)
 {
   // C = A * B, C is 6x6, A is 6x6 , B is 6x6 sym
 
@@ -437,8 +550,9 @@ void KHC(const MPlexLL& A, const MPlexLS& B, MPlexLS& C)
 #include "KHC.ah"
 }
 
+template<int NN>
 inline
-void KHC(const MPlexL2& A, const MPlexLS& B, MPlexLS& C)
+void KHC(const MPlexL2_T<NN>& A, const MPlexLS_T<NN>& B, MPlexLS_T<NN>& C)
 {
   // C = A * B, C is 6x6 sym, A is 6x2 , B is 6x6 sym
  
@@ -452,14 +566,16 @@ void KHC(const MPlexL2& A, const MPlexLS& B, MPlexLS& C)
 #include "K62HC.ah"
 }
 
+template<int NN>
 inline
-void ConvertToCCS(const MPlexLV& A, MPlexLV& B, MPlexLL& C)
+void ConvertToCCS(const MPlexLV_T<NN>& A, MPlexLV_T<NN>& B, MPlexLL_T<NN>& C)
 {
   ConvertToCCS_imp(A, B, C, 0, NN);
 }
 
+template<int NN>
 inline
-void ConvertToCartesian(const MPlexLV& A, MPlexLV& B, MPlexLL& C)
+void ConvertToCartesian(const MPlexLV_T<NN>& A, MPlexLV_T<NN>& B, MPlexLL_T<NN>& C)
 {
   ConvertToCartesian_imp(A, B, C, 0, NN); 
 }
@@ -513,29 +629,74 @@ void ConvertToCartesian(const MPlexLV& A, MPlexLV& B, MPlexLL& C)
 // updateParametersMPlex
 //==============================================================================
 
-void updateParametersMPlex(const MPlexLS &psErr,  const MPlexLV& psPar, const MPlexQI &inChg,
-                           const MPlexHS &msErr,  const MPlexHV& msPar,
-                                 MPlexLS &outErr,       MPlexLV& outPar,
+template<int NN>
+void updateParametersMPlex(const MPlexLS_T<NN> &psErr,  const MPlexLV_T<NN>& psPar, const MPlexQI_T<NN> &inChg,
+                           const MPlexHS_T<NN> &msErr,  const MPlexHV_T<NN>& msPar,
+                                 MPlexLS_T<NN> &outErr,       MPlexLV_T<NN>& outPar,
                            const int      N_proc)
+{
+  MPlexQF_T<NN> msInv2R;
+  HitInvTwoR(msPar, msInv2R);
+
+  updateParametersMPlex(psErr, psPar, inChg, msErr, msPar, msInv2R, outErr, outPar, N_proc);
+}
+
+template<int NN>
+void updateParametersMPlex(const MPlexLS_T<NN> &psErr,  const MPlexLV_T<NN>& psPar, const MPlexQI_T<NN> &inChg,
+                           const MPlexHS_T<NN> &msErr,  const MPlexHV_T<NN>& msPar, const MPlexQF_T<NN> &msInv2R,
+                                 MPlexLS_T<NN> &outErr,       MPlexLV_T<NN>& outPar,
+                           const int      N_proc)
+{
+  UpdateParametersContext<NN> ctx;
+
+  updateParametersMPlex(psErr, psPar, inChg, msErr, msPar, msInv2R, outErr, outPar, N_proc, ctx);
+}
+
+namespace
+{
+// With CMS geometry the state is at the layer radius, propagate it and its
+// errors to the hit radius. Returns pointers to the state to use, psErr/psPar
+// themselves when no step is needed.
+template<int NN>
+void stepToHitRadius(const MPlexLS_T<NN> &psErr, const MPlexLV_T<NN>& psPar, const MPlexQI_T<NN> &inChg,
+                     const MPlexHV_T<NN>& msPar, const int N_proc, UpdateParametersContext<NN>& ctx,
+                     const MPlexLS_T<NN>* &propErr, const MPlexLV_T<NN>* &propPar)
+{
+  propErr = &psErr;
+  propPar = &psPar;
+
+  if (Config::useCMSGeom)
+  {
+    propagateHelixToRMPlex(psErr, psPar, inChg, msPar, ctx.propErr, ctx.propPar, N_proc);
+    propErr = &ctx.propErr;
+    propPar = &ctx.propPar;
+  }
+}
+}
+
+template<int NN>
+void updateParametersMPlex(const MPlexLS_T<NN> &psErr,  const MPlexLV_T<NN>& psPar, const MPlexQI_T<NN> &inChg,
+                           const MPlexHS_T<NN> &msErr,  const MPlexHV_T<NN>& msPar, const MPlexQF_T<NN> &msInv2R,
+                                 MPlexLS_T<NN> &outErr,       MPlexLV_T<NN>& outPar,
+                           const int      N_proc, UpdateParametersContext<NN>& ctx)
 {
   // const idx_t N = psErr.N;
   // Assert N-s of all parameters are the same.
 
-  // Temporaries -- this is expensive -- should have them allocated outside and reused.
-  // Can be passed in in a struct, see above.
+  const MPlexLS_T<NN> *pErr;
+  const MPlexLV_T<NN> *pPar;
+  stepToHitRadius(psErr, psPar, inChg, msPar, N_proc, ctx, pErr, pPar);
 
-  // updateParametersContext ctx;
-  //assert((long long)(&updateCtx.propErr.fArray[0]) % 64 == 0);
-
-  MPlexLS propErr;
-  MPlexLV propPar;
-  // do a full propagation step to correct for residual distance from the hit radius - need the charge for this
-  if (Config::useCMSGeom) {
-    propagateHelixToRMPlex(psErr,  psPar, inChg,  msPar, propErr, propPar, N_proc);
-  } else {
-    propErr = psErr;
-    propPar = psPar;
+#ifndef CCSCOORD
+  // Converted to CCS in place below.
+  if (Config::updateViaCCS && pErr != &ctx.propErr)
+  {
+    ctx.propErr = *pErr;
+    pErr = &ctx.propErr;
   }
+#endif
+  const MPlexLS_T<NN> &propErr = *pErr;
+  const MPlexLV_T<NN> &propPar = *pPar;
 
 #ifdef DEBUG
   {
@@ -568,25 +729,24 @@ void updateParametersMPlex(const MPlexLS &psErr,  const MPlexLV& psPar, const MP
   //     0    1    0
   // Minimize temporaries: only two float are needed!
 
-  MPlexQF rotT00;
-  MPlexQF rotT01;
+  MPlexQF_T<NN> &rotT00 = ctx.rotT00;
+  MPlexQF_T<NN> &rotT01 = ctx.rotT01;
 #pragma simd
   for (int n = 0; n < NN; ++n) {
-    float r = hipo(msPar.ConstAt(n, 0, 0), msPar.ConstAt(n, 1, 0));
-    rotT00.At(n, 0, 0) = -(msPar.ConstAt(n, 1, 0)+propPar.ConstAt(n, 1, 0))/(2*r);
-    rotT01.At(n, 0, 0) =  (msPar.ConstAt(n, 0, 0)+propPar.ConstAt(n, 0, 0))/(2*r);
+    rotT00.At(n, 0, 0) = -(msPar.ConstAt(n, 1, 0)+propPar.ConstAt(n, 1, 0))*msInv2R.ConstAt(n, 0, 0);
+    rotT01.At(n, 0, 0) =  (msPar.ConstAt(n, 0, 0)+propPar.ConstAt(n, 0, 0))*msInv2R.ConstAt(n, 0, 0);
   }
 
-  MPlexHV res_glo;   //position residual in global coordinates
+  MPlexHV_T<NN> &res_glo = ctx.res_glo;      //position residual in global coordinates
   SubtractFirst3(msPar, propPar, res_glo);
   
-  MPlexHS resErr_glo;//covariance sum in global position coordinates
+  MPlexHS_T<NN> &resErr_glo = ctx.resErr_glo;//covariance sum in global position coordinates
   AddIntoUpperLeft3x3(propErr, msErr, resErr_glo);
 
-  MPlex2V res_loc;   //position residual in local coordinates
+  MPlex2V_T<NN> &res_loc = ctx.res_loc;      //position residual in local coordinates
   RotateResidulsOnTangentPlane(rotT00,rotT01,res_glo,res_loc);
-  MPlex2S resErr_loc;//covariance sum in local position coordinates
-  MPlexHH tempHH;
+  MPlex2S_T<NN> &resErr_loc = ctx.resErr_loc;//covariance sum in local position coordinates
+  MPlexHH_T<NN> &tempHH = ctx.tempHH;
   ProjectResErr      (rotT00, rotT01, resErr_glo, tempHH);
   ProjectResErrTransp(rotT00, rotT01, tempHH, resErr_loc);
 
@@ -600,46 +760,51 @@ void updateParametersMPlex(const MPlexLS &psErr,  const MPlexLV& psPar, const MP
   }
 #endif
 
-  //invert the 2x2 matrix
-  Matriplex::InvertCramerSym(resErr_loc);
+  // factorize the 2x2 matrix, resErr_loc = L * LT
+  Matriplex::CholeskyDecomposeSym(resErr_loc);
+
+  // The update only projects out x, y, z so it is done in the coordinates
+  // the parameters are stored in, see Config::updateViaCCS for the
+  // cartesian case.
 
 #ifndef CCSCOORD
   // Move to CCS coordinates: (x,y,z,1/pT,phi,theta)
 
-  MPlexLV propPar_ccs;// propagated parameters in CCS coordinates
-  MPlexLL jac_ccs;    // jacobian from cartesian to CCS
-  ConvertToCCS(propPar,propPar_ccs,jac_ccs);
+  MPlexLV_T<NN> &propPar_ccs = ctx.propPar_ccs;// propagated parameters in CCS coordinates
+  MPlexLL_T<NN> &jac_ccs = ctx.jac_ccs;        // jacobian from cartesian to CCS
+  if (Config::updateViaCCS)
+  {
+    ConvertToCCS(propPar,propPar_ccs,jac_ccs);
 
-  MPlexLL tempLL;
-  CCSErr      (jac_ccs, propErr, tempLL);
-  CCSErrTransp(jac_ccs, tempLL, propErr);// propErr is now propagated errors in CCS coordinates
+    CCSErr(jac_ccs, ctx.propErr);// propErr is now propagated errors in CCS coordinates
+  }
 #endif
 
-  // Kalman update in CCS coordinates
+  MPlexLH_T<NN> &K = ctx.K;  // kalman gain, fixme should be L2
+  KalmanGain(propErr, rotT00, rotT01, resErr_loc, K);
 
-  MPlexLH K;           // kalman gain, fixme should be L2
-  KalmanHTG(rotT00, rotT01, resErr_loc, tempHH); // intermediate term to get kalman gain (H^T*G)
-  KalmanGain(propErr, tempHH, K);
-
-#ifdef CCSCOORD
-  MultResidualsAdd(K, propPar, res_loc, outPar);// propPar_ccs is now the updated parameters in CCS coordinates
-  MPlexLL tempLL;
-#else
-  MultResidualsAdd(K, propPar_ccs, res_loc, propPar_ccs);// propPar_ccs is now the updated parameters in CCS coordinates
+#ifndef CCSCOORD
+  if (Config::updateViaCCS)
+    MultResidualsAdd(K, propPar_ccs, res_loc, propPar_ccs);// propPar_ccs is now the updated parameters in CCS coordinates
+  else
 #endif
+  MultResidualsAdd(K, propPar, res_loc, outPar);
 
+  MPlexLL_T<NN> &tempLL = ctx.tempLL;
 
   KHMult(K, rotT00, rotT01, tempLL);
   KHC(tempLL, propErr, outErr);
-  outErr.Subtract(propErr, outErr);// outErr is in CCS coordinates now
+  outErr.Subtract(propErr, outErr);
 
 #ifndef CCSCOORD
-  // Go back to cartesian coordinates
+  if (Config::updateViaCCS)
+  {
+    // Go back to cartesian coordinates
 
-  // jac_ccs is now the jacobian from CCS to cartesian
-  ConvertToCartesian(propPar_ccs, outPar, jac_ccs);
-  CartesianErr      (jac_ccs, outErr, tempLL);
-  CartesianErrTransp(jac_ccs, tempLL, outErr);// outErr is in cartesian coordinates now
+    // jac_ccs is now the jacobian from CCS to cartesian
+    ConvertToCartesian(propPar_ccs, outPar, jac_ccs);
+    CartesianErr(jac_ccs, outErr);// outErr is in cartesian coordinates now
+  }
 #endif
 
 #ifdef DEBUG
@@ -653,7 +818,7 @@ void updateParametersMPlex(const MPlexLS &psErr,  const MPlexLV& psPar, const MP
     for (int i = 0; i < 2; ++i) {
         printf("%8f ", res_loc.At(0,i,0));
     } printf("\n");
-    printf("resErr_loc (Inv):\n");
+    printf("resErr_loc (Cholesky factor):\n");
     for (int i = 0; i < 2; ++i) { for (int j = 0; j < 2; ++j)
         printf("%8f ", resErr_loc.At(0,i,j)); printf("\n");
     } printf("\n");
@@ -679,30 +844,45 @@ void updateParametersMPlex(const MPlexLS &psErr,  const MPlexLV& psPar, const MP
 #endif
 }
 
-void computeChi2MPlex(const MPlexLS &psErr,  const MPlexLV& psPar, const MPlexQI &inChg,
-                      const MPlexHS &msErr,  const MPlexHV& msPar,
-                            MPlexQF& outChi2,
+template<int NN>
+void computeChi2MPlex(const MPlexLS_T<NN> &psErr,  const MPlexLV_T<NN>& psPar, const MPlexQI_T<NN> &inChg,
+                      const MPlexHS_T<NN> &msErr,  const MPlexHV_T<NN>& msPar,
+                            MPlexQF_T<NN>& outChi2,
                       const int      N_proc)
 {
+  MPlexQF_T<NN> msInv2R;
+  HitInvTwoR(msPar, msInv2R);
+
+  computeChi2MPlex(psErr, psPar, inChg, msErr, msPar, msInv2R, outChi2, N_proc);
+}
+
+template<int NN>
+void computeChi2MPlex(const MPlexLS_T<NN> &psErr,  const MPlexLV_T<NN>& psPar, const MPlexQI_T<NN> &inChg,
+                      const MPlexHS_T<NN> &msErr,  const MPlexHV_T<NN>& msPar, const MPlexQF_T<NN> &msInv2R,
+                            MPlexQF_T<NN>& outChi2,
+                      const int      N_proc)
+{
+  UpdateParametersContext<NN> ctx;
+
+  computeChi2MPlex(psErr, psPar, inChg, msErr, msPar, msInv2R, outChi2, N_proc, ctx);
+}
+
+template<int NN>
+void computeChi2MPlex(const MPlexLS_T<NN> &psErr,  const MPlexLV_T<NN>& psPar, const MPlexQI_T<NN> &inChg,
+                      const MPlexHS_T<NN> &msErr,  const MPlexHV_T<NN>& msPar, const MPlexQF_T<NN> &msInv2R,
+                            MPlexQF_T<NN>& outChi2,
+                      const int      N_proc, UpdateParametersContext<NN>& ctx)
+{
 
   // const idx_t N = psErr.N;
   // Assert N-s of all parameters are the same.
 
-  // Temporaries -- this is expensive -- should have them allocated outside and reused.
-  // Can be passed in in a struct, see above.
-
-  // updateParametersContext ctx;
-  //assert((long long)(&updateCtx.propErr.fArray[0]) % 64 == 0);
+  const MPlexLS_T<NN> *pErr;
+  const MPlexLV_T<NN> *pPar;
+  stepToHitRadius(psErr, psPar, inChg, msPar, N_proc, ctx, pErr, pPar);
 
-  MPlexLS propErr;
-  MPlexLV propPar;
-  // do a full propagation step to correct for residual distance from the hit radius - need the charge for this
-  if (Config::useCMSGeom) {
-    propagateHelixToRMPlex(psErr,  psPar, inChg,  msPar, propErr, propPar, N_proc);
-  } else {
-    propErr = psErr;
-    propPar = psPar;
-  }
+  const MPlexLS_T<NN> &propErr = *pErr;
+  const MPlexLV_T<NN> &propPar = *pPar;
 
 #ifdef DEBUG
   {
@@ -726,60 +906,13 @@ void computeChi2MPlex(const MPlexLS &psErr,  const MPlexLV& psPar, const MPlexQI
   }
 #endif
 
-  // Rotate global point on tangent plane to cylinder
-  // Tangent point is half way between hit and propagate position
-
-  // Rotation matrix
-  //  rotT00  0  rotT01
-  //  rotT01  0 -rotT00
-  //     0    1    0
-  // Minimize temporaries: only two float are needed!
-
-  MPlexQF rotT00;
-  MPlexQF rotT01;
-  for (int n = 0; n < NN; ++n) {
-    const float r = hipo(msPar.ConstAt(n, 0, 0), msPar.ConstAt(n, 1, 0));
-    rotT00.At(n, 0, 0) = -(msPar.ConstAt(n, 1, 0)+propPar.ConstAt(n, 1, 0))/(2*r);
-    rotT01.At(n, 0, 0) =  (msPar.ConstAt(n, 0, 0)+propPar.ConstAt(n, 0, 0))/(2*r);
-  }
-
-  MPlexHV res_glo;   //position residual in global coordinates
-  SubtractFirst3(msPar, propPar, res_glo);
-  
-  MPlexHS resErr_glo;//covariance sum in global position coordinates
-  AddIntoUpperLeft3x3(propErr, msErr, resErr_glo);
-
-  MPlex2V res_loc;   //position residual in local coordinates
-  RotateResidulsOnTangentPlane(rotT00,rotT01,res_glo,res_loc);
-  MPlex2S resErr_loc;//covariance sum in local position coordinates
-  MPlexHH tempHH;
-  ProjectResErr      (rotT00, rotT01, resErr_glo, tempHH);
-  ProjectResErrTransp(rotT00, rotT01, tempHH, resErr_loc);
-
-#ifdef DEBUG
-  {
-    dmutex_guard;
-    printf("resErr_loc:\n");
-    for (int i = 0; i < 2; ++i) { for (int j = 0; j < 2; ++j)
-        printf("%8f ", resErr_loc.At(0,i,j)); printf("\n");
-    } printf("\n");
-  }
-#endif
-
-  //invert the 2x2 matrix
-  Matriplex::InvertCramerSym(resErr_loc);
-
-  //compute chi2
-  Chi2Similarity(res_loc, resErr_loc, outChi2);
+  // Rotate on tangent plane to cylinder, see updateParametersMPlex(), and
+  // compute chi2 in one pass.
+  Chi2OnTangentPlane(propErr, propPar, msErr, msPar, msInv2R, outChi2);
 
 #ifdef DEBUG
   {
     dmutex_guard;
-    printf("resErr_loc (Inv):\n");
-    for (int i = 0; i < 2; ++i) {
-      for (int j = 0; j < 2; ++j)
-        printf("%8f ", resErr_loc.At(0,i,j)); printf("\n");
-    } printf("\n");
     printf("chi2: %8f\n", outChi2.At(0,0,0));
   }
 #endif
@@ -790,9 +923,10 @@ void computeChi2MPlex(const MPlexLS &psErr,  const MPlexLV& psPar, const MPlexQI
 
 
 
-void updateParametersEndcapMPlex(const MPlexLS &psErr,  const MPlexLV& psPar, const MPlexQI &inChg,
-				 const MPlexHS &msErr,  const MPlexHV& msPar,
-                                       MPlexLS &outErr,       MPlexLV& outPar,
+template<int NN>
+void updateParametersEndcapMPlex(const MPlexLS_T<NN> &psErr,  const MPlexLV_T<NN>& psPar, const MPlexQI_T<NN> &inChg,
+				 const MPlexHS_T<NN> &msErr,  const MPlexHV_T<NN>& msPar,
+                                       MPlexLS_T<NN> &outErr,       MPlexLV_T<NN>& outPar,
 				 const int      N_proc)
 {
   // const idx_t N = psErr.N;
@@ -804,8 +938,8 @@ void updateParametersEndcapMPlex(const MPlexLS &psErr,  const MPlexLV& psPar, co
   // updateParametersContext ctx;
   //assert((long long)(&updateCtx.propErr.fArray[0]) % 64 == 0);
 
-  MPlexLS propErr;
-  MPlexLV propPar;
+  MPlexLS_T<NN> propErr;
+  MPlexLV_T<NN> propPar;
   // do a full propagation step to correct for residual distance from the hit radius - need the charge for this
   if (Config::useCMSGeom) {
     propagateHelixToZMPlex(psErr,  psPar, inChg,  msPar, propErr, propPar, N_proc);
@@ -837,10 +971,10 @@ void updateParametersEndcapMPlex(const MPlexLS &psErr,  const MPlexLV& psPar, co
   }
 #endif
 
-  MPlex2V res;
+  MPlex2V_T<NN> res;
   SubtractFirst2(msPar, propPar, res);
 
-  MPlex2S resErr;
+  MPlex2S_T<NN> resErr;
   AddIntoUpperLeft2x2(propErr, msErr, resErr);
 
 #ifdef DEBUG
@@ -853,10 +987,10 @@ void updateParametersEndcapMPlex(const MPlexLS &psErr,  const MPlexLV& psPar, co
   }
 #endif
 
-  //invert the 2x2 matrix
-  Matriplex::InvertCramerSym(resErr);
+  // factorize the 2x2 matrix, resErr = L * LT
+  Matriplex::CholeskyDecomposeSym(resErr);
 
-  MPlexL2 K;
+  MPlexL2_T<NN> K;
   KalmanGain(propErr, resErr, K);
 
   MultResidualsAdd(K, propPar, res, outPar);
@@ -881,7 +1015,7 @@ void updateParametersEndcapMPlex(const MPlexLS &psErr,  const MPlexLV& psPar, co
     for (int i = 0; i < 2; ++i) {
         printf("%8f ", res.At(0,i,0));
     } printf("\n");
-    printf("resErr (Inv):\n");
+    printf("resErr (Cholesky factor):\n");
     for (int i = 0; i < 2; ++i) { for (int j = 0; j < 2; ++j)
         printf("%8f ", resErr.At(0,i,j)); printf("\n");
     } printf("\n");
@@ -901,9 +1035,10 @@ void updateParametersEndcapMPlex(const MPlexLS &psErr,  const MPlexLV& psPar, co
 #endif
 }
 
-void computeChi2EndcapMPlex(const MPlexLS &psErr,  const MPlexLV& psPar, const MPlexQI &inChg,
-			    const MPlexHS &msErr,  const MPlexHV& msPar,
-                                  MPlexQF& outChi2,
+template<int NN>
+void computeChi2EndcapMPlex(const MPlexLS_T<NN> &psErr,  const MPlexLV_T<NN>& psPar, const MPlexQI_T<NN> &inChg,
+			    const MPlexHS_T<NN> &msErr,  const MPlexHV_T<NN>& msPar,
+                                  MPlexQF_T<NN>& outChi2,
 			    const int      N_proc)
 {
   // const idx_t N = psErr.N;
@@ -915,8 +1050,8 @@ void computeChi2EndcapMPlex(const MPlexLS &psErr,  const MPlexLV& psPar, const M
   // updateParametersContext ctx;
   //assert((long long)(&updateCtx.propErr.fArray[0]) % 64 == 0);
 
-  MPlexLS propErr;
-  MPlexLV propPar;
+  MPlexLS_T<NN> propErr;
+  MPlexLV_T<NN> propPar;
   // do a full propagation step to correct for residual distance from the hit radius - need the charge for this
   if (Config::useCMSGeom) {
     propagateHelixToZMPlex(psErr,  psPar, inChg,  msPar, propErr, propPar, N_proc);
@@ -948,42 +1083,125 @@ void computeChi2EndcapMPlex(const MPlexLS &psErr,  const MPlexLV& psPar, const M
   }
 #endif
 
-  MPlex2V res;
-  SubtractFirst2(msPar, propPar, res);
-
-  MPlex2S resErr;
-  AddIntoUpperLeft2x2(propErr, msErr, resErr);
+  Chi2OnZPlane(propErr, propPar, msErr, msPar, outChi2);
 
 #ifdef DEBUG
   {
     dmutex_guard;
-    printf("res:\n");
-    for (int i = 0; i < 2; ++i) {
-        printf("%8f ", res.At(0,0,i)); printf("\n");
-    } printf("\n");
-    printf("resErr:\n");
-    for (int i = 0; i < 2; ++i) { for (int j = 0; j < 2; ++j)
-        printf("%8f ", resErr.At(0,i,j)); printf("\n");
-    } printf("\n");
+    printf("chi2: %8f\n", outChi2.At(0,0,0));
   }
 #endif
 
-  //invert the 2x2 matrix
-  Matriplex::InvertCramerSym(resErr);
+}
 
-  //compute chi2
-  Chi2Similarity(res, resErr, outChi2);
+//==============================================================================
+// Mixed barrel / endcap
+//==============================================================================
 
-#ifdef DEBUG
+namespace
+{
+template<int NN>
+int countDisks(const MPlexQI_T<NN> &isDisk, const int N_proc)
+{
+  int n_disk = 0;
+  for (int n = 0; n < N_proc; ++n)
   {
-    dmutex_guard;
-    printf("resErr_loc (Inv):\n");
-    for (int i = 0; i < 2; ++i) {
-      for (int j = 0; j < 2; ++j)
-        printf("%8f ", resErr.At(0,i,j)); printf("\n");
-    } printf("\n");
-    printf("chi2: %8f\n", outChi2.At(0,0,0));
+    n_disk += isDisk.ConstAt(n, 0, 0) != 0;
   }
-#endif
+  return n_disk;
+}
+}
 
+template<int NN>
+void updateParametersMixedMPlex(const MPlexLS_T<NN> &psErr,  const MPlexLV_T<NN>& psPar, const MPlexQI_T<NN> &inChg,
+                                const MPlexQI_T<NN> &isDisk,
+                                const MPlexHS_T<NN> &msErr,  const MPlexHV_T<NN>& msPar, const MPlexQF_T<NN> &msInv2R,
+                                      MPlexLS_T<NN> &outErr,       MPlexLV_T<NN>& outPar,
+                                const int      N_proc, UpdateParametersContext<NN>& ctx)
+{
+  const int n_disk = countDisks(isDisk, N_proc);
+
+  if (n_disk == 0)
+  {
+    updateParametersMPlex(psErr, psPar, inChg, msErr, msPar, msInv2R, outErr, outPar, N_proc, ctx);
+  }
+  else if (n_disk == N_proc)
+  {
+    updateParametersEndcapMPlex(psErr, psPar, inChg, msErr, msPar, outErr, outPar, N_proc);
+  }
+  else
+  {
+    MPlexLS_T<NN> errZ;
+    MPlexLV_T<NN> parZ;
+    updateParametersMPlex      (psErr, psPar, inChg, msErr, msPar, msInv2R, outErr, outPar, N_proc, ctx);
+    updateParametersEndcapMPlex(psErr, psPar, inChg, msErr, msPar, errZ, parZ, N_proc);
+    outErr.Blend(errZ, isDisk.fArray);
+    outPar.Blend(parZ, isDisk.fArray);
+  }
 }
+
+template<int NN>
+void computeChi2MixedMPlex(const MPlexLS_T<NN> &psErr,  const MPlexLV_T<NN>& psPar, const MPlexQI_T<NN> &inChg,
+                           const MPlexQI_T<NN> &isDisk,
+                           const MPlexHS_T<NN> &msErr,  const MPlexHV_T<NN>& msPar, const MPlexQF_T<NN> &msInv2R,
+                                 MPlexQF_T<NN>& outChi2,
+                           const int      N_proc, UpdateParametersContext<NN>& ctx)
+{
+  const int n_disk = countDisks(isDisk, N_proc);
+
+  if (n_disk == 0)
+  {
+    computeChi2MPlex(psErr, psPar, inChg, msErr, msPar, msInv2R, outChi2, N_proc, ctx);
+  }
+  else if (n_disk == N_proc)
+  {
+    computeChi2EndcapMPlex(psErr, psPar, inChg, msErr, msPar, outChi2, N_proc);
+  }
+  else
+  {
+    MPlexQF_T<NN> chi2Z;
+    computeChi2MPlex      (psErr, psPar, inChg, msErr, msPar, msInv2R, outChi2, N_proc, ctx);
+    computeChi2EndcapMPlex(psErr, psPar, inChg, msErr, msPar, chi2Z, N_proc);
+    outChi2.Blend(chi2Z, isDisk.fArray);
+  }
+}
+
+//==============================================================================
+// Explicit instantiations, see MPLEX_FOR_EACH_WIDTH in Matrix.h
+//==============================================================================
+
+#define INSTANTIATE_KALMAN_MPLEX(W) \
+  template void updateParametersMPlex<W>(const MPlexLS_T<W>&, const MPlexLV_T<W>&, const MPlexQI_T<W>&, \
+                                         const MPlexHS_T<W>&, const MPlexHV_T<W>&, \
+                                         MPlexLS_T<W>&, MPlexLV_T<W>&, const int); \
+  template void updateParametersMPlex<W>(const MPlexLS_T<W>&, const MPlexLV_T<W>&, const MPlexQI_T<W>&, \
+                                         const MPlexHS_T<W>&, const MPlexHV_T<W>&, const MPlexQF_T<W>&, \
+                                         MPlexLS_T<W>&, MPlexLV_T<W>&, const int); \
+  template void updateParametersMPlex<W>(const MPlexLS_T<W>&, const MPlexLV_T<W>&, const MPlexQI_T<W>&, \
+                                         const MPlexHS_T<W>&, const MPlexHV_T<W>&, const MPlexQF_T<W>&, \
+                                         MPlexLS_T<W>&, MPlexLV_T<W>&, const int, UpdateParametersContext<W>&); \
+  template void computeChi2MPlex<W>(const MPlexLS_T<W>&, const MPlexLV_T<W>&, const MPlexQI_T<W>&, \
+                                    const MPlexHS_T<W>&, const MPlexHV_T<W>&, \
+                                    MPlexQF_T<W>&, const int); \
+  template void computeChi2MPlex<W>(const MPlexLS_T<W>&, const MPlexLV_T<W>&, const MPlexQI_T<W>&, \
+                                    const MPlexHS_T<W>&, const MPlexHV_T<W>&, const MPlexQF_T<W>&, \
+                                    MPlexQF_T<W>&, const int); \
+  template void computeChi2MPlex<W>(const MPlexLS_T<W>&, const MPlexLV_T<W>&, const MPlexQI_T<W>&, \
+                                    const MPlexHS_T<W>&, const MPlexHV_T<W>&, const MPlexQF_T<W>&, \
+                                    MPlexQF_T<W>&, const int, UpdateParametersContext<W>&); \
+  template void updateParametersEndcapMPlex<W>(const MPlexLS_T<W>&, const MPlexLV_T<W>&, const MPlexQI_T<W>&, \
+                                               const MPlexHS_T<W>&, const MPlexHV_T<W>&, \
+                                               MPlexLS_T<W>&, MPlexLV_T<W>&, const int); \
+  template void computeChi2EndcapMPlex<W>(const MPlexLS_T<W>&, const MPlexLV_T<W>&, const MPlexQI_T<W>&, \
+                                          const MPlexHS_T<W>&, const MPlexHV_T<W>&, \
+                                          MPlexQF_T<W>&, const int); \
+  template void updateParametersMixedMPlex<W>(const MPlexLS_T<W>&, const MPlexLV_T<W>&, const MPlexQI_T<W>&, \
+                                              const MPlexQI_T<W>&, \
+                                              const MPlexHS_T<W>&, const MPlexHV_T<W>&, const MPlexQF_T<W>&, \
+                                              MPlexLS_T<W>&, MPlexLV_T<W>&, const int, UpdateParametersContext<W>&); \
+  template void computeChi2MixedMPlex<W>(const MPlexLS_T<W>&, const MPlexLV_T<W>&, const MPlexQI_T<W>&, \
+                                         const MPlexQI_T<W>&, \
+                                         const MPlexHS_T<W>&, const MPlexHV_T<W>&, const MPlexQF_T<W>&, \
+                                         MPlexQF_T<W>&, const int, UpdateParametersContext<W>&);
+
+MPLEX_FOR_EACH_KERNEL_WIDTH(INSTANTIATE_KALMAN_MPLEX)
@@ -4,34 +4,104 @@
 #include "Track.h"
 #include "Matrix.h"
 
+// Templated on plex width, instantiated for MPLEX_FOR_EACH_WIDTH (Matrix.h).
+
 #ifdef USE_CUDA
 #include "FitterCU.h"
 #endif
 
-void updateParametersMPlex(const MPlexLS &psErr,  const MPlexLV& psPar, const MPlexQI &inChg,
-                           const MPlexHS &msErr,  const MPlexHV& msPar,
-                                 MPlexLS &outErr,       MPlexLV& outPar,
+// Temporaries of updateParametersMPlex() and computeChi2MPlex(), to be kept
+// by the caller (MkFitterT::UpdCtx) and reused between calls.
+template<int NN>
+struct UpdateParametersContext
+{
+  MPlexLS_T<NN> propErr;     // state at the hit radius, CMS geometry
+  MPlexLV_T<NN> propPar;
+
+  MPlexQF_T<NN> rotT00;      // rotation to the tangent plane
+  MPlexQF_T<NN> rotT01;
+  MPlexHV_T<NN> res_glo;     // residual and its covariance, global and local
+  MPlexHS_T<NN> resErr_glo;
+  MPlex2V_T<NN> res_loc;
+  MPlex2S_T<NN> resErr_loc;
+  MPlexHH_T<NN> tempHH;
+  MPlexLH_T<NN> K;           // kalman gain
+  MPlexLL_T<NN> tempLL;
+#ifndef CCSCOORD
+  MPlexLV_T<NN> propPar_ccs;
+  MPlexLL_T<NN> jac_ccs;
+#endif
+};
+
+template<int NN>
+void updateParametersMPlex(const MPlexLS_T<NN> &psErr,  const MPlexLV_T<NN>& psPar, const MPlexQI_T<NN> &inChg,
+                           const MPlexHS_T<NN> &msErr,  const MPlexHV_T<NN>& msPar,
+                                 MPlexLS_T<NN> &outErr,       MPlexLV_T<NN>& outPar,
                            const int      N_proc);
 
+// Same, with msInv2R = 1 / (2 * r_hit) precomputed, see LayerOfHits::m_hit_inv2rs.
+template<int NN>
+void updateParametersMPlex(const MPlexLS_T<NN> &psErr,  const MPlexLV_T<NN>& psPar, const MPlexQI_T<NN> &inChg,
+                           const MPlexHS_T<NN> &msErr,  const MPlexHV_T<NN>& msPar, const MPlexQF_T<NN> &msInv2R,
+                                 MPlexLS_T<NN> &outErr,       MPlexLV_T<NN>& outPar,
+                           const int      N_proc);
+
+template<int NN>
+void updateParametersMPlex(const MPlexLS_T<NN> &psErr,  const MPlexLV_T<NN>& psPar, const MPlexQI_T<NN> &inChg,
+                           const MPlexHS_T<NN> &msErr,  const MPlexHV_T<NN>& msPar, const MPlexQF_T<NN> &msInv2R,
+                                 MPlexLS_T<NN> &outErr,       MPlexLV_T<NN>& outPar,
+                           const int      N_proc, UpdateParametersContext<NN>& ctx);
+
 #ifdef USE_CUDA  // FIXME: temporary; move to FitterCU
 void computeChi2MPlex_tmp(const MPlexLS &psErr,  const MPlexLV& psPar, const MPlexQI &inChg,
                       const MPlexHS &msErr,  const MPlexHV& msPar,
                             MPlexQF& outChi2,
                             FitterCU<float>& cuFitter);
 #endif
-void computeChi2MPlex(const MPlexLS &psErr,  const MPlexLV& psPar, const MPlexQI &inChg,
-		      const MPlexHS &msErr,  const MPlexHV& msPar,
-                            MPlexQF& outChi2,
+template<int NN>
+void computeChi2MPlex(const MPlexLS_T<NN> &psErr,  const MPlexLV_T<NN>& psPar, const MPlexQI_T<NN> &inChg,
+		      const MPlexHS_T<NN> &msErr,  const MPlexHV_T<NN>& msPar,
+                            MPlexQF_T<NN>& outChi2,
+                      const int      N_proc);
+
+template<int NN>
+void computeChi2MPlex(const MPlexLS_T<NN> &psErr,  const MPlexLV_T<NN>& psPar, const MPlexQI_T<NN> &inChg,
+                      const MPlexHS_T<NN> &msErr,  const MPlexHV_T<NN>& msPar, const MPlexQF_T<NN> &msInv2R,
+                            MPlexQF_T<NN>& outChi2,
                       const int      N_proc);
 
-void updateParametersEndcapMPlex(const MPlexLS &psErr,  const MPlexLV& psPar, const MPlexQI &inChg,
-				 const MPlexHS &msErr,  const MPlexHV& msPar,
-                                       MPlexLS &outErr,       MPlexLV& outPar,
+template<int NN>
+void computeChi2MPlex(const MPlexLS_T<NN> &psErr,  const MPlexLV_T<NN>& psPar, const MPlexQI_T<NN> &inChg,
+                      const MPlexHS_T<NN> &msErr,  const MPlexHV_T<NN>& msPar, const MPlexQF_T<NN> &msInv2R,
+                            MPlexQF_T<NN>& outChi2,
+                      const int      N_proc, UpdateParametersContext<NN>& ctx);
+
+template<int NN>
+void updateParametersEndcapMPlex(const MPlexLS_T<NN> &psErr,  const MPlexLV_T<NN>& psPar, const MPlexQI_T<NN> &inChg,
+				 const MPlexHS_T<NN> &msErr,  const MPlexHV_T<NN>& msPar,
+                                       MPlexLS_T<NN> &outErr,       MPlexLV_T<NN>& outPar,
 				 const int      N_proc);
 
-void computeChi2EndcapMPlex(const MPlexLS &psErr,  const MPlexLV& psPar, const MPlexQI &inChg,
-			    const MPlexHS &msErr,  const MPlexHV& msPar,
-                                  MPlexQF& outChi2,
+template<int NN>
+void computeChi2EndcapMPlex(const MPlexLS_T<NN> &psErr,  const MPlexLV_T<NN>& psPar, const MPlexQI_T<NN> &inChg,
+			    const MPlexHS_T<NN> &msErr,  const MPlexHV_T<NN>& msPar,
+                                  MPlexQF_T<NN>& outChi2,
 			    const int      N_proc);
 
+// Barrel (isDisk == 0) or endcap (isDisk != 0) update / chi2 per slot. Mixed
+// plexes run both and take each slot from the matching one.
+template<int NN>
+void updateParametersMixedMPlex(const MPlexLS_T<NN> &psErr,  const MPlexLV_T<NN>& psPar, const MPlexQI_T<NN> &inChg,
+                                const MPlexQI_T<NN> &isDisk,
+                                const MPlexHS_T<NN> &msErr,  const MPlexHV_T<NN>& msPar, const MPlexQF_T<NN> &msInv2R,
+                                      MPlexLS_T<NN> &outErr,       MPlexLV_T<NN>& outPar,
+                                const int      N_proc, UpdateParametersContext<NN>& ctx);
+
+template<int NN>
+void computeChi2MixedMPlex(const MPlexLS_T<NN> &psErr,  const MPlexLV_T<NN>& psPar, const MPlexQI_T<NN> &inChg,
+                           const MPlexQI_T<NN> &isDisk,
+                           const MPlexHS_T<NN> &msErr,  const MPlexHV_T<NN>& msPar, const MPlexQF_T<NN> &msInv2R,
+                                 MPlexQF_T<NN>& outChi2,
+                           const int      N_proc, UpdateParametersContext<NN>& ctx);
+
 #endif
@@ -0,0 +1,147 @@
+#include "MaterialMap.h"
+
+#include "PropagationMPlex.h"
+
+#include <cstdio>
+#include <fstream>
+#include <sstream>
+
+MaterialMap g_material_map;
+
+//==============================================================================
+
+MaterialMap::MaterialMap(int nr, float rmax, int nz, float zmax)
+{
+  Reset(nr, rmax, nz, zmax);
+}
+
+void MaterialMap::Reset(int nr, float rmax, int nz, float zmax)
+{
+  m_nr     = nr;
+  m_nz     = nz;
+  m_inv_dr = nr / rmax;
+  m_inv_dz = nz / zmax;
+  m_last_r = nr - 0.5f;
+  m_last_z = nz - 0.5f;
+
+  m_data.assign(2 * nr * nz, 0.0f);
+
+  FillFromParametrization();
+}
+
+void MaterialMap::FillFromParametrization()
+{
+  const float dr = 1.0f / m_inv_dr;
+  const float dz = 1.0f / m_inv_dz;
+
+  for (int ir = 0; ir < m_nr; ++ir)
+  {
+    const float r = (ir + 0.5f) * dr;
+    for (int iz = 0; iz < m_nz; ++iz)
+    {
+      const float z = (iz + 0.5f) * dz;
+      const int   b = ir * m_nz + iz;
+      m_data[2*b]     = getRlVal(r, z);
+      m_data[2*b + 1] = getXiVal(r, z);
+    }
+  }
+}
+
+//------------------------------------------------------------------------------
+
+int MaterialMap::FillFromSimHits(const std::string& fname)
+{
+  std::ifstream infile(fname);
+  if ( ! infile) return -1;
+
+  std::vector<double> sum(2 * m_nr * m_nz, 0.0);
+  std::vector<int>    cnt(m_nr * m_nz, 0);
+  int n_used = 0;
+
+  std::string line;
+  while (std::getline(infile, line))
+  {
+    std::istringstream iss(line);
+    std::string type;
+    iss >> type;
+
+    if (type != "simHit") continue;
+
+    float x, y, z, r, eta, radl, xi;
+    iss >> x >> y >> z >> r >> eta >> radl >> xi;
+    if ( ! iss) continue;
+
+    const int b = Bin(std::sqrt(x*x + y*y), z);
+    sum[2*b]     += radl;
+    sum[2*b + 1] += xi;
+    ++cnt[b];
+    ++n_used;
+  }
+
+  for (int b = 0; b < m_nr * m_nz; ++b)
+  {
+    if (cnt[b] == 0) continue;
+    m_data[2*b]     = sum[2*b]     / cnt[b];
+    m_data[2*b + 1] = sum[2*b + 1] / cnt[b];
+  }
+
+  return n_used;
+}
+
+//------------------------------------------------------------------------------
+
+bool MaterialMap::Load(const std::string& fname)
+{
+  std::ifstream infile(fname);
+  if ( ! infile) return false;
+
+  bool        got_header = false;
+  std::string line;
+  while (std::getline(infile, line))
+  {
+    if (line.empty() || line[0] == '#') continue;
+
+    std::istringstream iss(line);
+    if ( ! got_header)
+    {
+      int   nr, nz;
+      float rmax, zmax;
+      iss >> nr >> rmax >> nz >> zmax;
+      if ( ! iss || nr <= 0 || nz <= 0 || rmax <= 0 || zmax <= 0) return false;
+      Reset(nr, rmax, nz, zmax);
+      got_header = true;
+      continue;
+    }
+
+    int   ir, iz;
+    float rl, xi;
+    iss >> ir >> iz >> rl >> xi;
+    if ( ! iss || ir < 0 || ir >= m_nr || iz < 0 || iz >= m_nz) return false;
+
+    const int b = ir * m_nz + iz;
+    m_data[2*b]     = rl;
+    m_data[2*b + 1] = xi;
+  }
+
+  return got_header;
+}
+
+bool MaterialMap::Save(const std::string& fname) const
+{
+  FILE *fp = fopen(fname.c_str(), "w");
+  if ( ! fp) return false;
+
+  fprintf(fp, "# nr rmax nz zmax, then: ir iz rl xi\n");
+  fprintf(fp, "%d %g %d %g\n", m_nr, rMax(), m_nz, zMax());
+  for (int ir = 0; ir < m_nr; ++ir)
+  {
+    for (int iz = 0; iz < m_nz; ++iz)
+    {
+      const int b = ir * m_nz + iz;
+      fprintf(fp, "%d %d %.6g %.6g\n", ir, iz, m_data[2*b], m_data[2*b + 1]);
+    }
+  }
+
+  fclose(fp);
+  return true;
+}
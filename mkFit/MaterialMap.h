@@ -0,0 +1,82 @@
+#ifndef _material_map_
+#define _material_map_
+
+#include <cmath>
+#include <string>
+#include <vector>
+
+// Radiation length (Rl) and energy loss parameter (Xi) of the tracker material,
+// tabulated on a uniform (r, |z|) grid. Both are for normal incidence,
+// applyMaterialEffects() does the 1/cos correction.
+//
+// The default map samples getRlVal()/getXiVal() (PropagationMPlex.h) at bin
+// centres. Their boundaries are all on integer cm so the 1 cm default binning
+// reproduces them exactly, and a lookup is two clamped float->int conversions
+// and one load per slot instead of a chain of branches.
+//
+// Values are constant within a bin, there is no interpolation: the material is
+// concentrated in thin layers and interpolating would smear it into the gaps.
+//
+// Points beyond rmax take the value of the last r bin, for the default map this
+// is exact as the parametrization does not change above r = 102 cm. The last z
+// bins are beyond the tracker so points beyond zmax see no material.
+
+class MaterialMap
+{
+public:
+  MaterialMap(int nr = 120, float rmax = 120.f, int nz = 300, float zmax = 300.f);
+
+  void Reset(int nr, float rmax, int nz, float zmax);
+
+  // Resample getRlVal()/getXiVal() on the current binning.
+  void FillFromParametrization();
+
+  // Average the simHit radl/xi of a CMSSW text input (Config::inputFile format)
+  // per bin. Bins without simHits keep their current values.
+  // Returns the number of simHits used, -1 if the file can not be opened.
+  int  FillFromSimHits(const std::string& fname);
+
+  // Text format: a "nr rmax nz zmax" line followed by "ir iz rl xi" lines.
+  // Lines starting with # are skipped. Bins not listed take the
+  // parametrization values.
+  bool Load(const std::string& fname);
+  bool Save(const std::string& fname) const;
+
+  int Bin(const float r, const float z) const
+  {
+    // Written with selects so that it vectorizes; NaN goes to the last bin.
+    const float fr = r * m_inv_dr;
+    const float fz = std::abs(z) * m_inv_dz;
+    const int   ir = (int) (fr < m_last_r ? fr : m_last_r);
+    const int   iz = (int) (fz < m_last_z ? fz : m_last_z);
+    return ir * m_nz + iz;
+  }
+
+  float Rl(const int bin) const { return m_data[2*bin];     }
+  float Xi(const int bin) const { return m_data[2*bin + 1]; }
+
+  void  Get(const float r, const float z, float& rl, float& xi) const
+  {
+    const float * __restrict__ d = &m_data[2*Bin(r, z)];
+    rl = d[0];
+    xi = d[1];
+  }
+
+  int   nR()   const { return m_nr; }
+  int   nZ()   const { return m_nz; }
+  float rMax() const { return m_nr / m_inv_dr; }
+  float zMax() const { return m_nz / m_inv_dz; }
+
+private:
+  int   m_nr, m_nz;
+  float m_inv_dr, m_inv_dz;
+  float m_last_r, m_last_z;
+
+  // Interleaved (rl, xi) pairs, bin = ir * m_nz + iz, so a barrel layer at
+  // fixed r is one contiguous row.
+  std::vector<float> m_data;
+};
+
+extern MaterialMap g_material_map;
+
+#endif
@@ -0,0 +1,226 @@
+#ifndef _math_mplex_
+#define _math_mplex_
+
+#include "Matrix.h"
+
+#include <cstring>
+
+// Branch-free float versions of the transcendental functions used in the hot
+// loops. libm calls are opaque to the vectorizer, these inline into the
+// per-slot loops (only selects, FMAs and integer bit ops) so gcc and icc can
+// vectorize them. Whole-plex versions, templated on plex width, are at the
+// bottom.
+//
+// Accuracy is chosen per call with the template argument:
+//   Full -- cephes single precision polynomials, within 3 ulp of libm;
+//           sincos is good for |x| < 8192, log for positive normal x.
+//   Fast -- shorter polynomials, about 4e-5 abs error for sincos and 1e-5 rad
+//           for atan2, for window and bin computations. log and exp are cheap
+//           enough that Fast is the same as Full.
+//
+// Sign of zero is not propagated: atan2(-0, x < 0) is +pi.
+// sqrt and rsqrt rely on -fno-math-errno (Makefile.config) to vectorize.
+
+namespace VecMath
+{
+  enum Accuracy { Fast, Full };
+
+  constexpr float kPi     = 3.14159265358979323846f;
+  constexpr float kPiOver2 = 1.57079632679489661923f;
+  constexpr float kPiOver4 = 0.78539816339744830962f;
+
+  CUDA_CALLABLE
+  inline int   float_as_int(float f) { int   i; std::memcpy(&i, &f, sizeof(i)); return i; }
+  CUDA_CALLABLE
+  inline float int_as_float(int i)   { float f; std::memcpy(&f, &i, sizeof(f)); return f; }
+
+  //----------------------------------------------------------------------------
+
+  // Reduce to r in [-pi/4, pi/4] with x = q * pi/2 + r, pi/2 in three parts
+  // (Cody-Waite), then pick sin/cos polynomial and sign from q mod 4.
+  template<Accuracy A = Full>
+  CUDA_CALLABLE
+  inline void sincos(const float x, float& s, float& c)
+  {
+    const float q = std::rint(x * 0.63661977236758134308f);
+    const int   iq = (int) q;
+    const float r = ((x - q * 1.5703125f) - q * 4.837512969970703125e-4f) - q * 7.54978995489188216e-8f;
+    const float z = r * r;
+
+    float ps, pc;
+    if (A == Full)
+    {
+      ps = r + r * z * (-1.6666654611e-1f + z * (8.3321608736e-3f + z * -1.9515295891e-4f));
+      pc = 1.f - 0.5f * z + z * z * (4.166664568298827e-2f + z * (-1.388731625493765e-3f + z * 2.443315711809948e-5f));
+    }
+    else
+    {
+      ps = r + r * z * (-1.6666654611e-1f + z * 8.3321608736e-3f);
+      pc = 1.f - 0.5f * z + z * z * (4.166664568298827e-2f - z * 1.388731625493765e-3f);
+    }
+
+    const float ss = (iq & 1) ? pc : ps;
+    const float cc = (iq & 1) ? ps : pc;
+    s = (iq & 2)       ? -ss : ss;
+    c = ((iq + 1) & 2) ? -cc : cc;
+  }
+
+  // Fold into t = min/max in [0, 1], evaluate atan(t) and unfold by octant.
+  // Full splits [0, 1] once more at tan(pi/8).
+  template<Accuracy A = Full>
+  CUDA_CALLABLE
+  inline float atan2(const float y, const float x)
+  {
+    const float ax = std::abs(x), ay = std::abs(y);
+    const float mx = ax > ay ? ax : ay;
+    const float mn = ax > ay ? ay : ax;
+    const float t  = mn / (mx + 1.17549435e-38f); // 0 for x = y = 0
+
+    float a;
+    if (A == Full)
+    {
+      const bool  big = t > 0.4142135623730950f;
+      const float tr  = (t - 1.f) / (t + 1.f);
+      const float u   = big ? tr : t;
+      const float z   = u * u;
+      a = (big ? kPiOver4 : 0.f) +
+          u + u * z * (-3.33329491539e-1f + z * (1.99777106478e-1f + z * (-1.38776856032e-1f + z * 8.05374449538e-2f)));
+    }
+    else
+    {
+      const float z = t * t;
+      a = t * (0.9998660f + z * (-0.3302995f + z * (0.1801410f + z * (-0.0851330f + z * 0.0208351f))));
+    }
+
+    a = ay > ax  ? kPiOver2 - a : a;
+    a = x  < 0.f ? kPi - a : a;
+    return y < 0.f ? -a : a;
+  }
+
+  template<Accuracy A = Full>
+  CUDA_CALLABLE
+  inline float atan(const float x)
+  {
+    return atan2<A>(x, 1.f);
+  }
+
+  // x = 2^e * m with m in [sqrt(1/2), sqrt(2)), log(m) by polynomial in m - 1,
+  // ln(2) in two parts.
+  template<Accuracy A = Full>
+  CUDA_CALLABLE
+  inline float log(const float x)
+  {
+    const int   i = float_as_int(x);
+    const float m = int_as_float((i & 0x007fffff) | 0x3f000000);
+    const bool  lo = m < 0.70710678118654752f;
+    const float e = (float) (((i >> 23) & 0xff) - (lo ? 127 : 126));
+    const float f = lo ? m + m - 1.f : m - 1.f;
+    const float z = f * f;
+
+    float y = f * z * (3.3333331174e-1f + f * (-2.4999993993e-1f + f * (2.0000714765e-1f + f * (-1.6668057665e-1f +
+              f * (1.4249322787e-1f + f * (-1.2420140846e-1f + f * (1.1676998740e-1f + f * (-1.1514610310e-1f +
+              f * 7.0376836292e-2f))))))));
+    y += -2.12194440e-4f * e - 0.5f * z;
+
+    const float r = f + y + 0.693359375f * e;
+    return x > 0.f ? r : (x == 0.f ? -HUGE_VALF : NAN);
+  }
+
+  // x = n ln(2) + r, |r| <= ln(2)/2, exp(r) by polynomial, 2^n built in the
+  // exponent bits. Clamped to the normal range.
+  template<Accuracy A = Full>
+  CUDA_CALLABLE
+  inline float exp(float x)
+  {
+    x = x > 88.3f ? 88.3f : x;
+    x = x < -87.3f ? -87.3f : x;
+
+    const float n = std::rint(x * 1.44269504088896341f);
+    const float r = (x - n * 0.693359375f) - n * -2.12194440e-4f;
+    const float z = r * r;
+
+    const float p = 1.f + r + z * (5.0000001201e-1f + r * (1.6666665459e-1f + r * (4.1665795894e-2f +
+                    r * (8.3334519073e-3f + r * (1.3981999507e-3f + r * 1.9875691500e-4f)))));
+
+    return p * int_as_float(((int) n + 127) << 23);
+  }
+
+  CUDA_CALLABLE
+  inline float sqrt(const float x)
+  {
+    return std::sqrt(x);
+  }
+
+  CUDA_CALLABLE
+  inline float rsqrt(const float x)
+  {
+    return 1.f / std::sqrt(x);
+  }
+
+  //----------------------------------------------------------------------------
+  // Whole plex versions, all NN slots are processed.
+  //----------------------------------------------------------------------------
+
+#ifndef __CUDACC__
+
+  template<Accuracy A = Full, int NN>
+  inline void SinCos(const MPlexQF_T<NN>& x, MPlexQF_T<NN>& s, MPlexQF_T<NN>& c)
+  {
+#pragma simd
+    for (int n = 0; n < NN; ++n)
+    {
+      sincos<A>(x.ConstAt(n, 0, 0), s.At(n, 0, 0), c.At(n, 0, 0));
+    }
+  }
+
+  template<Accuracy A = Full, int NN>
+  inline void ATan2(const MPlexQF_T<NN>& y, const MPlexQF_T<NN>& x, MPlexQF_T<NN>& out)
+  {
+#pragma simd
+    for (int n = 0; n < NN; ++n)
+    {
+      out.At(n, 0, 0) = atan2<A>(y.ConstAt(n, 0, 0), x.ConstAt(n, 0, 0));
+    }
+  }
+
+  template<Accuracy A = Full, int NN>
+  inline void Log(const MPlexQF_T<NN>& x, MPlexQF_T<NN>& out)
+  {
+#pragma simd
+    for (int n = 0; n < NN; ++n)
+    {
+      out.At(n, 0, 0) = log<A>(x.ConstAt(n, 0, 0));
+    }
+  }
+
+  template<Accuracy A = Full, int NN>
+  inline void Exp(const MPlexQF_T<NN>& x, MPlexQF_T<NN>& out)
+  {
+#pragma simd
+    for (int n = 0; n < NN; ++n)
+    {
+      out.At(n, 0, 0) = exp<A>(x.ConstAt(n, 0, 0));
+    }
+  }
+
+  template<int NN>
+  inline void Sqrt(const MPlexQF_T<NN>& x, MPlexQF_T<NN>& out)
+  {
+#pragma simd
+    for (int n = 0; n < NN; ++n)
+    {
+      out.At(n, 0, 0) = std::sqrt(x.ConstAt(n, 0, 0));
+    }
+  }
+
+  template<int NN>
+  inline void RSqrt(const MPlexQF_T<NN>& x, MPlexQF_T<NN>& out)
+  {
+    Matriplex::InvSqrt<float, NN>(x.fArray, out.fArray);
+  }
+
+#endif
+
+}
+
+#endif
@@ -16,12 +16,12 @@ ExecutionContext g_exe_ctx;
 namespace
 {
   auto retcand = [](CandCloner* cloner) { g_exe_ctx.m_cloners.ReturnToPool(cloner); };
-  auto retfitr = [](MkFitter*   mkfp  ) { g_exe_ctx.m_fitters.ReturnToPool(mkfp);   };
 }
 
 #ifdef DEBUG
 namespace {
-  void pre_prop_print(int ilay, MkFitter* mkfp) {
+  template<int NN>
+  void pre_prop_print(int ilay, MkFitterT<NN>* mkfp) {
     std::cout << "propagate to lay=" << ilay+1 
               << " start from x=" << mkfp->getPar(0, 0, 0) << " y=" << mkfp->getPar(0, 0, 1) << " z=" << mkfp->getPar(0, 0, 2)
               << " r=" << getHypot(mkfp->getPar(0, 0, 0), mkfp->getPar(0, 0, 1))
@@ -33,7 +33,8 @@ namespace {
 #endif
   }
 
-  void post_prop_print(int ilay, MkFitter* mkfp) {
+  template<int NN>
+  void post_prop_print(int ilay, MkFitterT<NN>* mkfp) {
     std::cout << "propagate to lay=" << ilay+1 
               << " arrive at x=" << mkfp->getPar(0, 1, 0) << " y=" << mkfp->getPar(0, 1, 1) << " z=" << mkfp->getPar(0, 1, 2)
               << " r=" << getHypot(mkfp->getPar(0, 1, 0), mkfp->getPar(0, 1, 1)) << std::endl;
@@ -111,6 +112,7 @@ MkBuilder::~MkBuilder()
 {
    for (int i = 0; i < Config::numThreadsFinder; ++i)
    {
+     m_mkfp_arr[i]->~MkFitter();
      _mm_free(m_mkfp_arr[i]);
    }
 }
@@ -200,10 +202,11 @@ int MkBuilder::find_seeds()
 {
   bool debug(false);
 
-  TripletIdxConVec seed_idcs;
+  TripletIdxVec seed_idcs;
 
   double time = dtime();
   findSeedsByRoadSearch(seed_idcs,m_event_of_hits.m_layers_of_hits,m_event->layerHits_[1].size(),m_event);
+  cleanSeedsByRoadSearch(seed_idcs,m_event_of_hits.m_layers_of_hits);
   time = dtime() - time;
 
   // use this to initialize tracks
@@ -214,35 +217,52 @@ int MkBuilder::find_seeds()
   // make seed tracks
   TrackVec & seedtracks = m_event->seedTracks_;
   seedtracks.resize(seed_idcs.size());
-  for (int iseed = 0; iseed < seedtracks.size(); iseed++)
-  {
-    auto & seedtrack = seedtracks[iseed];
-    seedtrack.setLabel(iseed);
 
-    // use to set charge
-    const Hit & hit0 = lay0hits[seed_idcs[iseed][0]];
-    const Hit & hit1 = lay1hits[seed_idcs[iseed][1]];
-    const Hit & hit2 = lay2hits[seed_idcs[iseed][2]];
+  tbb::parallel_for(tbb::blocked_range<int>(0, seedtracks.size(), 1024),
+    [&](const tbb::blocked_range<int>& seeds) {
+      for (int iseed = seeds.begin(); iseed < seeds.end(); iseed++)
+      {
+        auto & seedtrack = seedtracks[iseed];
+        seedtrack.setLabel(iseed);
 
-    seedtrack.setCharge(calculateCharge(hit0,hit1,hit2));
+        // use to set charge
+        const Hit & hit0 = lay0hits[seed_idcs[iseed][0]];
+        const Hit & hit1 = lay1hits[seed_idcs[iseed][1]];
+        const Hit & hit2 = lay2hits[seed_idcs[iseed][2]];
 
-    for (int ihit = 0; ihit < Config::nlayers_per_seed; ihit++)
-    {
-      seedtrack.addHitIdx(seed_idcs[iseed][ihit],0.0f);
-    }
+        seedtrack.setCharge(calculateCharge(hit0,hit1,hit2));
 
-    for (int ihit = Config::nlayers_per_seed; ihit < Config::nLayers; ihit++)
-    {
-      seedtrack.setHitIdx(ihit,-1);
+        for (int ihit = 0; ihit < Config::nlayers_per_seed; ihit++)
+        {
+          seedtrack.addHitIdx(seed_idcs[iseed][ihit],0.0f);
+        }
+
+        for (int ihit = Config::nlayers_per_seed; ihit < Config::nLayers; ihit++)
+        {
+          seedtrack.setHitIdx(ihit,-1);
+        }
+
+        dprint("iseed: " << iseed << " mcids: " << hit0.mcTrackID(m_event->simHitsInfo_) << " " <<
+               hit1.mcTrackID(m_event->simHitsInfo_) << " " << hit1.mcTrackID(m_event->simHitsInfo_));
+      }
     }
-    
-    dprint("iseed: " << iseed << " mcids: " << hit0.mcTrackID(m_event->simHitsInfo_) << " " <<
-	   hit1.mcTrackID(m_event->simHitsInfo_) << " " << hit1.mcTrackID(m_event->simHitsInfo_));
-  }
+  );
   return time;
 }
 
 void MkBuilder::fit_seeds()
+{
+  switch (Config::fitVecWidth)
+  {
+#define FIT_SEEDS_CASE(W) case W: fit_seeds_impl<W>(); break;
+    MPLEX_FOR_EACH_WIDTH(FIT_SEEDS_CASE)
+#undef FIT_SEEDS_CASE
+    default: fit_seeds_impl<NN>();
+  }
+}
+
+template<int NN>
+void MkBuilder::fit_seeds_impl()
 {
   g_exe_ctx.populate(Config::numThreadsFinder);
   TrackVec& seedtracks = m_event->seedTracks_;
@@ -250,10 +270,13 @@ void MkBuilder::fit_seeds()
   int theEnd = seedtracks.size();
   int count = (theEnd + NN - 1)/NN;
 
+  Pool<MkFitterT<NN>> &pool = g_exe_ctx.fitters<NN>();
+  auto retfitr_nn = [&pool](MkFitterT<NN>* mkfp) { pool.ReturnToPool(mkfp); };
+
   tbb::parallel_for(tbb::blocked_range<int>(0, count, std::max(1, Config::numSeedsPerTask/NN)),
     [&](const tbb::blocked_range<int>& i) {
 
-      std::unique_ptr<MkFitter, decltype(retfitr)> mkfp(g_exe_ctx.m_fitters.GetFromPool(), retfitr);
+      std::unique_ptr<MkFitterT<NN>, decltype(retfitr_nn)> mkfp(pool.GetFromPool(), retfitr_nn);
       for (int it = i.begin(); it < i.end(); ++it)
       {
         fit_one_seed_set(seedtracks, it*NN, std::min((it+1)*NN, theEnd), mkfp.get());
@@ -265,7 +288,8 @@ void MkBuilder::fit_seeds()
   dcall(print_seeds(seedtracks));
 }
 
-inline void MkBuilder::fit_one_seed_set(TrackVec& seedtracks, int itrack, int end, MkFitter *mkfp)
+template<int NN>
+inline void MkBuilder::fit_one_seed_set(TrackVec& seedtracks, int itrack, int end, MkFitterT<NN> *mkfp)
 {
   mkfp->SetNhits(Config::nlayers_per_seed); //just to be sure (is this needed?)
   mkfp->InputTracksAndHits(seedtracks, m_event_of_hits.m_layers_of_hits, itrack, end);
@@ -600,6 +624,18 @@ void MkBuilder::find_tracks_load_seeds(EventOfCandidates& event_of_cands)
 }
 
 void MkBuilder::FindTracksBestHit(EventOfCandidates& event_of_cands)
+{
+  switch (Config::buildVecWidth)
+  {
+#define FIND_TRACKS_BH_CASE(W) case W: FindTracksBestHitImpl<W>(event_of_cands); break;
+    MPLEX_FOR_EACH_WIDTH(FIND_TRACKS_BH_CASE)
+#undef FIND_TRACKS_BH_CASE
+    default: FindTracksBestHitImpl<NN>(event_of_cands);
+  }
+}
+
+template<int NN>
+void MkBuilder::FindTracksBestHitImpl(EventOfCandidates& event_of_cands)
 {
   g_exe_ctx.populate(Config::numThreadsFinder);
 
@@ -612,15 +648,25 @@ void MkBuilder::FindTracksBestHit(EventOfCandidates& event_of_cands)
       tbb::parallel_for(tbb::blocked_range<int>(0,etabin_of_candidates.m_fill_index,Config::numSeedsPerTask), 
         [&](const tbb::blocked_range<int>& tracks)
       {
-        std::unique_ptr<MkFitter, decltype(retfitr)> mkfp(g_exe_ctx.m_fitters.GetFromPool(), retfitr);
-        
-        for (int itrack = tracks.begin(); itrack < tracks.end(); itrack += NN) {
-          int end = std::min(itrack + NN, tracks.end());
+        MkFitterSetT<NN> mkfps(Config::numBatchesInterleaved);
+
+        // With interleaving, mkfps.size() batches are walked through the layers
+        // together: hit selection and prefetching is done for all of them before
+        // any chi2 / update work is started.
+        for (int itrack = tracks.begin(); itrack < tracks.end(); itrack += mkfps.size() * NN) {
+          const int n_batches = std::min(mkfps.size(), (tracks.end() - itrack + NN - 1) / NN);
+
+          for (int ib = 0; ib < n_batches; ++ib)
+          {
+            const int beg = itrack + ib * NN;
+            const int end = std::min(beg + NN, tracks.end());
 
-          dprint(std::endl << "processing track=" << itrack << " etabin=" << ebin << " findex=" << etabin_of_candidates.m_fill_index);
+            dprint(std::endl << "processing track=" << beg << " etabin=" << ebin << " findex=" << etabin_of_candidates.m_fill_index);
 
-          mkfp->SetNhits(3);//just to be sure (is this needed?)
-          mkfp->InputTracksAndHitIdx(etabin_of_candidates.m_candidates, itrack, end, true);
+            mkfps[ib]->SetNhits(3);//just to be sure (is this needed?)
+            mkfps[ib]->InputTracksAndHitIdx(etabin_of_candidates.m_candidates, beg, end, true);
+            mkfps[ib]->ComputeHitWindows(end - beg);
+          }
 
           //ok now we start looping over layers
           //loop over layers, starting from after the seed
@@ -637,27 +683,49 @@ void MkBuilder::FindTracksBestHit(EventOfCandidates& event_of_cands)
             //   _mm_prefetch((char*) & bunch_of_hits.m_hits[i], _MM_HINT_T1);
             // }
 
-            mkfp->SelectHitIndices(layer_of_hits, end - itrack);
+            for (int ib = 0; ib < n_batches; ++ib)
+            {
+              const int beg = itrack + ib * NN;
+              const int end = std::min(beg + NN, tracks.end());
+
+              mkfps[ib]->SelectHitIndices(layer_of_hits, end - beg);
+
+              if (n_batches > 1) mkfps[ib]->PrefetchHits(layer_of_hits, end - beg);
+            }
 
 // #ifdef PRINTOUTS_FOR_PLOTS
 // 	     std::cout << "MX number of hits in window in layer " << ilay << " is " <<  mkfp->getXHitEnd(0, 0, 0)-mkfp->getXHitBegin(0, 0, 0) << std::endl;
 // #endif
 
-            //make candidates with best hit
-            dprint("make new candidates");
-            mkfp->AddBestHit(layer_of_hits, end - itrack);
-            mkfp->SetNhits(ilay + 1);  //here again assuming one hit per layer (is this needed?)
-
-            //propagate to layer
-            if (ilay + 1 < Config::nLayers)
+            for (int ib = 0; ib < n_batches; ++ib)
             {
-              dcall(pre_prop_print(ilay, mkfp.get()));
-              mkfp->PropagateTracksToR(m_event->geom_.Radius(ilay+1), end - itrack);
-              dcall(post_prop_print(ilay, mkfp.get()));
+              MkFitterT<NN> *mkfp = mkfps[ib];
+              const int  beg  = itrack + ib * NN;
+              const int  end  = std::min(beg + NN, tracks.end());
+
+              //make candidates with best hit
+              dprint("make new candidates");
+              mkfp->AddBestHit(layer_of_hits, end - beg);
+              mkfp->SetNhits(ilay + 1);  //here again assuming one hit per layer (is this needed?)
+
+              //propagate to layer
+              if (ilay + 1 < Config::nLayers)
+              {
+                dcall(pre_prop_print(ilay, mkfp));
+                mkfp->PropagateTracksToRAndWindow(m_event->geom_.Radius(ilay+1), end - beg);
+                dcall(post_prop_print(ilay, mkfp));
+              }
             }
 
           } // end of layer loop
-          mkfp->OutputFittedTracksAndHitIdx(etabin_of_candidates.m_candidates, itrack, end, true);
+
+          for (int ib = 0; ib < n_batches; ++ib)
+          {
+            const int beg = itrack + ib * NN;
+            const int end = std::min(beg + NN, tracks.end());
+
+            mkfps[ib]->OutputFittedTracksAndHitIdx(etabin_of_candidates.m_candidates, beg, end, true);
+          }
         }
       }); // end of seed loop
     }
@@ -690,6 +758,18 @@ void MkBuilder::find_tracks_load_seeds()
 //------------------------------------------------------------------------------
 
 void MkBuilder::FindTracksStandard()
+{
+  switch (Config::buildVecWidth)
+  {
+#define FIND_TRACKS_STD_CASE(W) case W: FindTracksStandardImpl<W>(); break;
+    MPLEX_FOR_EACH_WIDTH(FIND_TRACKS_STD_CASE)
+#undef FIND_TRACKS_STD_CASE
+    default: FindTracksStandardImpl<NN>();
+  }
+}
+
+template<int NN>
+void MkBuilder::FindTracksStandardImpl()
 {
   g_exe_ctx.populate(Config::numThreadsFinder);
   EventOfCombCandidates &event_of_comb_cands = m_event_tmp->m_event_of_comb_cands;
@@ -747,40 +827,61 @@ void MkBuilder::FindTracksStandard()
 	    tmp_candidates[iseed].reserve(2*Config::maxCandsPerSeed);//factor 2 seems reasonable to start with
 	  }
 
-	  //vectorized loop
-	  for (int itrack = 0; itrack < theEndCand; itrack += NN)
-	  {
-	    int end = std::min(itrack + NN, theEndCand);
-	  
-	    dprint("processing track=" << itrack);
-	  
-	    std::unique_ptr<MkFitter,   decltype(retfitr)> mkfp  (g_exe_ctx.m_fitters.GetFromPool(), retfitr);	
-	    
-	    mkfp->SetNhits(ilay);//here again assuming one hit per layer
-	  
-	    //fixme find a way to deal only with the candidates needed in this thread
-	    mkfp->InputTracksAndHitIdx(etabin_of_comb_candidates.m_candidates,
-				       seed_cand_idx, itrack, end,
-				       ilay == Config::nlayers_per_seed);
+	  //vectorized loop, software pipelined over mkfps.size() batches:
+	  //batch ib is propagated and gets its hits selected / prefetched before
+	  //FindCandidates() is run on batch ib - mkfps.size() + 1
+	  MkFitterSetT<NN> mkfps(Config::numBatchesInterleaved);
+
+	  const int n_batches = (theEndCand + NN - 1) / NN;
 
-	    //propagate to layer
-	    if (ilay > Config::nlayers_per_seed)
+	  for (int ib = 0; ib < n_batches + mkfps.size() - 1; ++ib)
+	  {
+	    if (ib < n_batches)
 	    {
-	      dcall(pre_prop_print(ilay, mkfp));
-	      mkfp->PropagateTracksToR(m_event->geom_.Radius(ilay), end - itrack);
-	      dcall(post_prop_print(ilay, mkfp));
+	      MkFitterT<NN> *mkfp = mkfps[ib];
+	      const int  itrack = ib * NN;
+	      const int  end    = std::min(itrack + NN, theEndCand);
+
+	      dprint("processing track=" << itrack);
+
+	      mkfp->SetNhits(ilay);//here again assuming one hit per layer
+
+	      //fixme find a way to deal only with the candidates needed in this thread
+	      mkfp->InputTracksAndHitIdx(etabin_of_comb_candidates.m_candidates,
+					 seed_cand_idx, itrack, end,
+					 ilay == Config::nlayers_per_seed);
+
+	      //propagate to layer
+	      if (ilay > Config::nlayers_per_seed)
+	      {
+		dcall(pre_prop_print(ilay, mkfp));
+		mkfp->PropagateTracksToRAndWindow(m_event->geom_.Radius(ilay), end - itrack);
+		dcall(post_prop_print(ilay, mkfp));
+	      }
+	      else
+	      {
+		mkfp->ComputeHitWindows(end - itrack);
+	      }
+
+	      dprint("now get hit range");
+	      mkfp->SelectHitIndices(layer_of_hits, end - itrack);
+
+	      if (mkfps.size() > 1) mkfp->PrefetchHits(layer_of_hits, end - itrack);
+
+	    //#ifdef PRINTOUTS_FOR_PLOTS
+	    //std::cout << "MX number of hits in window in layer " << ilay << " is " <<  mkfp->getXHitEnd(0, 0, 0)-mkfp->getXHitBegin(0, 0, 0) << std::endl;
+	    //#endif
 	    }
 
-	    dprint("now get hit range");
-	    mkfp->SelectHitIndices(layer_of_hits, end - itrack);
-	  
-	  //#ifdef PRINTOUTS_FOR_PLOTS
-	  //std::cout << "MX number of hits in window in layer " << ilay << " is " <<  mkfp->getXHitEnd(0, 0, 0)-mkfp->getXHitBegin(0, 0, 0) << std::endl;
-	  //#endif
-	    
-	    dprint("make new candidates");
-	    mkfp->FindCandidates(layer_of_hits, tmp_candidates, start_seed, end - itrack);
-	  
+	    const int jb = ib - mkfps.size() + 1;
+	    if (jb >= 0)
+	    {
+	      const int itrack = jb * NN;
+	      const int end    = std::min(itrack + NN, theEndCand);
+
+	      dprint("make new candidates");
+	      mkfps[jb]->FindCandidates(layer_of_hits, tmp_candidates, start_seed, end - itrack);
+	    }
 	  } //end of vectorized loop
 
 	  // clean exceeding candidates per seed
@@ -846,6 +947,18 @@ void MkBuilder::FindTracksStandard()
 //------------------------------------------------------------------------------
 
 void MkBuilder::FindTracksCloneEngine()
+{
+  switch (Config::buildVecWidth)
+  {
+#define FIND_TRACKS_CE_CASE(W) case W: FindTracksCloneEngineImpl<W>(); break;
+    MPLEX_FOR_EACH_WIDTH(FIND_TRACKS_CE_CASE)
+#undef FIND_TRACKS_CE_CASE
+    default: FindTracksCloneEngineImpl<NN>();
+  }
+}
+
+template<int NN>
+void MkBuilder::FindTracksCloneEngineImpl()
 {
   g_exe_ctx.populate(Config::numThreadsFinder);
   EventOfCombCandidates &event_of_comb_cands = m_event_tmp->m_event_of_comb_cands;
@@ -862,17 +975,18 @@ void MkBuilder::FindTracksCloneEngine()
         [&](const tbb::blocked_range<int>& seeds)
       {
         std::unique_ptr<CandCloner, decltype(retcand)> cloner(g_exe_ctx.m_cloners.GetFromPool(), retcand);
-        std::unique_ptr<MkFitter,   decltype(retfitr)> mkfp  (g_exe_ctx.m_fitters.GetFromPool(), retfitr);
+        MkFitterSetT<NN> mkfps(Config::numBatchesInterleaved);
 
         // loop over layers
-        find_tracks_in_layers(etabin_of_comb_candidates, *cloner, mkfp.get(), seeds.begin(), seeds.end(), ebin);
+        find_tracks_in_layers(etabin_of_comb_candidates, *cloner, mkfps, seeds.begin(), seeds.end(), ebin);
       });
     }
   });
 }
 
+template<int NN>
 void MkBuilder::find_tracks_in_layers(EtaBinOfCombCandidates &etabin_of_comb_candidates, CandCloner &cloner,
-                                      MkFitter *mkfp, int start_seed, int end_seed, int ebin)
+                                      const MkFitterSetT<NN> &mkfps, int start_seed, int end_seed, int ebin)
 {
   auto n_seeds = end_seed - start_seed;
 
@@ -910,80 +1024,109 @@ void MkBuilder::find_tracks_in_layers(EtaBinOfCombCandidates &etabin_of_comb_can
       cloner.begin_layer(ilay);
     }
 
-    //vectorized loop
-    for (int itrack = 0; itrack < theEndCand; itrack += NN)
+    //vectorized loop, software pipelined over mkfps.size() batches:
+    //batch ib gets updated, propagated and has its hits selected / prefetched
+    //before FindCandidatesMinimizeCopy() is run on batch ib - mkfps.size() + 1
+    const int n_batches = (theEndCand + NN - 1) / NN;
+
+    for (int ib = 0; ib < n_batches + mkfps.size() - 1; ++ib)
     {
-      const int end = std::min(itrack + NN, theEndCand);
+      if (ib < n_batches)
+      {
+        MkFitterT<NN> *mkfp = mkfps[ib];
+        const int  itrack = ib * NN;
+        const int  end    = std::min(itrack + NN, theEndCand);
 
 #ifdef DEBUG
-      dprint("processing track=" << itrack);
-      dprintf("FTCE: start_seed=%d, n_seeds=%d, theEndCand=%d\n"
-              "      itrack=%d, end=%d, nn=%d, end_eq_tec=%d\n",
-              start_seed, n_seeds, theEndCand,
-              itrack, end, end-itrack, end == theEndCand);
-      dprintf("      ");
-      for (int i=itrack; i < end; ++i) dprintf("%d,%d  ", seed_cand_idx[i].first, seed_cand_idx[i].second);
-      dprintf("\n");
+        dprint("processing track=" << itrack);
+        dprintf("FTCE: start_seed=%d, n_seeds=%d, theEndCand=%d\n"
+                "      itrack=%d, end=%d, nn=%d, end_eq_tec=%d\n",
+                start_seed, n_seeds, theEndCand,
+                itrack, end, end-itrack, end == theEndCand);
+        dprintf("      ");
+        for (int i=itrack; i < end; ++i) dprintf("%d,%d  ", seed_cand_idx[i].first, seed_cand_idx[i].second);
+        dprintf("\n");
 #endif
 
-      // mkfp->SetNhits(ilay == Config::nlayers_per_seed ? ilay : ilay + 1);
-      mkfp->SetNhits(ilay);
+        // mkfp->SetNhits(ilay == Config::nlayers_per_seed ? ilay : ilay + 1);
+        mkfp->SetNhits(ilay);
 
-      mkfp->InputTracksAndHitIdx(etabin_of_comb_candidates.m_candidates,
-                                 seed_cand_idx, itrack, end,
-                                 true);
+        mkfp->InputTracksAndHitIdx(etabin_of_comb_candidates.m_candidates,
+                                   seed_cand_idx, itrack, end,
+                                   true);
 
 #ifdef DEBUG
-      for (int i=itrack; i < end; ++i)
-        dprintf("  track %d, idx %d is from seed %d\n", i, i - itrack, mkfp->Label(i - itrack,0,0));
-      dprintf("\n");
+        for (int i=itrack; i < end; ++i)
+          dprintf("  track %d, idx %d is from seed %d\n", i, i - itrack, mkfp->Label(i - itrack,0,0));
+        dprintf("\n");
 #endif
 
-      if (ilay > Config::nlayers_per_seed)
-      {
-        LayerOfHits &layer_of_hits = m_event_of_hits.m_layers_of_hits[ilay - 1];
+        if (ilay > Config::nlayers_per_seed)
+        {
+          LayerOfHits &layer_of_hits = m_event_of_hits.m_layers_of_hits[ilay - 1];
+
+          mkfp->UpdateWithLastHit(layer_of_hits, end - itrack);
+
+          if (ilay < Config::nLayers)
+          {
+            // Propagate to this layer
+
+            mkfp->PropagateTracksToRAndWindow(m_event->geom_.Radius(ilay), end - itrack);
+
+            // copy_out the propagated track params, errors only (hit-idcs and chi2 already updated)
+            mkfp->CopyOutParErr(etabin_of_comb_candidates.m_candidates,
+                                end - itrack, true);
+          }
+          else
+          {
+            // copy_out the updated track params, errors only (hit-idcs and chi2 already updated)
+            mkfp->CopyOutParErr(etabin_of_comb_candidates.m_candidates,
+                                end - itrack, false);
+          }
+        }
 
-        mkfp->UpdateWithLastHit(layer_of_hits, end - itrack);
+        // if (ilay == Config::nLayers)
+        // {
+        //   break;
+        // }
 
         if (ilay < Config::nLayers)
         {
-          // Propagate to this layer
-
-          mkfp->PropagateTracksToR(m_event->geom_.Radius(ilay), end - itrack);
-
-	  // copy_out the propagated track params, errors only (hit-idcs and chi2 already updated)
-	  mkfp->CopyOutParErr(etabin_of_comb_candidates.m_candidates,
-			      end - itrack, true);
-	} 
-	else {
-	  // copy_out the updated track params, errors only (hit-idcs and chi2 already updated)
-	  mkfp->CopyOutParErr(etabin_of_comb_candidates.m_candidates,
-			      end - itrack, false);
-	  continue;
-	}
-      }
+          dprint("now get hit range");
 
-      // if (ilay == Config::nLayers)
-      // {
-      //   break;
-      // }
+          LayerOfHits &layer_of_hits = m_event_of_hits.m_layers_of_hits[ilay];
 
-      dprint("now get hit range");
+          // Propagated states have their window from above, seeds need one.
+          if (ilay == Config::nlayers_per_seed)
+          {
+            mkfp->ComputeHitWindows(end - itrack);
+          }
 
-      LayerOfHits &layer_of_hits = m_event_of_hits.m_layers_of_hits[ilay];
+          mkfp->SelectHitIndices(layer_of_hits, end - itrack);
 
-      mkfp->SelectHitIndices(layer_of_hits, end - itrack);
+          if (mkfps.size() > 1) mkfp->PrefetchHits(layer_of_hits, end - itrack);
 
-      //#ifdef PRINTOUTS_FOR_PLOTS
-      //std::cout << "MX number of hits in window in layer " << ilay << " is " <<  mkfp->getXHitEnd(0, 0, 0)-mkfp->getXHitBegin(0, 0, 0) << std::endl;
-      //#endif
+          //#ifdef PRINTOUTS_FOR_PLOTS
+          //std::cout << "MX number of hits in window in layer " << ilay << " is " <<  mkfp->getXHitEnd(0, 0, 0)-mkfp->getXHitBegin(0, 0, 0) << std::endl;
+          //#endif
+        }
+      }
+
+      const int jb = ib - mkfps.size() + 1;
+      if (jb >= 0 && ilay < Config::nLayers)
+      {
+        const int itrack = jb * NN;
+        const int end    = std::min(itrack + NN, theEndCand);
 
-      dprint("make new candidates");
-      cloner.begin_iteration();
+        LayerOfHits &layer_of_hits = m_event_of_hits.m_layers_of_hits[ilay];
 
-      mkfp->FindCandidatesMinimizeCopy(layer_of_hits, cloner, start_seed, end - itrack);
+        dprint("make new candidates");
+        cloner.begin_iteration();
 
-      cloner.end_iteration();
+        mkfps[jb]->FindCandidatesMinimizeCopy(layer_of_hits, cloner, start_seed, end - itrack);
+
+        cloner.end_iteration();
+      }
     } //end of vectorized loop
 
     if (ilay < Config::nLayers)
@@ -23,10 +23,49 @@ struct ExecutionContext
     m_cloners.populate(n_thr - m_cloners.size());
     m_fitters.populate(n_thr - m_fitters.size());
   }
+
+  // Fitters of plex width W, for stages running with Config::fitVecWidth or
+  // buildVecWidth. For W == NN this is m_fitters, other pools fill on use.
+  template<int W> Pool<MkFitterT<W>>& fitters()
+  {
+    static Pool<MkFitterT<W>> s_fitters;
+    return s_fitters;
+  }
 };
 
+template<> inline Pool<MkFitter>& ExecutionContext::fitters<NN>() { return m_fitters; }
+
 extern ExecutionContext g_exe_ctx;
 
+// MkFitters used by a single task when building with interleaved batches.
+// Batch ib is processed by fitter ib % size(); all are returned to the
+// pool on destruction.
+template<int NN>
+struct MkFitterSetT
+{
+  MkFitterT<NN> *m_fitters[Config::maxBatchesInterleaved];
+  int            m_n;
+
+  explicit MkFitterSetT(int n) :
+    m_n(std::max(1, std::min(n, Config::maxBatchesInterleaved)))
+  {
+    for (int i = 0; i < m_n; ++i) m_fitters[i] = g_exe_ctx.fitters<NN>().GetFromPool();
+  }
+
+  ~MkFitterSetT()
+  {
+    for (int i = 0; i < m_n; ++i) g_exe_ctx.fitters<NN>().ReturnToPool(m_fitters[i]);
+  }
+
+  MkFitterSetT(const MkFitterSetT&) = delete;
+  MkFitterSetT& operator=(const MkFitterSetT&) = delete;
+
+  int            size()           const { return m_n; }
+  MkFitterT<NN>* operator[](int ib) const { return m_fitters[ib % m_n]; }
+};
+
+typedef MkFitterSetT<NN> MkFitterSet;
+
 //==============================================================================
 // The usual
 //==============================================================================
@@ -34,12 +73,14 @@ extern ExecutionContext g_exe_ctx;
 class Event;
 class EventTmp;
 
-class MkFitter;
-
 class MkBuilder
 {
 protected:
-  void fit_one_seed_set(TrackVec& simtracks, int itrack, int end, MkFitter *mkfp);
+  template<int NN> void fit_seeds_impl();
+  template<int NN> void fit_one_seed_set(TrackVec& simtracks, int itrack, int end, MkFitterT<NN> *mkfp);
+  template<int NN> void FindTracksBestHitImpl(EventOfCandidates& event_of_cands);
+  template<int NN> void FindTracksStandardImpl();
+  template<int NN> void FindTracksCloneEngineImpl();
 
   Event         *m_event;
   EventTmp      *m_event_tmp;
@@ -88,7 +129,8 @@ public:
 
   void find_tracks_load_seeds(EventOfCandidates& event_of_cands); // for FindTracksBestHit
   void find_tracks_load_seeds();
-  void find_tracks_in_layers(EtaBinOfCombCandidates &eb_of_cc, CandCloner &cloner, MkFitter *mkfp,
+  template<int NN>
+  void find_tracks_in_layers(EtaBinOfCombCandidates &eb_of_cc, CandCloner &cloner, const MkFitterSetT<NN> &mkfps,
                              int start_seed, int end_seed, int ebin);
 
   // --------
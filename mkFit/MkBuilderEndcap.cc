@@ -192,6 +192,7 @@ void MkBuilderEndcap::FindTracksBestHit(EventOfCandidates& event_of_cands)
 
           mkfp->SetNhits(Config::nlayers_per_seed);//just to be sure (is this needed?)
           mkfp->InputTracksAndHitIdx(etabin_of_candidates.m_candidates, itrack, end, true);
+          mkfp->ComputeHitWindowsEndcap(end - itrack);
 
           //ok now we start looping over layers
           //loop over layers, starting from after the seed
@@ -224,7 +225,7 @@ void MkBuilderEndcap::FindTracksBestHit(EventOfCandidates& event_of_cands)
             if (ilay + 1 < Config::nLayers)
             {
               dcall(pre_prop_print(ilay, mkfp.get()));
-              mkfp->PropagateTracksToZ(m_event->geom_.zPlane(ilay+1), end - itrack);
+              mkfp->PropagateTracksToZAndWindow(m_event->geom_.zPlane(ilay+1), end - itrack);
               dcall(post_prop_print(ilay, mkfp.get()));
             }
 
@@ -316,9 +317,13 @@ void MkBuilderEndcap::FindTracksStandard()
 	    if (ilay > Config::nlayers_per_seed)
   	    {
 	      dcall(pre_prop_print(ilay, mkfp));
-	      mkfp->PropagateTracksToZ(m_event->geom_.zPlane(ilay), end - itrack);
+	      mkfp->PropagateTracksToZAndWindow(m_event->geom_.zPlane(ilay), end - itrack);
 	      dcall(post_prop_print(ilay, mkfp));
 	    }
+	    else
+	    {
+	      mkfp->ComputeHitWindowsEndcap(end - itrack);
+	    }
 
 	    dprint("now get hit range");
 	    mkfp->SelectHitIndicesEndcap(layer_of_hits, end - itrack);
@@ -494,7 +499,7 @@ void MkBuilderEndcap::find_tracks_in_layers_endcap(EtaBinOfCombCandidates &etabi
         {
           // Propagate to this layer
 
-          mkfp->PropagateTracksToZ(m_event->geom_.zPlane(ilay), end - itrack);
+          mkfp->PropagateTracksToZAndWindow(m_event->geom_.zPlane(ilay), end - itrack);
 
 	  // copy_out the propagated track params, errors only (hit-idcs and chi2 already updated)
 	  mkfp->CopyOutParErr(etabin_of_comb_candidates.m_candidates,
@@ -518,6 +523,12 @@ void MkBuilderEndcap::find_tracks_in_layers_endcap(EtaBinOfCombCandidates &etabi
 
       LayerOfHits &layer_of_hits = m_event_of_hits.m_layers_of_hits[ilay];
 
+      // Propagated states have their window from above, seeds need one.
+      if (ilay == Config::nlayers_per_seed)
+      {
+        mkfp->ComputeHitWindowsEndcap(end - itrack);
+      }
+
       mkfp->SelectHitIndicesEndcap(layer_of_hits, end - itrack);
 
       //#ifdef PRINTOUTS_FOR_PLOTS
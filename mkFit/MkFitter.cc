@@ -4,6 +4,7 @@
 #include "PropagationMPlex.h"
 #include "KalmanUtilsMPlex.h"
 #include "ConformalUtilsMPlex.h"
+#include "MathMPlex.h"
 #ifdef USE_CUDA
 //#include "FitterCU.h"
 #endif
@@ -12,8 +13,35 @@
 #include "Debug.h"
 
 #include <sstream>
+#include <cstring>
 
-void MkFitter::CheckAlignment()
+namespace
+{
+  // idx[] holds byte offsets into m_hits, as used for SlurpIn of msErr / msPar.
+  template<int NN>
+  inline void SlurpInHitInv2R(const LayerOfHits &layer_of_hits, const int *idx, MPlexQF_T<NN> &inv2r)
+  {
+    for (int i = 0; i < NN; ++i)
+    {
+      inv2r[i] = layer_of_hits.m_hit_inv2rs[idx[i] / sizeof(Hit)];
+    }
+  }
+
+  // Bitwise, so NaNs in the same place compare equal.
+  template<int NN, class M>
+  inline bool SameSlot(const M &a, const M &b, const int itrack, const int n_el = M::kSize)
+  {
+    for (int i = 0; i < n_el; ++i)
+    {
+      if (std::memcmp(&a.fArray[i * NN + itrack], &b.fArray[i * NN + itrack], sizeof(a.fArray[0])) != 0)
+        return false;
+    }
+    return true;
+  }
+}
+
+template<int NN>
+void MkFitterT<NN>::CheckAlignment()
 {
   printf("MkFitter alignment check:\n");
   Matriplex::align_check("  Err[0]   =", &Err[0].fArray[0]);
@@ -24,7 +52,8 @@ void MkFitter::CheckAlignment()
   Matriplex::align_check("  msPar[0] =", &msPar[0].fArray[0]);
 }
 
-void MkFitter::PrintPt(int idx)
+template<int NN>
+void MkFitterT<NN>::PrintPt(int idx)
 {
   for (int i = 0; i < NN; ++i)
   {
@@ -32,7 +61,8 @@ void MkFitter::PrintPt(int idx)
   }
 }
 
-int MkFitter::countValidHits(int itrack, int end_hit) const
+template<int NN>
+int MkFitterT<NN>::countValidHits(int itrack, int end_hit) const
 {
   int result = 0;
   for (int hi = 0; hi < end_hit; ++hi)
@@ -42,7 +72,8 @@ int MkFitter::countValidHits(int itrack, int end_hit) const
   return result;
 }
 
-int MkFitter::countInvalidHits(int itrack, int end_hit) const
+template<int NN>
+int MkFitterT<NN>::countInvalidHits(int itrack, int end_hit) const
 {
   int result = 0;
   for (int hi = 0; hi < end_hit; ++hi)
@@ -55,7 +86,71 @@ int MkFitter::countInvalidHits(int itrack, int end_hit) const
 
 //==============================================================================
 
-void MkFitter::InputTracksAndHits(const std::vector<Track>&  tracks,
+template<int NN>
+void MkFitterT<NN>::CopyInStates(const Track *const *trks, int n_proc, int iI)
+{
+#ifdef COMPACT_TRACK_ERRORS
+  const CompactSym66 *err[NN];
+  const float        *par[NN];
+  for (int i = 0; i < n_proc; ++i)
+  {
+    err[i] = &trks[i]->errors_compact();
+    par[i] = trks[i]->parameters().Array();
+  }
+  CopyInCompact<NN>(Err[iI], err, n_proc);
+#else
+  const float *err[NN], *par[NN];
+  for (int i = 0; i < n_proc; ++i)
+  {
+    err[i] = trks[i]->errors().Array();
+    par[i] = trks[i]->parameters().Array();
+  }
+  Err[iI].CopyInBlock(err, n_proc);
+#endif
+  Par[iI].CopyInBlock(par, n_proc);
+}
+
+template<int NN>
+void MkFitterT<NN>::CopyOutStates(Track *const *trks, int n_proc, int iO) const
+{
+#ifdef COMPACT_TRACK_ERRORS
+  CompactSym66 *err[NN];
+  float        *par[NN];
+  for (int i = 0; i < n_proc; ++i)
+  {
+    err[i] = &trks[i]->errors_compact_nc();
+    par[i] = trks[i]->parameters_nc().Array();
+  }
+  CopyOutCompact<NN>(Err[iO], err, n_proc);
+#else
+  float *err[NN], *par[NN];
+  for (int i = 0; i < n_proc; ++i)
+  {
+    err[i] = trks[i]->errors_nc().Array();
+    par[i] = trks[i]->parameters_nc().Array();
+  }
+  Err[iO].CopyOutBlock(err, n_proc);
+#endif
+  Par[iO].CopyOutBlock(par, n_proc);
+}
+
+template<int NN>
+void MkFitterT<NN>::CopyOutState(int itrack, int iO, Track &trk) const
+{
+#ifdef COMPACT_TRACK_ERRORS
+  float err[LL * (LL + 1) / 2];
+  Err[iO].CopyOut(itrack, err);
+  trk.errors_compact_nc().Pack(err);
+#else
+  Err[iO].CopyOut(itrack, trk.errors_nc().Array());
+#endif
+  Par[iO].CopyOut(itrack, trk.parameters_nc().Array());
+}
+
+//==============================================================================
+
+template<int NN>
+void MkFitterT<NN>::InputTracksAndHits(const std::vector<Track>&  tracks,
                                   const std::vector<HitVec>& layerHits,
                                   int beg, int end)
 {
@@ -64,6 +159,7 @@ void MkFitter::InputTracksAndHits(const std::vector<Track>&  tracks,
   // This might not be true for the last chunk!
   // assert(end - beg == NN);
 
+  const Track *trk_ptrs[NN];
   int itrack;
 
 // FIXME: uncomment when track building is ported to GPU.
@@ -79,12 +175,10 @@ void MkFitter::InputTracksAndHits(const std::vector<Track>&  tracks,
   for (int i = beg; i < end; ++i) {
     itrack = i - beg;
     const Track &trk = tracks[i];
+    trk_ptrs[itrack] = &trk;
 
     Label(itrack, 0, 0) = trk.label();
 
-    Err[iC].CopyIn(itrack, trk.errors().Array());
-    Par[iC].CopyIn(itrack, trk.parameters().Array());
-
     Chg(itrack, 0, 0) = trk.charge();
     Chi2(itrack, 0, 0) = trk.chi2();
 
@@ -107,9 +201,12 @@ void MkFitter::InputTracksAndHits(const std::vector<Track>&  tracks,
     }
 #endif
   }
+
+  CopyInStates(&trk_ptrs[0], end - beg, iC);
 }
 
-void MkFitter::InputTracksAndHits(const std::vector<Track>&  tracks,
+template<int NN>
+void MkFitterT<NN>::InputTracksAndHits(const std::vector<Track>&  tracks,
                                   const std::vector<LayerOfHits>& layerHits,
                                   int beg, int end)
 {
@@ -118,6 +215,7 @@ void MkFitter::InputTracksAndHits(const std::vector<Track>&  tracks,
   // This might not be true for the last chunk!
   // assert(end - beg == NN);
 
+  const Track *trk_ptrs[NN];
   int itrack;
 //#ifdef USE_CUDA
 #if 0
@@ -131,12 +229,10 @@ void MkFitter::InputTracksAndHits(const std::vector<Track>&  tracks,
   for (int i = beg; i < end; ++i) {
     itrack = i - beg;
     const Track &trk = tracks[i];
+    trk_ptrs[itrack] = &trk;
 
     Label(itrack, 0, 0) = trk.label();
 
-    Err[iC].CopyIn(itrack, trk.errors().Array());
-    Par[iC].CopyIn(itrack, trk.parameters().Array());
-
     Chg(itrack, 0, 0) = trk.charge();
     Chi2(itrack, 0, 0) = trk.chi2();
 
@@ -156,21 +252,26 @@ void MkFitter::InputTracksAndHits(const std::vector<Track>&  tracks,
     }
 #endif
   }
+
+  CopyInStates(&trk_ptrs[0], end - beg, iC);
 }
 
-void MkFitter::SlurpInTracksAndHits(const std::vector<Track>&  tracks,
+template<int NN>
+void MkFitterT<NN>::SlurpInTracksAndHits(const std::vector<Track>&  tracks,
                                     const std::vector<HitVec>& layerHits,
                                     int beg, int end)
 {
   // Assign track parameters to initial state and copy hit values in.
-
-  // This might not be true for the last chunk!
-  // assert(end - beg == NN);
+  // Unused slots of a partial last chunk gather the first track again.
 
   const Track &trk = tracks[beg];
   const char *varr       = (char*) &trk;
-  const int   off_error  = (char*) trk.errors().Array() - varr;
   const int   off_param  = (char*) trk.parameters().Array() - varr;
+#ifdef COMPACT_TRACK_ERRORS
+  const CompactSym66 *err[NN];
+#else
+  const int   off_error  = (char*) trk.errors().Array() - varr;
+#endif
 
   int idx[NN]      __attribute__((aligned(64)));
   int itrack;
@@ -191,19 +292,21 @@ void MkFitter::SlurpInTracksAndHits(const std::vector<Track>&  tracks,
     Label(itrack, 0, 0) = trk.label();
 
     idx[itrack] = (char*) &trk - varr;
+#ifdef COMPACT_TRACK_ERRORS
+    err[itrack] = &trk.errors_compact();
+#endif
 
     Chg(itrack, 0, 0) = trk.charge();
     Chi2(itrack, 0, 0) = trk.chi2();
   }
+  for (itrack = end - beg; itrack < NN; ++itrack) idx[itrack] = 0;
 
-#ifdef MIC_INTRINSICS
-  __m512i vi      = _mm512_load_epi32(idx);
-  Err[iC].SlurpIn(varr + off_error, vi);
-  Par[iC].SlurpIn(varr + off_param, vi);
+#ifdef COMPACT_TRACK_ERRORS
+  CopyInCompact<NN>(Err[iC], err, end - beg);
 #else
   Err[iC].SlurpIn(varr + off_error, idx);
-  Par[iC].SlurpIn(varr + off_param, idx);
 #endif
+  Par[iC].SlurpIn(varr + off_param, idx);
   
 // CopyIn seems fast enough, but indirections are quite slow.
 // For GPU computations, it has been moved in between kernels
@@ -226,20 +329,16 @@ void MkFitter::SlurpInTracksAndHits(const std::vector<Track>&  tracks,
       idx[itrack] = (char*) &hit - varr;
       HitsIdx[hi](itrack, 0, 0) = hidx;
     }
+    for (itrack = end - beg; itrack < NN; ++itrack) idx[itrack] = 0;
 
-#ifdef MIC_INTRINSICS
-    __m512i vi      = _mm512_load_epi32(idx);
-    msErr[hi].SlurpIn(varr + off_error, vi);
-    msPar[hi].SlurpIn(varr + off_param, vi);
-#else
     msErr[hi].SlurpIn(varr + off_error, idx);
     msPar[hi].SlurpIn(varr + off_param, idx);
-#endif
   }
 #endif
 }
 
-void MkFitter::InputTracksAndHitIdx(const std::vector<Track>& tracks,
+template<int NN>
+void MkFitterT<NN>::InputTracksAndHitIdx(const std::vector<Track>& tracks,
                                     int beg, int end,
                                     bool inputProp)
 {
@@ -250,17 +349,17 @@ void MkFitter::InputTracksAndHitIdx(const std::vector<Track>& tracks,
 
   const int iI = inputProp ? iP : iC;
 
+  const Track *trk_ptrs[NN];
+
   int itrack = 0;
   for (int i = beg; i < end; ++i, ++itrack)
   {
 
     const Track &trk = tracks[i];
+    trk_ptrs[itrack] = &trk;
 
     Label(itrack, 0, 0) = trk.label();
 
-    Err[iI].CopyIn(itrack, trk.errors().Array());
-    Par[iI].CopyIn(itrack, trk.parameters().Array());
-
     Chg (itrack, 0, 0) = trk.charge();
     Chi2(itrack, 0, 0) = trk.chi2();
 
@@ -273,9 +372,12 @@ void MkFitter::InputTracksAndHitIdx(const std::vector<Track>& tracks,
 
     }
   }
+
+  CopyInStates(&trk_ptrs[0], end - beg, iI);
 }
 
-void MkFitter::InputTracksAndHitIdx(const std::vector<std::vector<Track> >& tracks,
+template<int NN>
+void MkFitterT<NN>::InputTracksAndHitIdx(const std::vector<std::vector<Track> >& tracks,
                                     const std::vector<std::pair<int,int> >& idxs,
                                     int beg, int end, bool inputProp)
 {
@@ -286,18 +388,18 @@ void MkFitter::InputTracksAndHitIdx(const std::vector<std::vector<Track> >& trac
 
   const int iI = inputProp ? iP : iC;
 
+  const Track *trk_ptrs[NN];
+
   int itrack = 0;
   for (int i = beg; i < end; ++i, ++itrack)
   {
     const Track &trk = tracks[idxs[i].first][idxs[i].second];
+    trk_ptrs[itrack] = &trk;
 
     Label(itrack, 0, 0) = trk.label();
     SeedIdx(itrack, 0, 0) = idxs[i].first;
     CandIdx(itrack, 0, 0) = idxs[i].second;
 
-    Err[iI].CopyIn(itrack, trk.errors().Array());
-    Par[iI].CopyIn(itrack, trk.parameters().Array());
-
     Chg (itrack, 0, 0) = trk.charge();
     Chi2(itrack, 0, 0) = trk.chi2();
 
@@ -308,9 +410,12 @@ void MkFitter::InputTracksAndHitIdx(const std::vector<std::vector<Track> >& trac
 
     }
   }
+
+  CopyInStates(&trk_ptrs[0], end - beg, iI);
 }
 
-void MkFitter::InputSeedsTracksAndHits(const std::vector<Track>&  seeds,
+template<int NN>
+void MkFitterT<NN>::InputSeedsTracksAndHits(const std::vector<Track>&  seeds,
 				       const std::vector<Track>&  tracks,
 				       const std::vector<HitVec>& layerHits,
 				       int beg, int end)
@@ -365,7 +470,8 @@ void MkFitter::InputSeedsTracksAndHits(const std::vector<Track>&  seeds,
   }
 }
 
-void MkFitter::ConformalFitTracks(bool fitting, int beg, int end)
+template<int NN>
+void MkFitterT<NN>::ConformalFitTracks(bool fitting, int beg, int end)
 {
   // bool fitting to determine to use fitting CF error widths
   // in reality, this is depedent on hits used to make pulls 
@@ -426,7 +532,8 @@ void MkFitter::ConformalFitTracks(bool fitting, int beg, int end)
   }
 }
 
-void MkFitter::FitTracks(const int N_proc, const Event * ev, const bool useParamBfield)
+template<int NN>
+void MkFitterT<NN>::FitTracks(const int N_proc, const Event * ev, const bool useParamBfield)
 {
   // Fitting loop.
 
@@ -442,12 +549,13 @@ void MkFitter::FitTracks(const int N_proc, const Event * ev, const bool useParam
     updateParametersMPlex(Err[iP], Par[iP], Chg, msErr[hi], msPar[hi],
                           Err[iC], Par[iC], N_proc);
 
-    if (Config::fit_val) MkFitter::CollectFitValidation(hi,N_proc,ev);
+    if (Config::fit_val) CollectFitValidation(hi,N_proc,ev);
   }
   // XXXXX What's with chi2?
 }
 
-void MkFitter::CollectFitValidation(const int hi, const int N_proc, const Event * ev) const
+template<int NN>
+void MkFitterT<NN>::CollectFitValidation(const int hi, const int N_proc, const Event * ev) const
 {
   for (int n = 0; n < N_proc; ++n)
   {
@@ -470,7 +578,8 @@ void MkFitter::CollectFitValidation(const int hi, const int N_proc, const Event
   }
 }
 
-void MkFitter::FitTracksTestEndcap(const int N_proc, const Event* ev, const bool useParamBfield)
+template<int NN>
+void MkFitterT<NN>::FitTracksTestEndcap(const int N_proc, const Event* ev, const bool useParamBfield)
 {
 
   if (countValidHits(0)<8) return;
@@ -524,26 +633,31 @@ void MkFitter::FitTracksTestEndcap(const int N_proc, const Event* ev, const bool
   // 	    << " fitted hits: " << hitcount<< std::endl;
 }
 
-void MkFitter::OutputTracks(std::vector<Track>& tracks, int beg, int end, int iCP) const
+template<int NN>
+void MkFitterT<NN>::OutputTracks(std::vector<Track>& tracks, int beg, int end, int iCP) const
 {
   // Copies last track parameters (updated) into Track objects.
   // The tracks vector should be resized to allow direct copying.
 
+  Track *trk_ptrs[NN];
+
   int itrack = 0;
   for (int i = beg; i < end; ++i, ++itrack)
   {
-    Err[iCP].CopyOut(itrack, tracks[i].errors_nc().Array());
-    Par[iCP].CopyOut(itrack, tracks[i].parameters_nc().Array());
-    
+    trk_ptrs[itrack] = &tracks[i];
+
     tracks[i].setCharge(Chg(itrack, 0, 0));
     
     // XXXXX chi2 is not set (also not in SMatrix fit, it seems)
     tracks[i].setChi2(Chi2(itrack, 0, 0));
     tracks[i].setLabel(Label(itrack, 0, 0));
   }
+
+  CopyOutStates(&trk_ptrs[0], end - beg, iCP);
 }
 
-void MkFitter::OutputFittedTracksAndHitIdx(std::vector<Track>& tracks, int beg, int end,
+template<int NN>
+void MkFitterT<NN>::OutputFittedTracksAndHitIdx(std::vector<Track>& tracks, int beg, int end,
                                            bool outputProp) const
 {
   // Copies last track parameters (updated) into Track objects and up to Nhits.
@@ -551,11 +665,12 @@ void MkFitter::OutputFittedTracksAndHitIdx(std::vector<Track>& tracks, int beg,
 
   const int iO = outputProp ? iP : iC;
 
+  Track *trk_ptrs[NN];
+
   int itrack = 0;
   for (int i = beg; i < end; ++i, ++itrack)
   {
-    Err[iO].CopyOut(itrack, tracks[i].errors_nc().Array());
-    Par[iO].CopyOut(itrack, tracks[i].parameters_nc().Array());
+    trk_ptrs[itrack] = &tracks[i];
 
     tracks[i].setCharge(Chg(itrack, 0, 0));
     tracks[i].setChi2(Chi2(itrack, 0, 0));
@@ -569,144 +684,216 @@ void MkFitter::OutputFittedTracksAndHitIdx(std::vector<Track>& tracks, int beg,
       tracks[i].addHitIdx(HitsIdx[hi](itrack, 0, 0),0.);
     }
   }
+
+  CopyOutStates(&trk_ptrs[0], end - beg, iO);
 }
 
-void MkFitter::PropagateTracksToR(float R, const int N_proc)
+template<int NN>
+void MkFitterT<NN>::PropagateTracksToR(float R, const int N_proc)
 {
     propagateHelixToRMPlex(Err[iC], Par[iC], Chg, R,
                            Err[iP], Par[iP], N_proc);
 }
 
-void MkFitter::SelectHitIndices(const LayerOfHits &layer_of_hits, const int N_proc, bool dump)
+template<int NN>
+void MkFitterT<NN>::PropagateTracksToRAndWindow(float R, const int N_proc)
+{
+    propagateHelixToRMPlex(Err[iC], Par[iC], Chg, R,
+                           Err[iP], Par[iP], XWin, N_proc);
+}
+
+template<int NN>
+void MkFitterT<NN>::ComputeHitWindows(const int N_proc)
 {
-  const int   iI = iP;
-  const float nSigmaPhi = 3;
-  const float nSigmaZ   = 3;
+  computeHitWindowMPlex(Err[iP], Par[iP], XWin, N_proc);
+}
 
+template<int NN>
+void MkFitterT<NN>::SelectHitIndices(const LayerOfHits &layer_of_hits, const int N_proc, bool dump)
+{
   // Vectorizing this makes it run slower!
   //#pragma ivdep
   //#pragma simd
   for (int itrack = 0; itrack < N_proc; ++itrack)
   {
-    XHitSize[itrack] = 0;
+    SelectHitIndicesTrack(layer_of_hits, itrack, dump);
+  }
+}
 
-    float z, phi, dz, dphi;
-    {
-      const float x = Par[iI].ConstAt(itrack, 0, 0);
-      const float y = Par[iI].ConstAt(itrack, 1, 0);
+template<int NN>
+void MkFitterT<NN>::SelectHitIndicesTrack(const LayerOfHits &layer_of_hits, const int itrack, bool dump)
+{
+  XHitSize[itrack] = 0;
 
-      const float r2 = x*x + y*y;
+  const float z    = XWin.z   .ConstAt(itrack, 0, 0);
+  const float phi  = XWin.phi .ConstAt(itrack, 0, 0);
+  const float dz   = XWin.dz  .ConstAt(itrack, 0, 0);
+  const float dphi = XWin.dphi.ConstAt(itrack, 0, 0);
 
-      z   = Par[iI].ConstAt(itrack, 2, 0);
-      phi = getPhi(x, y);
-      dz  = nSigmaZ * std::sqrt(Err[iI].ConstAt(itrack, 2, 2));
+  const LayerOfHits &L = layer_of_hits;
 
-      const float dphidx = -y/r2, dphidy = x/r2;
-      const float dphi2  = dphidx * dphidx * Err[iI].ConstAt(itrack, 0, 0) +
-                           dphidy * dphidy * Err[iI].ConstAt(itrack, 1, 1) +
-                       2 * dphidx * dphidy * Err[iI].ConstAt(itrack, 0, 1);
+  const int zb1 = L.GetZBinChecked(z - dz);
+  const int zb2 = L.GetZBinChecked(z + dz) + 1;
+  const int pb1 = L.GetPhiBin(phi - dphi);
+  const int pb2 = L.GetPhiBin(phi + dphi) + 1;
+  // MT: The extra phi bins give us ~1.5% more good tracks at expense of 10% runtime.
+  // const int pb1 = L.GetPhiBin(phi - dphi) - 1;
+  // const int pb2 = L.GetPhiBin(phi + dphi) + 2;
 
-#ifdef HARD_CHECK
-      assert(dphi2 >= 0);
-#endif
+  if (dump)
+    printf("LayerOfHits::SelectHitIndices %6.3f %6.3f %6.6f %7.5f %3d %3d %4d %4d\n",
+           z, phi, dz, dphi, zb1, zb2, pb1, pb2);
+
+  // MT: One could iterate in "spiral" order, to pick hits close to the center.
+  // http://stackoverflow.com/questions/398299/looping-in-a-spiral
+  // This would then work best with relatively small bin sizes.
+  // Or, set them up so I can always take 3x3 array around the intersection.
 
-      dphi = nSigmaPhi * std::sqrt(std::abs(dphi2));
+  for (int zi = zb1; zi < zb2; ++zi)
+  {
+    for (int pi = pb1; pi < pb2; ++pi)
+    {
+      const int pb = pi & L.m_phi_mask;
 
-      if (std::abs(dphi)<Config::minDPhi) dphi = Config::minDPhi;
-      if (std::abs(dz)<Config::minDZ) dz = Config::minDZ;
+      // MT: The following line is the biggest hog (4% total run time).
+      // This comes from cache misses, I presume.
+      // It might make sense to make first loop to extract bin indices
+      // and issue prefetches at the same time.
+      // Then enter vectorized loop to actually collect the hits in proper order.
 
-      if (Config::useCMSGeom)
+      for (int hi = L.m_phi_bin_infos[zi][pb].first; hi < L.m_phi_bin_infos[zi][pb].second; ++hi)
       {
-        //now correct for bending and for layer thickness unsing linear approximation
-        const float deltaR = Config::cmsDeltaRad; //fixme! using constant value, to be taken from layer properties
-        const float r  = std::sqrt(r2);
-#ifdef CCSCOORD
-        //here alpha is the difference between posPhi and momPhi
-        const float alpha = phi - Par[iP].ConstAt(itrack, 4, 0);
-        float cosA, sinA;
-        if (Config::useTrigApprox) {
-          sincos4(alpha, sinA, cosA);
-        } else {
-          cosA = std::cos(alpha);
-          sinA = std::sin(alpha);
-        }
-#else
-        const float px = Par[iP].ConstAt(itrack, 3, 0);
-        const float py = Par[iP].ConstAt(itrack, 4, 0);
-        const float pt = std::sqrt(px*px + py*py);
-        //here alpha is the difference between posPhi and momPhi
-        const float cosA = ( x*px + y*py ) / (pt*r);
-        const float sinA = ( y*px - x*py ) / (pt*r);
+        // MT: Access into m_hit_zs and m_hit_phis is 1% run-time each.
+
+#ifdef LOH_USE_PHI_Z_ARRAYS
+        float ddz   = std::abs(z   - L.m_hit_zs[hi]);
+        float ddphi = std::abs(phi - L.m_hit_phis[hi]);
+        if (ddphi > Config::PI) ddphi = Config::TwoPI - ddphi;
+
+        if (dump)
+          printf("     SHI %3d %4d %4d %5d  %6.3f %6.3f %6.4f %7.5f   %s\n",
+                 zi, pi, pb, hi,
+                 L.m_hit_zs[hi], L.m_hit_phis[hi], ddz, ddphi,
+                 (ddz < dz && ddphi < dphi) ? "PASS" : "FAIL");
+
+        // MT: Commenting this check out gives full efficiency ...
+        //     and means our error estimations are wrong!
+        // Avi says we should have *minimal* search windows per layer.
+        // Also ... if bins are sufficiently small, we do not need the extra
+        // checks, see above.
+        // if (ddz < dz && ddphi < dphi && XHitSize[itrack] < MPlexHitIdxMax)
 #endif
-        //take abs so that we always inflate the window
-        const float dist = std::abs(deltaR*sinA/cosA);
-        dphi += dist / r;
+        // MT: The following check also makes more sense with spiral traversal,
+        // we'd be taking in closest hits first.
+        if (XHitSize[itrack] < MPlexHitIdxMax)
+        {
+          XHitArr.At(itrack, XHitSize[itrack]++, 0) = hi;
+        }
       }
     }
+  }
+}
+
+//==============================================================================
+// PrefetchHits()
+//==============================================================================
+
+template<int NN>
+void MkFitterT<NN>::PrefetchHits(const LayerOfHits &layer_of_hits, const int N_proc) const
+{
+  // Called right after SelectHitIndices() when another batch will be processed
+  // before this one gets to AddBestHit() / FindCandidates*(). The first hit of
+  // each window goes to L1, the rest to L2 -- there is plenty of time for them
+  // to arrive while the other batch is being crunched.
+
+  const char *varr = (const char*) layer_of_hits.m_hits;
+
+  for (int itrack = 0; itrack < N_proc; ++itrack)
+  {
+    const int n_hits = XHitSize.ConstAt(itrack, 0, 0);
+
+    if (n_hits > 0)
+    {
+      _mm_prefetch(varr + XHitArr.ConstAt(itrack, 0, 0) * sizeof(Hit), _MM_HINT_T0);
+    }
+    for (int hit_cnt = 1; hit_cnt < n_hits; ++hit_cnt)
+    {
+      _mm_prefetch(varr + XHitArr.ConstAt(itrack, hit_cnt, 0) * sizeof(Hit), _MM_HINT_T1);
+    }
+  }
+}
 
-    const LayerOfHits &L = layer_of_hits;
+//==============================================================================
+// Hit-major chi2
+//==============================================================================
+
+template<int NN>
+bool MkFitterT<NN>::UseHitMajorChi2(const int N_proc) const
+{
+  // Track-major needs as many passes as the largest window, hit-major
+  // needs ceil(size / NN) passes per candidate.
 
-    if (std::abs(dz)   > Config::m_max_dz)   dz   = Config::m_max_dz;
-    if (std::abs(dphi) > Config::m_max_dphi) dphi = Config::m_max_dphi;
+  if ( ! Config::useHitMajorChi2) return false;
 
-    const int zb1 = L.GetZBinChecked(z - dz);
-    const int zb2 = L.GetZBinChecked(z + dz) + 1;
-    const int pb1 = L.GetPhiBin(phi - dphi);
-    const int pb2 = L.GetPhiBin(phi + dphi) + 1;
-    // MT: The extra phi bins give us ~1.5% more good tracks at expense of 10% runtime.
-    // const int pb1 = L.GetPhiBin(phi - dphi) - 1;
-    // const int pb2 = L.GetPhiBin(phi + dphi) + 2;
+  int maxSize = 0, hm_passes = 0;
+  for (int itrack = 0; itrack < N_proc; ++itrack)
+  {
+    const int n_hits = XHitSize.ConstAt(itrack, 0, 0);
+
+    maxSize    = std::max(maxSize, n_hits);
+    hm_passes += (n_hits + NN - 1) / NN;
+  }
+
+  return hm_passes < maxSize;
+}
+
+template<int NN>
+void MkFitterT<NN>::ComputeChi2HitMajor(const LayerOfHits &layer_of_hits, const int N_proc)
+{
+  const char *varr      = (char*) layer_of_hits.m_hits;
+
+  const int   off_error = (char*) layer_of_hits.m_hits[0].errArray() - varr;
+  const int   off_param = (char*) layer_of_hits.m_hits[0].posArray() - varr;
+
+  int idx[NN]      __attribute__((aligned(64)));
+
+  MPlexLS candErr;
+  MPlexLV candPar;
+  MPlexQI candChg;
+  MPlexHS hitErr;
+  MPlexHV hitPar;
+  MPlexQF hitInv2R;
+  MPlexQF outChi2;
+
+  for (int itrack = 0; itrack < N_proc; ++itrack)
+  {
+    const int n_hits = XHitSize[itrack];
 
-    if (dump)
-      printf("LayerOfHits::SelectHitIndices %6.3f %6.3f %6.6f %7.5f %3d %3d %4d %4d\n",
-             z, phi, dz, dphi, zb1, zb2, pb1, pb2);
+    if (n_hits == 0) continue;
 
-    // MT: One could iterate in "spiral" order, to pick hits close to the center.
-    // http://stackoverflow.com/questions/398299/looping-in-a-spiral
-    // This would then work best with relatively small bin sizes.
-    // Or, set them up so I can always take 3x3 array around the intersection.
+    candErr.Broadcast(Err[iP], itrack);
+    candPar.Broadcast(Par[iP], itrack);
+    candChg.Broadcast(Chg,     itrack);
 
-    for (int zi = zb1; zi < zb2; ++zi)
+    for (int hit_beg = 0; hit_beg < n_hits; hit_beg += NN)
     {
-      for (int pi = pb1; pi < pb2; ++pi)
+      const int n_proc = std::min(NN, n_hits - hit_beg);
+
+      // Unused slots get the last hit again, keeping the gather in bounds.
+      for (int ih = 0; ih < NN; ++ih)
       {
-        const int pb = pi & L.m_phi_mask;
+        idx[ih] = XHitArr.At(itrack, hit_beg + std::min(ih, n_proc - 1), 0) * sizeof(Hit);
+      }
+      hitErr.SlurpIn(varr + off_error, idx);
+      hitPar.SlurpIn(varr + off_param, idx);
 
-        // MT: The following line is the biggest hog (4% total run time).
-        // This comes from cache misses, I presume.
-        // It might make sense to make first loop to extract bin indices
-        // and issue prefetches at the same time.
-        // Then enter vectorized loop to actually collect the hits in proper order.
+      SlurpInHitInv2R(layer_of_hits, idx, hitInv2R);
 
-        for (int hi = L.m_phi_bin_infos[zi][pb].first; hi < L.m_phi_bin_infos[zi][pb].second; ++hi)
-        {
-          // MT: Access into m_hit_zs and m_hit_phis is 1% run-time each.
+      computeChi2MPlex(candErr, candPar, candChg, hitErr, hitPar, hitInv2R, outChi2, n_proc, UpdCtx);
 
-#ifdef LOH_USE_PHI_Z_ARRAYS
-          float ddz   = std::abs(z   - L.m_hit_zs[hi]);
-          float ddphi = std::abs(phi - L.m_hit_phis[hi]);
-          if (ddphi > Config::PI) ddphi = Config::TwoPI - ddphi;
-
-          if (dump)
-            printf("     SHI %3d %4d %4d %5d  %6.3f %6.3f %6.4f %7.5f   %s\n",
-                   zi, pi, pb, hi,
-                   L.m_hit_zs[hi], L.m_hit_phis[hi], ddz, ddphi,
-                   (ddz < dz && ddphi < dphi) ? "PASS" : "FAIL");
-
-          // MT: Commenting this check out gives full efficiency ...
-          //     and means our error estimations are wrong!
-          // Avi says we should have *minimal* search windows per layer.
-          // Also ... if bins are sufficiently small, we do not need the extra
-          // checks, see above.
-          // if (ddz < dz && ddphi < dphi && XHitSize[itrack] < MPlexHitIdxMax)
-#endif
-          // MT: The following check also makes more sense with spiral traversal,
-          // we'd be taking in closest hits first.
-          if (XHitSize[itrack] < MPlexHitIdxMax)
-          {
-            XHitArr.At(itrack, XHitSize[itrack]++, 0) = hi;
-          }
-        }
+      for (int ih = 0; ih < n_proc; ++ih)
+      {
+        XHitChi2.At(itrack, hit_beg + ih, 0) = outChi2[ih];
       }
     }
   }
@@ -719,7 +906,8 @@ void MkFitter::SelectHitIndices(const LayerOfHits &layer_of_hits, const int N_pr
 //#define NO_PREFETCH
 //#define NO_GATHER
 
-void MkFitter::AddBestHit(const LayerOfHits &layer_of_hits, const int N_proc)
+template<int NN>
+void MkFitterT<NN>::AddBestHit(const LayerOfHits &layer_of_hits, const int N_proc)
 {
   float minChi2[NN];
   int   bestHit[NN];
@@ -761,74 +949,84 @@ void MkFitter::AddBestHit(const LayerOfHits &layer_of_hits, const int N_proc)
     minChi2[it] = Config::chi2Cut;
   }
 
+  const bool hit_major = UseHitMajorChi2(N_proc);
+  if (hit_major) ComputeChi2HitMajor(layer_of_hits, N_proc);
+
 // Has basically no effect, it seems.
 //#pragma noprefetch
   for (int hit_cnt = 0; hit_cnt < maxSize; ++hit_cnt)
   {
-    //fixme what if size is zero???
+    MPlexQF outChi2;
+    MPlexQF msInv2R;
 
-#pragma simd
-    for (int itrack = 0; itrack < N_proc; ++itrack)
+    if (hit_major)
     {
-      if (hit_cnt < XHitSize[itrack])
+#pragma simd
+      for (int itrack = 0; itrack < N_proc; ++itrack)
       {
-        idx[itrack] = XHitArr.At(itrack, hit_cnt, 0) * sizeof(Hit);
+        outChi2[itrack] = XHitChi2.At(itrack, hit_cnt, 0);
       }
     }
-#if defined(MIC_INTRINSICS)
-    __m512i vi = _mm512_load_epi32(idx);
-#endif
+    else
+    {
+      //fixme what if size is zero???
+
+#pragma simd
+      for (int itrack = 0; itrack < N_proc; ++itrack)
+      {
+        if (hit_cnt < XHitSize[itrack])
+        {
+          idx[itrack] = XHitArr.At(itrack, hit_cnt, 0) * sizeof(Hit);
+        }
+      }
 
 #ifndef NO_PREFETCH
-    // Prefetch to L2 the hits we'll process after two loops iterations.
-    // Ideally this would be initiated before coming here, for whole bunch_of_hits.m_hits vector.
-    for (int itrack = 0; itrack < N_proc; ++itrack)
-    {
-      if (hit_cnt + 2 < XHitSize[itrack])
+      // Prefetch to L2 the hits we'll process after two loops iterations.
+      // Ideally this would be initiated before coming here, for whole bunch_of_hits.m_hits vector.
+      for (int itrack = 0; itrack < N_proc; ++itrack)
       {
-        _mm_prefetch(varr + XHitArr.At(itrack, hit_cnt+2, 0)*sizeof(Hit), _MM_HINT_T1);
+        if (hit_cnt + 2 < XHitSize[itrack])
+        {
+          _mm_prefetch(varr + XHitArr.At(itrack, hit_cnt+2, 0)*sizeof(Hit), _MM_HINT_T1);
+        }
       }
-    }
 #endif
 
 #ifdef NO_GATHER
 
 #pragma simd
-    for (int itrack = 0; itrack < N_proc; ++itrack)
-    {
-      if (hit_cnt < XHitSize[itrack])
+      for (int itrack = 0; itrack < N_proc; ++itrack)
       {
-        const Hit &hit = layer_of_hits.m_hits[XHitArr.At(itrack, hit_cnt, 0)];
-        msErr[Nhits].CopyIn(itrack, hit.errArray());
-        msPar[Nhits].CopyIn(itrack, hit.posArray());
+        if (hit_cnt < XHitSize[itrack])
+        {
+          const Hit &hit = layer_of_hits.m_hits[XHitArr.At(itrack, hit_cnt, 0)];
+          msErr[Nhits].CopyIn(itrack, hit.errArray());
+          msPar[Nhits].CopyIn(itrack, hit.posArray());
+        }
       }
-    }
     
 #else //NO_GATHER
 
-#if defined(MIC_INTRINSICS)
-    msErr[Nhits].SlurpIn(varr + off_error, vi);
-    msPar[Nhits].SlurpIn(varr + off_param, vi);
-#else
-    msErr[Nhits].SlurpIn(varr + off_error, idx);
-    msPar[Nhits].SlurpIn(varr + off_param, idx);
-#endif
+      msErr[Nhits].SlurpIn(varr + off_error, idx);
+      msPar[Nhits].SlurpIn(varr + off_param, idx);
 #endif //NO_GATHER
 
-    //now compute the chi2 of track state vs hit
-    MPlexQF outChi2;
-    computeChi2MPlex(Err[iP], Par[iP], Chg, msErr[Nhits], msPar[Nhits], outChi2, N_proc);
+      //now compute the chi2 of track state vs hit
+      SlurpInHitInv2R(layer_of_hits, idx, msInv2R);
+
+      computeChi2MPlex(Err[iP], Par[iP], Chg, msErr[Nhits], msPar[Nhits], msInv2R, outChi2, N_proc, UpdCtx);
 
 #ifndef NO_PREFETCH
-    // Prefetch to L1 the hits we'll process in the next loop iteration.
-    for (int itrack = 0; itrack < N_proc; ++itrack)
-    {
-      if (hit_cnt + 1 < XHitSize[itrack])
+      // Prefetch to L1 the hits we'll process in the next loop iteration.
+      for (int itrack = 0; itrack < N_proc; ++itrack)
       {
-        _mm_prefetch(varr + XHitArr.At(itrack, hit_cnt+1, 0)*sizeof(Hit), _MM_HINT_T0);
+        if (hit_cnt + 1 < XHitSize[itrack])
+        {
+          _mm_prefetch(varr + XHitArr.At(itrack, hit_cnt+1, 0)*sizeof(Hit), _MM_HINT_T0);
+        }
       }
-    }
 #endif
+    }
 
     //update best hit in case chi2<minChi2
 #pragma simd
@@ -897,7 +1095,8 @@ void MkFitter::AddBestHit(const LayerOfHits &layer_of_hits, const int N_proc)
 }
 
 
-void MkFitter::FindCandidates(const LayerOfHits &layer_of_hits,
+template<int NN>
+void MkFitterT<NN>::FindCandidates(const LayerOfHits &layer_of_hits,
                               std::vector<std::vector<Track> >& tmp_candidates,
                               const int offset, const int N_proc)
 {
@@ -930,53 +1129,64 @@ void MkFitter::FindCandidates(const LayerOfHits &layer_of_hits,
     idx[it] = 0;
     }
 
+  const bool hit_major = UseHitMajorChi2(N_proc);
+  if (hit_major) ComputeChi2HitMajor(layer_of_hits, N_proc);
+
   // Has basically no effect, it seems.
   //#pragma noprefetch
   for (int hit_cnt = 0; hit_cnt < maxSize; ++hit_cnt)
   {
-#pragma simd
-    for (int itrack = 0; itrack < N_proc; ++itrack)
+    MPlexQF outChi2;
+    MPlexQF msInv2R;
+
+    if (hit_major)
     {
-      if (hit_cnt < XHitSize[itrack])
+#pragma simd
+      for (int itrack = 0; itrack < N_proc; ++itrack)
       {
-	idx[itrack] = XHitArr.At(itrack, hit_cnt, 0) * sizeof(Hit);
+        outChi2[itrack] = XHitChi2.At(itrack, hit_cnt, 0);
       }
     }
-#if defined(MIC_INTRINSICS)
-    __m512i vi = _mm512_load_epi32(idx);
-#endif
-    
-    // Prefetch to L2 the hits we'll (probably) process after two loops iterations.
-    // Ideally this would be initiated before coming here, for whole bunch_of_hits.m_hits vector.
-    for (int itrack = 0; itrack < N_proc; ++itrack)
+    else
     {
-      if (hit_cnt + 2 < XHitSize[itrack])
+#pragma simd
+      for (int itrack = 0; itrack < N_proc; ++itrack)
       {
-	_mm_prefetch(varr + XHitArr.At(itrack, hit_cnt+2, 0)*sizeof(Hit), _MM_HINT_T1);
+        if (hit_cnt < XHitSize[itrack])
+        {
+	  idx[itrack] = XHitArr.At(itrack, hit_cnt, 0) * sizeof(Hit);
+        }
+      }
+    
+      // Prefetch to L2 the hits we'll (probably) process after two loops iterations.
+      // Ideally this would be initiated before coming here, for whole bunch_of_hits.m_hits vector.
+      for (int itrack = 0; itrack < N_proc; ++itrack)
+      {
+        if (hit_cnt + 2 < XHitSize[itrack])
+        {
+	  _mm_prefetch(varr + XHitArr.At(itrack, hit_cnt+2, 0)*sizeof(Hit), _MM_HINT_T1);
+        }
       }
-    }
 
-#if defined(MIC_INTRINSICS)
-    msErr[Nhits].SlurpIn(varr + off_error, vi);
-    msPar[Nhits].SlurpIn(varr + off_param, vi);
-#else
-    msErr[Nhits].SlurpIn(varr + off_error, idx);
-    msPar[Nhits].SlurpIn(varr + off_param, idx);
-#endif
+      msErr[Nhits].SlurpIn(varr + off_error, idx);
+      msPar[Nhits].SlurpIn(varr + off_param, idx);
 
-    //now compute the chi2 of track state vs hit
-    MPlexQF outChi2;
-    computeChi2MPlex(Err[iP], Par[iP], Chg, msErr[Nhits], msPar[Nhits], outChi2, N_proc);
+      //now compute the chi2 of track state vs hit
+      SlurpInHitInv2R(layer_of_hits, idx, msInv2R);
+
+      computeChi2MPlex(Err[iP], Par[iP], Chg, msErr[Nhits], msPar[Nhits], msInv2R, outChi2, N_proc, UpdCtx);
     
-    // Prefetch to L1 the hits we'll (probably) process in the next loop iteration.
-    for (int itrack = 0; itrack < N_proc; ++itrack)
-    {
-      if (hit_cnt + 1 < XHitSize[itrack])
+      // Prefetch to L1 the hits we'll (probably) process in the next loop iteration.
+      for (int itrack = 0; itrack < N_proc; ++itrack)
       {
-	_mm_prefetch(varr + XHitArr.At(itrack, hit_cnt+1, 0)*sizeof(Hit), _MM_HINT_T0);
+        if (hit_cnt + 1 < XHitSize[itrack])
+        {
+	  _mm_prefetch(varr + XHitArr.At(itrack, hit_cnt+1, 0)*sizeof(Hit), _MM_HINT_T0);
+        }
       }
-    }
     
+    }
+
     //now update the track parameters with this hit (note that some calculations are already done when computing chi2, to be optimized)
     //this is not needed for candidates the hit is not added to, but it's vectorized so doing it serially below should take the same time
     //still it's a waste of time in case the hit is not added to any of the candidates, so check beforehand that at least one cand needs update
@@ -997,7 +1207,22 @@ void MkFitter::FindCandidates(const LayerOfHits &layer_of_hits,
     
     if (oneCandPassCut)
     {
-      updateParametersMPlex(Err[iP], Par[iP], Chg, msErr[Nhits], msPar[Nhits], Err[iC], Par[iC], N_proc);
+      if (hit_major)
+      {
+        // Hits were only gathered for chi2 so far, the update needs them here.
+        for (int itrack = 0; itrack < N_proc; ++itrack)
+        {
+          if (hit_cnt < XHitSize[itrack])
+          {
+            idx[itrack] = XHitArr.At(itrack, hit_cnt, 0) * sizeof(Hit);
+          }
+        }
+        msErr[Nhits].SlurpIn(varr + off_error, idx);
+        msPar[Nhits].SlurpIn(varr + off_param, idx);
+        SlurpInHitInv2R(layer_of_hits, idx, msInv2R);
+      }
+
+      updateParametersMPlex(Err[iP], Par[iP], Chg, msErr[Nhits], msPar[Nhits], msInv2R, Err[iC], Par[iC], N_proc, UpdCtx);
       dprint("update parameters" << std::endl
 	     << "propagated track parameters x=" << Par[iP].ConstAt(0, 0, 0) << " y=" << Par[iP].ConstAt(0, 1, 0) << std::endl
 	     << "               hit position x=" << msPar[Nhits].ConstAt(0, 0, 0) << " y=" << msPar[Nhits].ConstAt(0, 1, 0) << std::endl
@@ -1026,8 +1251,7 @@ void MkFitter::FindCandidates(const LayerOfHits &layer_of_hits,
 	    newcand.addHitIdx(XHitArr.At(itrack, hit_cnt, 0), chi2);
 	    newcand.setLabel(Label(itrack, 0, 0));
 	    //set the track state to the updated parameters
-	    Err[iC].CopyOut(itrack, newcand.errors_nc().Array());
-	    Par[iC].CopyOut(itrack, newcand.parameters_nc().Array());
+	    CopyOutState(itrack, iC, newcand);
 
 	    dprint("updated track parameters x=" << newcand.parameters()[0] << " y=" << newcand.parameters()[1] << " z=" << newcand.parameters()[2] << " pt=" << 1./newcand.parameters()[3]);
 	    
@@ -1055,13 +1279,13 @@ void MkFitter::FindCandidates(const LayerOfHits &layer_of_hits,
     newcand.addHitIdx(hit_idx, 0.);
     newcand.setLabel(Label(itrack, 0, 0));
     //set the track state to the propagated parameters
-    Err[iP].CopyOut(itrack, newcand.errors_nc().Array());
-    Par[iP].CopyOut(itrack, newcand.parameters_nc().Array());
+    CopyOutState(itrack, iP, newcand);
     tmp_candidates[SeedIdx(itrack, 0, 0)-offset].push_back(newcand);
   }
 }
 
-void MkFitter::FindCandidatesEndcap(const LayerOfHits &layer_of_hits,
+template<int NN>
+void MkFitterT<NN>::FindCandidatesEndcap(const LayerOfHits &layer_of_hits,
 				    std::vector<std::vector<Track> >& tmp_candidates,
 				    const int offset, const int N_proc)
 {
@@ -1106,9 +1330,6 @@ void MkFitter::FindCandidatesEndcap(const LayerOfHits &layer_of_hits,
 	idx[itrack] = XHitArr.At(itrack, hit_cnt, 0) * sizeof(Hit);
       }
     }
-#if defined(MIC_INTRINSICS)
-    __m512i vi = _mm512_load_epi32(idx);
-#endif
       
     // Prefetch to L2 the hits we'll (probably) process after two loops iterations.
     // Ideally this would be initiated before coming here, for whole bunch_of_hits.m_hits vector.
@@ -1120,13 +1341,8 @@ void MkFitter::FindCandidatesEndcap(const LayerOfHits &layer_of_hits,
       }
     }
     
-#if defined(MIC_INTRINSICS)    
-    msErr[Nhits].SlurpIn(varr + off_error, vi);
-    msPar[Nhits].SlurpIn(varr + off_param, vi);
-#else
     msErr[Nhits].SlurpIn(varr + off_error, idx);
     msPar[Nhits].SlurpIn(varr + off_param, idx);
-#endif
 
     //now compute the chi2 of track state vs hit
     MPlexQF outChi2;
@@ -1190,8 +1406,7 @@ void MkFitter::FindCandidatesEndcap(const LayerOfHits &layer_of_hits,
 	    newcand.addHitIdx(XHitArr.At(itrack, hit_cnt, 0), chi2);
 	    newcand.setLabel(Label(itrack, 0, 0));
 	    //set the track state to the updated parameters
-	    Err[iC].CopyOut(itrack, newcand.errors_nc().Array());
-	    Par[iC].CopyOut(itrack, newcand.parameters_nc().Array());
+	    CopyOutState(itrack, iC, newcand);
 
 	    dprint("updated track parameters x=" << newcand.parameters()[0] << " y=" << newcand.parameters()[1] << " z=" << newcand.parameters()[2] << " pt=" << 1./newcand.parameters()[3]);
 	    
@@ -1229,13 +1444,13 @@ void MkFitter::FindCandidatesEndcap(const LayerOfHits &layer_of_hits,
     newcand.addHitIdx(hit_idx, 0.);
     newcand.setLabel(Label(itrack, 0, 0));
       //set the track state to the propagated parameters
-    Err[iP].CopyOut(itrack, newcand.errors_nc().Array());
-    Par[iP].CopyOut(itrack, newcand.parameters_nc().Array());
+    CopyOutState(itrack, iP, newcand);
     tmp_candidates[SeedIdx(itrack, 0, 0)-offset].push_back(newcand);
   }
 }
 
-void MkFitter::FindCandidatesMinimizeCopy(const LayerOfHits &layer_of_hits, CandCloner& cloner,
+template<int NN>
+void MkFitterT<NN>::FindCandidatesMinimizeCopy(const LayerOfHits &layer_of_hits, CandCloner& cloner,
                                           const int offset, const int N_proc)
 {
   const char *varr      = (char*) layer_of_hits.m_hits;
@@ -1269,50 +1484,60 @@ void MkFitter::FindCandidatesMinimizeCopy(const LayerOfHits &layer_of_hits, Cand
   }
   // XXXX MT FIXME: use masks to filter out SlurpIns
 
+  const bool hit_major = UseHitMajorChi2(N_proc);
+  if (hit_major) ComputeChi2HitMajor(layer_of_hits, N_proc);
+
 // Has basically no effect, it seems.
 //#pragma noprefetch
   for (int hit_cnt = 0; hit_cnt < maxSize; ++hit_cnt)
   {
-#pragma simd
-    for (int itrack = 0; itrack < N_proc; ++itrack)
+    MPlexQF outChi2;
+    MPlexQF msInv2R;
+
+    if (hit_major)
     {
-      if (hit_cnt < XHitSize[itrack])
+#pragma simd
+      for (int itrack = 0; itrack < N_proc; ++itrack)
       {
-        idx[itrack] = XHitArr.At(itrack, hit_cnt, 0) * sizeof(Hit);
+        outChi2[itrack] = XHitChi2.At(itrack, hit_cnt, 0);
       }
     }
-#if defined(MIC_INTRINSICS)
-    __m512i vi = _mm512_load_epi32(idx);
-#endif
-
-    // Prefetch to L2 the hits we'll (probably) process after two loops iterations.
-    // Ideally this would be initiated before coming here, for whole bunch_of_hits.m_hits vector.
-    for (int itrack = 0; itrack < N_proc; ++itrack)
+    else
     {
-      if (hit_cnt + 2 < XHitSize[itrack])
+#pragma simd
+      for (int itrack = 0; itrack < N_proc; ++itrack)
       {
-        _mm_prefetch(varr + XHitArr.At(itrack, hit_cnt+2, 0)*sizeof(Hit), _MM_HINT_T1);
+        if (hit_cnt < XHitSize[itrack])
+        {
+          idx[itrack] = XHitArr.At(itrack, hit_cnt, 0) * sizeof(Hit);
+        }
       }
-    }
 
-#if defined(MIC_INTRINSICS)
-    msErr[Nhits].SlurpIn(varr + off_error, vi);
-    msPar[Nhits].SlurpIn(varr + off_param, vi);
-#else
-    msErr[Nhits].SlurpIn(varr + off_error, idx);
-    msPar[Nhits].SlurpIn(varr + off_param, idx);
-#endif
+      // Prefetch to L2 the hits we'll (probably) process after two loops iterations.
+      // Ideally this would be initiated before coming here, for whole bunch_of_hits.m_hits vector.
+      for (int itrack = 0; itrack < N_proc; ++itrack)
+      {
+        if (hit_cnt + 2 < XHitSize[itrack])
+        {
+          _mm_prefetch(varr + XHitArr.At(itrack, hit_cnt+2, 0)*sizeof(Hit), _MM_HINT_T1);
+        }
+      }
 
-    //now compute the chi2 of track state vs hit
-    MPlexQF outChi2;
-    computeChi2MPlex(Err[iP], Par[iP], Chg, msErr[Nhits], msPar[Nhits], outChi2, N_proc);
+      msErr[Nhits].SlurpIn(varr + off_error, idx);
+      msPar[Nhits].SlurpIn(varr + off_param, idx);
 
-    // Prefetch to L1 the hits we'll (probably) process in the next loop iteration.
-    for (int itrack = 0; itrack < N_proc; ++itrack)
-    {
-      if (hit_cnt + 1 < XHitSize[itrack])
+      //now compute the chi2 of track state vs hit
+      SlurpInHitInv2R(layer_of_hits, idx, msInv2R);
+
+      computeChi2MPlex(Err[iP], Par[iP], Chg, msErr[Nhits], msPar[Nhits], msInv2R, outChi2, N_proc, UpdCtx);
+
+      // Prefetch to L1 the hits we'll (probably) process in the next loop iteration.
+      for (int itrack = 0; itrack < N_proc; ++itrack)
       {
-        _mm_prefetch(varr + XHitArr.At(itrack, hit_cnt+1, 0)*sizeof(Hit), _MM_HINT_T0);
+        if (hit_cnt + 1 < XHitSize[itrack])
+        {
+          _mm_prefetch(varr + XHitArr.At(itrack, hit_cnt+1, 0)*sizeof(Hit), _MM_HINT_T0);
+        }
       }
     }
 
@@ -1370,8 +1595,9 @@ void MkFitter::FindCandidatesMinimizeCopy(const LayerOfHits &layer_of_hits, Cand
 
 
 
-void MkFitter::InputTracksAndHitIdx(const std::vector<std::vector<Track> >& tracks,
-                                    const std::vector<std::pair<int,MkFitter::IdxChi2List> >& idxs,
+template<int NN>
+void MkFitterT<NN>::InputTracksAndHitIdx(const std::vector<std::vector<Track> >& tracks,
+                                    const std::vector<std::pair<int,IdxChi2List> >& idxs,
                                     int beg, int end, bool inputProp)
 {
   // Assign track parameters to initial state and copy hit values in.
@@ -1381,27 +1607,19 @@ void MkFitter::InputTracksAndHitIdx(const std::vector<std::vector<Track> >& trac
 
   //fixme: why do we need both i and itrack in the loops below?
 
+  const Track *trk_ptrs[NN];
+
   int itrack = 0;
   for (int i = beg; i < end; ++i, ++itrack)
   {
 
     const Track &trk = tracks[idxs[i].first][idxs[i].second.trkIdx];
+    trk_ptrs[itrack] = &trk;
 
     Label(itrack, 0, 0) = trk.label();
     SeedIdx(itrack, 0, 0) = idxs[i].first;
     CandIdx(itrack, 0, 0) = idxs[i].second.trkIdx;
 
-    if (inputProp) 
-    {
-      Err[iP].CopyIn(itrack, trk.errors().Array());
-      Par[iP].CopyIn(itrack, trk.parameters().Array());
-    } 
-    else 
-    {      
-      Err[iC].CopyIn(itrack, trk.errors().Array());
-      Par[iC].CopyIn(itrack, trk.parameters().Array());
-    } 
-
     Chg(itrack, 0, 0) = trk.charge();
     Chi2(itrack, 0, 0) = trk.chi2();
 
@@ -1410,11 +1628,17 @@ void MkFitter::InputTracksAndHitIdx(const std::vector<std::vector<Track> >& trac
       HitsIdx[hi](itrack, 0, 0) = trk.getHitIdx(hi);//dummy value for now
     }
   }
+
+  CopyInStates(&trk_ptrs[0], end - beg, inputProp ? iP : iC);
 }
 
 
-void MkFitter::UpdateWithLastHit(const LayerOfHits &layer_of_hits, int N_proc)
+template<int NN>
+void MkFitterT<NN>::UpdateWithLastHit(const LayerOfHits &layer_of_hits, int N_proc)
 {
+  // Lanes without a hit get restored from Err/Par[iP] below, any finite value will do.
+  MPlexQF msInv2R(1.0f);
+
   for (int i = 0; i < N_proc; ++i)
   {
     int hit_idx = HitsIdx[Nhits - 1](i, 0, 0);
@@ -1425,9 +1649,10 @@ void MkFitter::UpdateWithLastHit(const LayerOfHits &layer_of_hits, int N_proc)
 
     msErr[Nhits - 1].CopyIn(i, hit.errArray());
     msPar[Nhits - 1].CopyIn(i, hit.posArray());
+    msInv2R[i] = layer_of_hits.m_hit_inv2rs[hit_idx];
   }
 
-  updateParametersMPlex(Err[iP], Par[iP], Chg, msErr[Nhits-1], msPar[Nhits-1], Err[iC], Par[iC], N_proc);
+  updateParametersMPlex(Err[iP], Par[iP], Chg, msErr[Nhits-1], msPar[Nhits-1], msInv2R, Err[iC], Par[iC], N_proc, UpdCtx);
 
   //now that we have moved propagation at the end of the sequence we lost the handle of
   //using the propagated parameters instead of the updated for the missing hit case.
@@ -1447,7 +1672,8 @@ void MkFitter::UpdateWithLastHit(const LayerOfHits &layer_of_hits, int N_proc)
   }
 }
 
-void MkFitter::UpdateWithLastHitEndcap(const LayerOfHits &layer_of_hits, int N_proc)
+template<int NN>
+void MkFitterT<NN>::UpdateWithLastHitEndcap(const LayerOfHits &layer_of_hits, int N_proc)
 {
   for (int i = 0; i < N_proc; ++i)
   {
@@ -1481,19 +1707,175 @@ void MkFitter::UpdateWithLastHitEndcap(const LayerOfHits &layer_of_hits, int N_p
   }
 }
 
-void MkFitter::CopyOutParErr(std::vector<std::vector<Track> >& seed_cand_vec,
+//==============================================================================
+// Mixed barrel / endcap
+//==============================================================================
+
+template<int NN>
+void MkFitterT<NN>::SetTarget(const int itrack, const Geometry &geom, const int layer, const bool is_disk)
+{
+  TargetIsDisk.At(itrack, 0, 0) = is_disk;
+  TargetPos   .At(itrack, 0, 0) = is_disk ? geom.zPlane(layer) : geom.Radius(layer);
+}
+
+template<int NN>
+void MkFitterT<NN>::PropagateTracksToTargets(const int N_proc)
+{
+  propagateHelixToSurfaceMPlex(Err[iC], Par[iC], Chg, TargetIsDisk, TargetPos,
+                               Err[iP], Par[iP], N_proc);
+}
+
+template<int NN>
+void MkFitterT<NN>::PropagateTracksToTargetsAndWindows(const int N_proc)
+{
+  propagateHelixToSurfaceMPlex(Err[iC], Par[iC], Chg, TargetIsDisk, TargetPos,
+                               Err[iP], Par[iP], XWin, XWinDisk, N_proc);
+}
+
+template<int NN>
+void MkFitterT<NN>::SelectHitIndicesMixed(const LayerOfHits *const *layers, const int N_proc, bool dump)
+{
+  for (int itrack = 0; itrack < N_proc; ++itrack)
+  {
+    if (TargetIsDisk.ConstAt(itrack, 0, 0))
+      SelectHitIndicesEndcapTrack(*layers[itrack], itrack, dump);
+    else
+      SelectHitIndicesTrack(*layers[itrack], itrack, dump);
+  }
+}
+
+template<int NN>
+void MkFitterT<NN>::UpdateWithLastHitMixed(const LayerOfHits *const *layers, int N_proc)
+{
+  // Lanes without a hit get restored from Err/Par[iP] below, any finite value will do.
+  MPlexQF msInv2R(1.0f);
+  MPlexQI noHit(1);
+
+  for (int i = 0; i < N_proc; ++i)
+  {
+    int hit_idx = HitsIdx[Nhits - 1](i, 0, 0);
+
+    if (hit_idx < 0) continue;
+
+    const LayerOfHits &L = *layers[i];
+    Hit &hit = L.m_hits[hit_idx];
+
+    msErr[Nhits - 1].CopyIn(i, hit.errArray());
+    msPar[Nhits - 1].CopyIn(i, hit.posArray());
+    msInv2R[i] = L.m_hit_inv2rs[hit_idx];
+    noHit[i]   = 0;
+  }
+
+  updateParametersMixedMPlex(Err[iP], Par[iP], Chg, TargetIsDisk, msErr[Nhits-1], msPar[Nhits-1], msInv2R,
+                             Err[iC], Par[iC], N_proc, UpdCtx);
+
+  Err[iC].Blend(Err[iP], noHit.fArray);
+  Par[iC].Blend(Par[iP], noHit.fArray);
+}
+
+template<int NN>
+int MkFitterT<NN>::CheckMixedKernels(const LayerOfHits *const *layers, const int N_proc)
+{
+  const int n_hits = Nhits;
+  const MPlexLS err_in = Err[iC];
+  const MPlexLV par_in = Par[iC];
+
+  auto take_first_hit = [&]()
+  {
+    for (int i = 0; i < N_proc; ++i)
+    {
+      HitsIdx[n_hits](i, 0, 0) = XHitSize[i] > 0 ? XHitArr.At(i, 0, 0) : -1;
+    }
+    Nhits = n_hits + 1;
+  };
+
+  PropagateTracksToTargetsAndWindows(N_proc);
+  SelectHitIndicesMixed(layers, N_proc);
+  take_first_hit();
+  UpdateWithLastHitMixed(layers, N_proc);
+
+  const MPlexLS     mix_err_p = Err[iP];
+  const MPlexLV     mix_par_p = Par[iP];
+  const MPlexQI     mix_xsize = XHitSize;
+  const MPlexHitIdx mix_xarr  = XHitArr;
+  const MPlexLS     mix_err_c = Err[iC];
+  const MPlexLV     mix_par_c = Par[iC];
+
+  const bool endcap_test = Config::endcapTest;
+
+  int n_diff = 0;
+
+  for (int disk = 0; disk < 2; ++disk)
+  {
+    int first = 0;
+    while (first < N_proc && TargetIsDisk.ConstAt(first, 0, 0) != disk) ++first;
+    if (first == N_proc) continue;
+
+    // All slots of one kind share the layer, run the whole plex through it.
+    const LayerOfHits &L   = *layers[first];
+    const float        pos = TargetPos.ConstAt(first, 0, 0);
+
+    Err[iC] = err_in;
+    Par[iC] = par_in;
+    Nhits   = n_hits;
+    Config::endcapTest = disk;
+
+    if (disk)
+    {
+      PropagateTracksToZ(pos, N_proc);
+      ComputeHitWindowsEndcap(N_proc);
+      SelectHitIndicesEndcap(L, N_proc);
+      take_first_hit();
+      UpdateWithLastHitEndcap(L, N_proc);
+    }
+    else
+    {
+      PropagateTracksToR(pos, N_proc);
+      ComputeHitWindows(N_proc);
+      SelectHitIndices(L, N_proc);
+      take_first_hit();
+      UpdateWithLastHit(L, N_proc);
+    }
+
+    for (int i = 0; i < N_proc; ++i)
+    {
+      if (TargetIsDisk.ConstAt(i, 0, 0) != disk) continue;
+
+      if ( ! SameSlot<NN>(mix_err_p, Err[iP], i) || ! SameSlot<NN>(mix_par_p, Par[iP], i) ||
+           ! SameSlot<NN>(mix_xsize, XHitSize, i) ||
+           ! SameSlot<NN>(mix_xarr,  XHitArr,  i, std::min(XHitSize[i], (int) MPlexHitIdx::kSize)) ||
+           ! SameSlot<NN>(mix_err_c, Err[iC], i) || ! SameSlot<NN>(mix_par_c, Par[iC], i))
+      {
+        dprint("mixed kernel mismatch in slot " << i << " disk=" << disk);
+        ++n_diff;
+      }
+    }
+  }
+
+  Config::endcapTest = endcap_test;
+  Nhits = n_hits;
+
+  return n_diff;
+}
+
+template<int NN>
+void MkFitterT<NN>::CopyOutParErr(std::vector<std::vector<Track> >& seed_cand_vec,
                              int N_proc, bool outputProp) const
 {
   const int iO = outputProp ? iP : iC;
 
+  Track *trk_ptrs[NN];
   for (int i = 0; i < N_proc; ++i)
   {
-    //create a new candidate and fill the cands_for_next_lay vector
-    Track &cand = seed_cand_vec[SeedIdx(i, 0, 0)][CandIdx(i, 0, 0)];
+    trk_ptrs[i] = &seed_cand_vec[SeedIdx(i, 0, 0)][CandIdx(i, 0, 0)];
+  }
 
-    //set the track state to the updated parameters
-    Err[iO].CopyOut(i, cand.errors_nc().Array());
-    Par[iO].CopyOut(i, cand.parameters_nc().Array());
+  //set the track state to the updated parameters
+  CopyOutStates(&trk_ptrs[0], N_proc, iO);
+
+  for (int i = 0; i < N_proc; ++i)
+  {
+    const Track &cand = *trk_ptrs[i];
 
     dprint((outputProp?"propagated":"updated") << " track parameters x=" << cand.parameters()[0]
               << " y=" << cand.parameters()[1]
@@ -1514,18 +1896,29 @@ void MkFitter::CopyOutParErr(std::vector<std::vector<Track> >& seed_cand_vec,
 //+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++//
 //-----------------------------------------------------------------------------------------//
 
-void MkFitter::PropagateTracksToZ(float Z, const int N_proc)
+template<int NN>
+void MkFitterT<NN>::PropagateTracksToZ(float Z, const int N_proc)
 {
     propagateHelixToZMPlex(Err[iC], Par[iC], Chg, Z,
                            Err[iP], Par[iP], N_proc);
 }
 
-void MkFitter::SelectHitIndicesEndcap(const LayerOfHits &layer_of_hits, const int N_proc, bool dump)
+template<int NN>
+void MkFitterT<NN>::PropagateTracksToZAndWindow(float Z, const int N_proc)
 {
-  const int   iI = iP;
-  const float nSigmaPhi = 3;
-  const float nSigmaR   = 3;
+    propagateHelixToZMPlex(Err[iC], Par[iC], Chg, Z,
+                           Err[iP], Par[iP], XWinDisk, N_proc);
+}
 
+template<int NN>
+void MkFitterT<NN>::ComputeHitWindowsEndcap(const int N_proc)
+{
+  computeDiskHitWindowMPlex(Err[iP], Par[iP], Chg, XWinDisk, N_proc);
+}
+
+template<int NN>
+void MkFitterT<NN>::SelectHitIndicesEndcap(const LayerOfHits &layer_of_hits, const int N_proc, bool dump)
+{
   //dump = true;
 
   // Vectorizing this makes it run slower!
@@ -1533,119 +1926,86 @@ void MkFitter::SelectHitIndicesEndcap(const LayerOfHits &layer_of_hits, const in
   //#pragma simd
   for (int itrack = 0; itrack < N_proc; ++itrack)
   {
-    XHitSize[itrack] = 0;
-
-    float r, phi, dr, dphi;
-    {
-      const float x = Par[iI].ConstAt(itrack, 0, 0);
-      const float y = Par[iI].ConstAt(itrack, 1, 0);
-
-      const float r2 = x*x + y*y;
-      r  = std::sqrt(r2);
-
-      phi = getPhi(x, y);
-      dr  = nSigmaR*(x*x*Err[iI].ConstAt(itrack, 0, 0) + y*y*Err[iI].ConstAt(itrack, 1, 1) + 2*x*y*Err[iI].ConstAt(itrack, 0, 1))/r2;
-
-      const float dphidx = -y/r2, dphidy = x/r2;
-      const float dphi2  = dphidx * dphidx * Err[iI].ConstAt(itrack, 0, 0) +
-                           dphidy * dphidy * Err[iI].ConstAt(itrack, 1, 1) +
-                       2 * dphidx * dphidy * Err[iI].ConstAt(itrack, 0, 1);
-
-#ifdef HARD_CHECK
-      assert(dphi2 >= 0);
-#endif
-
-      dphi = nSigmaPhi * std::sqrt(std::abs(dphi2));
-
-      if (std::abs(dphi)<Config::minDPhi) dphi = Config::minDPhi;
-//       if (std::abs(dz)<Config::minDZ) dz = Config::minDZ;
+    SelectHitIndicesEndcapTrack(layer_of_hits, itrack, dump);
+  }
+}
 
-      if (Config::useCMSGeom)
-      {
-        //now correct for bending and for layer thickness unsing linear approximation
-        const float deltaZ = 5; //fixme! using constant value, to be taken from layer properties
-#ifdef CCSCOORD
-	float cosT = std::cos(Par[iI].ConstAt(itrack, 5, 0));
-	float sinT = std::sin(Par[iI].ConstAt(itrack, 5, 0));
-	//here alpha is the helix angular path corresponding to deltaZ
-	const float k = Chg.ConstAt(itrack, 0, 0) * 100.f / (-Config::sol*Config::Bfield);
-	const float alpha  = deltaZ*sinT*Par[iI].ConstAt(itrack, 3, 0)/(cosT*k);
-#else
-	assert(0);
-#endif
-        dphi += std::abs(alpha);
-      }
-    }
+template<int NN>
+void MkFitterT<NN>::SelectHitIndicesEndcapTrack(const LayerOfHits &layer_of_hits, const int itrack, bool dump)
+{
+  XHitSize[itrack] = 0;
 
-    const LayerOfHits &L = layer_of_hits;
+  const float r    = XWinDisk.r   .ConstAt(itrack, 0, 0);
+  const float phi  = XWinDisk.phi .ConstAt(itrack, 0, 0);
+  const float dr   = XWinDisk.dr  .ConstAt(itrack, 0, 0);
+  const float dphi = XWinDisk.dphi.ConstAt(itrack, 0, 0);
 
-    // if (std::abs(dz)   > Config::m_max_dz)   dz   = Config::m_max_dz;
-    if (std::abs(dphi) > Config::m_max_dphi) dphi = Config::m_max_dphi;
+  const LayerOfHits &L = layer_of_hits;
 
-    const int rb1 = L.GetRBinChecked(r - dr);
-    const int rb2 = L.GetRBinChecked(r + dr) + 1;
-    const int pb1 = L.GetPhiBin(phi - dphi);
-    const int pb2 = L.GetPhiBin(phi + dphi) + 1;
-    // MT: The extra phi bins give us ~1.5% more good tracks at expense of 10% runtime.
-    // const int pb1 = L.GetPhiBin(phi - dphi) - 1;
-    // const int pb2 = L.GetPhiBin(phi + dphi) + 2;
+  const int rb1 = L.GetRBinChecked(r - dr);
+  const int rb2 = L.GetRBinChecked(r + dr) + 1;
+  const int pb1 = L.GetPhiBin(phi - dphi);
+  const int pb2 = L.GetPhiBin(phi + dphi) + 1;
+  // MT: The extra phi bins give us ~1.5% more good tracks at expense of 10% runtime.
+  // const int pb1 = L.GetPhiBin(phi - dphi) - 1;
+  // const int pb2 = L.GetPhiBin(phi + dphi) + 2;
 
-    if (dump)
-      printf("LayerOfHits::SelectHitIndices %6.3f %6.3f %6.4f %7.5f %3d %3d %4d %4d\n",
-             r, phi, dr, dphi, rb1, rb2, pb1, pb2);
+  if (dump)
+    printf("LayerOfHits::SelectHitIndices %6.3f %6.3f %6.4f %7.5f %3d %3d %4d %4d\n",
+           r, phi, dr, dphi, rb1, rb2, pb1, pb2);
 
-    // MT: One could iterate in "spiral" order, to pick hits close to the center.
-    // http://stackoverflow.com/questions/398299/looping-in-a-spiral
-    // This would then work best with relatively small bin sizes.
-    // Or, set them up so I can always take 3x3 array around the intersection.
+  // MT: One could iterate in "spiral" order, to pick hits close to the center.
+  // http://stackoverflow.com/questions/398299/looping-in-a-spiral
+  // This would then work best with relatively small bin sizes.
+  // Or, set them up so I can always take 3x3 array around the intersection.
 
-    for (int ri = rb1; ri < rb2; ++ri)
+  for (int ri = rb1; ri < rb2; ++ri)
+  {
+    for (int pi = pb1; pi < pb2; ++pi)
     {
-      for (int pi = pb1; pi < pb2; ++pi)
-      {
-        const int pb = pi & L.m_phi_mask;
+      const int pb = pi & L.m_phi_mask;
 
-        // MT: The following line is the biggest hog (4% total run time).
-        // This comes from cache misses, I presume.
-        // It might make sense to make first loop to extract bin indices
-        // and issue prefetches at the same time.
-        // Then enter vectorized loop to actually collect the hits in proper order.
+      // MT: The following line is the biggest hog (4% total run time).
+      // This comes from cache misses, I presume.
+      // It might make sense to make first loop to extract bin indices
+      // and issue prefetches at the same time.
+      // Then enter vectorized loop to actually collect the hits in proper order.
 
-        for (int hi = L.m_phi_bin_infos[ri][pb].first; hi < L.m_phi_bin_infos[ri][pb].second; ++hi)
-        {
-          // MT: Access into m_hit_zs and m_hit_phis is 1% run-time each.
+      for (int hi = L.m_phi_bin_infos[ri][pb].first; hi < L.m_phi_bin_infos[ri][pb].second; ++hi)
+      {
+        // MT: Access into m_hit_zs and m_hit_phis is 1% run-time each.
 
 #ifdef LOH_USE_PHI_Z_ARRAYS
-          float ddz   = std::abs(z   - L.m_hit_zs[hi]);
-          float ddphi = std::abs(phi - L.m_hit_phis[hi]);
-          if (ddphi > Config::PI) ddphi = Config::TwoPI - ddphi;
-
-          if (dump)
-            printf("     SHI %3d %4d %4d %5d  %6.3f %6.3f %6.4f %7.5f   %s\n",
-                   ri, pi, pb, hi,
-                   L.m_hit_zs[hi], L.m_hit_phis[hi], ddz, ddphi,
-                   (ddz < dz && ddphi < dphi) ? "PASS" : "FAIL");
-
-          // MT: Commenting this check out gives full efficiency ...
-          //     and means our error estimations are wrong!
-          // Avi says we should have *minimal* search windows per layer.
-          // Also ... if bins are sufficiently small, we do not need the extra
-          // checks, see above.
-          // if (ddz < dz && ddphi < dphi && XHitSize[itrack] < MPlexHitIdxMax)
+        float ddz   = std::abs(z   - L.m_hit_zs[hi]);
+        float ddphi = std::abs(phi - L.m_hit_phis[hi]);
+        if (ddphi > Config::PI) ddphi = Config::TwoPI - ddphi;
+
+        if (dump)
+          printf("     SHI %3d %4d %4d %5d  %6.3f %6.3f %6.4f %7.5f   %s\n",
+                 ri, pi, pb, hi,
+                 L.m_hit_zs[hi], L.m_hit_phis[hi], ddz, ddphi,
+                 (ddz < dz && ddphi < dphi) ? "PASS" : "FAIL");
+
+        // MT: Commenting this check out gives full efficiency ...
+        //     and means our error estimations are wrong!
+        // Avi says we should have *minimal* search windows per layer.
+        // Also ... if bins are sufficiently small, we do not need the extra
+        // checks, see above.
+        // if (ddz < dz && ddphi < dphi && XHitSize[itrack] < MPlexHitIdxMax)
 #endif
-          // MT: The following check also makes more sense with spiral traversal,
-          // we'd be taking in closest hits first.
-          if (XHitSize[itrack] < MPlexHitIdxMax)
-          {
-            XHitArr.At(itrack, XHitSize[itrack]++, 0) = hi;
-          }
+        // MT: The following check also makes more sense with spiral traversal,
+        // we'd be taking in closest hits first.
+        if (XHitSize[itrack] < MPlexHitIdxMax)
+        {
+          XHitArr.At(itrack, XHitSize[itrack]++, 0) = hi;
         }
       }
     }
   }
 }
 
-void MkFitter::AddBestHitEndcap(const LayerOfHits &layer_of_hits, const int N_proc)
+template<int NN>
+void MkFitterT<NN>::AddBestHitEndcap(const LayerOfHits &layer_of_hits, const int N_proc)
 {
   float minChi2[NN];
   int   bestHit[NN];
@@ -1701,9 +2061,6 @@ void MkFitter::AddBestHitEndcap(const LayerOfHits &layer_of_hits, const int N_pr
         idx[itrack] = XHitArr.At(itrack, hit_cnt, 0) * sizeof(Hit);
       }
     }
-#if defined(MIC_INTRINSICS)
-    __m512i vi = _mm512_load_epi32(idx);
-#endif
 
 #ifndef NO_PREFETCH
     // Prefetch to L2 the hits we'll process after two loops iterations.
@@ -1732,13 +2089,8 @@ void MkFitter::AddBestHitEndcap(const LayerOfHits &layer_of_hits, const int N_pr
 
 #else //NO_GATHER
 
-#if defined(MIC_INTRINSICS)
-    msErr[Nhits].SlurpIn(varr + off_error, vi);
-    msPar[Nhits].SlurpIn(varr + off_param, vi);
-#else
     msErr[Nhits].SlurpIn(varr + off_error, idx);
     msPar[Nhits].SlurpIn(varr + off_param, idx);
-#endif
 #endif //NO_GATHER
 
     //now compute the chi2 of track state vs hit
@@ -1836,7 +2188,8 @@ void MkFitter::AddBestHitEndcap(const LayerOfHits &layer_of_hits, const int N_pr
   //std::cout << "Par[iP](0,0,0)=" << Par[iP](0,0,0) << " Par[iC](0,0,0)=" << Par[iC](0,0,0)<< std::endl;
 }
 
-void MkFitter::FindCandidatesMinimizeCopyEndcap(const LayerOfHits &layer_of_hits, CandCloner& cloner,
+template<int NN>
+void MkFitterT<NN>::FindCandidatesMinimizeCopyEndcap(const LayerOfHits &layer_of_hits, CandCloner& cloner,
                                                 const int offset, const int N_proc)
 {
   const char *varr      = (char*) layer_of_hits.m_hits;
@@ -1882,9 +2235,6 @@ void MkFitter::FindCandidatesMinimizeCopyEndcap(const LayerOfHits &layer_of_hits
         idx[itrack] = XHitArr.At(itrack, hit_cnt, 0) * sizeof(Hit);
       }
     }
-#if defined(MIC_INTRINSICS)
-    __m512i vi = _mm512_load_epi32(idx);
-#endif
 
     // Prefetch to L2 the hits we'll (probably) process after two loops iterations.
     // Ideally this would be initiated before coming here, for whole bunch_of_hits.m_hits vector.
@@ -1896,13 +2246,8 @@ void MkFitter::FindCandidatesMinimizeCopyEndcap(const LayerOfHits &layer_of_hits
       }
     }
 
-#if defined(MIC_INTRINSICS)
-    msErr[Nhits].SlurpIn(varr + off_error, vi);
-    msPar[Nhits].SlurpIn(varr + off_param, vi);
-#else
     msErr[Nhits].SlurpIn(varr + off_error, idx);
     msPar[Nhits].SlurpIn(varr + off_param, idx);
-#endif
 
     //now compute the chi2 of track state vs hit
     MPlexQF outChi2;
@@ -1977,3 +2322,11 @@ void MkFitter::FindCandidatesMinimizeCopyEndcap(const LayerOfHits &layer_of_hits
 #endif
     }
 }
+
+//==============================================================================
+// Explicit instantiations, see MPLEX_FOR_EACH_WIDTH in Matrix.h
+//==============================================================================
+
+#define INSTANTIATE_MKFITTER(W) template struct MkFitterT<W>;
+
+MPLEX_FOR_EACH_KERNEL_WIDTH(INSTANTIATE_MKFITTER)
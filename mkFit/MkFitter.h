@@ -4,6 +4,8 @@
 #include "Event.h"
 #include "Matrix.h"
 #include "KalmanUtils.h"
+#include "KalmanUtilsMPlex.h"
+#include "PropagationMPlex.h"
 
 #include "HitStructures.h"
 #include "BinInfoUtils.h"
@@ -20,10 +22,37 @@
 class CandCloner;
 
 const int MPlexHitIdxMax = 16;
-typedef Matriplex::Matriplex<int, MPlexHitIdxMax, 1, NN> MPlexHitIdx;
+template<int W> using MPlexHitIdx_T  = Matriplex::Matriplex<int,   MPlexHitIdxMax, 1, W>;
+template<int W> using MPlexHitChi2_T = Matriplex::Matriplex<float, MPlexHitIdxMax, 1, W>;
 
-struct MkFitter
+//minimal set of information for bookkeping
+struct IdxChi2List
 {
+  int   trkIdx;//candidate index
+  int   hitIdx;//hit index
+  int   nhits; //number of hits (used for sorting)
+  float chi2;//total chi2 (used for sorting)
+};
+
+// MkFitterT is templated on plex width so that fitting and building can
+// run with different widths, see Config::fitVecWidth / buildVecWidth.
+// It is instantiated for MPLEX_FOR_EACH_WIDTH (Matrix.h); MkFitter is the
+// NN-wide one.
+
+template<int NN>
+struct MkFitterT
+{
+  typedef MPlexLL_T<NN> MPlexLL;
+  typedef MPlexLV_T<NN> MPlexLV;
+  typedef MPlexLS_T<NN> MPlexLS;
+  typedef MPlexHV_T<NN> MPlexHV;
+  typedef MPlexHS_T<NN> MPlexHS;
+  typedef MPlexQF_T<NN> MPlexQF;
+  typedef MPlexQI_T<NN> MPlexQI;
+
+  typedef MPlexHitIdx_T<NN>  MPlexHitIdx;
+  typedef MPlexHitChi2_T<NN> MPlexHitChi2;
+
   MPlexLS Err[2];
   MPlexLV Par[2];
 
@@ -31,17 +60,35 @@ struct MkFitter
 
   MPlexQF Chi2;
 
-  MPlexHS msErr[Config::nLayers];
-  MPlexHV msPar[Config::nLayers];
+  // Per layer measurements and hit indices, Config::nLayers entries each,
+  // allocated by the constructor -- nLayers must not change afterwards.
+  MPlexHS *msErr;
+  MPlexHV *msPar;
 
   MPlexQI Label;  //this is the seed index in global seed vector (for MC truth match)
   MPlexQI SeedIdx;//this is the seed index in local thread (for bookkeeping at thread level)
   MPlexQI CandIdx;//this is the candidate index for the given seed (for bookkeeping of clone engine)
-  MPlexQI HitsIdx[Config::nLayers];
+  MPlexQI *HitsIdx;
 
   // Hold hit indices to explore at current layer.
   MPlexQI     XHitSize;
   MPlexHitIdx XHitArr;
+  // Chi2 of hits in XHitArr, filled by ComputeChi2HitMajor().
+  MPlexHitChi2 XHitChi2;
+  // Barrel hit search window at Err/Par[iP], filled by
+  // PropagateTracksToRAndWindow() or ComputeHitWindows().
+  HitWindowMPlex<NN> XWin;
+  // Endcap counterpart, filled by PropagateTracksToZAndWindow() or
+  // ComputeHitWindowsEndcap().
+  DiskHitWindowMPlex<NN> XWinDisk;
+
+  // Scratch for computeChi2MPlex() / updateParametersMPlex().
+  UpdateParametersContext<NN> UpdCtx;
+
+  // Per slot propagation target for batches mixing barrel and endcap
+  // candidates: disk (1) or cylinder (0), and its |z| or r. See SetTarget().
+  MPlexQI TargetIsDisk;
+  MPlexQF TargetPos;
 
   // Indices into Err and Par arrays.
   // Thought I'll have to flip between them ...
@@ -51,14 +98,23 @@ struct MkFitter
   int Nhits;
 
 public:
-  MkFitter() : Nhits(0)
+  MkFitterT() : MkFitterT(0)
   {}
-  MkFitter(int n_hits) : Nhits(n_hits)
+  MkFitterT(int n_hits) : Nhits(n_hits)
   {
-    // XXXX Eventually dynamically allocate measurement arrays.
-    // XXXX std::vector is no good, not aligned!
-    // XXXX Hmmh, should really copy them in layer by layer.
+    // std::vector is no good, not aligned!
+    msErr   = (MPlexHS*) _mm_malloc(sizeof(MPlexHS) * Config::nLayers, 64);
+    msPar   = (MPlexHV*) _mm_malloc(sizeof(MPlexHV) * Config::nLayers, 64);
+    HitsIdx = (MPlexQI*) _mm_malloc(sizeof(MPlexQI) * Config::nLayers, 64);
   }
+  ~MkFitterT()
+  {
+    _mm_free(msErr);
+    _mm_free(msPar);
+    _mm_free(HitsIdx);
+  }
+  MkFitterT(const MkFitterT&) = delete;
+  MkFitterT& operator=(const MkFitterT&) = delete;
 
   // Copy-in timing tests.
   MPlexLS& GetErr0() { return Err[0]; }
@@ -76,6 +132,13 @@ public:
   int countValidHits  (int itrack) const { return countValidHits  (itrack, Nhits); }
   int countInvalidHits(int itrack) const { return countInvalidHits(itrack, Nhits); }
 
+  // Track parameters and errors of n_proc tracks into / out of slots
+  // 0 .. n_proc-1 of Err[i] and Par[i], via blocked transposes.
+  void CopyInStates (const Track *const *trks, int n_proc, int iI);
+  void CopyOutStates(Track *const *trks, int n_proc, int iO) const;
+  // Single slot version, for candidates created one at a time.
+  void CopyOutState (int itrack, int iO, Track &trk) const;
+
   void InputTracksAndHits(const std::vector<Track>& tracks, const std::vector<HitVec>& layerHits, int beg, int end);
   void InputTracksAndHits(const std::vector<Track>& tracks, const std::vector<LayerOfHits>& layerHits, int beg, int end);
   void SlurpInTracksAndHits(const std::vector<Track>&  tracks, const std::vector<HitVec>& layerHits, int beg, int end);
@@ -101,11 +164,49 @@ public:
   void OutputFittedTracksAndHitIdx(std::vector<Track>& tracks, int beg, int end, bool outputProp) const;
 
   void PropagateTracksToR(float R, const int N_proc);
+  // Same, with the hit window for SelectHitIndices() computed along with the
+  // error propagation. ComputeHitWindows() is for states that were not
+  // propagated here, e.g. the ones just read in.
+  void PropagateTracksToRAndWindow(float R, const int N_proc);
+  void ComputeHitWindows(const int N_proc);
 
   void PropagateTracksToZ(float Z, const int N_proc);
+  // As for the barrel above, with the window for SelectHitIndicesEndcap().
+  void PropagateTracksToZAndWindow(float Z, const int N_proc);
+  void ComputeHitWindowsEndcap(const int N_proc);
 
+  // Barrel hit selection uses the window in XWin, endcap the one in
+  // XWinDisk, see above.
   void SelectHitIndices(const LayerOfHits &layer_of_hits, const int N_proc, bool dump=false);
   void SelectHitIndicesEndcap(const LayerOfHits &layer_of_hits, const int N_proc, bool dump=false);
+  void SelectHitIndicesTrack      (const LayerOfHits &layer_of_hits, const int itrack, bool dump);
+  void SelectHitIndicesEndcapTrack(const LayerOfHits &layer_of_hits, const int itrack, bool dump);
+
+  // Mixed barrel / endcap batches: each slot goes to its own next layer as
+  // given by the caller's layer plan. layers[itrack] is the LayerOfHits of
+  // that layer, the hit-level steps between selection and update
+  // (AddBestHit, FindCandidates*) still take a single layer.
+  void SetTarget(const int itrack, const Geometry &geom, const int layer, const bool is_disk);
+  void PropagateTracksToTargets(const int N_proc);
+  // Same, with XWin filled for the barrel slots and XWinDisk for the disk
+  // ones, as SelectHitIndicesMixed() needs them.
+  void PropagateTracksToTargetsAndWindows(const int N_proc);
+  void SelectHitIndicesMixed(const LayerOfHits *const *layers, const int N_proc, bool dump=false);
+  void UpdateWithLastHitMixed(const LayerOfHits *const *layers, int N_proc);
+
+  // Runs the mixed chain above from Err/Par[iC] (taking the first selected
+  // hit of each slot) and again with the uniform barrel / endcap functions,
+  // Config::endcapTest toggled accordingly. Returns the number of slots whose
+  // propagated state, hit list or updated state are not bit-identical.
+  int  CheckMixedKernels(const LayerOfHits *const *layers, const int N_proc);
+
+  // Prefetch hits selected by SelectHitIndices(); used when several batches are interleaved.
+  void PrefetchHits(const LayerOfHits &layer_of_hits, const int N_proc) const;
+
+  // Hit-major chi2: each candidate is broadcast over the plex and evaluated
+  // against its hit window, NN hits per pass. Results go into XHitChi2.
+  bool UseHitMajorChi2(const int N_proc) const;
+  void ComputeChi2HitMajor(const LayerOfHits &layer_of_hits, const int N_proc);
 
   void AddBestHit      (const LayerOfHits &layer_of_hits, const int N_proc);
   void AddBestHitEndcap(const LayerOfHits &layer_of_hits, const int N_proc);
@@ -117,14 +218,7 @@ public:
   // ================================================================
   // Methods used with clone engine
   // ================================================================
-  //minimal set of information for bookkeping
-  struct IdxChi2List
-  {
-    int   trkIdx;//candidate index
-    int   hitIdx;//hit index
-    int   nhits; //number of hits (used for sorting)
-    float chi2;//total chi2 (used for sorting)
-  };
+  typedef ::IdxChi2List IdxChi2List;
   //version of find candidates that does not cloning, just fills the IdxChi2List as output (to be then read by the clone engine)
   void FindCandidatesMinimizeCopy(const LayerOfHits &layer_of_hits, CandCloner& cloner,
                                   const int offset, const int N_proc);
@@ -143,4 +237,6 @@ public:
                      int N_proc, bool outputProp) const;
 };
 
+typedef MkFitterT<NN> MkFitter;
+
 #endif
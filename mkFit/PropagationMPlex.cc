@@ -1,4 +1,8 @@
 #include "PropagationMPlex.h"
+#include "MathMPlex.h"
+#include "MaterialMap.h"
+#include "Matriplex/MatriplexSparse.h"
+#include "FieldMap.h"
 
 //#define DEBUG
 #include "Debug.h"
@@ -9,9 +13,10 @@
 
 using namespace Matriplex;
 
-void propagateLineToRMPlex(const MPlexLS &psErr,  const MPlexLV& psPar,
-                           const MPlexHS &msErr,  const MPlexHV& msPar,
-                                 MPlexLS &outErr,       MPlexLV& outPar,
+template<int NN>
+void propagateLineToRMPlex(const MPlexLS_T<NN> &psErr,  const MPlexLV_T<NN>& psPar,
+                           const MPlexHS_T<NN> &msErr,  const MPlexHV_T<NN>& msPar,
+                                 MPlexLS_T<NN> &outErr,       MPlexLV_T<NN>& outPar,
                            const int      N_proc)
 {
    // XXX Regenerate parts below with a script.
@@ -39,8 +44,8 @@ void propagateLineToRMPlex(const MPlexLS &psErr,  const MPlexLV& psPar,
       outPar[5 * N + n] = psPar[5 * N + n];
 
       {
-        const MPlexLS& A = psErr;
-              MPlexLS& B = outErr;
+        const MPlexLS_T<NN>& A = psErr;
+              MPlexLS_T<NN>& B = outErr;
 
         B.fArray[0 * N + n] = A.fArray[0 * N + n];
         B.fArray[1 * N + n] = A.fArray[1 * N + n];
@@ -77,63 +82,47 @@ void propagateLineToRMPlex(const MPlexLS &psErr,  const MPlexLV& psPar,
 namespace
 {
 
-void MultHelixProp(const MPlexLL& A, const MPlexLS& B, MPlexLL& C)
+// Patterns of the helix propagation jacobians to a cylinder and to a disk,
+// the same as in GenMPlexOps.pl for MultHelixProp.ah and
+// MultHelixPropEndcap.ah (those are still used by the CUDA kernels).
+namespace PropagationSparse
 {
-   // C = A * B
-
-   typedef float T;
-   const idx_t N  = NN;
-
-   const T *a = A.fArray; ASSUME_ALIGNED(a, 64);
-   const T *b = B.fArray; ASSUME_ALIGNED(b, 64);
-         T *c = C.fArray; ASSUME_ALIGNED(c, 64);
-
-#include "MultHelixProp.ah"
+  using namespace ::Matriplex::Sparse;
+
+  typedef Gen<6, 6, Pattern<X, X, O, X, X, O,
+                            X, X, O, X, X, O,
+                            X, X, I, X, X, X,
+                            X, X, O, X, X, O,
+                            X, X, O, X, X, O,
+                            O, O, O, O, O, I> > JacHelix;
+
+  typedef Gen<6, 6, Pattern<I, O, X, X, X, X,
+                            O, I, X, X, X, X,
+                            O, O, O, O, O, O,
+                            O, O, O, I, O, O,
+                            O, O, X, X, I, X,
+                            O, O, O, O, O, I> > JacHelixEndcap;
+
+  typedef Sym<6> ErrLS;
 }
 
-void MultHelixPropTransp(const MPlexLL& A, const MPlexLL& B, MPlexLS& C)
+// err = errorProp * err * errorPropT, in place.
+template<int NN>
+inline void SimilarityHelixProp(const MPlexLL_T<NN>& errorProp, MPlexLS_T<NN>& err)
 {
-   // C = B * AT;
-
-   typedef float T;
-   const idx_t N  = NN;
-
-   const T *a = A.fArray; ASSUME_ALIGNED(a, 64);
-   const T *b = B.fArray; ASSUME_ALIGNED(b, 64);
-         T *c = C.fArray; ASSUME_ALIGNED(c, 64);
-
-#include "MultHelixPropTransp.ah"
+   using namespace PropagationSparse;
+   Similarity<NN, JacHelix, ErrLS, ErrLS>(errorProp.fArray, err.fArray, err.fArray);
 }
 
-void MultHelixPropEndcap(const MPlexLL& A, const MPlexLS& B, MPlexLL& C)
+template<int NN>
+inline void SimilarityHelixPropEndcap(const MPlexLL_T<NN>& errorProp, MPlexLS_T<NN>& err)
 {
-   // C = A * B
-
-   typedef float T;
-   const idx_t N  = NN;
-
-   const T *a = A.fArray; ASSUME_ALIGNED(a, 64);
-   const T *b = B.fArray; ASSUME_ALIGNED(b, 64);
-         T *c = C.fArray; ASSUME_ALIGNED(c, 64);
-
-#include "MultHelixPropEndcap.ah"
+   using namespace PropagationSparse;
+   Similarity<NN, JacHelixEndcap, ErrLS, ErrLS>(errorProp.fArray, err.fArray, err.fArray);
 }
 
-void MultHelixPropTranspEndcap(const MPlexLL& A, const MPlexLL& B, MPlexLS& C)
-{
-   // C = B * AT;
-
-   typedef float T;
-   const idx_t N  = NN;
-
-   const T *a = A.fArray; ASSUME_ALIGNED(a, 64);
-   const T *b = B.fArray; ASSUME_ALIGNED(b, 64);
-         T *c = C.fArray; ASSUME_ALIGNED(c, 64);
-
-#include "MultHelixPropTranspEndcap.ah"
-}
-
-inline void MultHelixPropTemp(const MPlexLL& A, const MPlexLL& B, MPlexLL& C, int n)
+template<int NN>
+inline void MultHelixPropTemp(const MPlexLL_T<NN>& A, const MPlexLL_T<NN>& B, MPlexLL_T<NN>& C, int n)
 {
    // C = A * B
 
@@ -183,7 +172,8 @@ inline void MultHelixPropTemp(const MPlexLL& A, const MPlexLL& B, MPlexLL& C, in
 }
 
 // this version does not assume to know which elements are 0 or 1, so it does the full multiplication
-void MultHelixPropFull(const MPlexLL& A, const MPlexLS& B, MPlexLL& C)
+template<int NN>
+void MultHelixPropFull(const MPlexLL_T<NN>& A, const MPlexLS_T<NN>& B, MPlexLL_T<NN>& C)
 {
 #pragma simd
   for (int n = 0; n < NN; ++n)
@@ -198,7 +188,8 @@ void MultHelixPropFull(const MPlexLL& A, const MPlexLS& B, MPlexLL& C)
 }
 
 // this version does not assume to know which elements are 0 or 1, so it does the full multiplication
-void MultHelixPropFull(const MPlexLL& A, const MPlexLL& B, MPlexLL& C)
+template<int NN>
+void MultHelixPropFull(const MPlexLL_T<NN>& A, const MPlexLL_T<NN>& B, MPlexLL_T<NN>& C)
 {
 #pragma simd
   for (int n = 0; n < NN; ++n)
@@ -213,7 +204,8 @@ void MultHelixPropFull(const MPlexLL& A, const MPlexLL& B, MPlexLL& C)
 }
 
 // this version does not assume to know which elements are 0 or 1, so it does the full mupltiplication
-void MultHelixPropTranspFull(const MPlexLL& A, const MPlexLL& B, MPlexLS& C)
+template<int NN>
+void MultHelixPropTranspFull(const MPlexLL_T<NN>& A, const MPlexLL_T<NN>& B, MPlexLS_T<NN>& C)
 {
 #pragma simd
   for (int n = 0; n < NN; ++n)
@@ -228,7 +220,8 @@ void MultHelixPropTranspFull(const MPlexLL& A, const MPlexLL& B, MPlexLS& C)
 }
 
 // this version does not assume to know which elements are 0 or 1, so it does the full mupltiplication
-void MultHelixPropTranspFull(const MPlexLL& A, const MPlexLL& B, MPlexLL& C)
+template<int NN>
+void MultHelixPropTranspFull(const MPlexLL_T<NN>& A, const MPlexLL_T<NN>& B, MPlexLL_T<NN>& C)
 {
 #pragma simd
   for (int n = 0; n < NN; ++n)
@@ -244,13 +237,14 @@ void MultHelixPropTranspFull(const MPlexLL& A, const MPlexLL& B, MPlexLL& C)
 
 } // end unnamed namespace
 
-void helixAtRFromIterativeCCSFullJac(const MPlexLV& inPar, const MPlexQI& inChg, MPlexLV& outPar,
-                                     const MPlexQF &msRad,       MPlexLL& errorProp,
+template<int NN>
+void helixAtRFromIterativeCCSFullJac(const MPlexLV_T<NN>& inPar, const MPlexQI_T<NN>& inChg, MPlexLV_T<NN>& outPar,
+                                     const MPlexQF_T<NN> &msRad,       MPlexLL_T<NN>& errorProp,
                                      const int      N_proc)
 {
   errorProp.SetVal(0.f);
-  MPlexLL errorPropTmp(0.f);//initialize to zero
-  MPlexLL errorPropSwap(0.f);//initialize to zero
+  MPlexLL_T<NN> errorPropTmp(0.f);//initialize to zero
+  MPlexLL_T<NN> errorPropSwap(0.f);//initialize to zero
 
 #pragma simd
   for (int n = 0; n < NN; ++n)
@@ -288,8 +282,9 @@ void helixAtRFromIterativeCCSFullJac(const MPlexLV& inPar, const MPlexQI& inChg,
 
       float cosa = 0., sina = 0.;
       //no trig approx here, phi and theta can be large
-            float cosP = std::cos(phiin), sinP = std::sin(phiin);
-      const float cosT = std::cos(theta), sinT = std::sin(theta);
+      float cosP, sinP, cosT, sinT;
+      VecMath::sincos(phiin, sinP, cosP);
+      VecMath::sincos(theta, sinT, cosT);
       float pxin = cosP/ipt;
       float pyin = sinP/ipt;
 
@@ -306,8 +301,7 @@ void helixAtRFromIterativeCCSFullJac(const MPlexLV& inPar, const MPlexQI& inChg,
 	if (Config::useTrigApprox) {
 	  sincos4(ialpha, sina, cosa);
 	} else {
-	  cosa=std::cos(ialpha);
-	  sina=std::sin(ialpha);
+	  VecMath::sincos(ialpha, sina, cosa);
 	}
 
 	//derivatives of alpha
@@ -323,8 +317,7 @@ void helixAtRFromIterativeCCSFullJac(const MPlexLV& inPar, const MPlexQI& inChg,
 
 	//need phi at origin, so this goes before redefining phi
 	//no trig approx here, phi can be large
-	cosP=std::cos(outPar.At(n, 4, 0));
-	sinP=std::sin(outPar.At(n, 4, 0));
+	VecMath::sincos(outPar.At(n, 4, 0), sinP, cosP);
 
 	outPar.At(n, 2, 0) = outPar.ConstAt(n, 2, 0) + k*ialpha*cosT/(ipt*sinT);
 	outPar.At(n, 3, 0) = ipt;
@@ -378,55 +371,153 @@ void helixAtRFromIterativeCCSFullJac(const MPlexLV& inPar, const MPlexQI& inChg,
 //#pragma omp declare simd simdlen(NN) notinbranch linear(n)
 #include "PropagationMPlex.icc"
 
-void helixAtRFromIterativeCCS(const MPlexLV& inPar, const MPlexQI& inChg, MPlexLV& outPar,
-                              const MPlexQF &msRad, MPlexLL& errorProp,
+// Bz at the start point of each slot: Config::Bfield, or with useParamBfield
+// the field map or the polynomial. Filled before the propagation loops so
+// that those do not branch on the field model.
+template<int NN>
+static inline void fieldAtStart(const MPlexLV_T<NN>& inPar, const bool useParamBfield,
+                                      MPlexQF_T<NN>& bField)
+{
+  if ( ! useParamBfield)
+  {
+    bField.SetVal(Config::Bfield);
+  }
+  else if (Config::useFieldMap)
+  {
+    const FieldMap &fmap = g_field_map;
+#pragma simd
+    for (int n = 0; n < NN; ++n) {
+      bField.At(n, 0, 0) = fmap.Bz(hipo(inPar.ConstAt(n, 0, 0), inPar.ConstAt(n, 1, 0)), inPar.ConstAt(n, 2, 0));
+    }
+  }
+  else
+  {
+#pragma simd
+    for (int n = 0; n < NN; ++n) {
+      bField.At(n, 0, 0) = Config::BfieldFromZR(inPar.ConstAt(n, 2, 0), hipo(inPar.ConstAt(n, 0, 0), inPar.ConstAt(n, 1, 0)));
+    }
+  }
+}
+
+template<int NN>
+void helixAtRFromIterativeCCS(const MPlexLV_T<NN>& inPar, const MPlexQI_T<NN>& inChg, MPlexLV_T<NN>& outPar,
+                              const MPlexQF_T<NN> &msRad, MPlexLL_T<NN>& errorProp,
                               const int      N_proc, const bool useParamBfield)
 {
   errorProp.SetVal(0.f);
      
-  helixAtRFromIterativeCCS_impl(inPar, inChg, outPar, msRad, errorProp, 0, NN, N_proc, useParamBfield);
+  MPlexQF_T<NN> bField;
+  fieldAtStart(inPar, useParamBfield, bField);
+
+  helixAtRFromIterativeCCS_impl(inPar, inChg, outPar, msRad, errorProp, 0, NN, N_proc, bField);
 }
 
 
-void helixAtRFromIterative(const MPlexLV& inPar, const MPlexQI& inChg, MPlexLV& outPar,
-                           const MPlexQF &msRad, MPlexLL& errorProp,
+template<int NN>
+void helixAtRFromIterative(const MPlexLV_T<NN>& inPar, const MPlexQI_T<NN>& inChg, MPlexLV_T<NN>& outPar,
+                           const MPlexQF_T<NN> &msRad, MPlexLL_T<NN>& errorProp,
                            const int      N_proc, const bool useParamBfield)
 {
   errorProp.SetVal(0.f);
 
-  helixAtRFromIterative_impl(inPar, inChg, outPar, msRad, errorProp, 0, NN, N_proc, useParamBfield);
+  MPlexQF_T<NN> bField;
+  fieldAtStart(inPar, useParamBfield, bField);
+
+  helixAtRFromIterative_impl(inPar, inChg, outPar, msRad, errorProp, 0, NN, N_proc, bField);
+}
+
+
+// Slots the closed form flagged as grazing r are propagated again with the
+// iterative version, see PropagationMPlex.icc.
+template<int NN, class Iterative>
+static inline void redoTangentSlots(const MPlexLV_T<NN>& inPar, MPlexLV_T<NN>& outPar,
+                                    MPlexLL_T<NN>& errorProp, const MPlexQF_T<NN>& tangent,
+                                    const int N_proc, Iterative iterative)
+{
+  for (int n = 0; n < N_proc; ++n)
+  {
+    if (tangent.ConstAt(n, 0, 0) == 0.f) continue;
+
+    for (int i = 0; i < 6; ++i)
+    {
+      outPar.At(n, i, 0) = inPar.ConstAt(n, i, 0);
+      for (int j = 0; j < 6; ++j) errorProp.At(n, i, j) = 0.f;
+    }
+    iterative(n);
+  }
+}
+
+template<int NN>
+void helixAtRAnalyticCCS(const MPlexLV_T<NN>& inPar, const MPlexQI_T<NN>& inChg, MPlexLV_T<NN>& outPar,
+                         const MPlexQF_T<NN> &msRad, MPlexLL_T<NN>& errorProp,
+                         const int      N_proc, const bool useParamBfield)
+{
+  MPlexQF_T<NN> bField;
+  fieldAtStart(inPar, useParamBfield, bField);
+
+  MPlexQF_T<NN> tangent;
+  helixAtRAnalyticCCS_impl(inPar, inChg, outPar, msRad, errorProp, tangent, 0, NN, N_proc, bField);
+
+  redoTangentSlots(inPar, outPar, errorProp, tangent, N_proc, [&](int n) {
+    helixAtRFromIterativeCCS_impl(inPar, inChg, outPar, msRad, errorProp, n, n + 1, N_proc, bField);
+  });
 }
 
 
-void applyMaterialEffects(const MPlexQF &hitsRl, const MPlexQF& hitsXi,
-                                MPlexLS &outErr,       MPlexLV& outPar,
-                         const int      N_proc)
+template<int NN>
+void helixAtRAnalytic(const MPlexLV_T<NN>& inPar, const MPlexQI_T<NN>& inChg, MPlexLV_T<NN>& outPar,
+                      const MPlexQF_T<NN> &msRad, MPlexLL_T<NN>& errorProp,
+                      const int      N_proc, const bool useParamBfield)
+{
+  MPlexQF_T<NN> bField;
+  fieldAtStart(inPar, useParamBfield, bField);
+
+  MPlexQF_T<NN> tangent;
+  helixAtRAnalytic_impl(inPar, inChg, outPar, msRad, errorProp, tangent, 0, NN, N_proc, bField);
+
+  redoTangentSlots(inPar, outPar, errorProp, tangent, N_proc, [&](int n) {
+    helixAtRFromIterative_impl(inPar, inChg, outPar, msRad, errorProp, n, n + 1, N_proc, bField);
+  });
+}
+
+
+namespace
+{
+// endcap is 1 for propagation to disks, 0 for cylinders. A float, gcc does not
+// vectorize selects on a scalar bool in a loop this big.
+template<int NN>
+void applyMaterialEffectsImpl(const MPlexQF_T<NN>& __restrict__ hitsRl, const MPlexQF_T<NN>& __restrict__ hitsXi,
+                                    MPlexLS_T<NN>& __restrict__ outErr,       MPlexLV_T<NN>& __restrict__ outPar,
+                              const int      N_proc, const float endcap)
 {
 #pragma simd
   for (int n = 0; n < NN; ++n)
     {
 #ifdef CCSCOORD
 
-      float radL = hitsRl.ConstAt(n,0,0);
-      if (radL<0.0000000000001f) continue;//ugly, please fixme
+      // Slots without material get zero updates, no branch so the loop vectorizes.
+      const bool noMat = hitsRl.ConstAt(n,0,0) < 0.0000000000001f;
+      float radL = noMat ? 1.f : hitsRl.ConstAt(n,0,0);
       const float x = outPar.ConstAt(n,0,0);
       const float y = outPar.ConstAt(n,0,1);
       const float theta = outPar.ConstAt(n,0,5);
       const float r = std::sqrt(x*x+y*y);
       const float pt = 1.f/outPar.ConstAt(n,0,3);
-      const float p = pt/std::sin(theta);
+      float sinT, cosT;
+      VecMath::sincos(theta, sinT, cosT);
+      const float p = pt/sinT;
       const float p2 = p*p;
       constexpr float mpi = 0.140; // m=140 MeV, pion
       constexpr float mpi2 = mpi*mpi; // m=140 MeV, pion
       const float beta2 = p2/(p2+mpi2);
       const float beta = std::sqrt(beta2);
       //radiation lenght, corrected for the crossing angle (cos alpha from dot product of radius vector and momentum)
-      const float invCos = Config::endcapTest ? 1./std::abs(std::cos(theta)) : p/pt;
+      const float invCos = endcap > 0.f ? 1.f/std::abs(cosT) : p/pt;
       radL = radL * invCos; //fixme works only for barrel geom
       // multiple scattering
       //vary independently phi and theta by the rms of the planar multiple scattering angle
-      const float thetaMSC = 0.0136f*std::sqrt(radL)*(1.f+0.038f*std::log(radL))/(beta*p);// eq 32.15
-      const float thetaMSC2 = thetaMSC*thetaMSC;
+      const float thetaMSC = 0.0136f*std::sqrt(radL)*(1.f+0.038f*VecMath::log(radL))/(beta*p);// eq 32.15
+      const float thetaMSC2 = noMat ? 0.f : thetaMSC*thetaMSC;
       outErr.At(n, 4, 4) += thetaMSC2;
       outErr.At(n, 5, 5) += thetaMSC2;
       //std::cout << "beta=" << beta << " p=" << p << std::endl;
@@ -437,17 +528,18 @@ void applyMaterialEffects(const MPlexQF &hitsRl, const MPlexQF& hitsXi,
       constexpr float me = 0.0005; // m=0.5 MeV, electron
       const float wmax = 2.f*me*beta2*gamma2 / ( 1.f + 2.f*gamma*me/mpi + me*me/(mpi*mpi) );
       constexpr float I = 16.0e-9 * 10.75;
-      const float deltahalf = std::log(28.816e-9f * std::sqrt(2.33f*0.498f)/I) + std::log(beta*gamma) - 0.5f;
-      const float dEdx = beta<1.f ? (2.f*(hitsXi.ConstAt(n,0,0) * invCos * (0.5f*std::log(2.f*me*beta2*gamma2*wmax/(I*I)) - beta2 - deltahalf) / beta2)) : 0.f;//protect against infs and nans
+      const float deltahalf = std::log(28.816e-9f * std::sqrt(2.33f*0.498f)/I) + VecMath::log(beta*gamma) - 0.5f;
+      const float dEdx = beta<1.f ? (2.f*(hitsXi.ConstAt(n,0,0) * invCos * (0.5f*VecMath::log(2.f*me*beta2*gamma2*wmax/(I*I)) - beta2 - deltahalf) / beta2)) : 0.f;//protect against infs and nans
       // dEdx = dEdx*2.;//xi in cmssw is defined with an extra factor 0.5 with respect to formula 27.1 in pdg
       //std::cout << "dEdx=" << dEdx << " delta=" << deltahalf << " wmax=" << wmax << " Xi=" << hitsXi.ConstAt(n,0,0) << std::endl;
-      const float dP = dEdx/beta;
-      outPar.At(n, 0, 3) = p/((p+dP)*pt);
+      const float dP = noMat ? 0.f : dEdx/beta;
+      outPar.At(n, 0, 3) = noMat ? outPar.ConstAt(n, 0, 3) : p/((p+dP)*pt);
       //assume 100% uncertainty
       outErr.At(n, 3, 3) += dP*dP/(p2*pt*pt);
 #else
-      float radL = hitsRl.ConstAt(n,0,0);
-      if (radL<0.0000000000001f) continue;//ugly, please fixme
+      // Slots without material get zero updates, no branch so the loop vectorizes.
+      const bool noMat = hitsRl.ConstAt(n,0,0) < 0.0000000000001f;
+      float radL = noMat ? 1.f : hitsRl.ConstAt(n,0,0);
       const float& x = outPar.ConstAt(n,0,0);
       const float& y = outPar.ConstAt(n,0,1);
       const float& px = outPar.ConstAt(n,0,3);
@@ -474,8 +566,8 @@ void applyMaterialEffects(const MPlexQF &hitsRl, const MPlexQF& hitsXi,
       // py' = py - (px*p*theta1 - pz*py*theta2)/pt;
       // pz' = pz + pt*theta2;
       // this actually changes |p| so that p'^2 = p^2(1+2thetaMSC^2) so we should renormalize everything but we neglect this effect here (we are just inflating uncertainties a bit)
-      const float thetaMSC = 0.0136f*std::sqrt(radL)*(1.f+0.038f*std::log(radL))/(beta*p);// eq 32.15
-      const float thetaMSC2 = thetaMSC*thetaMSC;
+      const float thetaMSC = 0.0136f*std::sqrt(radL)*(1.f+0.038f*VecMath::log(radL))/(beta*p);// eq 32.15
+      const float thetaMSC2 = noMat ? 0.f : thetaMSC*thetaMSC;
       const float thetaMSC2overPt2 = thetaMSC2/(pt*pt);
       outErr.At(n, 3, 3) += (py*py*p*p + pz*pz*px*px)*thetaMSC2overPt2;
       outErr.At(n, 4, 4) += (px*px*p*p + pz*pz*py*py)*thetaMSC2overPt2;
@@ -491,11 +583,11 @@ void applyMaterialEffects(const MPlexQF &hitsRl, const MPlexQF& hitsXi,
       constexpr float me = 0.0005; // m=0.5 MeV, electron
       const float wmax = 2.f*me*beta2*gamma2 / ( 1.f + 2.f*gamma*me/mpi + me*me/(mpi*mpi) );
       constexpr float I = 16.0e-9f * 10.75f;
-      const float deltahalf = std::log(28.816e-9f * std::sqrt(2.33f*0.498f)/I) + std::log(beta*gamma) - 0.5f;
-      const float dEdx = 2.f*(hitsXi.ConstAt(n,0,0) * invCos * (0.5f*std::log(2*me*beta2*gamma2*wmax/(I*I)) - beta2 - deltahalf) / beta2) ;
+      const float deltahalf = std::log(28.816e-9f * std::sqrt(2.33f*0.498f)/I) + VecMath::log(beta*gamma) - 0.5f;
+      const float dEdx = 2.f*(hitsXi.ConstAt(n,0,0) * invCos * (0.5f*VecMath::log(2*me*beta2*gamma2*wmax/(I*I)) - beta2 - deltahalf) / beta2) ;
       //dEdx = dEdx*2.f;//xi in cmssw is defined with an extra factor 0.5 with respect to formula 27.1 in pdg
       // std::cout << "dEdx=" << dEdx << " delta=" << deltahalf << std::endl;
-      float dP = dEdx/beta;
+      float dP = noMat ? 0.f : dEdx/beta;
       outPar.At(n, 0, 3) -= dP*px/p;
       outPar.At(n, 0, 4) -= dP*py/p;
       outPar.At(n, 0, 5) -= dP*pz/p;
@@ -513,10 +605,20 @@ void applyMaterialEffects(const MPlexQF &hitsRl, const MPlexQF& hitsXi,
     }
 
 }
+}
+
+template<int NN>
+void applyMaterialEffects(const MPlexQF_T<NN>& hitsRl, const MPlexQF_T<NN>& hitsXi,
+                                MPlexLS_T<NN>& outErr,       MPlexLV_T<NN>& outPar,
+                          const int      N_proc)
+{
+  applyMaterialEffectsImpl(hitsRl, hitsXi, outErr, outPar, N_proc, Config::endcapTest ? 1.f : 0.f);
+}
 
-void propagateHelixToRMPlex(const MPlexLS &inErr,  const MPlexLV& inPar,
-                            const MPlexQI &inChg,  const MPlexHV& msPar, 
-			          MPlexLS &outErr,       MPlexLV& outPar,
+template<int NN>
+void propagateHelixToRMPlex(const MPlexLS_T<NN> &inErr,  const MPlexLV_T<NN>& inPar,
+                            const MPlexQI_T<NN> &inChg,  const MPlexHV_T<NN>& msPar, 
+			          MPlexLS_T<NN> &outErr,       MPlexLV_T<NN>& outPar,
                             const int      N_proc, const bool useParamBfield)
 {
    const idx_t N  = NN;
@@ -524,9 +626,9 @@ void propagateHelixToRMPlex(const MPlexLS &inErr,  const MPlexLV& inPar,
    outErr = inErr;
    outPar = inPar;
 
-   MPlexLL errorProp;
+   MPlexLL_T<NN> errorProp;
 
-   MPlexQF msRad;
+   MPlexQF_T<NN> msRad;
    // MPlexQF hitsRl;
    // MPlexQF hitsXi;
 #pragma simd
@@ -539,9 +641,15 @@ void propagateHelixToRMPlex(const MPlexLS &inErr,  const MPlexLV& inPar,
    }
 
 #ifdef CCSCOORD
-   helixAtRFromIterativeCCS(inPar, inChg, outPar, msRad, errorProp, N_proc, useParamBfield);
+   if (Config::useAnalyticHelixAtR)
+     helixAtRAnalyticCCS(inPar, inChg, outPar, msRad, errorProp, N_proc, useParamBfield);
+   else
+     helixAtRFromIterativeCCS(inPar, inChg, outPar, msRad, errorProp, N_proc, useParamBfield);
 #else
-   helixAtRFromIterative(inPar, inChg, outPar, msRad, errorProp, N_proc, useParamBfield);
+   if (Config::useAnalyticHelixAtR)
+     helixAtRAnalytic(inPar, inChg, outPar, msRad, errorProp, N_proc, useParamBfield);
+   else
+     helixAtRFromIterative(inPar, inChg, outPar, msRad, errorProp, N_proc, useParamBfield);
 #endif
 
 #ifdef DEBUG
@@ -564,9 +672,7 @@ void propagateHelixToRMPlex(const MPlexLS &inErr,  const MPlexLV& inPar,
 
    // Matriplex version of:
    // result.errors = ROOT::Math::Similarity(errorProp, outErr);
-   MPlexLL temp;
-   MultHelixProp      (errorProp, outErr, temp);
-   MultHelixPropTransp(errorProp, temp,   outErr);
+   SimilarityHelixProp(errorProp, outErr);
 
    // if (Config::useCMSGeom) {
    //   applyMaterialEffects(hitsRl, hitsXi, outErr, outPar);
@@ -596,48 +702,372 @@ void propagateHelixToRMPlex(const MPlexLS &inErr,  const MPlexLV& inPar,
 #endif
 }
 
-void propagateHelixToRMPlex(const MPlexLS& inErr,  const MPlexLV& inPar,
-                            const MPlexQI& inChg,  const float    r,
-                            MPlexLS&       outErr, MPlexLV&       outPar,
-                            const int      N_proc)
+//==============================================================================
+// Hit search window
+//==============================================================================
+
+namespace
 {
-   outErr = inErr;
-   outPar = inPar;
+// Window size limits, copied from Config once per call so that the slot
+// loops do not reload them.
+struct HitWindowLimits
+{
+  const float minDZ   = Config::minDZ;
+  const float minDPhi = Config::minDPhi;
+  const float maxDZ   = Config::m_max_dz;
+  const float maxDPhi = Config::m_max_dphi;
+};
+
+// Window for one slot: nSigma times the position errors around the state, at
+// least Config::minDZ / minDPhi, at most Config::m_max_dz / m_max_dphi. With
+// CMS geometry dphi is widened for the bending over the layer thickness.
+template<bool CMSGeom>
+inline void hitWindowAtR(const float x,   const float y,   const float z,
+                         const float p3,  const float p4,
+                         const float e00, const float e01, const float e11, const float e22,
+                         const HitWindowLimits &lim,
+                         float &wz, float &wphi, float &wdz, float &wdphi)
+{
+  const float nSigmaPhi = 3;
+  const float nSigmaZ   = 3;
+
+  const float r2 = x*x + y*y;
+
+  const float phi = VecMath::atan2(y, x);
+  float       dz  = nSigmaZ * std::sqrt(e22);
+
+  const float dphidx = -y/r2, dphidy = x/r2;
+  const float dphi2  = dphidx * dphidx * e00 +
+                       dphidy * dphidy * e11 +
+                   2 * dphidx * dphidy * e01;
+
+#ifdef HARD_CHECK
+  assert(dphi2 >= 0);
+#endif
+
+  float dphi = nSigmaPhi * std::sqrt(std::abs(dphi2));
+
+  if (std::abs(dphi)<lim.minDPhi) dphi = lim.minDPhi;
+  if (std::abs(dz)<lim.minDZ) dz = lim.minDZ;
 
-   MPlexLL errorProp;
+  if (CMSGeom)
+  {
+    //now correct for bending and for layer thickness unsing linear approximation
+    const float deltaR = Config::cmsDeltaRad; //fixme! using constant value, to be taken from layer properties
+    const float r  = std::sqrt(r2);
+#ifdef CCSCOORD
+    //here alpha is the difference between posPhi and momPhi
+    const float alpha = phi - p4;
+    float cosA, sinA;
+    if (Config::useTrigApprox) {
+      sincos4(alpha, sinA, cosA);
+    } else {
+      VecMath::sincos<VecMath::Fast>(alpha, sinA, cosA);
+    }
+#else
+    const float pt = std::sqrt(p3*p3 + p4*p4);
+    //here alpha is the difference between posPhi and momPhi
+    const float cosA = ( x*p3 + y*p4 ) / (pt*r);
+    const float sinA = ( y*p3 - x*p4 ) / (pt*r);
+#endif
+    //take abs so that we always inflate the window
+    const float dist = std::abs(deltaR*sinA/cosA);
+    dphi += dist / r;
+  }
 
+  if (std::abs(dz)   > lim.maxDZ)   dz   = lim.maxDZ;
+  if (std::abs(dphi) > lim.maxDPhi) dphi = lim.maxDPhi;
+
+  wz = z; wphi = phi; wdz = dz; wdphi = dphi;
+}
+
+template<int NN, bool CMSGeom>
+void computeHitWindowImpl(const MPlexLS_T<NN>& err, const MPlexLV_T<NN>& par,
+                                HitWindowMPlex<NN>& win)
+{
+  const HitWindowLimits lim;
 
-   MPlexQF msRad;
 #pragma simd
-   for (int n = 0; n < NN; ++n) {
-     msRad.At(n, 0, 0) = r;
-   }
+  for (int n = 0; n < NN; ++n)
+  {
+    hitWindowAtR<CMSGeom>(par.ConstAt(n, 0, 0), par.ConstAt(n, 1, 0), par.ConstAt(n, 2, 0),
+                          par.ConstAt(n, 3, 0), par.ConstAt(n, 4, 0),
+                          err.ConstAt(n, 0, 0), err.ConstAt(n, 0, 1),
+                          err.ConstAt(n, 1, 1), err.ConstAt(n, 2, 2), lim,
+                          win.z.At(n, 0, 0), win.phi.At(n, 0, 0),
+                          win.dz.At(n, 0, 0), win.dphi.At(n, 0, 0));
+  }
+}
+
+// outErr = errorProp * inErr * errorPropT and the hit window at outPar, in
+// one loop over the slots. The similarity is SimilarityHelixProp done per
+// slot, the product and the propagated errors stay in registers and outErr
+// is written once.
+template<idx_t N, bool CMSGeom>
+void propagateErrAndHitWindowImpl(const float *__restrict__ a, const float *__restrict__ b,
+                                        float *__restrict__ c, const float *__restrict__ p,
+                                        float *__restrict__ wz,    float *__restrict__ wphi,
+                                        float *__restrict__ wdz,   float *__restrict__ wdphi)
+{
+  using namespace PropagationSparse;
+
+  ASSUME_ALIGNED(a, 64);
+  ASSUME_ALIGNED(b, 64);
+  ASSUME_ALIGNED(c, 64);
+  ASSUME_ALIGNED(p, 64);
+
+  const HitWindowLimits lim;
+
+#pragma simd
+  for (idx_t n = 0; n < N; ++n)
+  {
+    float jac[36], err[21], res[21];
+    LoadSlot<N, 36>(a + n, jac);
+    LoadSlot<N, 21>(b + n, err);
+
+    Similarity<1, JacHelix, ErrLS, ErrLS>(jac, err, res);
+
+    StoreSlot<N, 21>(res, c + n);
+
+    hitWindowAtR<CMSGeom>(p[0 * N + n], p[1 * N + n], p[2 * N + n], p[3 * N + n], p[4 * N + n],
+                          res[0], res[1], res[2], res[5], lim,
+                          wz[n], wphi[n], wdz[n], wdphi[n]);
+  }
+}
 
+template<int NN>
+void propagateErrAndHitWindow(const MPlexLL_T<NN>& errorProp, const MPlexLS_T<NN>& inErr,
+                                    MPlexLS_T<NN>& outErr,    const MPlexLV_T<NN>& outPar,
+                                    HitWindowMPlex<NN>& win)
+{
+  auto kernel = Config::useCMSGeom ? propagateErrAndHitWindowImpl<NN, true>
+                                   : propagateErrAndHitWindowImpl<NN, false>;
+
+  kernel(errorProp.fArray, inErr.fArray, outErr.fArray, outPar.fArray,
+         win.z.fArray, win.phi.fArray, win.dz.fArray, win.dphi.fArray);
+}
+}
+
+template<int NN>
+void computeHitWindowMPlex(const MPlexLS_T<NN>& err, const MPlexLV_T<NN>& par,
+                                 HitWindowMPlex<NN>& win,
+                           const int      N_proc)
+{
+  if (Config::useCMSGeom)
+    computeHitWindowImpl<NN, true> (err, par, win);
+  else
+    computeHitWindowImpl<NN, false>(err, par, win);
+}
+
+namespace
+{
+// Disk window for one slot: nSigma times the position errors around the
+// state in r and phi, dphi at least Config::minDPhi and at most
+// Config::m_max_dphi. With CMS geometry dphi is widened for the bending over
+// the layer thickness.
+template<bool CMSGeom>
+inline void hitWindowAtZ(const float x,   const float y,
+                         const float p3,  const float p5,  const int chg,
+                         const float e00, const float e01, const float e11,
+                         const HitWindowLimits &lim,
+                         float &wr, float &wphi, float &wdr, float &wdphi)
+{
+  const float nSigmaPhi = 3;
+  const float nSigmaR   = 3;
+
+  const float r2 = x*x + y*y;
+  const float r  = std::sqrt(r2);
+
+  const float phi = VecMath::atan2(y, x);
+  const float dr  = nSigmaR*(x*x*e00 + y*y*e11 + 2*x*y*e01)/r2;
+
+  const float dphidx = -y/r2, dphidy = x/r2;
+  const float dphi2  = dphidx * dphidx * e00 +
+                       dphidy * dphidy * e11 +
+                   2 * dphidx * dphidy * e01;
+
+#ifdef HARD_CHECK
+  assert(dphi2 >= 0);
+#endif
+
+  float dphi = nSigmaPhi * std::sqrt(std::abs(dphi2));
+
+  if (std::abs(dphi)<lim.minDPhi) dphi = lim.minDPhi;
+
+  if (CMSGeom)
+  {
+    //now correct for bending and for layer thickness unsing linear approximation
+    const float deltaZ = 5; //fixme! using constant value, to be taken from layer properties
+    const float k = chg * 100.f / (-Config::sol*Config::Bfield);
 #ifdef CCSCOORD
-   helixAtRFromIterativeCCS(inPar, inChg, outPar, msRad, errorProp, N_proc);
+    float cosT, sinT;
+    VecMath::sincos<VecMath::Fast>(p5, sinT, cosT);
+    //here alpha is the helix angular path corresponding to deltaZ
+    const float alpha  = deltaZ*sinT*p3/(cosT*k);
 #else
-   helixAtRFromIterative(inPar, inChg, outPar, msRad, errorProp, N_proc);
+    //here alpha is the helix angular path corresponding to deltaZ, z moves by k*alpha*pz
+    const float alpha  = deltaZ/(p5*k);
+#endif
+    dphi += std::abs(alpha);
+  }
+
+  if (std::abs(dphi) > lim.maxDPhi) dphi = lim.maxDPhi;
+
+  wr = r; wphi = phi; wdr = dr; wdphi = dphi;
+}
+
+template<int NN, bool CMSGeom>
+void computeDiskHitWindowImpl(const MPlexLS_T<NN>& err, const MPlexLV_T<NN>& par,
+                              const MPlexQI_T<NN>& chg, DiskHitWindowMPlex<NN>& win)
+{
+  const HitWindowLimits lim;
+
+#pragma simd
+  for (int n = 0; n < NN; ++n)
+  {
+    hitWindowAtZ<CMSGeom>(par.ConstAt(n, 0, 0), par.ConstAt(n, 1, 0),
+                          par.ConstAt(n, 3, 0), par.ConstAt(n, 5, 0), chg.ConstAt(n, 0, 0),
+                          err.ConstAt(n, 0, 0), err.ConstAt(n, 0, 1), err.ConstAt(n, 1, 1), lim,
+                          win.r.At(n, 0, 0), win.phi.At(n, 0, 0),
+                          win.dr.At(n, 0, 0), win.dphi.At(n, 0, 0));
+  }
+}
+
+// outErr = errorProp * inErr * errorPropT (+ d) and the disk hit window at
+// outPar, in one loop over the slots, as propagateErrAndHitWindowImpl() for
+// the barrel. d holds the material effects that propagation to a disk adds
+// after the similarity, see propagateHelixToZsMPlex().
+template<idx_t N, bool CMSGeom, bool AddErr>
+void propagateErrAndDiskHitWindowImpl(const float *__restrict__ a, const float *__restrict__ b,
+                                      const float *__restrict__ d,
+                                            float *__restrict__ c, const float *__restrict__ p,
+                                      const int   *__restrict__ q,
+                                            float *__restrict__ wr,    float *__restrict__ wphi,
+                                            float *__restrict__ wdr,   float *__restrict__ wdphi)
+{
+  using namespace PropagationSparse;
+
+  ASSUME_ALIGNED(a, 64);
+  ASSUME_ALIGNED(b, 64);
+  ASSUME_ALIGNED(c, 64);
+  ASSUME_ALIGNED(p, 64);
+
+  const HitWindowLimits lim;
+
+#pragma simd
+  for (idx_t n = 0; n < N; ++n)
+  {
+    float jac[36], err[21], res[21];
+    LoadSlot<N, 36>(a + n, jac);
+    LoadSlot<N, 21>(b + n, err);
+
+    Similarity<1, JacHelixEndcap, ErrLS, ErrLS>(jac, err, res);
+
+    if (AddErr)
+    {
+      for (int i = 0; i < 21; ++i) res[i] += d[i * N + n];
+    }
+
+    StoreSlot<N, 21>(res, c + n);
+
+    hitWindowAtZ<CMSGeom>(p[0 * N + n], p[1 * N + n], p[3 * N + n], p[5 * N + n], q[n],
+                          res[0], res[1], res[2], lim,
+                          wr[n], wphi[n], wdr[n], wdphi[n]);
+  }
+}
+
+template<int NN>
+void propagateErrAndDiskHitWindow(const MPlexLL_T<NN>& errorProp, const MPlexLS_T<NN>& inErr,
+                                  const MPlexLS_T<NN>* addErr,
+                                        MPlexLS_T<NN>& outErr,    const MPlexLV_T<NN>& outPar,
+                                  const MPlexQI_T<NN>& chg,       DiskHitWindowMPlex<NN>& win)
+{
+  auto kernel = Config::useCMSGeom ?
+    (addErr ? propagateErrAndDiskHitWindowImpl<NN, true,  true> : propagateErrAndDiskHitWindowImpl<NN, true,  false>) :
+    (addErr ? propagateErrAndDiskHitWindowImpl<NN, false, true> : propagateErrAndDiskHitWindowImpl<NN, false, false>);
+
+  kernel(errorProp.fArray, inErr.fArray, addErr ? addErr->fArray : nullptr,
+         outErr.fArray, outPar.fArray, chg.fArray,
+         win.r.fArray, win.phi.fArray, win.dr.fArray, win.dphi.fArray);
+}
+}
+
+template<int NN>
+void computeDiskHitWindowMPlex(const MPlexLS_T<NN>& err, const MPlexLV_T<NN>& par,
+                               const MPlexQI_T<NN>& chg,
+                                     DiskHitWindowMPlex<NN>& win,
+                               const int      N_proc)
+{
+  if (Config::useCMSGeom)
+    computeDiskHitWindowImpl<NN, true> (err, par, chg, win);
+  else
+    computeDiskHitWindowImpl<NN, false>(err, par, chg, win);
+}
+
+namespace
+{
+// Propagation to a cylinder of radius msRad per slot, with material effects
+// for CMS geometry. endcap is passed on to applyMaterialEffectsImpl(). If win
+// is given the hit window is computed along with the error propagation.
+template<int NN>
+void propagateHelixToRadiiMPlex(const MPlexLS_T<NN>& inErr,  const MPlexLV_T<NN>& inPar,
+                                const MPlexQI_T<NN>& inChg,  const MPlexQF_T<NN>& msRad,
+                                MPlexLS_T<NN>&       outErr, MPlexLV_T<NN>&       outPar,
+                                const int      N_proc, const float endcap,
+                                HitWindowMPlex<NN>  *win = nullptr)
+{
+   // The fused error propagation reads inErr, or its copy with material
+   // effects applied, and writes outErr once.
+   MPlexLS_T<NN>  matErr;
+   MPlexLS_T<NN> &propErr = win ? matErr : outErr;
+
+   if (Config::useCMSGeom || ! win) propErr = inErr;
+   outPar = inPar;
+
+   MPlexLL_T<NN> errorProp;
+
+#ifdef CCSCOORD
+   if (Config::useAnalyticHelixAtR)
+     helixAtRAnalyticCCS(inPar, inChg, outPar, msRad, errorProp, N_proc);
+   else
+     helixAtRFromIterativeCCS(inPar, inChg, outPar, msRad, errorProp, N_proc);
+#else
+   if (Config::useAnalyticHelixAtR)
+     helixAtRAnalytic(inPar, inChg, outPar, msRad, errorProp, N_proc);
+   else
+     helixAtRFromIterative(inPar, inChg, outPar, msRad, errorProp, N_proc);
 #endif
 
    //add multiple scattering uncertainty and energy loss (FIXME: in this way it is not applied in track fit)
    if (Config::useCMSGeom) {
-     MPlexQF hitsRl;
-     MPlexQF hitsXi;
+     MPlexQF_T<NN> hitsRl;
+     MPlexQF_T<NN> hitsXi;
+     MPlexQI_T<NN> matBin;
+     const MaterialMap &mmap = g_material_map;
+     // Bins and loads in separate loops, the fused one does not vectorize.
 #pragma simd
      for (int n = 0; n < NN; ++n) {
-       hitsRl.At(n, 0, 0) = getRlVal(r, outPar.ConstAt(n, 2, 0));
-       hitsXi.At(n, 0, 0) = getXiVal(r, outPar.ConstAt(n, 2, 0));
+       matBin.At(n, 0, 0) = mmap.Bin(msRad.ConstAt(n, 0, 0), outPar.ConstAt(n, 2, 0));
      }
-     applyMaterialEffects(hitsRl, hitsXi, outErr, outPar, N_proc);
+#pragma simd
+     for (int n = 0; n < NN; ++n) {
+       hitsRl.At(n, 0, 0) = mmap.Rl(matBin.ConstAt(n, 0, 0));
+       hitsXi.At(n, 0, 0) = mmap.Xi(matBin.ConstAt(n, 0, 0));
+     }
+     applyMaterialEffectsImpl(hitsRl, hitsXi, propErr, outPar, N_proc, endcap);
    }
 
-   // Matriplex version of:
-   // result.errors = ROOT::Math::Similarity(errorProp, outErr);
-
-   //MultHelixProp can be optimized for CCS coordinates, see GenMPlexOps.pl
-   MPlexLL temp;
-   MultHelixProp      (errorProp, outErr, temp);
-   MultHelixPropTransp(errorProp, temp,   outErr);
+   if (win)
+   {
+     propagateErrAndHitWindow(errorProp, Config::useCMSGeom ? propErr : inErr,
+                              outErr, outPar, *win);
+   }
+   else
+   {
+     // Matriplex version of:
+     // result.errors = ROOT::Math::Similarity(errorProp, outErr);
+     SimilarityHelixProp(errorProp, outErr);
+   }
 
    // This dump is now out of its place as similarity is done with matriplex ops.
 #ifdef DEBUG
@@ -665,10 +1095,45 @@ void propagateHelixToRMPlex(const MPlexLS& inErr,  const MPlexLV& inPar,
      }
    */
 }
+}
+
+template<int NN>
+void propagateHelixToRMPlex(const MPlexLS_T<NN>& inErr,  const MPlexLV_T<NN>& inPar,
+                            const MPlexQI_T<NN>& inChg,  const float    r,
+                            MPlexLS_T<NN>&       outErr, MPlexLV_T<NN>&       outPar,
+                            const int      N_proc)
+{
+   MPlexQF_T<NN> msRad;
+#pragma simd
+   for (int n = 0; n < NN; ++n) {
+     msRad.At(n, 0, 0) = r;
+   }
+
+   propagateHelixToRadiiMPlex(inErr, inPar, inChg, msRad, outErr, outPar, N_proc,
+                              Config::endcapTest ? 1.f : 0.f);
+}
 
-void propagateHelixToZMPlex(const MPlexLS &inErr,  const MPlexLV& inPar,
-                            const MPlexQI &inChg,  const MPlexHV& msPar,
-			          MPlexLS &outErr,       MPlexLV& outPar,
+template<int NN>
+void propagateHelixToRMPlex(const MPlexLS_T<NN>& inErr,  const MPlexLV_T<NN>& inPar,
+                            const MPlexQI_T<NN>& inChg,  const float    r,
+                            MPlexLS_T<NN>&       outErr, MPlexLV_T<NN>&       outPar,
+                            HitWindowMPlex<NN>&  win,
+                            const int      N_proc)
+{
+   MPlexQF_T<NN> msRad;
+#pragma simd
+   for (int n = 0; n < NN; ++n) {
+     msRad.At(n, 0, 0) = r;
+   }
+
+   propagateHelixToRadiiMPlex(inErr, inPar, inChg, msRad, outErr, outPar, N_proc,
+                              Config::endcapTest ? 1.f : 0.f, &win);
+}
+
+template<int NN>
+void propagateHelixToZMPlex(const MPlexLS_T<NN> &inErr,  const MPlexLV_T<NN>& inPar,
+                            const MPlexQI_T<NN> &inChg,  const MPlexHV_T<NN>& msPar,
+			          MPlexLS_T<NN> &outErr,       MPlexLV_T<NN>& outPar,
                             const int      N_proc, const bool useParamBfield)
 {
    const idx_t N  = NN;
@@ -676,9 +1141,9 @@ void propagateHelixToZMPlex(const MPlexLS &inErr,  const MPlexLV& inPar,
    outErr = inErr;
    outPar = inPar;
 
-   MPlexLL errorProp;
+   MPlexLL_T<NN> errorProp;
 
-   MPlexQF msZ;
+   MPlexQF_T<NN> msZ;
    // MPlexQF msRad;
    // MPlexQF hitsRl;
    // MPlexQF hitsXi;
@@ -714,9 +1179,7 @@ void propagateHelixToZMPlex(const MPlexLS &inErr,  const MPlexLV& inPar,
 
    // Matriplex version of:
    // result.errors = ROOT::Math::Similarity(errorProp, outErr);
-   MPlexLL temp;
-   MultHelixPropEndcap      (errorProp, outErr, temp);
-   MultHelixPropTranspEndcap(errorProp, temp,   outErr);
+   SimilarityHelixPropEndcap(errorProp, outErr);
 
    // if (Config::useCMSGeom || Config::readCmsswSeeds) {
    //   applyMaterialEffects(hitsRl, hitsXi, outErr, outPar, N_proc);
@@ -747,35 +1210,42 @@ void propagateHelixToZMPlex(const MPlexLS &inErr,  const MPlexLV& inPar,
 }
 
 
-void propagateHelixToZMPlex(const MPlexLS &inErr,  const MPlexLV& inPar,
-                            const MPlexQI &inChg,  const float z,
-			          MPlexLS &outErr,       MPlexLV& outPar,
-                            const int      N_proc)
+namespace
+{
+// Propagation to a disk at msZ per slot, with material effects for CMS
+// geometry. endcap is passed on to applyMaterialEffectsImpl(). If win is
+// given the disk hit window is computed along with the error propagation.
+template<int NN>
+void propagateHelixToZsMPlex(const MPlexLS_T<NN> &inErr,  const MPlexLV_T<NN>& inPar,
+                             const MPlexQI_T<NN> &inChg,  const MPlexQF_T<NN>& msZ,
+			           MPlexLS_T<NN> &outErr,       MPlexLV_T<NN>& outPar,
+                             const int      N_proc, const float endcap,
+                             DiskHitWindowMPlex<NN> *win = nullptr)
 {
    const idx_t N  = NN;
 
-   outErr = inErr;
+   if ( ! win) outErr = inErr;
    outPar = inPar;
 
-   MPlexLL errorProp;
-
-   MPlexQF msZ;
-#pragma simd
-   for (int n = 0; n < NN; ++n) {
-     msZ.At(n, 0, 0) = (inPar.ConstAt(n, 2, 0) > 0) ? z : -z;
-   }
+   MPlexLL_T<NN> errorProp;
 
    helixAtZ(inPar, inChg, outPar, msZ, errorProp, N_proc);
 
-     MPlexQF msRad;
-     MPlexQF hitsRl;
-     MPlexQF hitsXi;
+     MPlexQF_T<NN> msRad;
+     MPlexQF_T<NN> hitsRl;
+     MPlexQF_T<NN> hitsXi;
      if (Config::useCMSGeom || Config::readCmsswSeeds) {
+       MPlexQI_T<NN> matBin;
+       const MaterialMap &mmap = g_material_map;
 #pragma simd
        for (int n = 0; n < NN; ++n) {
 	 msRad.At(n, 0, 0) = hipo(outPar.ConstAt(n, 0, 0), outPar.ConstAt(n, 1, 0));
-	 hitsRl.At(n, 0, 0) = getRlVal(msRad.ConstAt(n, 0, 0), z);
-	 hitsXi.At(n, 0, 0) = getXiVal(msRad.ConstAt(n, 0, 0), z);
+	 matBin.At(n, 0, 0) = mmap.Bin(msRad.ConstAt(n, 0, 0), msZ.ConstAt(n, 0, 0));
+       }
+#pragma simd
+       for (int n = 0; n < NN; ++n) {
+	 hitsRl.At(n, 0, 0) = mmap.Rl(matBin.ConstAt(n, 0, 0));
+	 hitsXi.At(n, 0, 0) = mmap.Xi(matBin.ConstAt(n, 0, 0));
        }
      }
 
@@ -797,14 +1267,29 @@ void propagateHelixToZMPlex(const MPlexLS &inErr,  const MPlexLV& inPar,
    }
 #endif
 
-   // Matriplex version of:
-   // result.errors = ROOT::Math::Similarity(errorProp, outErr);
-   MPlexLL temp;
-   MultHelixPropEndcap      (errorProp, outErr, temp);
-   MultHelixPropTranspEndcap(errorProp, temp,   outErr);
+   if (win)
+   {
+     // Material effects only add to the propagated errors, collect them in
+     // matErr for the fused loop to add after the similarity. The window then
+     // sees the parameters after the energy loss, as without the fusion.
+     const bool material = Config::useCMSGeom || Config::readCmsswSeeds;
+     MPlexLS_T<NN> matErr;
+     if (material) {
+       matErr.SetVal(0.f);
+       applyMaterialEffectsImpl(hitsRl, hitsXi, matErr, outPar, N_proc, endcap);
+     }
+     propagateErrAndDiskHitWindow(errorProp, inErr, material ? &matErr : nullptr,
+                                  outErr, outPar, inChg, *win);
+   }
+   else
+   {
+     // Matriplex version of:
+     // result.errors = ROOT::Math::Similarity(errorProp, outErr);
+     SimilarityHelixPropEndcap(errorProp, outErr);
 
-   if (Config::useCMSGeom || Config::readCmsswSeeds) {
-     applyMaterialEffects(hitsRl, hitsXi, outErr, outPar, N_proc);
+     if (Config::useCMSGeom || Config::readCmsswSeeds) {
+       applyMaterialEffectsImpl(hitsRl, hitsXi, outErr, outPar, N_proc, endcap);
+     }
    }
 
    // This dump is now out of its place as similarity is done with matriplex ops.
@@ -830,14 +1315,130 @@ void propagateHelixToZMPlex(const MPlexLS &inErr,  const MPlexLV& inPar,
    }
 #endif
 }
+}
 
+template<int NN>
+void propagateHelixToZMPlex(const MPlexLS_T<NN> &inErr,  const MPlexLV_T<NN>& inPar,
+                            const MPlexQI_T<NN> &inChg,  const float z,
+			          MPlexLS_T<NN> &outErr,       MPlexLV_T<NN>& outPar,
+                            const int      N_proc)
+{
+   MPlexQF_T<NN> msZ;
+#pragma simd
+   for (int n = 0; n < NN; ++n) {
+     msZ.At(n, 0, 0) = (inPar.ConstAt(n, 2, 0) > 0) ? z : -z;
+   }
+
+   propagateHelixToZsMPlex(inErr, inPar, inChg, msZ, outErr, outPar, N_proc,
+                           Config::endcapTest ? 1.f : 0.f);
+}
 
-void helixAtZ(const MPlexLV& inPar, const MPlexQI& inChg, MPlexLV& outPar,
-	      const MPlexQF &msZ, MPlexLL& errorProp,
+template<int NN>
+void propagateHelixToZMPlex(const MPlexLS_T<NN> &inErr,  const MPlexLV_T<NN>& inPar,
+                            const MPlexQI_T<NN> &inChg,  const float z,
+			          MPlexLS_T<NN> &outErr,       MPlexLV_T<NN>& outPar,
+                                  DiskHitWindowMPlex<NN>& win,
+                            const int      N_proc)
+{
+   MPlexQF_T<NN> msZ;
+#pragma simd
+   for (int n = 0; n < NN; ++n) {
+     msZ.At(n, 0, 0) = (inPar.ConstAt(n, 2, 0) > 0) ? z : -z;
+   }
+
+   propagateHelixToZsMPlex(inErr, inPar, inChg, msZ, outErr, outPar, N_proc,
+                           Config::endcapTest ? 1.f : 0.f, &win);
+}
+
+//==============================================================================
+// propagateHelixToSurfaceMPlex
+//==============================================================================
+
+namespace
+{
+template<int NN>
+void propagateHelixToSurfaceImpl(const MPlexLS_T<NN>& inErr,  const MPlexLV_T<NN>& inPar,
+                                 const MPlexQI_T<NN>& inChg,
+                                 const MPlexQI_T<NN>& isDisk, const MPlexQF_T<NN>& target,
+                                       MPlexLS_T<NN>& outErr,       MPlexLV_T<NN>& outPar,
+                                 const int      N_proc,
+                                 HitWindowMPlex<NN> *win, DiskHitWindowMPlex<NN> *winDisk)
+{
+  int n_disk = 0;
+  for (int n = 0; n < N_proc; ++n)
+  {
+    n_disk += isDisk.ConstAt(n, 0, 0) != 0;
+  }
+
+  // Slots of the other kind stay where they are in each pass, zero step.
+  MPlexQF_T<NN> msRad;
+  MPlexQF_T<NN> msZ;
+#pragma simd
+  for (int n = 0; n < NN; ++n)
+  {
+    const bool  disk = isDisk.ConstAt(n, 0, 0) != 0;
+    const float z    = inPar.ConstAt(n, 2, 0);
+    const float tgt  = target.ConstAt(n, 0, 0);
+    msRad.At(n, 0, 0) = disk ? hipo(inPar.ConstAt(n, 0, 0), inPar.ConstAt(n, 1, 0)) : tgt;
+    msZ  .At(n, 0, 0) = disk ? (z > 0 ? tgt : -tgt) : z;
+  }
+
+  // Each pass fills its own window, only the slots of its kind use it.
+  if (n_disk == 0)
+  {
+    propagateHelixToRadiiMPlex(inErr, inPar, inChg, msRad, outErr, outPar, N_proc, 0.f, win);
+  }
+  else if (n_disk == N_proc)
+  {
+    propagateHelixToZsMPlex(inErr, inPar, inChg, msZ, outErr, outPar, N_proc, 1.f, winDisk);
+  }
+  else
+  {
+    MPlexLS_T<NN> errZ;
+    MPlexLV_T<NN> parZ;
+    propagateHelixToRadiiMPlex(inErr, inPar, inChg, msRad, outErr, outPar, N_proc, 0.f, win);
+    propagateHelixToZsMPlex   (inErr, inPar, inChg, msZ,   errZ,   parZ,   N_proc, 1.f, winDisk);
+    outErr.Blend(errZ, isDisk.fArray);
+    outPar.Blend(parZ, isDisk.fArray);
+  }
+}
+}
+
+template<int NN>
+void propagateHelixToSurfaceMPlex(const MPlexLS_T<NN>& inErr,  const MPlexLV_T<NN>& inPar,
+                                  const MPlexQI_T<NN>& inChg,
+                                  const MPlexQI_T<NN>& isDisk, const MPlexQF_T<NN>& target,
+                                        MPlexLS_T<NN>& outErr,       MPlexLV_T<NN>& outPar,
+                                  const int      N_proc)
+{
+  propagateHelixToSurfaceImpl<NN>(inErr, inPar, inChg, isDisk, target, outErr, outPar, N_proc,
+                                  nullptr, nullptr);
+}
+
+template<int NN>
+void propagateHelixToSurfaceMPlex(const MPlexLS_T<NN>& inErr,  const MPlexLV_T<NN>& inPar,
+                                  const MPlexQI_T<NN>& inChg,
+                                  const MPlexQI_T<NN>& isDisk, const MPlexQF_T<NN>& target,
+                                        MPlexLS_T<NN>& outErr,       MPlexLV_T<NN>& outPar,
+                                        HitWindowMPlex<NN>& win, DiskHitWindowMPlex<NN>& winDisk,
+                                  const int      N_proc)
+{
+  propagateHelixToSurfaceImpl(inErr, inPar, inChg, isDisk, target, outErr, outPar, N_proc,
+                              &win, &winDisk);
+}
+
+//==============================================================================
+
+template<int NN>
+void helixAtZ(const MPlexLV_T<NN>& inPar, const MPlexQI_T<NN>& inChg, MPlexLV_T<NN>& outPar,
+	      const MPlexQF_T<NN> &msZ, MPlexLL_T<NN>& errorProp,
 	      const int      N_proc, const bool useParamBfield)
 {
   errorProp.SetVal(0.f);
 
+  MPlexQF_T<NN> bField;
+  fieldAtStart(inPar, useParamBfield, bField);
+
 #pragma simd
   for (int n = 0; n < NN; ++n)
     {
@@ -857,7 +1458,7 @@ void helixAtZ(const MPlexLV& inPar, const MPlexQI& inChg, MPlexLV& outPar,
       const float phiin = inPar.ConstAt(n, 4, 0);
       const float theta = inPar.ConstAt(n, 5, 0);
 
-      const float k = inChg.ConstAt(n, 0, 0) * 100.f / (-Config::sol*(useParamBfield?Config::BfieldFromZR(zin,hipo(inPar.ConstAt(n,0,0),inPar.ConstAt(n,1,0))):Config::Bfield));
+      const float k = inChg.ConstAt(n, 0, 0) * 100.f / (-Config::sol*bField.ConstAt(n, 0, 0));
 
       dprint_np(n, std::endl << "input parameters"
             << " inPar.ConstAt(n, 0, 0)=" << std::setprecision(9) << inPar.ConstAt(n, 0, 0)
@@ -873,8 +1474,9 @@ void helixAtZ(const MPlexLV& inPar, const MPlexQI& inChg, MPlexLV& outPar,
 
       float D = 0., cosa = 0., sina = 0., id = 0.;
       //no trig approx here, phi can be large
-      float cosP = std::cos(phiin), sinP = std::sin(phiin);
-      float cosT = std::cos(theta), sinT = std::sin(theta);
+      float cosP, sinP, cosT, sinT;
+      VecMath::sincos(phiin, sinP, cosP);
+      VecMath::sincos(theta, sinT, cosT);
       const float pxin = cosP*pt;
       const float pyin = sinP*pt;
 
@@ -889,8 +1491,7 @@ void helixAtZ(const MPlexLV& inPar, const MPlexQI& inChg, MPlexLV& outPar,
       if (Config::useTrigApprox) {
 	sincos4(alpha, sina, cosa);
       } else {
-	cosa=std::cos(alpha);
-	sina=std::sin(alpha);
+	VecMath::sincos(alpha, sina, cosa);
       }
 
       //update parameters
@@ -935,3 +1536,57 @@ void helixAtZ(const MPlexLV& inPar, const MPlexQI& inChg, MPlexLV& outPar,
 #endif
     }
 }
+
+//==============================================================================
+// Explicit instantiations, see MPLEX_FOR_EACH_WIDTH in Matrix.h
+//==============================================================================
+
+#define INSTANTIATE_PROPAGATION_MPLEX(W) \
+  template void propagateLineToRMPlex<W>(const MPlexLS_T<W>&, const MPlexLV_T<W>&, \
+                                         const MPlexHS_T<W>&, const MPlexHV_T<W>&, \
+                                         MPlexLS_T<W>&, MPlexLV_T<W>&, const int); \
+  template void propagateHelixToRMPlex<W>(const MPlexLS_T<W>&, const MPlexLV_T<W>&, \
+                                          const MPlexQI_T<W>&, const MPlexHV_T<W>&, \
+                                          MPlexLS_T<W>&, MPlexLV_T<W>&, const int, const bool); \
+  template void propagateHelixToRMPlex<W>(const MPlexLS_T<W>&, const MPlexLV_T<W>&, \
+                                          const MPlexQI_T<W>&, const float, \
+                                          MPlexLS_T<W>&, MPlexLV_T<W>&, const int); \
+  template void propagateHelixToRMPlex<W>(const MPlexLS_T<W>&, const MPlexLV_T<W>&, \
+                                          const MPlexQI_T<W>&, const float, \
+                                          MPlexLS_T<W>&, MPlexLV_T<W>&, HitWindowMPlex<W>&, const int); \
+  template void computeHitWindowMPlex<W>(const MPlexLS_T<W>&, const MPlexLV_T<W>&, \
+                                         HitWindowMPlex<W>&, const int); \
+  template void helixAtRFromIterativeCCSFullJac<W>(const MPlexLV_T<W>&, const MPlexQI_T<W>&, MPlexLV_T<W>&, \
+                                                   const MPlexQF_T<W>&, MPlexLL_T<W>&, const int); \
+  template void helixAtRFromIterativeCCS<W>(const MPlexLV_T<W>&, const MPlexQI_T<W>&, MPlexLV_T<W>&, \
+                                            const MPlexQF_T<W>&, MPlexLL_T<W>&, const int, const bool); \
+  template void helixAtRFromIterative<W>(const MPlexLV_T<W>&, const MPlexQI_T<W>&, MPlexLV_T<W>&, \
+                                         const MPlexQF_T<W>&, MPlexLL_T<W>&, const int, const bool); \
+  template void helixAtRAnalyticCCS<W>(const MPlexLV_T<W>&, const MPlexQI_T<W>&, MPlexLV_T<W>&, \
+                                       const MPlexQF_T<W>&, MPlexLL_T<W>&, const int, const bool); \
+  template void helixAtRAnalytic<W>(const MPlexLV_T<W>&, const MPlexQI_T<W>&, MPlexLV_T<W>&, \
+                                    const MPlexQF_T<W>&, MPlexLL_T<W>&, const int, const bool); \
+  template void propagateHelixToZMPlex<W>(const MPlexLS_T<W>&, const MPlexLV_T<W>&, \
+                                          const MPlexQI_T<W>&, const MPlexHV_T<W>&, \
+                                          MPlexLS_T<W>&, MPlexLV_T<W>&, const int, const bool); \
+  template void propagateHelixToZMPlex<W>(const MPlexLS_T<W>&, const MPlexLV_T<W>&, \
+                                          const MPlexQI_T<W>&, const float, \
+                                          MPlexLS_T<W>&, MPlexLV_T<W>&, const int); \
+  template void propagateHelixToZMPlex<W>(const MPlexLS_T<W>&, const MPlexLV_T<W>&, \
+                                          const MPlexQI_T<W>&, const float, \
+                                          MPlexLS_T<W>&, MPlexLV_T<W>&, DiskHitWindowMPlex<W>&, const int); \
+  template void computeDiskHitWindowMPlex<W>(const MPlexLS_T<W>&, const MPlexLV_T<W>&, const MPlexQI_T<W>&, \
+                                             DiskHitWindowMPlex<W>&, const int); \
+  template void propagateHelixToSurfaceMPlex<W>(const MPlexLS_T<W>&, const MPlexLV_T<W>&, \
+                                                const MPlexQI_T<W>&, const MPlexQI_T<W>&, const MPlexQF_T<W>&, \
+                                                MPlexLS_T<W>&, MPlexLV_T<W>&, const int); \
+  template void propagateHelixToSurfaceMPlex<W>(const MPlexLS_T<W>&, const MPlexLV_T<W>&, \
+                                                const MPlexQI_T<W>&, const MPlexQI_T<W>&, const MPlexQF_T<W>&, \
+                                                MPlexLS_T<W>&, MPlexLV_T<W>&, \
+                                                HitWindowMPlex<W>&, DiskHitWindowMPlex<W>&, const int); \
+  template void helixAtZ<W>(const MPlexLV_T<W>&, const MPlexQI_T<W>&, MPlexLV_T<W>&, \
+                            const MPlexQF_T<W>&, MPlexLL_T<W>&, const int, const bool); \
+  template void applyMaterialEffects<W>(const MPlexQF_T<W>&, const MPlexQF_T<W>&, \
+                                        MPlexLS_T<W>&, MPlexLV_T<W>&, const int);
+
+MPLEX_FOR_EACH_KERNEL_WIDTH(INSTANTIATE_PROPAGATION_MPLEX)
@@ -4,55 +4,149 @@
 #include "Track.h"
 #include "Matrix.h"
 
-void propagateLineToRMPlex(const MPlexLS &psErr,  const MPlexLV& psPar,
-                           const MPlexHS &msErr,  const MPlexHV& msPar,
-                                 MPlexLS &outErr,       MPlexLV& outPar,
+// Templated on plex width, instantiated for MPLEX_FOR_EACH_WIDTH (Matrix.h).
+
+template<int NN>
+void propagateLineToRMPlex(const MPlexLS_T<NN> &psErr,  const MPlexLV_T<NN>& psPar,
+                           const MPlexHS_T<NN> &msErr,  const MPlexHV_T<NN>& msPar,
+                                 MPlexLS_T<NN> &outErr,       MPlexLV_T<NN>& outPar,
                            const int      N_proc);
 
-void propagateHelixToRMPlex(const MPlexLS &inErr,  const MPlexLV& inPar,
-                            const MPlexQI &inChg,  const MPlexHV& msPar,
-			          MPlexLS &outErr,       MPlexLV& outPar,
+template<int NN>
+void propagateHelixToRMPlex(const MPlexLS_T<NN> &inErr,  const MPlexLV_T<NN>& inPar,
+                            const MPlexQI_T<NN> &inChg,  const MPlexHV_T<NN>& msPar,
+			          MPlexLS_T<NN> &outErr,       MPlexLV_T<NN>& outPar,
                             const int      N_proc, const bool useParamBfield = false);
 
-void propagateHelixToRMPlex(const MPlexLS& inErr,  const MPlexLV& inPar,
-                            const MPlexQI& inChg,  const float    r,
-			          MPlexLS& outErr,       MPlexLV& outPar,
+template<int NN>
+void propagateHelixToRMPlex(const MPlexLS_T<NN>& inErr,  const MPlexLV_T<NN>& inPar,
+                            const MPlexQI_T<NN>& inChg,  const float    r,
+			          MPlexLS_T<NN>& outErr,       MPlexLV_T<NN>& outPar,
+                            const int      N_proc);
+
+// Hit search window around states on a cylinder: z and phi of the state and
+// their half widths, as used by MkFitter::SelectHitIndices().
+template<int NN>
+struct HitWindowMPlex
+{
+  MPlexQF_T<NN> z, phi, dz, dphi;
+};
+
+// As above, with the error propagation and the hit window computation done in
+// one pass over the slots, see PropagationMPlex.cc.
+template<int NN>
+void propagateHelixToRMPlex(const MPlexLS_T<NN>& inErr,  const MPlexLV_T<NN>& inPar,
+                            const MPlexQI_T<NN>& inChg,  const float    r,
+			          MPlexLS_T<NN>& outErr,       MPlexLV_T<NN>& outPar,
+                                  HitWindowMPlex<NN>& win,
                             const int      N_proc);
 
-void helixAtRFromIterativeCCSFullJac(const MPlexLV& inPar, const MPlexQI& inChg,
-                                           MPlexLV& outPar, const MPlexQF &msRad,
-                                           MPlexLL& errorProp,
+// Hit window for states that were not propagated by the above.
+template<int NN>
+void computeHitWindowMPlex(const MPlexLS_T<NN>& err, const MPlexLV_T<NN>& par,
+                                 HitWindowMPlex<NN>& win,
+                           const int      N_proc);
+
+template<int NN>
+void helixAtRFromIterativeCCSFullJac(const MPlexLV_T<NN>& inPar, const MPlexQI_T<NN>& inChg,
+                                           MPlexLV_T<NN>& outPar, const MPlexQF_T<NN> &msRad,
+                                           MPlexLL_T<NN>& errorProp,
                                      const int      N_proc);
 
-void helixAtRFromIterativeCCS(const MPlexLV& inPar, const MPlexQI& inChg,
-                                    MPlexLV& outPar, const MPlexQF &msRad,
-                                    MPlexLL& errorProp,
+template<int NN>
+void helixAtRFromIterativeCCS(const MPlexLV_T<NN>& inPar, const MPlexQI_T<NN>& inChg,
+                                    MPlexLV_T<NN>& outPar, const MPlexQF_T<NN> &msRad,
+                                    MPlexLL_T<NN>& errorProp,
                               const int      N_proc, const bool useParamBfield = false);
 
-void helixAtRFromIterative(const MPlexLV& inPar, const MPlexQI& inChg, 
-			         MPlexLV& outPar, const MPlexQF &msRad, 
-			         MPlexLL& errorProp, bool useSimpleJac,
+template<int NN>
+void helixAtRFromIterative(const MPlexLV_T<NN>& inPar, const MPlexQI_T<NN>& inChg, 
+			         MPlexLV_T<NN>& outPar, const MPlexQF_T<NN> &msRad, 
+			         MPlexLL_T<NN>& errorProp,
                            const int      N_proc, const bool useParamBfield = false);
 
-void propagateHelixToZMPlex(const MPlexLS &inErr,  const MPlexLV& inPar,
-                            const MPlexQI &inChg,  const MPlexHV& msPar,
-			          MPlexLS &outErr,       MPlexLV& outPar,
+// Closed-form counterparts of the two above, see PropagationMPlex.icc.
+template<int NN>
+void helixAtRAnalyticCCS(const MPlexLV_T<NN>& inPar, const MPlexQI_T<NN>& inChg,
+                               MPlexLV_T<NN>& outPar, const MPlexQF_T<NN> &msRad,
+                               MPlexLL_T<NN>& errorProp,
+                         const int      N_proc, const bool useParamBfield = false);
+
+template<int NN>
+void helixAtRAnalytic(const MPlexLV_T<NN>& inPar, const MPlexQI_T<NN>& inChg,
+                            MPlexLV_T<NN>& outPar, const MPlexQF_T<NN> &msRad,
+                            MPlexLL_T<NN>& errorProp,
+                      const int      N_proc, const bool useParamBfield = false);
+
+template<int NN>
+void propagateHelixToZMPlex(const MPlexLS_T<NN> &inErr,  const MPlexLV_T<NN>& inPar,
+                            const MPlexQI_T<NN> &inChg,  const MPlexHV_T<NN>& msPar,
+			          MPlexLS_T<NN> &outErr,       MPlexLV_T<NN>& outPar,
                             const int      N_proc, const bool useParamBfield = false);
 
-void propagateHelixToZMPlex(const MPlexLS &inErr,  const MPlexLV& inPar,
-                            const MPlexQI &inChg,  const float    z,
-			          MPlexLS &outErr,       MPlexLV& outPar,
+template<int NN>
+void propagateHelixToZMPlex(const MPlexLS_T<NN> &inErr,  const MPlexLV_T<NN>& inPar,
+                            const MPlexQI_T<NN> &inChg,  const float    z,
+			          MPlexLS_T<NN> &outErr,       MPlexLV_T<NN>& outPar,
+                            const int      N_proc);
+
+// Hit search window around states on a disk: r and phi of the state and
+// their half widths, as used by MkFitter::SelectHitIndicesEndcap().
+template<int NN>
+struct DiskHitWindowMPlex
+{
+  MPlexQF_T<NN> r, phi, dr, dphi;
+};
+
+// As above, with the error propagation and the disk hit window computation
+// done in one pass over the slots, see PropagationMPlex.cc.
+template<int NN>
+void propagateHelixToZMPlex(const MPlexLS_T<NN> &inErr,  const MPlexLV_T<NN>& inPar,
+                            const MPlexQI_T<NN> &inChg,  const float    z,
+			          MPlexLS_T<NN> &outErr,       MPlexLV_T<NN>& outPar,
+                                  DiskHitWindowMPlex<NN>& win,
                             const int      N_proc);
 
-void helixAtZ(const MPlexLV& inPar,  const MPlexQI& inChg,
-	            MPlexLV& outPar, const MPlexQF &msZ,
-	            MPlexLL& errorProp,
+// Disk hit window for states that were not propagated by the above.
+template<int NN>
+void computeDiskHitWindowMPlex(const MPlexLS_T<NN>& err, const MPlexLV_T<NN>& par,
+                               const MPlexQI_T<NN>& chg,
+                                     DiskHitWindowMPlex<NN>& win,
+                               const int      N_proc);
+
+// Per slot target: cylinder of radius target (isDisk == 0) or disk at
+// |z| = target on the side of the track (isDisk != 0). Mixed plexes run both
+// propagations and take each slot from the matching one, uniform ones only one.
+template<int NN>
+void propagateHelixToSurfaceMPlex(const MPlexLS_T<NN>& inErr,  const MPlexLV_T<NN>& inPar,
+                                  const MPlexQI_T<NN>& inChg,
+                                  const MPlexQI_T<NN>& isDisk, const MPlexQF_T<NN>& target,
+                                        MPlexLS_T<NN>& outErr,       MPlexLV_T<NN>& outPar,
+                                  const int      N_proc);
+
+// As above, with the barrel window of the cylinder slots in win and the disk
+// window of the disk slots in winDisk computed along with the propagation.
+template<int NN>
+void propagateHelixToSurfaceMPlex(const MPlexLS_T<NN>& inErr,  const MPlexLV_T<NN>& inPar,
+                                  const MPlexQI_T<NN>& inChg,
+                                  const MPlexQI_T<NN>& isDisk, const MPlexQF_T<NN>& target,
+                                        MPlexLS_T<NN>& outErr,       MPlexLV_T<NN>& outPar,
+                                        HitWindowMPlex<NN>& win, DiskHitWindowMPlex<NN>& winDisk,
+                                  const int      N_proc);
+
+template<int NN>
+void helixAtZ(const MPlexLV_T<NN>& inPar,  const MPlexQI_T<NN>& inChg,
+	            MPlexLV_T<NN>& outPar, const MPlexQF_T<NN> &msZ,
+	            MPlexLL_T<NN>& errorProp,
 	      const int      N_proc, const bool useParamBfield = false);
 
-void applyMaterialEffects(const MPlexQF &hitsRl, const MPlexQF& hitsXi, 
-                                MPlexLS &outErr, MPlexLV& outPar,
+template<int NN>
+void applyMaterialEffects(const MPlexQF_T<NN> &hitsRl, const MPlexQF_T<NN>& hitsXi, 
+                                MPlexLS_T<NN> &outErr, MPlexLV_T<NN>& outPar,
                           const int      N_proc);
 
+// Material parametrization, propagation looks it up through the binned
+// MaterialMap (MaterialMap.h) that is filled from these two.
 inline float getRlVal(const float r, const float zin) {
   float z = std::abs(zin);
   //pixel barrel
@@ -14,6 +14,10 @@
 
 #define BLOCK_SIZE_X 256
 
+// Config::chi2Cut is a host variable, set at run time; the GPU does not do
+// the cms geometry yet and keeps the toy default.
+constexpr float tmp_chi2Cut = 15.;
+
 
 __device__ void getNewBestHitChi2_fn(
     const GPlexQI &XHitSize, const GPlexHitIdx &XHitArr,
@@ -155,7 +159,7 @@ __device__ void bestHit_fn(
 
   /*int itrack = threadIdx.x + blockDim.x*blockIdx.x;*/
   int bestHit_reg = -1;
-  float minChi2_reg = Config::chi2Cut;
+  float minChi2_reg = tmp_chi2Cut;
 
   if (itrack < N)
     HitsIdx[itrack] = 0;
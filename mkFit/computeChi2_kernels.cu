@@ -11,6 +11,7 @@
 #define HV 3
 #define BLOCK_SIZE_X 256
 
+#include "MathMPlex.h"
 #include "KalmanUtilsMPlex.icc"
 
 __device__ void chi2Similarity_fn(
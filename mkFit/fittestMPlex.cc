@@ -25,6 +25,7 @@
 
 #include <iostream>
 #include <memory>
+#include <random>
 
 #if defined(USE_VTUNE_PAUSE)
 #include "ittnotify.h"
@@ -106,23 +107,22 @@ void make_validation_tree(const char         *fname,
 #include "Pool.h"
 namespace
 {
-  struct ExecutionContext
+  // One pool of fitters per plex width; the width is picked at run time
+  // from Config::fitVecWidth.
+  template<int NN>
+  Pool<MkFitterT<NN>>& fitter_pool()
   {
-    Pool<MkFitter>   m_fitters;
-
-    void populate(int n_thr)
-    {
-      m_fitters.populate(n_thr - m_fitters.size());
-    }
-  };
-
-  ExecutionContext g_exe_ctx;
-  auto retfitr = [](MkFitter*   mkfp  ) { g_exe_ctx.m_fitters.ReturnToPool(mkfp);   };
-}
+    static Pool<MkFitterT<NN>> s_fitters;
+    return s_fitters;
+  }
 
-double runFittingTestPlex(Event& ev, std::vector<Track>& rectracks)
+template<int NN>
+double runFittingTestPlexImpl(Event& ev, std::vector<Track>& rectracks)
 {
-   g_exe_ctx.populate(Config::numThreadsFinder);
+   Pool<MkFitterT<NN>> &pool = fitter_pool<NN>();
+   pool.populate(Config::numThreadsFinder - pool.size());
+   auto retfitr = [&pool](MkFitterT<NN>* mkfp) { pool.ReturnToPool(mkfp); };
+
    std::vector<Track>& simtracks = ev.simTracks_;
 
    const int Nhits = Config::nLayers;
@@ -144,7 +144,7 @@ double runFittingTestPlex(Event& ev, std::vector<Track>& rectracks)
    tbb::parallel_for(tbb::blocked_range<int>(0, count, std::max(1, Config::numSeedsPerTask/NN)),
      [&](const tbb::blocked_range<int>& i)
    {
-     std::unique_ptr<MkFitter, decltype(retfitr)> mkfp(g_exe_ctx.m_fitters.GetFromPool(), retfitr);
+     std::unique_ptr<MkFitterT<NN>, decltype(retfitr)> mkfp(pool.GetFromPool(), retfitr);
      mkfp->SetNhits(Nhits);
      for (int it = i.begin(); it < i.end(); ++it)
      {
@@ -159,12 +159,8 @@ double runFittingTestPlex(Event& ev, std::vector<Track>& rectracks)
 	  }
 	  mkfp->FitTracksTestEndcap(end - itrack, &ev, true);
 	} else {
-	  if (theEnd < end) {
-	    end = theEnd;
-	    mkfp->InputTracksAndHits(simtracks, ev.layerHits_, itrack, end);
-	  } else {
-	    mkfp->SlurpInTracksAndHits(simtracks, ev.layerHits_, itrack, end); // only safe for a full matriplex
-	  }
+	  if (theEnd < end) end = theEnd;
+	  mkfp->SlurpInTracksAndHits(simtracks, ev.layerHits_, itrack, end);
 	  
 	  if (Config::cf_fitting) mkfp->ConformalFitTracks(true, itrack, end);
 	  mkfp->FitTracks(end - itrack, &ev, true);
@@ -184,6 +180,104 @@ double runFittingTestPlex(Event& ev, std::vector<Track>& rectracks)
    return time;
 }
 
+//==============================================================================
+// runMixedKernelCheck
+//==============================================================================
+
+template<int NN>
+int runMixedKernelCheckImpl(Event& ev)
+{
+   Pool<MkFitterT<NN>> &pool = fitter_pool<NN>();
+   pool.populate(1 - pool.size());
+   auto retfitr = [&pool](MkFitterT<NN>* mkfp) { pool.ReturnToPool(mkfp); };
+   std::unique_ptr<MkFitterT<NN>, decltype(retfitr)> mkfp(pool.GetFromPool(), retfitr);
+
+   std::vector<Track>& simtracks = ev.simTracks_;
+   const int n_tracks = simtracks.size();
+   const int lay      = std::min(3, Config::nLayers - 1);
+   const int lay_disk = 0;
+
+   // Barrel: the simulated hits of layer lay. Disk: the z plane of the first
+   // layer with a hit next to where each track crosses it, so that most slots
+   // pick one up.
+   LayerOfHits barrel, disk;
+   barrel.SetupLayer(-Config::g_layer_zwidth[lay], Config::g_layer_zwidth[lay], Config::g_layer_dz[lay]);
+   barrel.SuckInHits(ev.layerHits_[lay]);
+
+   std::vector<Track> at_disk(simtracks);
+   // Disk extends to the outermost barrel layer, tracks crossing the plane
+   // beyond it (or not at all) get no hit.
+   HitVec disk_hits;
+   const float disk_rmax = ev.geom_.Radius(Config::nLayers - 1);
+   for (int itrack = 0; itrack < n_tracks; itrack += NN)
+   {
+     const int end = std::min(itrack + NN, n_tracks);
+     mkfp->SetNhits(0);
+     mkfp->InputTracksAndHits(simtracks, ev.layerHits_, itrack, end);
+     for (int i = 0; i < end - itrack; ++i) mkfp->SetTarget(i, ev.geom_, lay_disk, true);
+     mkfp->PropagateTracksToTargets(end - itrack);
+     mkfp->OutputPropagatedTracks(at_disk, itrack, end);
+   }
+   for (int i = 0; i < n_tracks; ++i)
+   {
+     const Track &t = at_disk[i];
+     if ( ! (std::hypot(t.x(), t.y()) < disk_rmax) || ! std::isfinite(t.z())) continue;
+     const float d = 0.001f * ((i % 7) - 3);
+     SMatrixSym33 err;
+     err(0,0) = err(1,1) = 1e-4f; err(2,2) = 1e-6f;
+     disk_hits.emplace_back(SVector3(t.x() + d, t.y() - d, t.z()), err, i);
+   }
+   disk.SetupDisk(0, disk_rmax + 1, 1);
+   disk.SuckInHitsEndcap(disk_hits);
+
+   // Every fourth plex all barrel, every fourth all disk, the rest a 50/50 mix.
+   std::mt19937 rnd(ev.evtID());
+   const LayerOfHits *layers[NN];
+   int n_slots = 0, n_diff = 0;
+   for (int itrack = 0; itrack < n_tracks; itrack += NN)
+   {
+     const int end = std::min(itrack + NN, n_tracks);
+     const int p   = itrack / NN;
+     mkfp->SetNhits(0);
+     mkfp->InputTracksAndHits(simtracks, ev.layerHits_, itrack, end);
+     for (int i = 0; i < end - itrack; ++i)
+     {
+       const bool is_disk = p % 4 == 1 || (p % 4 > 1 && (rnd() & 1));
+       mkfp->SetTarget(i, ev.geom_, is_disk ? lay_disk : lay, is_disk);
+       layers[i] = is_disk ? &disk : &barrel;
+     }
+     n_diff  += mkfp->CheckMixedKernels(layers, end - itrack);
+     n_slots += end - itrack;
+   }
+
+   printf("Mixed kernel check: %d of %d slots differ\n", n_diff, n_slots);
+
+   return n_diff;
+}
+}
+
+double runFittingTestPlex(Event& ev, std::vector<Track>& rectracks)
+{
+  switch (Config::fitVecWidth)
+  {
+#define FIT_TEST_CASE(W) case W: return runFittingTestPlexImpl<W>(ev, rectracks);
+    MPLEX_FOR_EACH_WIDTH(FIT_TEST_CASE)
+#undef FIT_TEST_CASE
+    default: return runFittingTestPlexImpl<NN>(ev, rectracks);
+  }
+}
+
+int runMixedKernelCheck(Event& ev)
+{
+  switch (Config::fitVecWidth)
+  {
+#define MIXED_CHECK_CASE(W) case W: return runMixedKernelCheckImpl<W>(ev);
+    MPLEX_FOR_EACH_WIDTH(MIXED_CHECK_CASE)
+#undef MIXED_CHECK_CASE
+    default: return runMixedKernelCheckImpl<NN>(ev);
+  }
+}
+
 #ifdef USE_CUDA
 void runAllEventsFittingTestPlexGPU(std::vector<Event>& events)
 {
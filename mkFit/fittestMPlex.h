@@ -14,6 +14,10 @@ void   make_validation_tree(const char         *fname,
 
 double runFittingTestPlex(Event& ev, std::vector<Track>& rectracks);
 
+// Mixed barrel / endcap MkFitter kernels against the uniform ones, see
+// MkFitterT::CheckMixedKernels(). Returns the number of differing slots.
+int    runMixedKernelCheck(Event& ev);
+
 #ifdef USE_CUDA
 void runAllEventsFittingTestPlexGPU(std::vector<Event>& events);
 double runFittingTestPlexGPU(FitterCU<float> &cuFitter, Event& ev, std::vector<Track>& rectracks);
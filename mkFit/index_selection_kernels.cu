@@ -8,6 +8,10 @@
 #define BLOCK_SIZE_X 32
 
 constexpr bool tmp_useCMSGeom = false;
+// Config::m_max_dz / m_max_dphi are host variables, set at run time; the GPU
+// does not do the cms geometry yet and keeps the toy defaults.
+constexpr float tmp_max_dz   = 1;
+constexpr float tmp_max_dphi = 0.02;
 
 __device__ void selectHitIndices_fn(const LayerOfHitsCU &layer_of_hits,
     const GPlexLS &Err, const GPlexLV &Par, GPlexQI &XHitSize, 
@@ -84,8 +88,8 @@ __device__ void selectHitIndices_fn(const LayerOfHitsCU &layer_of_hits,
 
     const LayerOfHitsCU &L = layer_of_hits;
 
-    if (fabs(dz)   > Config::m_max_dz)   dz   = Config::m_max_dz;
-    if (fabs(dphi) > Config::m_max_dphi) dphi = Config::m_max_dphi;
+    if (fabs(dz)   > tmp_max_dz)   dz   = tmp_max_dz;
+    if (fabs(dphi) > tmp_max_dphi) dphi = tmp_max_dphi;
 
     const int zb1 = L.GetZBinChecked(z - dz);
     const int zb2 = L.GetZBinChecked(z + dz) + 1;
@@ -69,6 +69,7 @@ void KalmanGain_fn(const GPlexLS &A, const GPlexRegHH &b, GPlexRegLH &c, const i
 #include "KalmanGain.ah"
 }
 
+#include "MathMPlex.h"
 #include "KalmanUtilsMPlex.icc"
 
 __device__
@@ -4,6 +4,8 @@
 #include "buildtestMPlex.h"
 
 #include "MkFitter.h"
+#include "MaterialMap.h"
+#include "FieldMap.h"
 
 #include "Config.h"
 
@@ -71,6 +73,9 @@ namespace
 
   bool  g_run_fit_std   = false;
 
+  bool  g_run_check_mixed  = false;
+  int   g_n_mixed_diff     = 0;
+
   bool  g_run_build_all = true;
   bool  g_run_build_bh  = false;
   bool  g_run_build_std = false;
@@ -150,8 +155,8 @@ void test_standard()
   // ---- end MT test
 
   printf("Running test_standard(), operation=\"%s\"\n", g_operation.c_str());
-  printf("  vusize=%d, num_th_sim=%d, num_th_finder=%d\n",
-         MPT_SIZE, Config::numThreadsSimulation, Config::numThreadsFinder);
+  printf("  vusize=%d, fit_width=%d, build_width=%d, num_th_sim=%d, num_th_finder=%d\n",
+         MPT_SIZE, Config::fitVecWidth, Config::buildVecWidth, Config::numThreadsSimulation, Config::numThreadsFinder);
   printf("  sizeof(Track)=%zu, sizeof(Hit)=%zu, sizeof(SVector3)=%zu, sizeof(SMatrixSym33)=%zu, sizeof(MCHitInfo)=%zu\n",
          sizeof(Track), sizeof(Hit), sizeof(SVector3), sizeof(SMatrixSym33), sizeof(MCHitInfo));
   if (Config::useCMSGeom) {
@@ -262,6 +267,8 @@ void test_standard()
 
     plex_tracks.resize(ev.simTracks_.size());
 
+    if (g_run_check_mixed) g_n_mixed_diff += runMixedKernelCheck(ev);
+
     double t_best[NT] = {0}, t_cur[NT];
 
     for (int b = 0; b < Config::finderReportBestOutOfN; ++b)
@@ -341,6 +348,103 @@ void next_arg_or_die(lStr_t& args, lStr_i& i, bool allow_single_minus=false)
   i = j;
 }
 
+//==============================================================================
+// ISA / width selection
+//==============================================================================
+
+// With WITH_ISA_VARIANTS set in Makefile.config the Matriplex kernels are
+// compiled once per instruction set, each for its own plex width, and all of
+// them are linked in; MKFIT_ISA_VARIANTS lists them as M(isa, width). The
+// stages templated on width (seed and track fitting, track building)
+// run with the widest variant the cpu supports unless --vec-width,
+// --fit-width or --build-width say otherwise. Without the variants all
+// widths are compiled for the host ISA and NN stays the default.
+
+namespace
+{
+  bool cpu_has_sse()    { return __builtin_cpu_supports("sse4.2"); }
+  bool cpu_has_avx2()   { return __builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma"); }
+  bool cpu_has_avx512() { return __builtin_cpu_supports("avx512f") && __builtin_cpu_supports("avx512vl"); }
+  bool cpu_has_host()   { return true; }
+
+  struct IsaVariant
+  {
+    const char *m_name;
+    int         m_vec_width;
+    bool      (*m_supported)();
+  };
+
+#ifdef MKFIT_ISA_VARIANTS
+  #define ISA_VARIANT_ENTRY(isa, width) { #isa, width, cpu_has_##isa },
+  const IsaVariant g_isa_variants[] = { MKFIT_ISA_VARIANTS(ISA_VARIANT_ENTRY) };
+  #undef ISA_VARIANT_ENTRY
+#else
+  #define ISA_VARIANT_ENTRY(width) { "host", width, cpu_has_host },
+  const IsaVariant g_isa_variants[] = { MPLEX_FOR_EACH_WIDTH(ISA_VARIANT_ENTRY) };
+  #undef ISA_VARIANT_ENTRY
+#endif
+
+  int g_vec_width = 0;
+
+  const IsaVariant* find_isa_variant(int w)
+  {
+    for (const IsaVariant &v : g_isa_variants)
+    {
+      if (v.m_vec_width == w) return &v;
+    }
+    return nullptr;
+  }
+
+  bool is_vec_width_usable(int w)
+  {
+    const IsaVariant *v = find_isa_variant(w);
+    return v != nullptr && v->m_supported();
+  }
+
+  int best_vec_width()
+  {
+    __builtin_cpu_init();
+
+#ifdef MKFIT_ISA_VARIANTS
+    int best = 0;
+    for (const IsaVariant &v : g_isa_variants)
+    {
+      if (v.m_supported() && v.m_vec_width > best) best = v.m_vec_width;
+    }
+    return best;
+#else
+    return NN;
+#endif
+  }
+
+  void select_vec_width(int &w, const char *what, int def)
+  {
+    if (w == 0) w = def;
+    if ( ! is_vec_width_usable(w))
+    {
+      fprintf(stderr, "Warning: Matriplex width %d for %s not available on this cpu / build, using %d.\n",
+              w, what, def);
+      w = def;
+    }
+  }
+}
+
+void select_vec_widths()
+{
+  const int best = best_vec_width();
+  if (best == 0)
+  {
+    fprintf(stderr, "Error: the cpu supports none of the compiled-in instruction sets.\n");
+    exit(1);
+  }
+
+  int def = g_vec_width;
+  select_vec_width(def, "--vec-width", best);
+
+  select_vec_width(Config::fitVecWidth,   "fitting",  def);
+  select_vec_width(Config::buildVecWidth, "building", def);
+}
+
 //==============================================================================
 
 int main(int argc, const char *argv[])
@@ -367,21 +471,39 @@ int main(int argc, const char *argv[])
         "Options:\n"
         "  --num-events    <num>    number of events to run over (def: %d)\n"
         "  --num-tracks    <num>    number of tracks to generate for each event (def: %d)\n"
+        "  --num-layers    <num>    number of detector layers (def: %d, max: %d)\n"
         "  --num-thr-sim   <num>    number of threads for simulation (def: %d)\n"
         "  --num-thr       <num>    number of threads for track finding (def: %d)\n"
         "                           extra cloning thread is spawned for each of them\n"
         "  --fit-std                run standard fitting test (def: false)\n"
         "  --fit-std-only           run only standard fitting test (def: false)\n"
+        "  --check-mixed            check mixed barrel/endcap kernels against uniform ones, no building (def: false)\n"
         "  --build-bh               run best-hit building test (def: false)\n"
         "  --build-std              run standard combinatorial building test (def: false)\n"
         "  --build-ce               run clone engine combinatorial building test (def: false)\n"
         "  --cloner-single-thread   do not spawn extra cloning thread (def: %s)\n"
         "  --seeds-per-task         number of seeds to process in a tbb task (def: %d)\n"
+        "  --interleave    <num>    number of MkFitter batches interleaved per task in building (def: %d, max: %d)\n"
+        "  --chi2-hit-major         allow hit-major chi2 evaluation for large hit windows (def: %s)\n"
         "  --best-out-of   <num>    run track finding num times, report best time (def: %d)\n"
+        "  --vec-width     <num>    Matriplex width for fitting and building (def: widest the cpu runs, %d here)\n"
+        "  --fit-width     <num>    Matriplex width for seed and track fitting (def: --vec-width)\n"
+        "  --build-width   <num>    Matriplex width for track building (def: --vec-width)\n"
 	"  --cms-geom               use cms-like geometry (def: %i)\n"
+	"  --eta-det       <num>    eta extent of the detector, sets the eta binning (def: %g; cmssw tests: 2, endcap 2.5)\n"
+	"  --chi2-cut      <num>    chi2 cut for adding a hit to a candidate (def: %g; cmssw tests: 30)\n"
+	"  --min-dphi      <num>    minimum half width in phi of the hit search window (def: %g; cmssw tests: 0.01)\n"
+	"  --max-dphi      <num>    maximum half width in phi of the hit search window (def: %g; cmssw barrel: 0.2)\n"
+	"  --min-dz        <num>    minimum half width in z of the barrel hit search window (def: %g; cmssw barrel: 10)\n"
+	"  --max-dz        <num>    maximum half width in z of the barrel hit search window (def: %g; cmssw barrel: 20)\n"
 	"  --cmssw-seeds            take seeds from CMSSW (def: %i)\n"
 	"  --find-seeds             run road search seeding [CF enabled by default] (def: %s)\n"
 	"  --hits-per-task <num>    number of layer1 hits per task in finding seeds (def: %i)\n"
+	"  --clean-seeds            drop road search seeds sharing two hits with a better one that is close\n"
+	"                           in eta/phi/curvature (def: %s)\n"
+	"  --clean-seeds-deta <num> eta difference for --clean-seeds (def: %g)\n"
+	"  --clean-seeds-dphi <num> phi difference for --clean-seeds (def: %g)\n"
+	"  --clean-seeds-dcurv <num> curvature difference [1/cm] for --clean-seeds (def: %g)\n"
 	"  --endcap-test            test endcap tracking (def: %i)\n"
 	"  --cf-seeding             enable CF in seeding (def: %s)\n"
 	"  --cf-fitting             enable CF in fitting (def: %s)\n"
@@ -390,6 +512,10 @@ int main(int argc, const char *argv[])
 	"  --write                  write simulation to file and exit\n"
 	"  --read                   read simulation from file\n"
 	"  --file-name              file name for write/read (def: %s)\n"
+	"  --material-map  <file>   read binned material map for cms geometry (def: built from parametrization)\n"
+	"  --write-material-map <file>  average simHit radl/xi of %s into the map, write it to file and exit\n"
+	"  --field-map     <file>   read Bz(r, z) map, used instead of the polynomial where the field is not constant\n"
+	"  --write-field-map <file> write the polynomial field sampled on the default grid to file and exit\n"
         "GPU specific options: \n"
         "  --num-thr-ev    <num>    number of threads to run the event loop\n"
         "  --num-thr-reorg <num>    number of threads to run the hits reorganization\n"
@@ -397,20 +523,29 @@ int main(int argc, const char *argv[])
         argv[0],
         Config::nEvents,
         Config::nTracks,
+        Config::nLayers, Config::nMaxLayers,
         Config::numThreadsSimulation, Config::numThreadsFinder,
         Config::clonerUseSingleThread ? "true" : "false",
         Config::numSeedsPerTask,
+        Config::numBatchesInterleaved, Config::maxBatchesInterleaved,
+        Config::useHitMajorChi2 ? "true" : "false",
         Config::finderReportBestOutOfN,
+        best_vec_width(),
 	Config::useCMSGeom,
+	Config::fEtaDet, Config::chi2Cut,
+	Config::minDPhi, Config::m_max_dphi, Config::minDZ, Config::m_max_dz,
 	Config::readCmsswSeeds,
 	Config::findSeeds ? "true" : "false",
 	Config::numHitsPerTask,
+	Config::cleanSeeds ? "true" : "false",
+	Config::seedCleanDEta, Config::seedCleanDPhi, Config::seedCleanDCurv,
 	Config::endcapTest,
 	Config::cf_seeding ? "true" : "false",
 	Config::cf_fitting ? "true" : "false",
 	Config::normal_val ? "true" : "false",
 	Config::fit_val    ? "true" : "false",
-	g_file_name.c_str()
+	g_file_name.c_str(),
+	Config::inputFile.c_str()
       );
       exit(0);
     }
@@ -424,6 +559,11 @@ int main(int argc, const char *argv[])
       next_arg_or_die(mArgs, i);
       Config::nTracks = atoi(i->c_str());
     }
+    else if (*i == "--num-layers")
+    {
+      next_arg_or_die(mArgs, i);
+      Config::nLayers = atoi(i->c_str());
+    }
     else if (*i == "--num-thr-sim")
     {
       next_arg_or_die(mArgs, i);
@@ -443,6 +583,11 @@ int main(int argc, const char *argv[])
       g_run_fit_std = true;
       g_run_build_all = false; g_run_build_bh = false; g_run_build_std = false; g_run_build_ce = false;
     }
+    else if(*i == "--check-mixed")
+    {
+      g_run_check_mixed = true;
+      g_run_build_all = false; g_run_build_bh = false; g_run_build_std = false; g_run_build_ce = false;
+    }
     else if(*i == "--build-bh")
     {
       g_run_build_all = false; g_run_build_bh = true; g_run_build_std = false; g_run_build_ce = false;
@@ -464,15 +609,65 @@ int main(int argc, const char *argv[])
       next_arg_or_die(mArgs, i);
       Config::numSeedsPerTask = atoi(i->c_str());
     }
+    else if (*i == "--interleave")
+    {
+      next_arg_or_die(mArgs, i);
+      Config::numBatchesInterleaved = std::max(1, std::min(atoi(i->c_str()), Config::maxBatchesInterleaved));
+    }
+    else if (*i == "--chi2-hit-major")
+    {
+      Config::useHitMajorChi2 = true;
+    }
     else if(*i == "--best-out-of")
     {
       next_arg_or_die(mArgs, i);
       Config::finderReportBestOutOfN = atoi(i->c_str());
     }
+    else if (*i == "--vec-width")
+    {
+      next_arg_or_die(mArgs, i);
+      g_vec_width = atoi(i->c_str());
+    }
+    else if (*i == "--fit-width" || *i == "--build-width")
+    {
+      const bool is_fit = (*i == "--fit-width");
+      next_arg_or_die(mArgs, i);
+      (is_fit ? Config::fitVecWidth : Config::buildVecWidth) = atoi(i->c_str());
+    }
     else if(*i == "--cms-geom")
     {
       Config::useCMSGeom = true;
     }
+    else if (*i == "--eta-det")
+    {
+      next_arg_or_die(mArgs, i);
+      Config::fEtaDet = atof(i->c_str());
+    }
+    else if (*i == "--chi2-cut")
+    {
+      next_arg_or_die(mArgs, i);
+      Config::chi2Cut = atof(i->c_str());
+    }
+    else if (*i == "--min-dphi")
+    {
+      next_arg_or_die(mArgs, i);
+      Config::minDPhi = atof(i->c_str());
+    }
+    else if (*i == "--max-dphi")
+    {
+      next_arg_or_die(mArgs, i);
+      Config::m_max_dphi = atof(i->c_str());
+    }
+    else if (*i == "--min-dz")
+    {
+      next_arg_or_die(mArgs, i);
+      Config::minDZ = atof(i->c_str());
+    }
+    else if (*i == "--max-dz")
+    {
+      next_arg_or_die(mArgs, i);
+      Config::m_max_dz = atof(i->c_str());
+    }
     else if(*i == "--cmssw-seeds")
     {
       Config::readCmsswSeeds = true;
@@ -486,6 +681,25 @@ int main(int argc, const char *argv[])
       next_arg_or_die(mArgs, i);
       Config::numHitsPerTask = atoi(i->c_str());
     }
+    else if (*i == "--clean-seeds")
+    {
+      Config::cleanSeeds = true;
+    }
+    else if (*i == "--clean-seeds-deta")
+    {
+      next_arg_or_die(mArgs, i);
+      Config::seedCleanDEta = atof(i->c_str());
+    }
+    else if (*i == "--clean-seeds-dphi")
+    {
+      next_arg_or_die(mArgs, i);
+      Config::seedCleanDPhi = atof(i->c_str());
+    }
+    else if (*i == "--clean-seeds-dcurv")
+    {
+      next_arg_or_die(mArgs, i);
+      Config::seedCleanDCurv = atof(i->c_str());
+    }
     else if(*i == "--endcap-test")
     {
       Config::endcapTest = true; Config::nlayers_per_seed = 2; // default is 3 for barrel
@@ -529,6 +743,48 @@ int main(int argc, const char *argv[])
       next_arg_or_die(mArgs, i);
       g_file_name = *i;
     }
+    else if(*i == "--material-map")
+    {
+      next_arg_or_die(mArgs, i);
+      if ( ! g_material_map.Load(*i))
+      {
+        fprintf(stderr, "Error: failed reading material map '%s'.\n", i->c_str());
+        exit(1);
+      }
+    }
+    else if(*i == "--write-material-map")
+    {
+      next_arg_or_die(mArgs, i);
+      int n_hits = g_material_map.FillFromSimHits(Config::inputFile);
+      if (n_hits < 0 || ! g_material_map.Save(*i))
+      {
+        fprintf(stderr, "Error: failed making material map '%s' from '%s'.\n", i->c_str(), Config::inputFile.c_str());
+        exit(1);
+      }
+      printf("Material map from %d simHits written to '%s'.\n", n_hits, i->c_str());
+      exit(0);
+    }
+    else if(*i == "--field-map")
+    {
+      next_arg_or_die(mArgs, i);
+      if ( ! g_field_map.Load(*i))
+      {
+        fprintf(stderr, "Error: failed reading field map '%s'.\n", i->c_str());
+        exit(1);
+      }
+      Config::useFieldMap = true;
+    }
+    else if(*i == "--write-field-map")
+    {
+      next_arg_or_die(mArgs, i);
+      if ( ! g_field_map.Save(*i))
+      {
+        fprintf(stderr, "Error: failed writing field map '%s'.\n", i->c_str());
+        exit(1);
+      }
+      printf("Field map written to '%s'.\n", i->c_str());
+      exit(0);
+    }
     else
     {
       fprintf(stderr, "Error: Unknown option/argument '%s'.\n", i->c_str());
@@ -538,12 +794,20 @@ int main(int argc, const char *argv[])
     mArgs.erase(start, ++i);
   }
 
+  if ( ! Config::SetupLayers())
+  {
+    fprintf(stderr, "Error: %d layers not supported by this geometry (max: %d).\n",
+            Config::nLayers, Config::nMaxLayers);
+    exit(1);
+  }
   Config::RecalculateDependentConstants();
 
+  select_vec_widths();
+
   printf ("Running with n_threads=%d, cloner_single_thread=%d, best_out_of=%d\n",
           Config::numThreadsFinder, Config::clonerUseSingleThread, Config::finderReportBestOutOfN);
 
   test_standard();
 
-  return 0;
+  return g_n_mixed_diff != 0;
 }
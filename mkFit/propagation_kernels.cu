@@ -52,6 +52,7 @@ __device__ void computeMsRad_fn(const GPlexHV& __restrict__ msPar,
 }
 
 
+#include "MathMPlex.h"
 #include "PropagationMPlex.icc"
 
 __device__ void helixAtRFromIterativeCCS_fn(const GPlexLV& inPar, 
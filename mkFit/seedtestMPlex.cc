@@ -1,117 +1,499 @@
 #include "seedtestMPlex.h"
+#include "MathMPlex.h"
 #include "tbb/tbb.h"
 
+#include <limits>
+
 // #define DEBUG
 #include "Debug.h"
 
-inline void intersectThirdLayer(const float a, const float b, const float hit1_x, const float hit1_y, float& lay2_x, float& lay2_y){
-  const float a2 = a*a; const float b2 = b*b; const float a2b2 = a2+b2;
-  const float lay2rad2  = (Config::fRadialSpacing*Config::fRadialSpacing)*9.0f; // average third radius squared
-  const float maxCurvR2 = Config::maxCurvR * Config::maxCurvR;
+namespace
+{
+  inline void intersectThirdLayer(const float a, const float b, const float hit1_x, const float hit1_y, float& lay2_x, float& lay2_y){
+    const float a2 = a*a; const float b2 = b*b; const float a2b2 = a2+b2;
+    const float lay2rad2  = (Config::fRadialSpacing*Config::fRadialSpacing)*9.0f; // average third radius squared
+    const float maxCurvR2 = Config::maxCurvR * Config::maxCurvR;
+
+    const float quad = std::sqrt( 2.0f*maxCurvR2*(a2b2+lay2rad2) - (a2b2-lay2rad2)*(a2b2-lay2rad2) - maxCurvR2*maxCurvR2 );
+    const float pos[2] = { (a2*a + a*(b2+lay2rad2-maxCurvR2) - b*quad)/ a2b2 , (b2*b + b*(a2+lay2rad2-maxCurvR2) + a*quad)/ a2b2 };
+    const float neg[2] = { (a2*a + a*(b2+lay2rad2-maxCurvR2) + b*quad)/ a2b2 , (b2*b + b*(a2+lay2rad2-maxCurvR2) - a*quad)/ a2b2 };
+
+    // since we have two intersection points, arbitrate which one is closer to layer2 hit
+    const bool use_pos = getHypot(pos[0]-hit1_x,pos[1]-hit1_y) < getHypot(neg[0]-hit1_x,neg[1]-hit1_y);
+    lay2_x = use_pos ? pos[0] : neg[0];
+    lay2_y = use_pos ? pos[1] : neg[1];
+  }
+
+  // Third layer search window for N_proc (hit0, hit1) pairs in lanes: phi
+  // between the intersections of the two max curvature circles through the
+  // pair, z from a straight line in r-z.
+  void thirdLayerWindowsMPlex(const MPlexQF& x0, const MPlexQF& y0, const MPlexQF& z0,
+                              const MPlexQF& x1, const MPlexQF& y1, const MPlexQF& z1,
+                              MPlexQF& phi2, MPlexQF& dphi2, MPlexQF& z2, const int N_proc)
+  {
+#pragma simd
+    for (int n = 0; n < N_proc; ++n)
+    {
+      const float hit0_x = x0.ConstAt(n, 0, 0); const float hit0_y = y0.ConstAt(n, 0, 0);
+      const float hit1_x = x1.ConstAt(n, 0, 0); const float hit1_y = y1.ConstAt(n, 0, 0);
+      const float hit01_r2 = getRad2(hit0_x-hit1_x,hit0_y-hit1_y);
+
+      const float quad = std::sqrt((4.0f*Config::maxCurvR*Config::maxCurvR - hit01_r2) / hit01_r2);
+
+      // center of negative curved track
+      const float aneg = 0.5f*((hit0_x+hit1_x)-(hit0_y-hit1_y)*quad);
+      const float bneg = 0.5f*((hit0_y+hit1_y)+(hit0_x-hit1_x)*quad);
+
+      // negative points of intersection with third layer
+      float lay2_negx, lay2_negy;
+      intersectThirdLayer(aneg,bneg,hit1_x,hit1_y,lay2_negx,lay2_negy);
+      const float lay2_negphi = VecMath::atan2<VecMath::Fast>(lay2_negy,lay2_negx);
+
+      // center of positive curved track
+      const float apos = 0.5f*((hit0_x+hit1_x)+(hit0_y-hit1_y)*quad);
+      const float bpos = 0.5f*((hit0_y+hit1_y)-(hit0_x-hit1_x)*quad);
+
+      // positive points of intersection with third layer
+      float lay2_posx, lay2_posy;
+      intersectThirdLayer(apos,bpos,hit1_x,hit1_y,lay2_posx,lay2_posy);
+      const float lay2_posphi = VecMath::atan2<VecMath::Fast>(lay2_posy,lay2_posx);
+
+      phi2 .At(n, 0, 0) = (lay2_posphi+lay2_negphi)/2.0f;
+      dphi2.At(n, 0, 0) = (lay2_posphi-lay2_negphi)/2.0f;
+      z2   .At(n, 0, 0) = 2.0f*z1.ConstAt(n, 0, 0)-z0.ConstAt(n, 0, 0);
+    }
+  }
+
+  // Cuts on N_proc triplets in lanes: z residual of the second layer hit,
+  // then a circle through the three hits for the pT and d0 cuts.
+  void selectTripletsMPlex(const MPlexQF& x0, const MPlexQF& y0, const MPlexQF& z0,
+                           const MPlexQF& x1, const MPlexQF& y1, const MPlexQF& z1,
+                           const MPlexQF& x2, const MPlexQF& y2, const MPlexQF& z2,
+                           MPlexQI& pass, const int N_proc)
+  {
+#pragma simd
+    for (int n = 0; n < N_proc; ++n)
+    {
+      const float hit0_x = x0.ConstAt(n, 0, 0); const float hit0_y = y0.ConstAt(n, 0, 0);
+      const float hit1_x = x1.ConstAt(n, 0, 0); const float hit1_y = y1.ConstAt(n, 0, 0);
+      const float hit2_x = x2.ConstAt(n, 0, 0); const float hit2_y = y2.ConstAt(n, 0, 0);
+
+      // filter by residual of second layer hit
+      const float lay1_predz = (z0.ConstAt(n, 0, 0) + z2.ConstAt(n, 0, 0)) / 2.0f;
+      const bool  z1_ok      = ! (std::abs(lay1_predz-z1.ConstAt(n, 0, 0)) > Config::seed_z1cut);
+
+      // now fit a circle, extract pT and d0 from center and radius
+      const float mr = (hit1_y-hit0_y)/(hit1_x-hit0_x);
+      const float mt = (hit2_y-hit1_y)/(hit2_x-hit1_x);
+      const float a  = (mr*mt*(hit2_y-hit0_y) + mr*(hit1_x+hit2_x) - mt*(hit0_x+hit1_x))/(2.0f*(mr-mt));
+      const float b  = -1.0f*(a-(hit0_x+hit1_x)/2.0f)/mr + (hit0_y+hit1_y)/2.0f;
+      const float r  = getHypot(hit0_x-a,hit0_y-b);
+
+      // filter by d0 cut 5mm, pT cut 0.5 GeV (radius of 0.5 GeV track)
+      const bool circle_ok = ! ((r < Config::maxCurvR) || (std::abs(getHypot(a,b)-r) > Config::seed_d0cut));
+
+      pass.At(n, 0, 0) = z1_ok && circle_ok;
+    }
+  }
+
+  // Per task scratch, cleared but not freed between the hits of a task so
+  // the window queries do not allocate once the buffers have grown.
+  struct SeedingBuffers
+  {
+    std::vector<int>        cand_idcs;
+    std::vector<int>        pair_hit0;
+    std::vector<int>        pair_hit1;
+    std::vector<TripletIdx> triplets;   // candidates waiting for selectTripletsMPlex()
+    int                     n_selected; // leading entries of triplets already done
+
+    MPlexQF x[3], y[3], z[3];
+    MPlexQF phi2, dphi2, z2;
+    MPlexQI pass;
+  };
+
+  // Runs the triplet cuts on the queued candidates NN at a time; unless
+  // flushing, a last partial plex is left queued for the next call.
+  void selectQueuedTriplets(SeedingBuffers& buf, const LayerOfHits* const lays[3],
+                            TripletIdxVec& seed_idcs, const bool flush)
+  {
+    const int n_queued = buf.triplets.size();
+
+    while (buf.n_selected < n_queued && (flush || n_queued - buf.n_selected >= NN))
+    {
+      const TripletIdx *trip   = &buf.triplets[buf.n_selected];
+      const int         N_proc = std::min(NN, n_queued - buf.n_selected);
+
+      for (int n = 0; n < N_proc; ++n)
+      {
+        for (int l = 0; l < 3; ++l)
+        {
+          const Hit &hit = lays[l]->m_hits[trip[n][l]];
+          buf.x[l].At(n, 0, 0) = hit.x();
+          buf.y[l].At(n, 0, 0) = hit.y();
+          buf.z[l].At(n, 0, 0) = hit.z();
+        }
+      }
+
+      selectTripletsMPlex(buf.x[0], buf.y[0], buf.z[0], buf.x[1], buf.y[1], buf.z[1],
+                          buf.x[2], buf.y[2], buf.z[2], buf.pass, N_proc);
+
+      for (int n = 0; n < N_proc; ++n)
+      {
+        if (buf.pass.At(n, 0, 0)) seed_idcs.push_back(trip[n]);
+      }
+      buf.n_selected += N_proc;
+    }
+
+    buf.triplets.erase(buf.triplets.begin(), buf.triplets.begin() + buf.n_selected);
+    buf.n_selected = 0;
+  }
+
+  // Helix parameters of N_proc seed triplets in lanes for seed cleaning:
+  // eta from the outer hits, phi of the chord from the first to the second
+  // hit, signed curvature of the circle through the three hits. quality is
+  // d0 and the z residual of the second hit relative to their cuts, lower
+  // is better.
+  void seedHelixParamsMPlex(const MPlexQF& x0, const MPlexQF& y0, const MPlexQF& z0,
+                            const MPlexQF& x1, const MPlexQF& y1, const MPlexQF& z1,
+                            const MPlexQF& x2, const MPlexQF& y2, const MPlexQF& z2,
+                            MPlexQF& eta, MPlexQF& phi, MPlexQF& curv, MPlexQF& quality,
+                            const int N_proc)
+  {
+#pragma simd
+    for (int n = 0; n < N_proc; ++n)
+    {
+      const float hit0_x = x0.ConstAt(n, 0, 0); const float hit0_y = y0.ConstAt(n, 0, 0);
+      const float hit1_x = x1.ConstAt(n, 0, 0); const float hit1_y = y1.ConstAt(n, 0, 0);
+      const float hit2_x = x2.ConstAt(n, 0, 0); const float hit2_y = y2.ConstAt(n, 0, 0);
+
+      const float mr = (hit1_y-hit0_y)/(hit1_x-hit0_x);
+      const float mt = (hit2_y-hit1_y)/(hit2_x-hit1_x);
+      const float a  = (mr*mt*(hit2_y-hit0_y) + mr*(hit1_x+hit2_x) - mt*(hit0_x+hit1_x))/(2.0f*(mr-mt));
+      const float b  = -1.0f*(a-(hit0_x+hit1_x)/2.0f)/mr + (hit0_y+hit1_y)/2.0f;
+      const float r  = getHypot(hit0_x-a,hit0_y-b);
+
+      // same sign convention as calculateCharge()
+      const float charge = (hit2_y-hit0_y)*(hit2_x-hit1_x) > (hit2_y-hit1_y)*(hit2_x-hit0_x) ? 1.0f : -1.0f;
+
+      const float cot_theta = (z2.ConstAt(n, 0, 0)-z0.ConstAt(n, 0, 0)) /
+                              (getHypot(hit2_x,hit2_y)-getHypot(hit0_x,hit0_y));
+
+      const float d0  = std::abs(getHypot(a,b)-r);
+      const float dz1 = std::abs((z0.ConstAt(n, 0, 0) + z2.ConstAt(n, 0, 0)) / 2.0f - z1.ConstAt(n, 0, 0));
+
+      eta    .At(n, 0, 0) = VecMath::log(cot_theta + std::sqrt(cot_theta*cot_theta + 1.0f));
+      phi    .At(n, 0, 0) = VecMath::atan2<VecMath::Fast>(hit1_y-hit0_y,hit1_x-hit0_x);
+      curv   .At(n, 0, 0) = charge / r;
+
+      // Collinear hits give no circle, rank them last.
+      const float q = d0 / Config::seed_d0cut + dz1 / Config::seed_z1cut;
+      quality.At(n, 0, 0) = std::isfinite(q) ? q : std::numeric_limits<float>::max();
+    }
+  }
+
+  struct SeedRank
+  {
+    float quality;
+    int   index;
+  };
+
+  // Ties are broken by the seed index so the result does not depend on the
+  // sort.
+  inline bool sortByQuality(const SeedRank& a, const SeedRank& b)
+  {
+    if (a.quality != b.quality) return a.quality < b.quality;
+    return a.index < b.index;
+  }
+
+  struct SeedParams
+  {
+    std::vector<float> eta, phi, curv;
+
+    explicit SeedParams(const int n) : eta(n), phi(n), curv(n) {}
+
+    bool close(const int a, const int b) const
+    {
+      float dphi = std::abs(phi[a] - phi[b]);
+      if (dphi > Config::PI) dphi = Config::TwoPI - dphi;
+      return std::abs(eta[a]  - eta[b])  < Config::seedCleanDEta &&
+             dphi                        < Config::seedCleanDPhi &&
+             std::abs(curv[a] - curv[b]) < Config::seedCleanDCurv;
+    }
+  };
+
+  // Cells of seeds with the same (layer la hit, layer lb hit) pair and
+  // curvature bin of width Config::seedCleanDCurv. Cells are numbered in
+  // (pair, bin) order so that the neighbouring bins of a pair, if present,
+  // are the adjacent cells; cell_key / cell_bin give them for each cell.
+  // Returns the number of cells.
+  struct SeedCellKey
+  {
+    long long pair;
+    int       bin;
+    int       index;
+
+    bool operator<(const SeedCellKey& o) const
+    {
+      if (pair != o.pair) return pair < o.pair;
+      if (bin  != o.bin)  return bin  < o.bin;
+      return index < o.index;
+    }
+  };
+
+  int cellsByHitPairAndCurv(const TripletIdxVec& seed_idcs, const std::vector<float>& curv,
+                            const int la, const int lb, std::vector<int>& cell,
+                            std::vector<long long>& cell_key, std::vector<int>& cell_bin)
+  {
+    const int n_seeds = seed_idcs.size();
 
-  const float quad = std::sqrt( 2.0f*maxCurvR2*(a2b2+lay2rad2) - (a2b2-lay2rad2)*(a2b2-lay2rad2) - maxCurvR2*maxCurvR2 );
-  const float pos[2] = { (a2*a + a*(b2+lay2rad2-maxCurvR2) - b*quad)/ a2b2 , (b2*b + b*(a2+lay2rad2-maxCurvR2) + a*quad)/ a2b2 };
-  const float neg[2] = { (a2*a + a*(b2+lay2rad2-maxCurvR2) + b*quad)/ a2b2 , (b2*b + b*(a2+lay2rad2-maxCurvR2) - a*quad)/ a2b2 };
+    std::vector<SeedCellKey> keys(n_seeds);
+    tbb::parallel_for(tbb::blocked_range<int>(0, n_seeds, 1024),
+      [&](const tbb::blocked_range<int>& seeds) {
+        for (int i = seeds.begin(); i < seeds.end(); ++i)
+        {
+          // Collinear triplets have no curvature; close() never matches them.
+          const float b = curv[i] / Config::seedCleanDCurv;
+          keys[i] = { ((long long) seed_idcs[i][la] << 32) | seed_idcs[i][lb],
+                      std::isfinite(b) ? (int) std::floor(std::max(-1e9f, std::min(b, 1e9f))) : 0, i };
+        }
+    });
+    tbb::parallel_sort(keys.begin(), keys.end());
 
-  // since we have two intersection points, arbitrate which one is closer to layer2 hit
-  if (getHypot(pos[0]-hit1_x,pos[1]-hit1_y)<getHypot(neg[0]-hit1_x,neg[1]-hit1_y)) {
-    lay2_x = pos[0];
-    lay2_y = pos[1];
+    cell.resize(n_seeds);
+    cell_key.clear();
+    cell_bin.clear();
+    for (int i = 0; i < n_seeds; ++i)
+    {
+      if (i == 0 || keys[i].pair != keys[i - 1].pair || keys[i].bin != keys[i - 1].bin)
+      {
+        cell_key.push_back(keys[i].pair);
+        cell_bin.push_back(keys[i].bin);
+      }
+      cell[keys[i].index] = cell_key.size() - 1;
+    }
+    return cell_key.size();
   }
-  else {
-    lay2_x = neg[0];
-    lay2_y = neg[1];
+
+  // Seeds from the layer 1 hits [ihit1_begin, ihit1_end), appended to
+  // chunk_seed_idcs in hit order.
+  void findSeedsInChunk(SeedingBuffers& buf, std::vector<LayerOfHits>& evt_lay_hits,
+                        const int ihit1_begin, const int ihit1_end,
+                        TripletIdxVec& chunk_seed_idcs, Event *ev)
+  {
+    bool debug(false);
+
+    // 0 = first layer, 1 = second layer, 2 = third layer
+    const LayerOfHits& lay1_hits = evt_lay_hits[1];
+    LayerOfHits& lay0_hits = evt_lay_hits[0];
+    LayerOfHits& lay2_hits = evt_lay_hits[2];
+    const LayerOfHits* const lays[3] = { &lay0_hits, &lay1_hits, &lay2_hits };
+
+    buf.pair_hit0.clear();
+    buf.pair_hit1.clear();
+
+    // pass 1: layer 0 hits compatible with each layer 1 hit of the chunk
+    for (int ihit1 = ihit1_begin; ihit1 < ihit1_end; ++ihit1)
+    {
+      const Hit & hit1   = lay1_hits.m_hits[ihit1];
+      const float hit1_z = hit1.z();
+
+      dprint("ihit1: " << ihit1 << " mcTrackID: " << hit1.mcTrackID(ev->simHitsInfo_) << " phi: " << hit1.phi() << " z: " << hit1.z());
+      dprint(" predphi: " << hit1.phi() << "+/-" << Config::lay01angdiff << " predz: " << hit1.z()/2.0f << "+/-" << Config::seed_z0cut/2.0f << std::endl);
+
+      buf.cand_idcs.clear();
+      lay0_hits.SelectHitIndices(hit1_z/2.0f,VecMath::atan2(hit1.y(),hit1.x()),Config::seed_z0cut/2.0f,Config::lay01angdiff,buf.cand_idcs,true,false);
+
+      for (auto&& ihit0 : buf.cand_idcs)
+      {
+        buf.pair_hit0.push_back(ihit0);
+        buf.pair_hit1.push_back(ihit1);
+      }
+    }
+
+    // pass 2: third layer windows for the pairs, NN at a time, and the
+    // triplet candidates found in them
+    const int n_pairs = buf.pair_hit0.size();
+    for (int ipair = 0; ipair < n_pairs; ipair += NN)
+    {
+      const int N_proc = std::min(NN, n_pairs - ipair);
+
+      for (int n = 0; n < N_proc; ++n)
+      {
+        const Hit & hit0 = lay0_hits.m_hits[buf.pair_hit0[ipair + n]];
+        const Hit & hit1 = lay1_hits.m_hits[buf.pair_hit1[ipair + n]];
+        buf.x[0].At(n, 0, 0) = hit0.x(); buf.y[0].At(n, 0, 0) = hit0.y(); buf.z[0].At(n, 0, 0) = hit0.z();
+        buf.x[1].At(n, 0, 0) = hit1.x(); buf.y[1].At(n, 0, 0) = hit1.y(); buf.z[1].At(n, 0, 0) = hit1.z();
+      }
+
+      thirdLayerWindowsMPlex(buf.x[0], buf.y[0], buf.z[0], buf.x[1], buf.y[1], buf.z[1],
+                             buf.phi2, buf.dphi2, buf.z2, N_proc);
+
+      for (int n = 0; n < N_proc; ++n)
+      {
+        const int ihit0 = buf.pair_hit0[ipair + n];
+        const int ihit1 = buf.pair_hit1[ipair + n];
+
+        dprint(" ihit0: " << ihit0 << " mcTrackID: " << lay0_hits.m_hits[ihit0].mcTrackID(ev->simHitsInfo_) << " phi: " << lay0_hits.m_hits[ihit0].phi() << " z: " << lay0_hits.m_hits[ihit0].z());
+        dprint("  predphi: " << buf.phi2.At(n, 0, 0) << "+/-" << buf.dphi2.At(n, 0, 0) << " predz: " << buf.z2.At(n, 0, 0) << "+/-" << Config::seed_z2cut << std::endl);
+
+        buf.cand_idcs.clear();
+        lay2_hits.SelectHitIndices(buf.z2.At(n, 0, 0),buf.phi2.At(n, 0, 0),Config::seed_z2cut,buf.dphi2.At(n, 0, 0),
+                                   buf.cand_idcs,true,false);
+
+        for (auto&& ihit2 : buf.cand_idcs)
+        {
+          buf.triplets.emplace_back(TripletIdx{{ihit0,ihit1,ihit2}});
+        }
+      }
+
+      // pass 3: triplet cuts, NN candidates at a time
+      selectQueuedTriplets(buf, lays, chunk_seed_idcs, false);
+    }
+    selectQueuedTriplets(buf, lays, chunk_seed_idcs, true);
   }
 }
 
-void findSeedsByRoadSearch(TripletIdxConVec & seed_idcs, std::vector<LayerOfHits>& evt_lay_hits, int lay1_size, Event *& ev)
+void findSeedsByRoadSearch(TripletIdxVec & seed_idcs, std::vector<LayerOfHits>& evt_lay_hits, int lay1_size, Event *& ev)
 {
-  bool debug(false);
+  // Layer 1 hits are cut into fixed chunks, each with its own output, so the
+  // seed order does not depend on how tbb splits the work.
+  const int hits_per_chunk = std::max(1, Config::numHitsPerTask);
+  const int n_chunks       = (lay1_size + hits_per_chunk - 1) / hits_per_chunk;
 
-  // 0 = first layer, 1 = second layer, 2 = third layer
-  const LayerOfHits& lay1_hits = evt_lay_hits[1];
-  LayerOfHits& lay0_hits = evt_lay_hits[0];
-  LayerOfHits& lay2_hits = evt_lay_hits[2];
+  std::vector<TripletIdxVec> chunk_seed_idcs(n_chunks);
 
-  tbb::parallel_for(tbb::blocked_range<int>(0, lay1_size, std::max(1, Config::numHitsPerTask)),
-    [&](const tbb::blocked_range<int>& i) {
-      TripletIdxVec temp_thr_seed_idcs;		      
-      for (int ihit1 = i.begin(); ihit1 < i.end(); ++ihit1)
+  tbb::parallel_for(tbb::blocked_range<int>(0, n_chunks),
+    [&](const tbb::blocked_range<int>& chunks) {
+      SeedingBuffers buf;
+      buf.n_selected = 0;
+
+      for (int ichunk = chunks.begin(); ichunk < chunks.end(); ++ichunk)
       {
-	const Hit & hit1   = lay1_hits.m_hits[ihit1];
-	const float hit1_z = hit1.z();
-			     
-	dprint("ihit1: " << ihit1 << " mcTrackID: " << hit1.mcTrackID(ev->simHitsInfo_) << " phi: " << hit1.phi() << " z: " << hit1.z());
-	dprint(" predphi: " << hit1.phi() << "+/-" << Config::lay01angdiff << " predz: " << hit1.z()/2.0f << "+/-" << Config::seed_z0cut/2.0f << std::endl);
-
-	std::vector<int> cand_hit0_indices; // pass by reference
-	lay0_hits.SelectHitIndices(hit1_z/2.0f,hit1.phi(),Config::seed_z0cut/2.0f,Config::lay01angdiff,cand_hit0_indices,true,false);
-	// loop over first layer hits
-	for (auto&& ihit0 : cand_hit0_indices)
-	{
-	  const Hit & hit0   = lay0_hits.m_hits[ihit0]; 
-	  const float hit0_z = hit0.z();
-	  const float hit0_x = hit0.x(); const float hit0_y = hit0.y();
-	  const float hit1_x = hit1.x(); const float hit1_y = hit1.y();
-	  const float hit01_r2 = getRad2(hit0_x-hit1_x,hit0_y-hit1_y);
-
-	  const float quad = std::sqrt((4.0f*Config::maxCurvR*Config::maxCurvR - hit01_r2) / hit01_r2);
-    
-	  // center of negative curved track
-	  const float aneg = 0.5f*((hit0_x+hit1_x)-(hit0_y-hit1_y)*quad);
-	  const float bneg = 0.5f*((hit0_y+hit1_y)+(hit0_x-hit1_x)*quad);
-
-	  // negative points of intersection with third layer
-	  float lay2_negx = 0.0f, lay2_negy = 0.0f;
-	  intersectThirdLayer(aneg,bneg,hit1_x,hit1_y,lay2_negx,lay2_negy);
-	  const float lay2_negphi = getPhi(lay2_negx,lay2_negy);
-
-	  // center of positive curved track
-	  const float apos = 0.5f*((hit0_x+hit1_x)+(hit0_y-hit1_y)*quad);
-	  const float bpos = 0.5f*((hit0_y+hit1_y)-(hit0_x-hit1_x)*quad);
-      
-	  // positive points of intersection with third layer
-	  float lay2_posx = 0.0f, lay2_posy = 0.0f;
-	  intersectThirdLayer(apos,bpos,hit1_x,hit1_y,lay2_posx,lay2_posy);
-	  const float lay2_posphi = getPhi(lay2_posx,lay2_posy);
-
-	  std::vector<int> cand_hit2_indices;
-	  lay2_hits.SelectHitIndices((2.0f*hit1_z-hit0_z),(lay2_posphi+lay2_negphi)/2.0f,
-				     Config::seed_z2cut,(lay2_posphi-lay2_negphi)/2.0f,
-				     cand_hit2_indices,true,false);
-
-	  dprint(" ihit0: " << ihit0 << " mcTrackID: " << hit0.mcTrackID(ev->simHitsInfo_) << " phi: " << hit0.phi() << " z: " << hit0.z());
-	  dprint("  predphi: " << (lay2_posphi+lay2_negphi)/2.0f << "+/-" << (lay2_posphi-lay2_negphi)/2.0f << " predz: " << 2.0f*hit1_z-hit0_z << "+/-" << Config::seed_z2cut << std::endl);
-
-	  // loop over candidate third layer hits
-	  //temp_thr_seed_idcs.reserve(temp_thr_seed_idcs.size()+cand_hit2_indices.size());
-#pragma simd
-	  for (auto&& ihit2 : cand_hit2_indices)
-	  {
-	    const Hit & hit2 = lay2_hits.m_hits[ihit2];
-
-	    const float lay1_predz = (hit0_z + hit2.z()) / 2.0f;
-	    // filter by residual of second layer hit
-	    if (std::abs(lay1_predz-hit1_z) > Config::seed_z1cut) continue;
-
-	    const float hit2_x = hit2.x(); const float hit2_y = hit2.y();
-
-	    // now fit a circle, extract pT and d0 from center and radius
-	    const float mr = (hit1_y-hit0_y)/(hit1_x-hit0_x);
-	    const float mt = (hit2_y-hit1_y)/(hit2_x-hit1_x);
-	    const float a  = (mr*mt*(hit2_y-hit0_y) + mr*(hit1_x+hit2_x) - mt*(hit0_x+hit1_x))/(2.0f*(mr-mt));
-	    const float b  = -1.0f*(a-(hit0_x+hit1_x)/2.0f)/mr + (hit0_y+hit1_y)/2.0f;
-	    const float r  = getHypot(hit0_x-a,hit0_y-b);
-
-	    // filter by d0 cut 5mm, pT cut 0.5 GeV (radius of 0.5 GeV track)
-	    if ((r < Config::maxCurvR) || (std::abs(getHypot(a,b)-r) > Config::seed_d0cut)) continue; 
-	
-	    dprint(" ihit2: " << ihit2 << " mcTrackID: " << hit2.mcTrackID(ev->simHitsInfo_) << " phi: " << hit2.phi() << " z: " << hit2.z()); 
-
-	    temp_thr_seed_idcs.emplace_back(TripletIdx{{ihit0,ihit1,ihit2}});
-	  } // end loop over third layer matches
-	} // end loop over first layer matches
-      } // end chunk of hits for parallel for
-      seed_idcs.grow_by(temp_thr_seed_idcs.begin(), temp_thr_seed_idcs.end());
-  }); // end parallel for loop over second layer hits
+        findSeedsInChunk(buf, evt_lay_hits, ichunk * hits_per_chunk,
+                         std::min((ichunk + 1) * hits_per_chunk, lay1_size),
+                         chunk_seed_idcs[ichunk], ev);
+      }
+  }); // end parallel for loop over chunks of second layer hits
+
+  // Exclusive scan of the chunk sizes gives where each chunk goes in the
+  // compacted output. There are only lay1_size / hits_per_chunk entries.
+  std::vector<int> chunk_offsets(n_chunks + 1, 0);
+  for (int ichunk = 0; ichunk < n_chunks; ++ichunk)
+  {
+    chunk_offsets[ichunk + 1] = chunk_offsets[ichunk] + chunk_seed_idcs[ichunk].size();
+  }
+
+  seed_idcs.resize(chunk_offsets[n_chunks]);
+
+  tbb::parallel_for(tbb::blocked_range<int>(0, n_chunks),
+    [&](const tbb::blocked_range<int>& chunks) {
+      for (int ichunk = chunks.begin(); ichunk < chunks.end(); ++ichunk)
+      {
+        std::copy(chunk_seed_idcs[ichunk].begin(), chunk_seed_idcs[ichunk].end(),
+                  seed_idcs.begin() + chunk_offsets[ichunk]);
+        TripletIdxVec().swap(chunk_seed_idcs[ichunk]);
+      }
+  });
+}
+
+void cleanSeedsByRoadSearch(TripletIdxVec & seed_idcs, std::vector<LayerOfHits>& evt_lay_hits)
+{
+  const int n_seeds = seed_idcs.size();
+  if ( ! Config::cleanSeeds || n_seeds == 0) return;
+
+  const LayerOfHits* const lays[3] = { &evt_lay_hits[0], &evt_lay_hits[1], &evt_lay_hits[2] };
+
+  std::vector<SeedRank> ranks(n_seeds);
+  SeedParams            params(n_seeds);
+
+  tbb::parallel_for(tbb::blocked_range<int>(0, n_seeds, 64 * NN),
+    [&](const tbb::blocked_range<int>& seeds) {
+      MPlexQF x[3], y[3], z[3];
+      MPlexQF eta, phi, curv, quality;
+
+      for (int iseed = seeds.begin(); iseed < seeds.end(); iseed += NN)
+      {
+        const int N_proc = std::min(NN, seeds.end() - iseed);
+
+        for (int n = 0; n < N_proc; ++n)
+        {
+          for (int l = 0; l < 3; ++l)
+          {
+            const Hit &hit = lays[l]->m_hits[seed_idcs[iseed + n][l]];
+            x[l].At(n, 0, 0) = hit.x();
+            y[l].At(n, 0, 0) = hit.y();
+            z[l].At(n, 0, 0) = hit.z();
+          }
+        }
+
+        seedHelixParamsMPlex(x[0], y[0], z[0], x[1], y[1], z[1], x[2], y[2], z[2],
+                             eta, phi, curv, quality, N_proc);
+
+        for (int n = 0; n < N_proc; ++n)
+        {
+          ranks[iseed + n] = { quality.At(n, 0, 0), iseed + n };
+          params.eta [iseed + n] = eta .At(n, 0, 0);
+          params.phi [iseed + n] = phi .At(n, 0, 0);
+          params.curv[iseed + n] = curv.At(n, 0, 0);
+        }
+      }
+  });
+
+  // Going from the best seed down, drop the ones sharing two hits with an
+  // already kept one that is close in eta, phi and curvature. Two shared hits
+  // means the same hit pair on one of the three layer pairs. The kept seeds
+  // of each cell are a linked list through next[]; only the cell of the seed
+  // and the two neighbouring curvature bins can hold close ones, and within
+  // those the kept seeds differ in eta or phi, so the lists stay short.
+  tbb::parallel_sort(ranks.begin(), ranks.end(), sortByQuality);
+
+  std::vector<char> keep(n_seeds, 0);
+
+  const int pair_layers[3][2] = { { 0, 1 }, { 0, 2 }, { 1, 2 } };
+
+  std::vector<int>       cell[3], head[3], next[3], cell_bin[3];
+  std::vector<long long> cell_key[3];
+  for (int p = 0; p < 3; ++p)
+  {
+    const int n_cells = cellsByHitPairAndCurv(seed_idcs, params.curv, pair_layers[p][0], pair_layers[p][1],
+                                              cell[p], cell_key[p], cell_bin[p]);
+    head[p].assign(n_cells, -1);
+    next[p].assign(n_seeds, -1);
+  }
+
+  for (auto &rank : ranks)
+  {
+    const int iseed = rank.index;
+
+    bool dup = false;
+    for (int p = 0; p < 3 && ! dup; ++p)
+    {
+      const int c = cell[p][iseed];
+      for (int nc = std::max(0, c - 1); nc <= std::min(c + 1, (int) head[p].size() - 1) && ! dup; ++nc)
+      {
+        if (cell_key[p][nc] != cell_key[p][c] || std::abs(cell_bin[p][nc] - cell_bin[p][c]) > 1) continue;
+
+        for (int o = head[p][nc]; o >= 0 && ! dup; o = next[p][o])
+        {
+          dup = params.close(o, iseed);
+        }
+      }
+    }
+    if (dup) continue;
+
+    for (int p = 0; p < 3; ++p)
+    {
+      next[p][iseed] = head[p][cell[p][iseed]];
+      head[p][cell[p][iseed]] = iseed;
+    }
+    keep[iseed] = 1;
+  }
+
+  // Survivors keep their order from road search.
+  int n_kept = 0;
+  for (int iseed = 0; iseed < n_seeds; ++iseed)
+  {
+    if (keep[iseed]) seed_idcs[n_kept++] = seed_idcs[iseed];
+  }
+  seed_idcs.resize(n_kept);
 }
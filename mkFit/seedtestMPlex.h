@@ -5,6 +5,10 @@
 #include "Track.h"
 #include "HitStructures.h"
 
-void findSeedsByRoadSearch(TripletIdxConVec & seed_idcs, std::vector<LayerOfHits>& evt_lay_hits, int lay1_size, Event *& ev);
+void findSeedsByRoadSearch(TripletIdxVec & seed_idcs, std::vector<LayerOfHits>& evt_lay_hits, int lay1_size, Event *& ev);
+
+// Drops duplicate road search seeds if Config::cleanSeeds, the remaining ones
+// keep their order.
+void cleanSeedsByRoadSearch(TripletIdxVec & seed_idcs, std::vector<LayerOfHits>& evt_lay_hits);
 
 #endif
@@ -16,7 +16,7 @@ void buildSeedsByMC(const TrackVec& evt_sim_tracks, TrackVec& evt_seed_tracks, T
 
   for (int itrack=0;itrack<evt_sim_tracks.size();++itrack) {
     const Track& trk = evt_sim_tracks[itrack];
-    int   seedhits[Config::nLayers];
+    int   seedhits[Config::nMaxLayers];
     float sumchi2 = 0;
 
     TrackState updatedState;